@@ -0,0 +1,5 @@
+@echo off
+g++ run_benchmark.cpp -O2 -std=c++11 -o benchmark_simplyp.exe -fmax-errors=5 -luuid -lole32 -loleaut32
+g++ run_benchmark.cpp -O2 -std=c++11 -DBENCHMARK_INCAN -o benchmark_incan.exe -fmax-errors=5 -luuid -lole32 -loleaut32
+g++ run_benchmark.cpp -O2 -std=c++11 -DBENCHMARK_BRANCHED -o benchmark_branched.exe -fmax-errors=5 -luuid -lole32 -loleaut32
+g++ run_benchmark.cpp -O2 -std=c++11 -DBENCHMARK_BRANCHED -DMOBIUS_THREAD_COUNT=4 -o benchmark_branched_4threads.exe -fmax-errors=5 -luuid -lole32 -loleaut32
@@ -1,2 +1,3 @@
 @echo off
-g++ hardcode_test.cpp -O2 -std=c++11 -fno-exceptions -o test.exe -fmax-errors=5 -luuid -lole32 -loleaut32
\ No newline at end of file
+g++ hardcode_test.cpp -O2 -std=c++11 -fno-exceptions -o test.exe -fmax-errors=5 -luuid -lole32 -loleaut32
+g++ regression_tests.cpp -O2 -std=c++11 -o regression_tests.exe -fmax-errors=5 -luuid -lole32 -loleaut32
@@ -0,0 +1,57 @@
+
+# Compares the native ensemble runner (mobius.Ensemble) with the joblib-threaded copy/set/run loop that simple_monte_carlo.py uses, for SimplyP on the Tarland setup. Both use one thread per core.
+# Usage: python ensemble_benchmark.py <path to simplyp dll> [number of parameter sets]
+# The dll has to be compiled from Applications/SimplyP/simplyp_dll.cpp.
+
+import sys
+import os
+import time
+import numpy as np
+from joblib import Parallel, delayed
+
+wrapper_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'PythonWrapper')
+tarland_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'Applications', 'SimplyP', 'Tarland')
+sys.path.append(wrapper_path)
+
+import mobius
+
+mobius.initialize(sys.argv[1])
+nsamples = int(sys.argv[2]) if len(sys.argv) > 2 else 1000
+
+dataset = mobius.DataSet.setup_from_parameter_and_input_files(os.path.join(tarland_path, 'TarlandParameters_v0-4.dat'), os.path.join(tarland_path, 'TarlandInputs.dat'))
+
+parameters = [('Baseflow index', []), ('Soil field capacity', ['Arable']), ('Groundwater time constant', [])]
+ranges     = [(0.5, 0.9), (100.0, 300.0), (30.0, 100.0)]
+results    = [('Reach flow (daily mean, cumecs)', ['Coull'])]
+
+matrix = np.column_stack([np.random.uniform(lo, hi, nsamples) for lo, hi in ranges])
+
+def evaluate(row) :
+	ds = dataset.copy(copyresults=False, borrowinputs=True)
+	for (name, indexes), value in zip(parameters, row) :
+		ds.set_parameter_double(name, indexes, value)
+	ds.run_model()
+	series = [ds.get_result_series(name, indexes) for name, indexes in results]
+	ds.delete()
+	return series
+
+start = time.perf_counter()
+loop_results = np.array(Parallel(n_jobs=-1, backend="threading")(map(delayed(evaluate), [matrix[j, :] for j in range(nsamples)])))
+loop_time = time.perf_counter() - start
+
+start = time.perf_counter()
+ensemble = mobius.Ensemble(dataset, parameters, results, thread_count=os.cpu_count())
+ensemble_results, _ = ensemble.run(matrix)
+ensemble_time = time.perf_counter() - start
+
+#NOTE: A reused ensemble does not have to set up its run contexts again.
+start = time.perf_counter()
+ensemble.run(matrix)
+reused_time = time.perf_counter() - start
+ensemble.delete()
+
+print('%d parameter sets, %d timesteps' % (nsamples, ensemble_results.shape[2]))
+print('joblib threaded loop : %.3f s (%.3f ms per run)' % (loop_time, 1000.0*loop_time/nsamples))
+print('Ensemble             : %.3f s (%.3f ms per run)' % (ensemble_time, 1000.0*ensemble_time/nsamples))
+print('Ensemble, reused     : %.3f s (%.3f ms per run)' % (reused_time, 1000.0*reused_time/nsamples))
+print('Results are identical : %s' % np.array_equal(loop_results, ensemble_results))
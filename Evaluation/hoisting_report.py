@@ -0,0 +1,44 @@
+
+# Reports how much of each given application is evaluated before the time loop of a model run instead of inside it, and how much only once per index tuple (see FindHoistedEquations in Src/mobius_model_run.h), and the run time with the current dll.
+# Usage: python hoisting_report.py <dll> <parameter file> <input file> [<dll> <parameter file> <input file> ...]
+# Example: python hoisting_report.py simplyp.dll ../Applications/SimplyP/Tarland/TarlandParameters_v0-4.dat ../Applications/SimplyP/Tarland/TarlandInputs.dat
+# Compile the dlls with MOBIUS_HOIST_EQUATIONS=0 to compare the run time with hoisting turned off.
+# Each application is run in its own process, since a process can only load one model dll through the wrapper.
+
+import sys
+import os
+import time
+import subprocess
+
+wrapper_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'PythonWrapper')
+sys.path.append(wrapper_path)
+
+def report(dll, parfile, inputfile, runs=10) :
+	import mobius
+	mobius.initialize(dll)
+
+	dataset = mobius.DataSet.setup_from_parameter_and_input_files(parfile, inputfile)
+	hoisting = dataset.get_hoisting_report()
+
+	dataset.run_model()
+	start = time.perf_counter()
+	for run in range(runs) :
+		dataset.run_model()
+	ms = 1000.0*(time.perf_counter() - start)/runs
+
+	print('%s' % os.path.basename(dll))
+	print('  hoisted equations : %d of %d (%.1f%%)' % (hoisting['hoisted_equations'], hoisting['equations'], 100.0*hoisting['hoisted_equations']/max(hoisting['equations'], 1)))
+	print('  hoisted results   : %d of %d per timestep (%.1f%%)' % (hoisting['hoisted_results'], hoisting['results'], 100.0*hoisting['hoisted_results']/max(hoisting['results'], 1)))
+	print('  constant equations: %d of %d (%.1f%%), %d values per run' % (hoisting['constant_equations'], hoisting['equations'], 100.0*hoisting['constant_equations']/max(hoisting['equations'], 1), hoisting['constant_results']))
+	print('  run time          : %.2f ms' % ms)
+	dataset.delete()
+
+if len(sys.argv) == 4 :
+	report(sys.argv[1], sys.argv[2], sys.argv[3])
+else :
+	args = sys.argv[1:]
+	if len(args) == 0 or len(args) % 3 != 0 :
+		print('Usage: python hoisting_report.py <dll> <parameter file> <input file> [<dll> <parameter file> <input file> ...]')
+		sys.exit(1)
+	for idx in range(0, len(args), 3) :
+		subprocess.call([sys.executable, os.path.abspath(__file__)] + args[idx:idx+3])
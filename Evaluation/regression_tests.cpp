@@ -0,0 +1,251 @@
+//NOTE: Regression tests for behaviour of the engine and the data set API that is easy to break without changing the benchmark checksums. They run SimplyP on the Tarland setup.
+//  Each test prints whether it passed, and the program returns 1 if any of them failed.
+//  Usage (from the Evaluation folder): regression_tests.exe
+
+#define MOBIUS_TIMESTEP_VERBOSITY 0
+#define MOBIUS_TEST_FOR_NAN 0
+#define MOBIUS_EQUATION_PROFILING 0
+#define MOBIUS_PRINT_TIMING_INFO 0
+#define MOBIUS_INDEX_BOUNDS_TESTS 0
+
+#include "../mobius.h"
+
+#include "../Modules/PET.h"
+#include "../Modules/Simply/SimplySnow.h"
+#define SIMPLYQ_GROUNDWATER
+#include "../Modules/Simply/SimplyQ.h"
+#include "../Modules/Simply/SimplySed.h"
+#include "../Modules/Simply/SimplyP.h"
+
+#define TEST_INPUT_FILE     "../Applications/SimplyP/Tarland/TarlandInputs.dat"
+#define TEST_PARAMETER_FILE "../Applications/SimplyP/Tarland/TarlandParameters_v0-4.dat"
+
+static mobius_model *
+BuildTestModel()
+{
+	mobius_model *Model = BeginModelDefinition("SimplyP", true);
+
+	AddThornthwaitePETModule(Model);
+	AddSimplySnowModule(Model);
+	AddSimplyHydrologyModule(Model);
+	AddSimplySedimentModule(Model);
+	AddSimplyPModel(Model);
+
+	ReadInputDependenciesFromFile(Model, TEST_INPUT_FILE);
+
+	EndModelDefinition(Model);
+
+	return Model;
+}
+
+static mobius_data_set *
+SetupTestDataSet(mobius_model *Model)
+{
+	mobius_data_set *DataSet = GenerateDataSet(Model);
+	ReadParametersFromFile(DataSet, TEST_PARAMETER_FILE);
+	ReadInputsFromFile(DataSet, TEST_INPUT_FILE);
+	return DataSet;
+}
+
+static int FailedTests = 0;
+
+static void
+ReportTest(const char *Name, bool Passed)
+{
+	std::cout << (Passed ? "PASSED " : "FAILED ") << Name << std::endl;
+	if(!Passed) ++FailedTests;
+}
+
+static void
+TestShortInputSeries(mobius_model *Model)
+{
+	//NOTE: SetInputSeries with a series that is shorter than the input storage has to set the timesteps after the end of the series to NaN (missing), and must not read past the end of the series.
+	mobius_data_set *DataSet = SetupTestDataSet(Model);
+
+	size_t Length = 100;
+	std::vector<double> Buffer(Length + 1);
+	for(size_t Idx = 0; Idx < Length; ++Idx) Buffer[Idx] = (double)Idx;
+	Buffer[Length] = 12345.0; //NOTE: Not part of the series.
+
+	SetInputSeries(DataSet, "Precipitation", {}, Buffer.data(), Length);
+
+	std::vector<double> Stored(DataSet->InputDataTimesteps);
+	GetInputSeries(DataSet, "Precipitation", {}, Stored.data(), Stored.size());
+
+	bool Passed = true;
+	for(size_t Idx = 0; Idx < Stored.size(); ++Idx)
+	{
+		if(Idx < Length) Passed = Passed && (Stored[Idx] == (double)Idx);
+		else             Passed = Passed && std::isnan(Stored[Idx]);
+	}
+	ReportTest("SetInputSeries with a short series", Passed);
+
+	delete DataSet;
+}
+
+static void
+TestRunAfterCheckpointResume(mobius_model *Model)
+{
+	//NOTE: Resuming from a checkpoint must only run the rest of the run, and must not change the data set, so that the next full run (or run to a checkpoint) covers all the timesteps again and gives the same results as before.
+	mobius_data_set *DataSet = SetupTestDataSet(Model);
+	const char *ResultName = "Reach flow (daily mean, cumecs)";
+	const char *Reach = "Coull";
+	u64 CheckpointStep = 300;
+
+	RunModel(DataSet);
+	u64 Timesteps = DataSet->TimestepsLastRun;
+	datetime StartDate = GetStartDate(DataSet);
+	std::vector<double> Full(Timesteps);
+	GetResultSeries(DataSet, ResultName, {Reach}, Full.data(), Full.size());
+
+	model_checkpoint Checkpoint;
+	RunModelToCheckpoint(DataSet, CheckpointStep, &Checkpoint);
+	RunModelFromCheckpoint(DataSet, &Checkpoint);
+
+	bool Passed = (DataSet->TimestepsLastRun == Timesteps - CheckpointStep);
+	std::vector<double> Resumed(Timesteps - CheckpointStep);
+	GetResultSeries(DataSet, ResultName, {Reach}, Resumed.data(), Resumed.size());
+	Passed = Passed && std::equal(Resumed.begin(), Resumed.end(), Full.begin() + CheckpointStep);
+	ReportTest("RunModelFromCheckpoint continues the run", Passed);
+
+	Passed = (GetStartDate(DataSet).SecondsSinceEpoch == StartDate.SecondsSinceEpoch);
+	RunModel(DataSet);
+	Passed = Passed && (DataSet->TimestepsLastRun == Timesteps);
+	std::vector<double> Rerun(Timesteps);
+	GetResultSeries(DataSet, ResultName, {Reach}, Rerun.data(), Rerun.size());
+	Passed = Passed && (Rerun == Full);
+	ReportTest("RunModel after RunModelFromCheckpoint runs all the timesteps", Passed);
+
+	model_checkpoint Again;
+	RunModelToCheckpoint(DataSet, CheckpointStep, &Again);
+	Passed = (DataSet->TimestepsLastRun == CheckpointStep) && (Again.Results == Checkpoint.Results) && (Again.Time.SecondsSinceEpoch == Checkpoint.Time.SecondsSinceEpoch);
+	ReportTest("RunModelToCheckpoint after RunModelFromCheckpoint", Passed);
+
+	delete DataSet;
+}
+
+static void
+TestIncrementalRunAfterInputChange(mobius_model *Model)
+{
+	//NOTE: An incremental run has to reuse all the results if nothing changed (also when a preprocessing step writes the same input series again), and has to reevaluate everything after an input series was changed.
+	mobius_data_set *DataSet = SetupTestDataSet(Model);
+	const char *ResultName = "Reach flow (daily mean, cumecs)";
+	const char *Reach = "Coull";
+
+	SetIncrementalRuns(DataSet, true);
+	RunModel(DataSet);
+	RunModel(DataSet);
+	const incremental_run_report &Report = DataSet->IncrementalRunReport;
+	ReportTest("Incremental run without changes reuses the results", Report.BatchGroupsSkipped == Report.BatchGroupCount);
+
+	std::vector<double> Precipitation(DataSet->InputDataTimesteps);
+	GetInputSeries(DataSet, "Precipitation", {}, Precipitation.data(), Precipitation.size());
+	for(double &Value : Precipitation) Value *= 1.5;
+	SetInputSeries(DataSet, "Precipitation", {}, Precipitation.data(), Precipitation.size());
+	RunModel(DataSet);
+	bool Passed = (Report.BatchGroupsSkipped == 0);
+
+	mobius_data_set *Full = SetupTestDataSet(Model);
+	SetInputSeries(Full, "Precipitation", {}, Precipitation.data(), Precipitation.size());
+	RunModel(Full);
+	std::vector<double> Incremental(DataSet->TimestepsLastRun);
+	std::vector<double> Expected(Full->TimestepsLastRun);
+	GetResultSeries(DataSet, ResultName, {Reach}, Incremental.data(), Incremental.size());
+	GetResultSeries(Full, ResultName, {Reach}, Expected.data(), Expected.size());
+	Passed = Passed && (Incremental == Expected);
+	ReportTest("Incremental run after SetInputSeries reevaluates", Passed);
+
+	delete Full;
+	delete DataSet;
+}
+
+static void
+TestThreadPoolRestart()
+{
+	//NOTE: A pool that is started again after it has run a job must not let the new workers run before the next Run, and every worker has to take part in each Run exactly once.
+	thread_pool Pool;
+	std::atomic<size_t> Calls(0);
+	auto Job = [&Calls](size_t) { ++Calls; };
+
+	Pool.Start(2);
+	Pool.Run(Job);
+	bool Passed = (Calls == 2);
+
+	Pool.Start(3);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	Passed = Passed && (Calls == 2);
+	Pool.Run(Job);
+	Passed = Passed && (Calls == 5);
+	Pool.Run(Job);
+	Passed = Passed && (Calls == 8);
+	ReportTest("Thread pool restarted after it ran a job", Passed);
+}
+
+static void
+WriteTestSeries(FILE *File, const char *Name, size_t Timesteps, double Scale)
+{
+	fprintf(File, "\"%s\" :\n", Name);
+	for(size_t Idx = 0; Idx < Timesteps; ++Idx)
+		fprintf(File, "%g\n", (double)(Idx % 1000) * Scale);
+	fprintf(File, "\n");
+}
+
+static void
+TestInputFileWithInclude(mobius_model *Model)
+{
+	//NOTE: The values of the input series are parsed on several threads in one go for each file (see ParseInputSeriesBlocks), so an include_file makes the parser parse the series of the main file, and then later the ones of the included file, on the same thread pool.
+	const char *MainFile     = "regression_include_main.dat";
+	const char *IncludedFile = "regression_include_included.dat";
+	const char *Names[5]     = {"Air temperature", "Precipitation", "observed Q", "observed SS", "observed TDP"};
+	size_t Timesteps = 150000;  //NOTE: Enough that each series is over 1MB, so that they are parsed on several threads.
+	
+	FILE *File = OpenFile(MainFile, "w");
+	fprintf(File, "start_date : 1981-01-01\ntimesteps : %d\n\ninputs :\n\n", (int)Timesteps);
+	WriteTestSeries(File, Names[0], Timesteps, 0.25);
+	WriteTestSeries(File, Names[1], Timesteps, 0.5);
+	fprintf(File, "include_file \"%s\"\n", IncludedFile);
+	fclose(File);
+	File = OpenFile(IncludedFile, "w");
+	for(size_t Idx = 2; Idx < 5; ++Idx)
+		WriteTestSeries(File, Names[Idx], Timesteps, 0.125*(double)Idx);
+	fclose(File);
+	
+	mobius_data_set *DataSet = GenerateDataSet(Model);
+	ReadParametersFromFile(DataSet, TEST_PARAMETER_FILE);
+	DataSet->InputThreadCount = 4;
+	ReadInputsFromFile(DataSet, MainFile);
+	
+	bool Passed = (DataSet->InputDataTimesteps == Timesteps);
+	std::vector<double> Stored(Timesteps);
+	for(size_t Idx = 0; Idx < 5 && Passed; ++Idx)
+	{
+		double Scale = (Idx == 0) ? 0.25 : (Idx == 1 ? 0.5 : 0.125*(double)Idx);
+		GetInputSeries(DataSet, Names[Idx], {}, Stored.data(), Stored.size());
+		for(size_t Step = 0; Step < Timesteps; ++Step)
+			Passed = Passed && (Stored[Step] == (double)(Step % 1000) * Scale);
+	}
+	ReportTest("Input file with include_file parsed on several threads", Passed);
+	
+	delete DataSet;
+	remove(MainFile);
+	remove(IncludedFile);
+}
+
+int main()
+{
+	mobius_model *Model = BuildTestModel();
+
+	TestShortInputSeries(Model);
+	TestRunAfterCheckpointResume(Model);
+	TestIncrementalRunAfterInputChange(Model);
+	TestThreadPoolRestart();
+	TestInputFileWithInclude(Model);
+
+	if(FailedTests > 0)
+	{
+		std::cout << FailedTests << " tests failed" << std::endl;
+		return 1;
+	}
+	std::cout << "All tests passed" << std::endl;
+	return 0;
+}
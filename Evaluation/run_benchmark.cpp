@@ -0,0 +1,378 @@
+
+
+//NOTE: Timing harness for the generic model run engine. This is used to compare the performance of the engine before and after changes to the run loop, not to test model correctness.
+//  By default it times SimplyP on the Tarland setup. Compile with -DBENCHMARK_INCAN to instead time INCA-N on the Tovdal setup.
+//  Compile with -DBENCHMARK_BRANCHED to instead time SimplyP on a synthetic network of 1000 reaches (a binary tree with the Tarland parameters for every reach) for 100 timesteps. Use -DMOBIUS_THREAD_COUNT=<n> to evaluate independent index tuples and reaches in parallel. The checksum should not depend on the thread count.
+//  Compile with -DBENCHMARK_COMPRESSION to also compare compressed result storage (see SetCompressedResults) to the full result storage: the compression ratio, the run time, and the throughput of extracting every result series. Combine with -DBENCHMARK_INCAN for the Tovdal setup.
+//  Compile with -DBENCHMARK_EXTRACTION to also time reading out every result series of the last run with GetResultSeries, both from the timestep-major result storage and from the series-major one (see SetSeriesMajorResults). Combine with -DBENCHMARK_INCAN for the Tovdal setup.
+//  Compile with -DBENCHMARK_INPUT_LOADING to also time loading a large input file (the inputs of the setup repeated 50 times) in the .dat format and in the binary format (see WriteInputsToBinaryFile). The files are written to the working directory and deleted afterwards. Combine with -DBENCHMARK_INCAN for the Tovdal setup.
+//  Compile with -DBENCHMARK_INPUT_PARSING to also time parsing a generated .dat input file of about 500 MB (the inputs of the setup repeated) with ReadInputsFromFile, on one thread and on one thread per hardware thread (see mobius_data_set::InputThreadCount). The file is written to the working directory and deleted afterwards. Combine with -DBENCHMARK_INCAN for the Tovdal setup, which has more input series.
+//  Usage: benchmark.exe [run count]
+
+#define MOBIUS_TIMESTEP_VERBOSITY 0
+#define MOBIUS_TEST_FOR_NAN 0
+#define MOBIUS_EQUATION_PROFILING 0
+#define MOBIUS_PRINT_TIMING_INFO 0
+#define MOBIUS_INDEX_BOUNDS_TESTS 0
+
+#if defined(BENCHMARK_BRANCHED) && defined(BENCHMARK_INCAN)
+#error "BENCHMARK_BRANCHED is only implemented for SimplyP"
+#endif
+
+#include "../mobius.h"
+
+#if defined(BENCHMARK_INCAN)
+
+#include "../Modules/INCA/Old/Persist_0_3.h"
+#include "../Modules/SoilTemperature.h"
+#include "../Modules/WaterTemperature.h"
+#include "../Modules/INCA/INCA-N.h"
+
+#define BENCHMARK_INPUT_FILE     "../Applications/IncaN/Tovdal/tovdalinputs.dat"
+#define BENCHMARK_PARAMETER_FILE "../Applications/IncaN/Tovdal/tovdalparameters.dat"
+
+static mobius_model *
+BuildBenchmarkModel()
+{
+	mobius_model *Model = BeginModelDefinition("INCA-N");
+
+	AddPersistModel(Model);
+	AddSoilTemperatureModel(Model);
+	AddWaterTemperatureModel(Model);
+	AddIncaNModel(Model);
+
+	return Model;
+}
+
+#else
+
+#include "../Modules/PET.h"
+#include "../Modules/Simply/SimplySnow.h"
+#define SIMPLYQ_GROUNDWATER
+#include "../Modules/Simply/SimplyQ.h"
+#include "../Modules/Simply/SimplySed.h"
+#include "../Modules/Simply/SimplyP.h"
+
+#define BENCHMARK_INPUT_FILE     "../Applications/SimplyP/Tarland/TarlandInputs.dat"
+#define BENCHMARK_PARAMETER_FILE "../Applications/SimplyP/Tarland/TarlandParameters_v0-4.dat"
+
+static mobius_model *
+BuildBenchmarkModel()
+{
+	mobius_model *Model = BeginModelDefinition("SimplyP", true);
+
+	AddThornthwaitePETModule(Model);
+	AddSimplySnowModule(Model);
+	AddSimplyHydrologyModule(Model);
+	AddSimplySedimentModule(Model);
+	AddSimplyPModel(Model);
+
+	return Model;
+}
+
+#endif
+
+#if defined(BENCHMARK_BRANCHED)
+static mobius_data_set *
+SetupBranchedDataSet(mobius_model *Model, u32 ReachCount)
+{
+	//NOTE: Reach number ReachCount-1-J in the network drains into reach number ReachCount-1-(J-1)/2, so that the network is a binary tree with the outlet as the last reach and with about log2(ReachCount) topological levels.
+	
+	mobius_data_set *Tarland = GenerateDataSet(Model);
+	ReadParametersFromFile(Tarland, BENCHMARK_PARAMETER_FILE);
+	
+	index_set_h Reaches = GetIndexSetHandle(Model, "Reaches");
+	index_set_h LandscapeUnits = GetIndexSetHandle(Model, "Landscape units");
+	
+	std::vector<std::string> ReachNames(ReachCount);
+	for(u32 Reach = 0; Reach < ReachCount; ++Reach)
+		ReachNames[Reach] = "Reach " + std::to_string(Reach);
+	
+	std::vector<std::pair<token_string, std::vector<token_string>>> Network(ReachCount);
+	for(u32 Reach = 0; Reach < ReachCount; ++Reach)
+	{
+		Network[Reach].first = ReachNames[Reach].data();
+		u32 J = ReachCount - 1 - Reach;
+		for(u32 Child = 2*J + 1; Child <= 2*J + 2 && Child < ReachCount; ++Child)
+			Network[Reach].second.push_back(ReachNames[ReachCount - 1 - Child].data());
+	}
+	//NOTE: SetBranchIndexes requires the inputs of a reach to be declared before it, and they are since Child > J.
+	
+	std::vector<token_string> LandscapeUnitNames;
+	for(u32 LU = 0; LU < Tarland->IndexCounts[LandscapeUnits.Handle].Index; ++LU)
+		LandscapeUnitNames.push_back(Tarland->IndexNames[LandscapeUnits.Handle][LU]);
+	
+	mobius_data_set *DataSet = GenerateDataSet(Model);
+	SetBranchIndexes(DataSet, "Reaches", Network);
+	SetIndexes(DataSet, "Landscape units", LandscapeUnitNames);
+	AllocateParameterStorage(DataSet);
+	
+	//NOTE: Every reach gets the parameter values of the single Tarland reach.
+	for(parameter_h Parameter : Model->Parameters)
+	{
+		ForeachParameterInstance(DataSet, Parameter, [DataSet, Tarland, Parameter, Reaches](index_t *Indexes, size_t IndexesCount)
+		{
+			std::vector<index_t> TarlandIndexes(Indexes, Indexes + IndexesCount);
+			for(index_t &Index : TarlandIndexes)
+				if(Index.IndexSetHandle == Reaches.Handle) Index.Index = 0;
+			
+			size_t Offset        = OffsetForHandle(DataSet->ParameterStorageStructure, Indexes, IndexesCount, DataSet->IndexCounts, Parameter);
+			size_t TarlandOffset = OffsetForHandle(Tarland->ParameterStorageStructure, TarlandIndexes.data(), IndexesCount, Tarland->IndexCounts, Parameter);
+			DataSet->ParameterData[Offset] = Tarland->ParameterData[TarlandOffset];
+		});
+	}
+	delete Tarland;
+	
+	//NOTE: Keep the result storage at a reasonable size.
+	SetParameterValue(DataSet, "End date", {}, "2004-04-09");
+	
+	return DataSet;
+}
+#endif
+
+
+int main(int argc, char **argv)
+{
+	int RunCount = 50;
+	if(argc > 1) RunCount = atoi(argv[1]);
+
+	mobius_model *Model = BuildBenchmarkModel();
+
+	input_file_header InputHeader;
+	ReadInputFileHeader(&InputHeader, Model, BENCHMARK_INPUT_FILE);
+	ReadInputDependenciesFromFile(Model, &InputHeader);
+
+	EndModelDefinition(Model);
+
+#if defined(BENCHMARK_BRANCHED)
+	mobius_data_set *DataSet = SetupBranchedDataSet(Model, 1000);
+#else
+	mobius_data_set *DataSet = GenerateDataSet(Model);
+
+	ReadParametersFromFile(DataSet, BENCHMARK_PARAMETER_FILE);
+#endif
+	ReadInputsFromFile(DataSet, &InputHeader);
+
+	RunModel(DataSet); //NOTE: Warm-up run, so that the first timed run does not pay for page faults in the input data.
+
+	timer Timer = BeginTimer();
+	for(int Run = 0; Run < RunCount; ++Run)
+		RunModel(DataSet);
+	u64 Ms = GetTimerMilliseconds(&Timer);
+
+	u64 Timesteps = DataSet->TimestepsLastRun;
+	std::cout << Model->Name << ": " << RunCount << " runs of " << Timesteps << " timesteps took " << Ms << " milliseconds (" << (double)Ms / (double)RunCount << " ms per run)." << std::endl;
+	
+	//NOTE: Checksum of the raw result bits, so that one can verify that an optimization did not change the results.
+	u64 Checksum = 0;
+	size_t ResultCount = DataSet->ResultStorageStructure.TotalCount * (Timesteps + 1);
+	for(size_t Idx = 0; Idx < ResultCount; ++Idx)
+	{
+		u64 Bits;
+		memcpy(&Bits, &DataSet->ResultData[Idx], sizeof(u64));
+		Checksum = (Checksum ^ Bits) * 1099511628211ull;
+	}
+	std::cout << "Result checksum: " << std::hex << Checksum << std::dec << std::endl;
+	
+#if defined(BENCHMARK_EXTRACTION)
+	std::vector<double> Series(Timesteps);
+	auto ExtractAll = [DataSet, Model, &Series](size_t *SeriesCount) -> double
+	{
+		double Sum = 0.0; //NOTE: So that the extraction is not optimized away.
+		*SeriesCount = 0;
+		for(equation_h Equation : Model->Equations)
+		{
+			if(Model->Equations[Equation].Type == EquationType_InitialValue) continue;
+			const char *Name = GetName(Model, Equation);
+			ForeachResultInstance(DataSet, Name, [DataSet, Name, &Series, &Sum, SeriesCount](const char *const *IndexNames, size_t IndexesCount)
+			{
+				GetResultSeries(DataSet, Name, IndexNames, IndexesCount, Series.data(), Series.size());
+				Sum += Series[Series.size() / 2];
+				++*SeriesCount;
+			});
+		}
+		return Sum;
+	};
+	
+	int ExtractCount = Max(RunCount, 1);
+	size_t SeriesCount;
+	double Sum = 0.0;
+	Timer = BeginTimer();
+	for(int Extract = 0; Extract < ExtractCount; ++Extract)
+		Sum += ExtractAll(&SeriesCount);
+	u64 TimestepMajorUs = GetTimerMicroseconds(&Timer);
+	
+	Timer = BeginTimer();
+	SetSeriesMajorResults(DataSet, true);
+	u64 TransposeUs = GetTimerMicroseconds(&Timer);
+	
+	Timer = BeginTimer();
+	for(int Extract = 0; Extract < ExtractCount; ++Extract)
+		Sum -= ExtractAll(&SeriesCount);
+	u64 SeriesMajorUs = GetTimerMicroseconds(&Timer);
+	
+	std::cout << "Extracting all " << SeriesCount << " result series: " << (double)TimestepMajorUs / (1000.0*ExtractCount) << " ms timestep-major, " << (double)SeriesMajorUs / (1000.0*ExtractCount) << " ms series-major (the transposition took " << (double)TransposeUs / 1000.0 << " ms). Difference in sums: " << Sum << std::endl;
+#endif
+
+#if defined(BENCHMARK_COMPRESSION)
+	{
+		//NOTE: Compares compressed result storage (see SetCompressedResults) to the full result storage of the runs above: the memory used, the run time, the time it takes to extract every series, and that the extracted series are the same.
+		std::vector<double> Series(Timesteps);
+		std::vector<double> FullSeries;
+		auto ExtractEvery = [DataSet, Model, &Series](std::vector<double> *Collect) -> size_t
+		{
+			size_t SeriesCount = 0;
+			for(equation_h Equation : Model->Equations)
+			{
+				if(Model->Equations[Equation].Type == EquationType_InitialValue) continue;
+				const char *Name = GetName(Model, Equation);
+				ForeachResultInstance(DataSet, Name, [DataSet, Name, &Series, Collect, &SeriesCount](const char *const *IndexNames, size_t IndexesCount)
+				{
+					GetResultSeries(DataSet, Name, IndexNames, IndexesCount, Series.data(), Series.size());
+					if(Collect) Collect->insert(Collect->end(), Series.begin(), Series.end());
+					++SeriesCount;
+				});
+			}
+			return SeriesCount;
+		};
+		
+		SetSeriesMajorResults(DataSet, false);
+		RunModel(DataSet);
+		int ExtractCount = Max(RunCount, 1);
+		Timer = BeginTimer();
+		for(int Extract = 0; Extract < ExtractCount; ++Extract)
+			ExtractEvery(nullptr);
+		u64 FullExtractUs = GetTimerMicroseconds(&Timer);
+		size_t SeriesCount = ExtractEvery(&FullSeries);
+		
+		SetCompressedResults(DataSet, true, 64);
+		Timer = BeginTimer();
+		for(int Run = 0; Run < RunCount; ++Run)
+			RunModel(DataSet);
+		u64 CompressedMs = GetTimerMilliseconds(&Timer);
+		
+		Timer = BeginTimer();
+		for(int Extract = 0; Extract < ExtractCount; ++Extract)
+			ExtractEvery(nullptr);
+		u64 CompressedExtractUs = GetTimerMicroseconds(&Timer);
+		std::vector<double> CompressedSeries;
+		ExtractEvery(&CompressedSeries);
+		bool Same = (CompressedSeries.size() == FullSeries.size()) && memcmp(CompressedSeries.data(), FullSeries.data(), sizeof(double)*FullSeries.size()) == 0;
+		
+		const compressed_results &Compressed = DataSet->CompressedResults;
+		double RawBytes        = (double)(Compressed.SeriesCount * (Timesteps + 1) * sizeof(double));
+		double CompressedBytes = (double)(Compressed.BitCount / 8 + Compressed.BlockStarts.size()*sizeof(u64) + Compressed.BlockRows.size()*sizeof(u32));
+		double ExtractedMB     = (double)(SeriesCount * Timesteps * sizeof(double)) / (1024.0*1024.0);
+		
+		std::cout << "Compressed results (blocks of 64 timesteps): " << RawBytes / (1024.0*1024.0) << " MB compressed to " << CompressedBytes / (1024.0*1024.0) << " MB (ratio " << RawBytes / CompressedBytes << "), " << (double)CompressedMs / (double)RunCount << " ms per run." << std::endl;
+		std::cout << "Extracting all " << SeriesCount << " result series: " << (double)FullExtractUs / (1000.0*ExtractCount) << " ms from full storage (" << ExtractedMB * ExtractCount / ((double)FullExtractUs * 1e-6) << " MB/s), " << (double)CompressedExtractUs / (1000.0*ExtractCount) << " ms compressed (" << ExtractedMB * ExtractCount / ((double)CompressedExtractUs * 1e-6) << " MB/s). Same series: " << (Same ? "yes" : "NO") << std::endl;
+	}
+#endif
+
+#if defined(BENCHMARK_INPUT_LOADING)
+	{
+		//NOTE: Makes an input set that is 50 times as long as the one of the setup, and times how long it takes to load it from a .dat file and from a binary input file. The loading time includes reading every input value once, since the binary file is mapped into memory and only read when the values are used.
+		const u64 Repeat = 50;
+		const char *TextFile   = "benchmark_inputs_large.dat";
+		const char *BinaryFile = "benchmark_inputs_large.bin";
+		
+		mobius_data_set *Large = GenerateDataSet(Model);
+		ReadParametersFromFile(Large, BENCHMARK_PARAMETER_FILE);
+		Large->InputDataStartDate            = DataSet->InputDataStartDate;
+		Large->InputDataHasSeparateStartDate = DataSet->InputDataHasSeparateStartDate;
+		AllocateInputStorage(Large, DataSet->InputDataTimesteps * Repeat);
+		size_t ValuesPerRow = DataSet->InputStorageStructure.TotalCount;
+		for(u64 Row = 0; Row < Large->InputDataTimesteps; ++Row)
+			memcpy(Large->InputData + Row*ValuesPerRow, DataSet->InputData + (Row % DataSet->InputDataTimesteps)*ValuesPerRow, sizeof(double)*ValuesPerRow);
+		for(size_t Offset = 0; Offset < ValuesPerRow; ++Offset)
+			Large->InputTimeseriesWasProvided[Offset] = DataSet->InputTimeseriesWasProvided[Offset];
+		
+		WriteInputsToFile(Large, TextFile);
+		WriteInputsToBinaryFile(Large, BinaryFile);
+		
+		double Sum = 0.0; //NOTE: So that reading the values is not optimized away.
+		auto TimeLoading = [Model, Large, &Sum](const char *Filename, bool *Same) -> u64
+		{
+			mobius_data_set *Loaded = GenerateDataSet(Model);
+			ReadParametersFromFile(Loaded, BENCHMARK_PARAMETER_FILE);
+			timer Timer = BeginTimer();
+			ReadInputsFromFile(Loaded, Filename);
+			size_t Count = Loaded->InputStorageStructure.TotalCount * Loaded->InputDataTimesteps;
+			for(size_t Idx = 0; Idx < Count; ++Idx)
+				if(!std::isnan(Loaded->InputData[Idx])) Sum += Loaded->InputData[Idx];
+			u64 Us = GetTimerMicroseconds(&Timer);
+			*Same = (Count == Large->InputStorageStructure.TotalCount * Large->InputDataTimesteps) && memcmp(Loaded->InputData, Large->InputData, sizeof(double)*Count) == 0;
+			delete Loaded;
+			return Us;
+		};
+		
+		bool TextSame, BinarySame; //NOTE: The .dat file is written with fewer digits, so the inputs loaded from it are not expected to be identical.
+		u64 TextUs   = TimeLoading(TextFile, &TextSame);
+		u64 BinaryUs = TimeLoading(BinaryFile, &BinarySame);
+		
+		std::cout << "Loading " << Large->InputDataTimesteps << " timesteps of inputs (" << ValuesPerRow << " values per timestep): " << (double)TextUs / 1000.0 << " ms from the .dat file, " << (double)BinaryUs / 1000.0 << " ms from the binary file (" << (double)TextUs / (double)BinaryUs << " times faster). Binary inputs are identical to the original: " << (BinarySame ? "yes" : "NO") << " (sum " << Sum << ")" << std::endl;
+		
+		delete Large;
+		remove(TextFile);
+		remove(BinaryFile);
+	}
+#endif
+
+#if defined(BENCHMARK_INPUT_PARSING)
+	{
+		//NOTE: Makes an input file of about 500 MB by repeating the inputs of the setup, and times how long it takes to read it with one thread and with all hardware threads. The inputs that are read should be identical.
+		const char *TextFile = "benchmark_inputs_parsing.dat";
+		const size_t TargetSize = 500*1024*1024;
+		
+		WriteInputsToFile(DataSet, TextFile);
+		FILE *File = OpenFile(TextFile, "rb");
+		fseek(File, 0, SEEK_END);
+		size_t SetupSize = ftell(File);
+		fclose(File);
+		u64 Repeat = (TargetSize + SetupSize - 1) / SetupSize;
+		
+		mobius_data_set *Large = GenerateDataSet(Model);
+		ReadParametersFromFile(Large, BENCHMARK_PARAMETER_FILE);
+		Large->InputDataStartDate            = DataSet->InputDataStartDate;
+		Large->InputDataHasSeparateStartDate = DataSet->InputDataHasSeparateStartDate;
+		AllocateInputStorage(Large, DataSet->InputDataTimesteps * Repeat);
+		size_t ValuesPerRow = DataSet->InputStorageStructure.TotalCount;
+		for(u64 Row = 0; Row < Large->InputDataTimesteps; ++Row)
+			memcpy(Large->InputData + Row*ValuesPerRow, DataSet->InputData + (Row % DataSet->InputDataTimesteps)*ValuesPerRow, sizeof(double)*ValuesPerRow);
+		for(size_t Offset = 0; Offset < ValuesPerRow; ++Offset)
+			Large->InputTimeseriesWasProvided[Offset] = DataSet->InputTimeseriesWasProvided[Offset];
+		WriteInputsToFile(Large, TextFile);
+		delete Large;
+		
+		File = OpenFile(TextFile, "rb");
+		fseek(File, 0, SEEK_END);
+		double FileMB = (double)ftell(File) / (1024.0*1024.0);
+		fclose(File);
+		
+		auto TimeParsing = [Model](const char *Filename, u32 InputThreadCount, mobius_data_set **Loaded) -> u64
+		{
+			*Loaded = GenerateDataSet(Model);
+			ReadParametersFromFile(*Loaded, BENCHMARK_PARAMETER_FILE);
+			(*Loaded)->InputThreadCount = InputThreadCount;
+			timer Timer = BeginTimer();
+			ReadInputsFromFile(*Loaded, Filename);
+			return GetTimerMicroseconds(&Timer);
+		};
+		
+		mobius_data_set *Serial, *Parallel;
+		u64 SerialUs   = TimeParsing(TextFile, 1, &Serial);
+		u64 ParallelUs = TimeParsing(TextFile, 0, &Parallel);
+		size_t Count = Serial->InputStorageStructure.TotalCount * Serial->InputDataTimesteps;
+		bool Same = memcmp(Serial->InputData, Parallel->InputData, sizeof(double)*Count) == 0;
+		
+		std::cout << "Parsing a " << FileMB << " MB input file (" << Serial->InputDataTimesteps << " timesteps, " << ValuesPerRow << " values per timestep): " << (double)SerialUs / 1000.0 << " ms on one thread (" << FileMB / ((double)SerialUs * 1e-6) << " MB/s), " << (double)ParallelUs / 1000.0 << " ms on " << std::max(std::thread::hardware_concurrency(), 1u) << " threads (" << FileMB / ((double)ParallelUs * 1e-6) << " MB/s). Same inputs: " << (Same ? "yes" : "NO") << std::endl;
+		
+		delete Serial;
+		delete Parallel;
+		remove(TextFile);
+	}
+#endif
+
+	delete DataSet;
+	delete Model;
+}
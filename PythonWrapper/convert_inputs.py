@@ -0,0 +1,32 @@
+
+# Converts a Mobius input file (.dat) to the binary input format, which loads without being parsed (see WriteInputsToBinaryFile in Src/mobius_io.h).
+# The binary file can be used anywhere the .dat file could, but only with the same model and with the same indexes for the index sets that the inputs depend on. Convert again if these change.
+# Usage: python convert_inputs.py <dll> <parameter file> <input file> <binary input file> [single]
+# Example: python convert_inputs.py simplyp.dll ../Applications/SimplyP/Tarland/TarlandParameters_v0-4.dat ../Applications/SimplyP/Tarland/TarlandInputs.dat TarlandInputs.bin
+# If 'single' is given, the values are stored in single precision (see set_single_precision_storage), which halves the size of the file.
+
+import sys
+import os
+
+wrapper_path = os.path.dirname(os.path.abspath(__file__))
+sys.path.append(wrapper_path)
+
+import mobius
+
+if len(sys.argv) < 5 or (len(sys.argv) == 6 and sys.argv[5] != 'single') or len(sys.argv) > 6 :
+	print('Usage: python convert_inputs.py <dll> <parameter file> <input file> <binary input file> [single]')
+	sys.exit(1)
+
+dll, parfile, inputfile, binaryfile = sys.argv[1:5]
+
+mobius.initialize(dll)
+
+dataset = mobius.DataSet.setup_with_blank_index_sets(inputfile)
+if len(sys.argv) == 6 :
+	dataset.set_single_precision_storage(results=False, inputs=True)
+dataset.read_parameters(parfile)
+dataset.read_inputs(inputfile)
+dataset.write_inputs_to_binary_file(binaryfile)
+dataset.delete()
+
+print('Wrote %s (%d bytes, from %d bytes)' % (binaryfile, os.path.getsize(binaryfile), os.path.getsize(inputfile)))
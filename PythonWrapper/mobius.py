@@ -11,6 +11,27 @@ class TimestepSize(ctypes.Structure):
 class dll_branch_index(ctypes.Structure):
 	_fields_ = [("IndexName", ctypes.c_char_p), ("BranchCount", ctypes.c_uint64), ("BranchNames", ctypes.POINTER(ctypes.c_char_p))]
 
+#NOTE: The columns of the output of DataSet.run_model_with_objectives
+objective_statistics = {'nse' : 0, 'kge' : 1, 'log_nse' : 2, 'bias' : 3, 'rmse' : 4, 'n' : 5}
+
+_result_receiver = ctypes.CFUNCTYPE(None, ctypes.c_uint64, ctypes.c_uint64, ctypes.c_uint64, ctypes.POINTER(ctypes.c_double))
+
+def read_result_file(filename) :
+	'''
+	Open a binary result file written by DataSet.run_model_to_file without reading it into memory.
+	
+	Arguments:
+		filename         -- string. The name of the file.
+	
+	Returns:
+		A read-only numpy.memmap with one row per timestep (row 0 is the initial values) and one column per result value. Use DataSet.get_result_offset to find the column of a result series. Example : read_result_file("results.bin")[1:, dataset.get_result_offset("Reach flow", ["Coull"])]
+	'''
+	header = np.fromfile(filename, dtype=np.uint64, count=2)
+	if len(header) < 2 or header[0].tobytes() != b'MOBRES01' :
+		raise RuntimeError('The file "%s" is not a binary result file' % filename)
+	values_per_row = int(header[1])
+	return np.memmap(filename, dtype=np.float64, mode='r', offset=16).reshape((-1, values_per_row))
+
 def initialize(dllname) :
 	global mobiusdll
 	mobiusdll = ctypes.CDLL(dllname)
@@ -28,6 +49,10 @@ def initialize(dllname) :
 	mobiusdll.DllSetupModelBlankIndexSets.argtypes = [ctypes.c_char_p]
 	mobiusdll.DllSetupModelBlankIndexSets.restype  = ctypes.c_void_p
 	
+	mobiusdll.DllSetFileCacheDirectory.argtypes = [ctypes.c_char_p]
+	
+	mobiusdll.DllGetFileCacheStatistics.argtypes = [ctypes.POINTER(ctypes.c_int64)]
+	
 	mobiusdll.DllReadInputs.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
 	
 	mobiusdll.DllReadParameters.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_bool]
@@ -38,6 +63,98 @@ def initialize(dllname) :
 
 	mobiusdll.DllRunModel.argtypes = [ctypes.c_void_p, ctypes.c_int64]
 	mobiusdll.DllRunModel.restype = ctypes.c_bool
+	
+	mobiusdll.DllRunModelWithSink.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_uint64, _result_receiver]
+	mobiusdll.DllRunModelWithSink.restype = ctypes.c_bool
+	
+	mobiusdll.DllRunModelToBinaryFile.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint64, ctypes.c_int64]
+	mobiusdll.DllRunModelToBinaryFile.restype = ctypes.c_bool
+	
+	mobiusdll.DllGetResultOffset.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	mobiusdll.DllGetResultOffset.restype = ctypes.c_uint64
+	
+	mobiusdll.DllRunModelToCheckpoint.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.c_int64]
+	mobiusdll.DllRunModelToCheckpoint.restype = ctypes.c_void_p
+	
+	mobiusdll.DllRunModelFromCheckpoint.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int64]
+	mobiusdll.DllRunModelFromCheckpoint.restype = ctypes.c_bool
+	
+	mobiusdll.DllGetCheckpointSize.argtypes = [ctypes.c_void_p]
+	mobiusdll.DllGetCheckpointSize.restype = ctypes.c_uint64
+	
+	mobiusdll.DllSerializeCheckpoint.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+	
+	mobiusdll.DllDeserializeCheckpoint.argtypes = [ctypes.c_char_p, ctypes.c_uint64]
+	mobiusdll.DllDeserializeCheckpoint.restype = ctypes.c_void_p
+	
+	mobiusdll.DllDeleteCheckpoint.argtypes = [ctypes.c_void_p]
+	
+	mobiusdll.DllAddObjective.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.c_uint64]
+	mobiusdll.DllAddObjective.restype = ctypes.c_uint64
+	
+	mobiusdll.DllClearObjectives.argtypes = [ctypes.c_void_p]
+	
+	mobiusdll.DllGetObjectiveCount.argtypes = [ctypes.c_void_p]
+	mobiusdll.DllGetObjectiveCount.restype = ctypes.c_uint64
+	
+	mobiusdll.DllRunModelWithObjectives.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.POINTER(ctypes.c_double)]
+	mobiusdll.DllRunModelWithObjectives.restype = ctypes.c_bool
+
+	mobiusdll.DllCreateEnsemble.argtypes = [ctypes.c_void_p, ctypes.c_uint64]
+	mobiusdll.DllCreateEnsemble.restype  = ctypes.c_void_p
+	
+	mobiusdll.DllEnsembleAddParameter.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	
+	mobiusdll.DllEnsembleAddResult.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.c_uint64]
+	
+	mobiusdll.DllRunEnsemble.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)]
+	
+	mobiusdll.DllDeleteEnsemble.argtypes = [ctypes.c_void_p]
+	
+	mobiusdll.DllCreateSeriesBatch.argtypes = [ctypes.c_void_p]
+	mobiusdll.DllCreateSeriesBatch.restype  = ctypes.c_void_p
+	
+	mobiusdll.DllBatchAddResult.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	
+	mobiusdll.DllBatchAddInput.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	
+	mobiusdll.DllBatchAddParameter.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	
+	mobiusdll.DllBatchGetResults.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double), ctypes.c_uint64]
+	
+	mobiusdll.DllBatchSetParameters.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double)]
+	
+	mobiusdll.DllBatchSetInputs.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_double), ctypes.c_uint64, ctypes.c_bool]
+	
+	mobiusdll.DllDeleteSeriesBatch.argtypes = [ctypes.c_void_p]
+	
+	mobiusdll.DllPrepareRun.argtypes = [ctypes.c_void_p]
+	mobiusdll.DllPrepareRun.restype  = ctypes.c_void_p
+	
+	mobiusdll.DllRunPrepared.argtypes = [ctypes.c_void_p, ctypes.c_int64]
+	mobiusdll.DllRunPrepared.restype  = ctypes.c_bool
+	
+	mobiusdll.DllGetPreparedRunTiming.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64)]
+	
+	mobiusdll.DllDeletePreparedRun.argtypes = [ctypes.c_void_p]
+
+	mobiusdll.DllSetThreadCount.argtypes = [ctypes.c_void_p, ctypes.c_uint64]
+	
+	mobiusdll.DllSetIncrementalRuns.argtypes = [ctypes.c_void_p, ctypes.c_bool]
+	
+	mobiusdll.DllSetSeriesMajorResults.argtypes = [ctypes.c_void_p, ctypes.c_bool]
+	
+	mobiusdll.DllSetSinglePrecisionStorage.argtypes = [ctypes.c_void_p, ctypes.c_bool, ctypes.c_bool]
+	
+	mobiusdll.DllSetCompressedResults.argtypes = [ctypes.c_void_p, ctypes.c_bool, ctypes.c_uint64]
+	
+	mobiusdll.DllSetMappedStorage.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+	
+	mobiusdll.DllOpenMappedStorage.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+	
+	mobiusdll.DllGetIncrementalRunReport.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64)]
+	
+	mobiusdll.DllGetHoistingReport.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint64)]
 
 	mobiusdll.DllCopyDataSet.argtypes = [ctypes.c_void_p, ctypes.c_bool, ctypes.c_bool]
 	mobiusdll.DllCopyDataSet.restype  = ctypes.c_void_p
@@ -60,7 +177,20 @@ def initialize(dllname) :
 
 	mobiusdll.DllGetResultSeries.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.POINTER(ctypes.c_double)]
 
+	mobiusdll.DllRecordResult.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	
+	mobiusdll.DllRecordAllResults.argtypes = [ctypes.c_void_p]
+	
+	mobiusdll.DllResultWasRecorded.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
+	mobiusdll.DllResultWasRecorded.restype = ctypes.c_bool
+
 	mobiusdll.DllGetInputSeries.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.POINTER(ctypes.c_double), ctypes.c_bool]
+	
+	mobiusdll.DllGetResultSeriesView.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64)]
+	mobiusdll.DllGetResultSeriesView.restype = ctypes.c_void_p
+	
+	mobiusdll.DllGetInputSeriesView.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.c_bool, ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64)]
+	mobiusdll.DllGetInputSeriesView.restype = ctypes.c_void_p
 
 	mobiusdll.DllSetParameterDouble.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64, ctypes.c_double]
 
@@ -75,6 +205,8 @@ def initialize(dllname) :
 	mobiusdll.DllWriteParametersToFile.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
 
 	mobiusdll.DllWriteInputsToFile.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+	
+	mobiusdll.DllWriteInputsToBinaryFile.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
 
 	mobiusdll.DllGetParameterDouble.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_uint64]
 	mobiusdll.DllGetParameterDouble.restype = ctypes.c_double
@@ -156,6 +288,29 @@ def initialize(dllname) :
 	
 	mobiusdll.DllGetBranchInputs.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p)]
 
+def set_cache_directory(path) :
+	'''
+	Turn on the file cache. When it is on, DataSet.setup_from_parameter_and_input_files and DataSet.read_inputs store what they read from the files in the directory, and load it from there instead of parsing the files again when the same files are read later for the same model, also in other processes. Entries are found by a hash of the model structure and of the contents of the files (and of the files they include), so changed files are parsed again. Warnings from parsing the files are only given the first time. The cache is shared by all datasets of the process.
+	
+	Arguments
+		path               -- string. An existing directory to place the cache entries in. Several processes can use the same directory. An empty string turns the cache off. Old entries are not deleted automatically.
+	'''
+	mobiusdll.DllSetFileCacheDirectory(_CStr(path))
+	check_dll_error()
+
+def get_cache_statistics() :
+	'''
+	Get how well the file cache (see set_cache_directory) worked in this process.
+	
+	Returns
+		A dict with the entries 'lookups', 'hits', 'hit_rate', 'parse_seconds' (time spent parsing files on misses), 'load_seconds' (time spent loading entries on hits) and 'saved_seconds' (the time it took to parse the files of the hit entries when they were stored, minus the time it took to load them).
+	'''
+	stats = (ctypes.c_int64 * 5)()
+	mobiusdll.DllGetFileCacheStatistics(stats)
+	check_dll_error()
+	return {'lookups' : stats[0], 'hits' : stats[1], 'hit_rate' : stats[1] / stats[0] if stats[0] > 0 else 0.0,
+		'parse_seconds' : stats[2]*1e-6, 'load_seconds' : stats[3]*1e-6, 'saved_seconds' : stats[4]*1e-6}
+
 def _CStr(string):
 	return string.encode('utf-8')   #TODO: We should figure out what encoding is best to use here.
 
@@ -163,6 +318,17 @@ def _PackIndexes(indexes):
 	cindexes = [index.encode('utf-8') for index in indexes]
 	return (ctypes.c_char_p * len(cindexes))(*cindexes)
 	
+class _SeriesMemory :
+	#NOTE: Describes a strided series in memory owned by the dll to numpy. This is what numpy.lib.stride_tricks.as_strided does too, but without first making an array to take the strides of, which costs more than the rest of getting a view.
+	#  The numpy array keeps this object as its base, so the reference to the dataset keeps the dataset alive for as long as the view is.
+	def __init__(self, dataset, pointer, count, stride, elementsize) :
+		self.dataset = dataset
+		self.__array_interface__ = {'data' : (pointer, True), 'shape' : (count,), 'strides' : (stride,), 'typestr' : '<f8' if elementsize == 8 else '<f4', 'version' : 3}
+
+def _SeriesView(dataset, pointer, count, stride, elementsize) :
+	#NOTE: Makes a read-only numpy array over memory owned by the dll, see DataSet.get_result_series_view.
+	return np.asarray(_SeriesMemory(dataset, pointer, count, stride, elementsize))
+
 def check_dll_error() :
 	buflen = 1024
 	msgbuf = ctypes.create_string_buffer(buflen)
@@ -281,6 +447,253 @@ class DataSet :
 		check_dll_error()
 		return finished
 	
+	def run_model_to_checkpoint(self, timestep, ms_timeout=-1) :
+		'''
+		Run the model for the given number of timesteps from the start date, and save the state of the run so that it can be continued later with run_model_from_checkpoint, for instance with different parameter values. This can be used to avoid repeating a long spin-up period. The results up to the checkpoint can be extracted as usual.
+		
+		Arguments
+			timestep           -- int. The number of timesteps to run before saving the checkpoint.
+			ms_timeout         -- int. See run_model.
+			
+		Returns
+			A Checkpoint object, or None if the run timed out.
+		'''
+		ptr = mobiusdll.DllRunModelToCheckpoint(self.datasetptr, timestep, ms_timeout)
+		check_dll_error()
+		return Checkpoint(ptr) if ptr else None
+	
+	def run_model_from_checkpoint(self, checkpoint, ms_timeout=-1) :
+		'''
+		Continue a model run from a checkpoint. The run evaluates the timesteps of the run set up by the 'Start date' and 'End date' (or 'Timesteps') parameters that come after the checkpoint. The extracted result series start at the date of the checkpoint. The parameters are not changed, so later runs start at the 'Start date' as usual. Continuing with the same parameter values gives exactly the same results as an uninterrupted run.
+		
+		Arguments
+			checkpoint         -- Checkpoint. Made by run_model_to_checkpoint or Checkpoint.from_bytes.
+			ms_timeout         -- int. See run_model.
+			
+		Returns
+			finished		   -- bool. Whether or not the model run finished without error or timeout.
+		'''
+		finished = mobiusdll.DllRunModelFromCheckpoint(self.datasetptr, checkpoint.checkpointptr, ms_timeout)
+		check_dll_error()
+		return finished
+	
+	def add_objective(self, result_name, result_indexes, obs_name, obs_indexes, skip_timesteps=0) :
+		'''
+		Register a goodness of fit comparison between a result series and an observed input series. The statistics are computed while the model runs, see run_model_with_objectives.
+		
+		Arguments
+			result_name        -- string. The name of the result series. Example : "Reach flow (daily mean, cumecs)"
+			result_indexes     -- list of strings. The indexes of the result series. Example : ["Coull"]
+			obs_name           -- string. The name of the input series with the observations. Missing (NaN) observations are skipped. Example : "Observed flow"
+			obs_indexes        -- list of strings. The indexes of the input series.
+			skip_timesteps     -- int. The number of timesteps at the start of the run to leave out of the statistics.
+			
+		Returns
+			The number of the objective, i.e. its row in the output of run_model_with_objectives.
+		'''
+		idx = mobiusdll.DllAddObjective(self.datasetptr, _CStr(result_name), _PackIndexes(result_indexes), len(result_indexes), _CStr(obs_name), _PackIndexes(obs_indexes), len(obs_indexes), skip_timesteps)
+		check_dll_error()
+		return idx
+	
+	def clear_objectives(self) :
+		'''
+		Remove all the objectives added with add_objective.
+		'''
+		mobiusdll.DllClearObjectives(self.datasetptr)
+		check_dll_error()
+	
+	def run_model_with_objectives(self, ms_timeout=-1) :
+		'''
+		Runs the model like run_model, and returns the goodness of fit statistics of the objectives added with add_objective. The result series do not have to be extracted to compute them.
+		
+		Arguments
+			ms_timeout         -- int. See run_model.
+			
+		Returns
+			A numpy.array with one row per objective and one column per statistic. The columns are given by objective_statistics (nse, kge, log_nse, bias, rmse, n). log_nse only uses the timesteps where both the simulated and the observed values are positive, and n is the number of observations used. The statistics are NaN if the run did not finish.
+		'''
+		count = mobiusdll.DllGetObjectiveCount(self.datasetptr)
+		stats = np.zeros((count, len(objective_statistics)))
+		mobiusdll.DllRunModelWithObjectives(self.datasetptr, ms_timeout, stats.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
+		check_dll_error()
+		return stats
+	
+	def run_model_streaming(self, receiver, window_size=1000, ms_timeout=-1) :
+		'''
+		Runs the model, but passes the results to a function as the run advances instead of storing them in the dataset. This keeps the memory use constant regardless of the number of timesteps. Only result series selected with record_result can be extracted with get_result_series after the run.
+		
+		Arguments
+			receiver           -- function(first_row, results). Called for each window of timesteps. results is a numpy.array with one row per timestep and one column per result value, and first_row is the row number of the first of them (row 0 is the initial values, row t+1 is timestep t). The column of a result series is given by dataset.get_result_offset. results is only valid during the call, so copy out what you need.
+			window_size        -- int. The number of timesteps that are kept in memory and passed to the receiver at a time.
+			ms_timeout         -- int. See run_model.
+			
+		Returns
+			finished		   -- bool. Whether or not the model run finished without error or timeout.
+		'''
+		def receive(first_row, row_count, values_per_row, results) :
+			receiver(first_row, np.ctypeslib.as_array(results, shape=(row_count, values_per_row)))
+		
+		callback = _result_receiver(receive)  #NOTE: Has to be kept alive until the run is finished.
+		finished = mobiusdll.DllRunModelWithSink(self.datasetptr, ms_timeout, window_size, callback)
+		check_dll_error()
+		return finished
+	
+	def run_model_to_file(self, filename, window_size=1000, ms_timeout=-1) :
+		'''
+		Runs the model and writes all the results to a binary result file instead of storing them in the dataset. The memory use is constant regardless of the number of timesteps. Only result series selected with record_result can be extracted with get_result_series after the run. Use read_result_file and get_result_offset to read the file.
+		
+		Arguments
+			filename           -- string. The file to write to.
+			window_size        -- int. The number of timesteps that are kept in memory and written to the file at a time.
+			ms_timeout         -- int. See run_model.
+			
+		Returns
+			finished		   -- bool. Whether or not the model run finished without error or timeout.
+		'''
+		finished = mobiusdll.DllRunModelToBinaryFile(self.datasetptr, _CStr(filename), window_size, ms_timeout)
+		check_dll_error()
+		return finished
+	
+	def get_result_offset(self, name, indexes) :
+		'''
+		Get the column of a result series in the results that are passed to the receiver of run_model_streaming or written to a binary result file.
+		
+		Arguments:
+			name             -- string. The name of the result series.
+			indexes          -- list of strings. A list of index names to identify the particular result series.
+		'''
+		offset = mobiusdll.DllGetResultOffset(self.datasetptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+		check_dll_error()
+		return offset
+	
+	def run_ensemble(self, parameters, parameter_matrix, results) :
+		'''
+		Run the model once for each row of parameter_matrix, and return the given result series of every run. This is much faster than copying the dataset and running each copy separately. The dataset itself is not changed. If you run many ensembles with the same parameters and results, create an Ensemble object instead so that its setup can be reused.
+		
+		Arguments
+			parameters         -- list of (name, indexes) pairs. The parameters that vary between the runs. Example : [("Baseflow index", []), ("Soil field capacity", ["Arable"])]
+			parameter_matrix   -- 2d array-like with one row per run and one column per parameter. Integer and enum parameters take whole non-negative numbers (the index of the value for enums), and boolean parameters take 0 or 1. All the values are checked before any run starts.
+			results            -- list of (name, indexes) pairs. The result series to return. Example : [("Reach flow (daily mean, cumecs)", ["Tarland1"])]
+			
+		Returns
+			A numpy.array of shape (runs, len(results), timesteps), where timesteps is dataset.get_next_timesteps().
+		'''
+		ensemble = Ensemble(self, parameters, results)
+		try :
+			series, _ = ensemble.run(parameter_matrix)
+		finally :
+			ensemble.delete()
+		return series
+	
+	def set_thread_count(self, thread_count) :
+		'''
+		Set how many threads model runs of this dataset can use. Batch groups where the index tuples (or the branches of a river network) can be evaluated independently of each other are then divided between the threads. The results are the same as for a serial run.
+		
+		Arguments
+			thread_count       -- int. The number of threads. 1 means a serial run. The default is 1 unless the dll was compiled with a different MOBIUS_THREAD_COUNT.
+		'''
+		mobiusdll.DllSetThreadCount(self.datasetptr, thread_count)
+		check_dll_error()
+	
+	def prepare_run(self) :
+		'''
+		Set up a run state for this dataset that is kept between runs, see PreparedRun.
+		
+		Returns
+			A PreparedRun.
+		'''
+		return PreparedRun(self)
+	
+	def set_incremental_runs(self, incremental=True) :
+		'''
+		Turn incremental model runs on or off for this dataset. In an incremental run, only the equations that are affected by the parameters that changed since the last run are evaluated, and the results of the rest are reused from the last run. The results are the same as for a full run. This speeds up for instance one-at-a-time sensitivity analysis of parameters that are only used late in the model.
+		Results are only reused from a run that stored all its results (not run_model_streaming or run_model_to_file, and with no record_result calls) over the same timesteps, and only if the input data is the same.
+		
+		Arguments
+			incremental        -- bool. Whether or not model runs should be incremental.
+		'''
+		mobiusdll.DllSetIncrementalRuns(self.datasetptr, incremental)
+		check_dll_error()
+	
+	def set_series_major_results(self, series_major=True) :
+		'''
+		Turn series-major result storage on or off for this dataset. If it is on, the results are rearranged after each model run so that every result series is stored contiguously. This makes get_result_series faster when many series are read out after each run, for instance for plotting or calibration of large setups, but it doubles the memory used for results.
+		
+		Arguments
+			series_major       -- bool. Whether or not results should be stored series by series after each run.
+		'''
+		mobiusdll.DllSetSeriesMajorResults(self.datasetptr, series_major)
+		check_dll_error()
+	
+	def set_single_precision_storage(self, results=True, inputs=True) :
+		'''
+		Choose whether the results and the inputs of this dataset are stored in single precision (32 bit float) instead of double precision. This halves the memory they use. The model still computes in double precision, and the state it carries from one timestep to the next is not rounded, so only the inputs and the stored result series lose precision. Values are converted to and from double in get_result_series, get_input_series and set_input_series.
+		With single precision results, incremental runs (see set_incremental_runs) and series-major storage (see set_series_major_results) are not used. Inputs that are already loaded are converted right away. The new setting for results applies from the next run.
+		
+		Arguments
+			results            -- bool. Whether or not results should be stored in single precision.
+			inputs             -- bool. Whether or not inputs should be stored in single precision.
+		'''
+		mobiusdll.DllSetSinglePrecisionStorage(self.datasetptr, results, inputs)
+		check_dll_error()
+	
+	def set_compressed_results(self, compressed=True, block_size=64) :
+		'''
+		Turn compressed result storage on or off for this dataset. If it is on, the results are compressed losslessly while the model runs, in blocks of block_size timesteps, and get_result_series decompresses a series when it is read. This saves memory for long runs where most results change slowly. It takes precedence over set_single_precision_storage for results.
+		Incremental runs (see set_incremental_runs) and series-major storage (see set_series_major_results) are not used with compressed results. The new setting applies from the next run.
+		
+		Arguments
+			compressed         -- bool. Whether or not results should be compressed.
+			block_size         -- int. The number of timesteps that are compressed together.
+		'''
+		mobiusdll.DllSetCompressedResults(self.datasetptr, compressed, block_size)
+		check_dll_error()
+	
+	def set_mapped_storage(self, path) :
+		'''
+		Store the input data in the file path + '.inputs' and the results in the file path + '.results' instead of in memory. The files are memory-mapped, so the data can be larger than the physical memory of the computer, and they are left on disk so that they can be opened again later with open_mapped_storage.
+		This applies to inputs that are read after it is called (e.g. on a dataset made with setup_with_blank_index_sets before read_inputs), and to the results from the next run. Results are only placed in the file if all of them are stored, i.e. not if only some results are recorded or they are packed. An empty path turns it off.
+		
+		Arguments
+			path               -- string. The path and base name of the files.
+		'''
+		mobiusdll.DllSetMappedStorage(self.datasetptr, _CStr(path))
+		check_dll_error()
+	
+	def open_mapped_storage(self, path) :
+		'''
+		Open files that were written using set_mapped_storage, for instance in an earlier session, so that the inputs and the results of the last run that was stored in them can be read without running the model again. The dataset has to have the same indexes as the one that wrote the files, for instance by being set up with setup_with_blank_index_sets and read_parameters using the same parameter file. The inputs are only opened if the dataset does not have inputs yet. Later runs of the dataset are stored in the same files.
+		
+		Arguments
+			path               -- string. The path and base name of the files.
+		'''
+		mobiusdll.DllOpenMappedStorage(self.datasetptr, _CStr(path))
+		check_dll_error()
+	
+	def get_incremental_run_report(self) :
+		'''
+		Get how much of the last model run was reused from the run before it (see set_incremental_runs). Everything is 0 if the last run was not incremental.
+		
+		Returns
+			A dict with the entries 'batch_groups_skipped', 'batch_groups', 'evaluations_skipped' and 'evaluations'. An evaluation is the computation of one result value in one timestep.
+		'''
+		report = (ctypes.c_uint64 * 4)()
+		mobiusdll.DllGetIncrementalRunReport(self.datasetptr, report)
+		check_dll_error()
+		return {'batch_groups_skipped' : report[0], 'batch_groups' : report[1], 'evaluations_skipped' : report[2], 'evaluations' : report[3]}
+	
+	def get_hoisting_report(self) :
+		'''
+		Get how much of the model is evaluated before the time loop of a model run instead of inside it. These are the equations that only depend on parameters, inputs and other such equations, for instance unit conversions of inputs. They are evaluated for all timesteps in one pass before the other equations. The ones that only depend on parameters (constant equations) are evaluated only once per index tuple. This only happens in runs that store all their results (i.e. not when results are streamed or only some results are recorded).
+		
+		Returns
+			A dict with the entries 'hoisted_equations', 'equations', 'hoisted_results', 'results', 'constant_equations' and 'constant_results'. 'hoisted_results' and 'results' are the number of result values per timestep with the index sets of this dataset, 'constant_results' is the number of values computed by the constant equations.
+		'''
+		report = (ctypes.c_uint64 * 6)()
+		mobiusdll.DllGetHoistingReport(self.datasetptr, report)
+		check_dll_error()
+		return {'hoisted_equations' : report[0], 'equations' : report[1], 'hoisted_results' : report[2], 'results' : report[3], 'constant_equations' : report[4], 'constant_results' : report[5]}
+	
 	def copy(self, copyresults=False, borrowinputs=False) :
 		'''
 		Create a copy of the dataset that contains all the same parameter values and input series.
@@ -313,6 +726,16 @@ class DataSet :
 		'''
 		mobiusdll.DllWriteInputsToFile(self.datasetptr, _CStr(filename))
 		check_dll_error()
+	
+	def write_inputs_to_binary_file(self, filename) :
+		'''
+		Write the input series in the dataset to a binary Mobius input file. Binary input files can be used wherever a standard input file can (e.g. in setup_from_parameter_and_input_files or read_inputs), and are loaded without being parsed, which is much faster for large input data. They only work with the same model and the same indexes for the index sets the inputs depend on, so a standard input file can be converted by setting up a dataset with it and calling this.
+		
+		Arguments
+			filename           -- string. The path of the binary input file to write.
+		'''
+		mobiusdll.DllWriteInputsToBinaryFile(self.datasetptr, _CStr(filename))
+		check_dll_error()
 		
 	def get_timestep_size(self) :
 		'''
@@ -342,6 +765,39 @@ class DataSet :
 	
 		return np.array(resultseries, copy=False)
 		
+	def record_result(self, name, indexes=[]) :
+		'''
+		Select a result series to be recorded in the following model runs. By default every result series is recorded, which can use a lot of memory for long runs of large models. If any result series are selected with record_result, only those (and series that the model itself needs to look back in time on) can be extracted with get_result_series after a run.
+		
+		Arguments:
+			name             -- string. The name of the result series. Example : "Reach flow"
+			indexes          -- list of strings. Either an empty list to record all instances of the result, or one index name per index set of the result, where "*" means all indexes of that index set. Example : ["Langtjern"] or ["*", "Forest"]
+		'''
+		mobiusdll.DllRecordResult(self.datasetptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+		check_dll_error()
+	
+	def record_all_results(self) :
+		'''
+		Go back to recording every result series in the following model runs.
+		'''
+		mobiusdll.DllRecordAllResults(self.datasetptr)
+		check_dll_error()
+	
+	def result_was_recorded(self, name, indexes) :
+		'''
+		Check if a result series was recorded during the last model run, see record_result.
+		
+		Arguments:
+			name             -- string. The name of the result series.
+			indexes          -- list of strings. A list of index names to identify the particular result series.
+		
+		Returns:
+			True if the series can be extracted with get_result_series, False otherwise.
+		'''
+		recorded = mobiusdll.DllResultWasRecorded(self.datasetptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+		check_dll_error()
+		return recorded
+		
 	def get_input_series(self, name, indexes, alignwithresults=False) :
 		'''
 		Extract one of the input series that were provided with the dataset.
@@ -367,6 +823,49 @@ class DataSet :
 		
 		return np.array(inputseries, copy=False)
 		
+	def get_result_series_view(self, name, indexes) :
+		'''
+		Same as get_result_series, but the returned array is a read-only view into the result storage of the dataset instead of a copy, so getting it does not cost anything even for long series.
+		
+		The view is only valid until the model is run again (also by run_model_with_objectives and similar), and must not be used after that. The next run may free or move the result storage, or overwrite the values in place. Changes made with record_result, set_single_precision_storage or similar take effect in the next run and have the same effect. A view keeps a reference to the dataset, but it can not be used after dataset.delete() was called. Copy the array (with numpy.array(view)) to keep the values.
+		
+		Arguments:
+			name             -- string. The name of the result series. Example : "Soil moisture"
+			indexes          -- list of strings. A list of index names to identify the particular result series. Example : ["Langtjern"] or ["Langtjern", "Forest"]
+		
+		Returns:
+			A numpy.array viewing the specified timeseries. Its dtype is float32 if the results were stored in single precision. If the results were compressed (see set_compressed_results), they can not be viewed, and a copy is returned instead.
+		'''
+		count, stride, elementsize = ctypes.c_uint64(), ctypes.c_uint64(), ctypes.c_uint64()
+		pointer = mobiusdll.DllGetResultSeriesView(self.datasetptr, _CStr(name), _PackIndexes(indexes), len(indexes), ctypes.byref(count), ctypes.byref(stride), ctypes.byref(elementsize))
+		check_dll_error()
+		
+		if not pointer :
+			return self.get_result_series(name, indexes)
+		return _SeriesView(self, pointer, count.value, stride.value, elementsize.value)
+		
+	def get_input_series_view(self, name, indexes, alignwithresults=False) :
+		'''
+		Same as get_input_series, but the returned array is a read-only view into the input storage of the dataset instead of a copy.
+		
+		The view is valid until the inputs are read again (e.g. with read_inputs) or dataset.delete() is called. It keeps a reference to the dataset. Values written with set_input_series are visible through it.
+		
+		Arguments:
+			name             -- string. The name of the input series. Example : "Air temperature"
+			indexes          -- list of strings. A list of index names to identify the particular input series. Example : ["Langtjern"] or ["Langtjern", "Forest"]
+			alignwithresults -- boolean. If False: View the entire input series. If True: View the series from the parameter 'Start date'. Unlike with get_input_series, the view ends where the input data ends, even if that is before the end of the model run.
+		
+		Returns:
+			A numpy.array viewing the specified timeseries. Its dtype is float32 if the inputs are stored in single precision. If alignwithresults is True and the model run starts before the input data, a copy is returned instead.
+		'''
+		count, stride, elementsize = ctypes.c_uint64(), ctypes.c_uint64(), ctypes.c_uint64()
+		pointer = mobiusdll.DllGetInputSeriesView(self.datasetptr, _CStr(name), _PackIndexes(indexes), len(indexes), alignwithresults, ctypes.byref(count), ctypes.byref(stride), ctypes.byref(elementsize))
+		check_dll_error()
+		
+		if not pointer :
+			return self.get_input_series(name, indexes, alignwithresults)
+		return _SeriesView(self, pointer, count.value, stride.value, elementsize.value)
+		
 	def set_input_series(self, name, indexes, inputseries, alignwithresults=False) :
 		'''
 		Overwrite one of the input series in the dataset.
@@ -802,4 +1301,250 @@ class DataSet :
 	@property
 	def parameter(self) :
 		return self._ParameterReference(self)
-	
\ No newline at end of file
+	
+
+
+class Ensemble :
+	'''
+	Runs the model for many parameter sets that differ from the parameters of a dataset only in the values of a few parameters. The runs are done in the dll on a pool of threads, each of which reuses the same run context for all the parameter sets it runs, and only the requested result series and statistics are copied out.
+	'''
+	
+	statistics = {'series' : 0, 'mean' : 1, 'sum' : 2, 'min' : 3, 'max' : 4, 'last' : 5}
+	
+	def __init__(self, dataset, parameters, results, thread_count=0) :
+		'''
+		Arguments
+			dataset            -- DataSet. The runs start out with the parameters of this dataset and share its input data. It must not be deleted before the ensemble, and the ensemble must be recreated if the index sets of the dataset are changed.
+			parameters         -- list of (name, indexes) pairs. The parameters that vary between the runs, in the order of the columns of the parameter matrix. Date parameters and "Timesteps" can not be used, since all the runs have the same timesteps. Example : [("Baseflow index", []), ("Soil field capacity", ["Arable"])]
+			results            -- list of (name, indexes) or (name, indexes, statistic) tuples, where statistic is one of 'series' (the default), 'mean', 'sum', 'min', 'max' or 'last'. Example : [("Reach flow (daily mean, cumecs)", ["Tarland1"]), ("Reach flow (daily mean, cumecs)", ["Tarland1"], 'mean')]
+			thread_count       -- int. How many threads to run on. 0 means the thread count of the dataset (see DataSet.set_thread_count).
+		'''
+		self.dataset = dataset
+		self.parameter_count = len(parameters)
+		self.series_count = 0
+		self.statistics_count = 0
+		
+		self.ensembleptr = mobiusdll.DllCreateEnsemble(dataset.datasetptr, thread_count)
+		check_dll_error()
+		
+		try :
+			for name, indexes in parameters :
+				mobiusdll.DllEnsembleAddParameter(self.ensembleptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+				check_dll_error()
+			
+			for result in results :
+				name, indexes = result[0], result[1]
+				statistic = result[2] if len(result) > 2 else 'series'
+				if statistic not in Ensemble.statistics :
+					raise ValueError('Unknown statistic "%s"' % statistic)
+				mobiusdll.DllEnsembleAddResult(self.ensembleptr, _CStr(name), _PackIndexes(indexes), len(indexes), Ensemble.statistics[statistic])
+				check_dll_error()
+				if statistic == 'series' : self.series_count += 1
+				else :                     self.statistics_count += 1
+		except :
+			self.delete()
+			raise
+	
+	def run(self, parameter_matrix) :
+		'''
+		Run the model once for each row of parameter_matrix.
+		
+		Arguments
+			parameter_matrix   -- 2d array-like with one row per run and one column per parameter. Integer and enum parameters take whole non-negative numbers (the index of the value for enums), and boolean parameters take 0 or 1. All the values are checked before any run starts.
+			
+		Returns
+			(series, statistics), where series is a numpy.array of shape (runs, number of requested series, timesteps) and statistics is a numpy.array of shape (runs, number of requested statistics). The results are in the order they were given to the constructor.
+		'''
+		matrix = np.ascontiguousarray(parameter_matrix, dtype=np.float64)
+		if matrix.ndim != 2 or matrix.shape[1] != self.parameter_count :
+			raise ValueError('The parameter matrix must have one column per parameter')
+		members = matrix.shape[0]
+		
+		timesteps = self.dataset.get_next_timesteps()
+		series     = np.zeros((members, self.series_count, timesteps), dtype=np.float64)
+		statistics = np.zeros((members, self.statistics_count), dtype=np.float64)
+		
+		as_ptr = lambda array : array.ctypes.data_as(ctypes.POINTER(ctypes.c_double))
+		mobiusdll.DllRunEnsemble(self.ensembleptr, members, as_ptr(matrix), as_ptr(series), as_ptr(statistics))
+		check_dll_error()
+		
+		return series, statistics
+	
+	def delete(self) :
+		'''
+		Delete the run contexts and threads of the ensemble. The dataset is not deleted.
+		'''
+		mobiusdll.DllDeleteEnsemble(self.ensembleptr)
+		check_dll_error()
+
+
+class SeriesBatch :
+	'''
+	A list of result series, input series and parameters of a dataset that can all be read or written with one call, e.g. in each iteration of a calibration. Their names and indexes are looked up once, when the batch is created, instead of in every call as with DataSet.get_result_series, DataSet.set_input_series and DataSet.set_parameter_double.
+	'''
+	
+	def __init__(self, dataset, results=[], inputs=[], parameters=[]) :
+		'''
+		Arguments
+			dataset            -- DataSet. It must not be deleted before the batch, and the batch must be recreated if the index sets of the dataset are changed.
+			results            -- list of (name, indexes) pairs. The result series to read with get_results. Example : [("Reach flow (daily mean, cumecs)", ["Tarland1"]), ("Soil water volume", ["Tarland1", "Arable"])]
+			inputs             -- list of (name, indexes) pairs. The input series to write with set_inputs. The input data of the dataset must have been read or allocated.
+			parameters         -- list of (name, indexes) pairs. The parameters to write with set_parameters. Date parameters can not be used.
+		'''
+		self.dataset = dataset
+		self.result_count = len(results)
+		self.input_count = len(inputs)
+		self.parameter_count = len(parameters)
+		
+		self.batchptr = mobiusdll.DllCreateSeriesBatch(dataset.datasetptr)
+		check_dll_error()
+		
+		try :
+			for name, indexes in results :
+				mobiusdll.DllBatchAddResult(self.batchptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+				check_dll_error()
+			for name, indexes in inputs :
+				mobiusdll.DllBatchAddInput(self.batchptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+				check_dll_error()
+			for name, indexes in parameters :
+				mobiusdll.DllBatchAddParameter(self.batchptr, _CStr(name), _PackIndexes(indexes), len(indexes))
+				check_dll_error()
+		except :
+			self.delete()
+			raise
+	
+	def get_results(self) :
+		'''
+		Extract the result series of the batch from the last run of the model.
+		
+		Returns
+			A numpy.array of shape (number of result series, timesteps), with the series in the order they were given to the constructor.
+		'''
+		timesteps = self.dataset.get_last_timesteps()
+		results = np.zeros((self.result_count, timesteps), dtype=np.float64)
+		mobiusdll.DllBatchGetResults(self.batchptr, results.ctypes.data_as(ctypes.POINTER(ctypes.c_double)), timesteps)
+		check_dll_error()
+		return results
+	
+	def set_parameters(self, values) :
+		'''
+		Overwrite the values of the parameters of the batch.
+		
+		Arguments
+			values             -- 1d array-like with one value per parameter, in the order they were given to the constructor. Integer and enum parameters take whole non-negative numbers (the index of the value for enums), and boolean parameters take 0 or 1. If any value is invalid, none of them are set.
+		'''
+		array = np.ascontiguousarray(values, dtype=np.float64)
+		if array.shape != (self.parameter_count,) :
+			raise ValueError('There must be one value per parameter')
+		mobiusdll.DllBatchSetParameters(self.batchptr, array.ctypes.data_as(ctypes.POINTER(ctypes.c_double)))
+		check_dll_error()
+	
+	def set_inputs(self, matrix, alignwithresults=False) :
+		'''
+		Overwrite the input series of the batch. Each row is written like with DataSet.set_input_series.
+		
+		Arguments
+			matrix             -- 2d array-like with one row per input series, in the order they were given to the constructor.
+			alignwithresults   -- boolean. If False: Start writing to the first timestep of the input series. If True: Start writing at the timestep corresponding to the parameter 'Start date'.
+		'''
+		array = np.ascontiguousarray(matrix, dtype=np.float64)
+		if array.ndim != 2 or array.shape[0] != self.input_count :
+			raise ValueError('The matrix must have one row per input series')
+		mobiusdll.DllBatchSetInputs(self.batchptr, array.ctypes.data_as(ctypes.POINTER(ctypes.c_double)), array.shape[1], alignwithresults)
+		check_dll_error()
+	
+	def delete(self) :
+		'''
+		Delete the batch. The dataset is not deleted.
+		'''
+		mobiusdll.DllDeleteSeriesBatch(self.batchptr)
+		check_dll_error()
+
+
+class PreparedRun :
+	'''
+	A model run state that is set up once for a dataset and kept between runs of it, so that repeated runs (for instance in a calibration loop) don't pay for setting it up again. Parameter values can be changed on the dataset between the runs as usual.
+	'''
+	
+	def __init__(self, dataset) :
+		'''
+		Arguments
+			dataset            -- DataSet. The dataset to run. It must not be deleted before the prepared run, and the prepared run must be recreated if the index sets of the dataset are changed.
+		'''
+		self.dataset = dataset
+		self.preparedptr = mobiusdll.DllPrepareRun(dataset.datasetptr)
+		check_dll_error()
+	
+	def run(self, ms_timeout=-1) :
+		'''
+		Run the model of the dataset. The results are the same as those of DataSet.run_model, and are read from the dataset.
+		
+		Arguments
+			ms_timeout         -- int. Stop the run if it takes longer than this many milliseconds. -1 means no timeout.
+		
+		Returns
+			False if the run timed out, True otherwise.
+		'''
+		finished = mobiusdll.DllRunPrepared(self.preparedptr, ms_timeout)
+		check_dll_error()
+		return finished
+	
+	def timing(self) :
+		'''
+		Get how long the preparation and the last run took.
+		
+		Returns
+			A dict with the entries 'prepare', 'setup' and 'execution', in seconds. 'setup' is the part of the last run that came before the first timestep (including the evaluation of the initial values), and 'execution' is the time spent running the timesteps.
+		'''
+		timing = (ctypes.c_uint64 * 3)()
+		mobiusdll.DllGetPreparedRunTiming(self.preparedptr, timing)
+		return {'prepare' : timing[0]*1e-6, 'setup' : timing[1]*1e-6, 'execution' : timing[2]*1e-6}
+	
+	def delete(self) :
+		'''
+		Free the run state. The dataset is not deleted.
+		'''
+		mobiusdll.DllDeletePreparedRun(self.preparedptr)
+		check_dll_error()
+
+
+class Checkpoint :
+	'''
+	The state of a model run at a given timestep, see DataSet.run_model_to_checkpoint.
+	'''
+	
+	def __init__(self, checkpointptr) :
+		self.checkpointptr = checkpointptr
+	
+	def to_bytes(self) :
+		'''
+		Serialize the checkpoint, for instance to store it in a file.
+		
+		Returns
+			A bytes object.
+		'''
+		size = mobiusdll.DllGetCheckpointSize(self.checkpointptr)
+		check_dll_error()
+		data = ctypes.create_string_buffer(size)
+		mobiusdll.DllSerializeCheckpoint(self.checkpointptr, data)
+		check_dll_error()
+		return data.raw
+	
+	@classmethod
+	def from_bytes(cls, data) :
+		'''
+		Load a checkpoint that was serialized with to_bytes.
+		
+		Arguments
+			data               -- bytes.
+		'''
+		ptr = mobiusdll.DllDeserializeCheckpoint(data, len(data))
+		check_dll_error()
+		return cls(ptr)
+	
+	def delete(self) :
+		'''
+		Free the memory of the checkpoint.
+		'''
+		mobiusdll.DllDeleteCheckpoint(self.checkpointptr)
+		check_dll_error()
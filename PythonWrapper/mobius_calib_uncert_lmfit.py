@@ -611,7 +611,7 @@ def get_result_dataframe(dataset, list) :
     df = pd.DataFrame({'Date' : dates})
 	
     for name, indexes in list :
-        series = dataset.get_result_series(name, indexes)
+        series = dataset.get_result_series_view(name, indexes)  # The dataframe copies it, so there is no need for get_result_series to copy it first
         full_name = combine_name(name, indexes)
         df[full_name] = series
 
@@ -82,15 +82,7 @@ mobius_setup_from_parameter_and_input_file(std::string ParameterFileName, std::s
 {
 	BuildModel();
 	
-	ReadInputDependenciesFromFile(Model, InputFileName.data());
-	
-	EndModelDefinition(Model);
-	
-	DataSet = GenerateDataSet(Model);
-	
-	ReadParametersFromFile(DataSet, ParameterFileName.data());
-
-	ReadInputsFromFile(DataSet, InputFileName.data());
+	DataSet = SetupDataSetFromFiles(Model, ParameterFileName.data(), InputFileName.data());
 }
 
 // [[Rcpp::export]]
@@ -19,6 +19,15 @@ YearLength(s32 Year)
 	return 365 + IsLeapYear(Year);
 }
 
+inline s64
+LeapYearsBefore(s32 Year)
+{
+	//NOTE: The number of leap years before Year, counted from an arbitrary year far back. Only differences between two of these are meaningful. The divisions are rounded down, so that this also works for negative years.
+	auto FloorDiv = [](s64 A, s64 B) -> s64 { return A / B - ((A % B != 0) && (A < 0)); };
+	s64 Y = (s64)Year - 1;
+	return FloorDiv(Y, 4) - FloorDiv(Y, 100) + FloorDiv(Y, 400);
+}
+
 inline s32
 MonthLength(s32 Year, s32 Month)
 {
@@ -50,17 +59,9 @@ private:
 		if(Day < 1 || Day > MonthLength(Year, Month) || Month < 1 || Month > 12)
 			return false; 
 		
-		s64 Result = 0;
-		if(Year > 1970)
-		{
-			for(s32 Y = 1970; Y < Year; ++Y)
-				Result += YearLength(Y)*24*60*60;
-		}
-		else if(Year < 1970)
-		{
-			for(s32 Y = 1969; Y >= Year; --Y)
-				Result -= YearLength(Y)*24*60*60;
-		}
+		//NOTE: The days from 1970 to the start of the year, without looping over the years in between (this is used for every date when reading input files).
+		s64 Days = 365*((s64)Year - 1970) + LeapYearsBefore(Year) - LeapYearsBefore(1970);
+		s64 Result = Days*24*60*60;
 		
 		Result += MonthOffset(Year, Month)*24*60*60;
 		Result += (Day-1)*24*60*60;
@@ -186,7 +186,7 @@ PrintParameterStorageStructure(mobius_data_set *DataSet)
 static void
 PrintInputStorageStructure(mobius_data_set *DataSet)
 {
-	if(!DataSet->InputData)
+	if(!InputStorageIsAllocated(DataSet))
 	{
 		WarningPrint("WARNING: Tried to print input storage structure before the input storage was allocated.\n");
 		return;
@@ -19,43 +19,27 @@ FILE *OpenFile(const char *Filename, const char *Mode)
 }
 
 static token_string
-ReadEntireFile(const char *Filename)
+MapEntireFile(const char *Filename, mapped_file *Mapped)
 {
-	token_string FileData = {};
+	//NOTE: Gives the contents of the file. The file is mapped into memory instead of read into an allocated buffer, so only the parts of it that are used are read from disk. The data is not zero-terminated. Close it with CloseMappedFile.
 	
-	FILE *File = OpenFile(Filename, "rb");
-
+	FILE *File = OpenFile(Filename, "rb"); //NOTE: So that a file that can not be opened gives the same error as elsewhere.
 	fseek(File, 0, SEEK_END);
-	FileData.Length = ftell(File);
-	fseek(File, 0, SEEK_SET);
-	
-	if(FileData.Length == 0)
-	{
-		fclose(File);
-		FatalError("ERROR: File ", Filename, " has 0 length.\n");
-	}
-	
-	char *Data = (char *)malloc(FileData.Length + 1);
-	
-	if(!Data)
-		FatalError("Unable to allocate enough memory to read in file ", Filename, '\n');
-
-	size_t ReadSize = fread((void *)Data, 1, FileData.Length, File); // NOTE: Casting away constness, but it doesn't matter since we just allocated it ourselves.
+	size_t Length = ftell(File);
 	fclose(File);
 	
-	if(ReadSize != FileData.Length)
-	{
-		free((void *)Data);
-		FatalError("ERROR: Was unable to read the entire file ", Filename);
-	}
+	if(Length == 0)
+		FatalError("ERROR: File ", Filename, " has 0 length.\n");
 	
-	Data[FileData.Length] = '\0';    // Zero-terminate it in case we want to interface with C libraries.
-	FileData.Data = Data;
+	if(!OpenMappedFile(Mapped, Filename, 0, false, true))
+		FatalError("ERROR: Tried to open file \"", Filename, "\", but was not able to.\n");
 	
+	token_string FileData;
+	FileData.Data   = (const char *)Mapped->Data;
+	FileData.Length = Mapped->Size;
 	return FileData;
 }
 
-
 static const char *
 MakePathRelativeTo(const char *ParentFile, token_string Filename)
 {
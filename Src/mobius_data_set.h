@@ -33,11 +33,19 @@ GenerateDataSet(mobius_model *Model)
 	return DataSet;
 }
 
+static void
+CloseMappedStorage(mobius_data_set *DataSet);
+
 mobius_data_set::~mobius_data_set()
 {
+	CloseMappedStorage(this);
 	if(ParameterData) free(ParameterData);
 	if(InputData && OwnsInputs) free(InputData);
+	if(SingleInputData && OwnsInputs) free(SingleInputData);
 	if(ResultData) free(ResultData);
+	if(RecordedResultData) free(RecordedResultData);
+	if(SeriesResultData) free(SeriesResultData);
+	if(SingleResultData) free(SingleResultData);
 	
 	BucketMemory.DeallocateAll();
 }
@@ -64,7 +72,23 @@ CopyStorageStructure(const storage_structure<handle_type> *Source, storage_struc
 	Dest->Model                  = Source->Model;
 }
 
+inline void
+InputsChanged(mobius_data_set *DataSet)
+{
+	//NOTE: Has to be called by everything that changes the input data (or which series were provided) of a data set, so that an incremental run (see SetIncrementalRuns) knows that it can't keep the results of the last run. Copies that borrow the inputs of another data set share its count.
+	while(DataSet->InputsBorrowedFrom) DataSet = DataSet->InputsBorrowedFrom;
+	++DataSet->InputGeneration;
+}
+
+inline u64
+InputGeneration(const mobius_data_set *DataSet)
+{
+	while(DataSet->InputsBorrowedFrom) DataSet = DataSet->InputsBorrowedFrom;
+	return DataSet->InputGeneration;
+}
+
 // If you don't BorrowInputs, you get a copy of them instead. If you BorrowInputs you should not delete the original data set before you stop using the copy.
+// The copy keeps its own data in memory even if the original uses memory-mapped storage (see SetMappedStorage). Borrowed inputs are read from the mapped file of the original.
 static mobius_data_set *
 CopyDataSet(mobius_data_set *DataSet, bool CopyResults = false, bool BorrowInputs = false)
 {
@@ -90,24 +114,62 @@ CopyDataSet(mobius_data_set *DataSet, bool CopyResults = false, bool BorrowInput
 		}
 	}
 	else Copy->InputData = nullptr; //Should not be necessary...
+	if(DataSet->SingleInputData)
+	{
+		if(!BorrowInputs)
+			Copy->SingleInputData = CopyArray(float, DataSet->InputStorageStructure.TotalCount * DataSet->InputDataTimesteps, DataSet->SingleInputData);
+		else
+		{
+			Copy->SingleInputData = DataSet->SingleInputData;
+			Copy->OwnsInputs = false;
+		}
+	}
+	Copy->SinglePrecisionInputs  = DataSet->SinglePrecisionInputs;
+	Copy->SinglePrecisionResults = DataSet->SinglePrecisionResults;
+	Copy->CompressResults        = DataSet->CompressResults;
+	Copy->CompressionBlockSize   = DataSet->CompressionBlockSize;
 	CopyStorageStructure(&DataSet->InputStorageStructure, &Copy->InputStorageStructure, &Copy->BucketMemory);
 	Copy->InputDataStartDate = DataSet->InputDataStartDate;
 	Copy->InputDataHasSeparateStartDate = DataSet->InputDataHasSeparateStartDate;
 	Copy->InputDataTimesteps = DataSet->InputDataTimesteps;
+	if(BorrowInputs && (DataSet->InputData || DataSet->SingleInputData))
+		Copy->InputsBorrowedFrom = DataSet->InputsBorrowedFrom ? DataSet->InputsBorrowedFrom : DataSet;
+	else
+		Copy->InputGeneration = InputGeneration(DataSet);
 	
 	if(DataSet->InputTimeseriesWasProvided) Copy->InputTimeseriesWasProvided = Copy->BucketMemory.Copy(DataSet->InputTimeseriesWasProvided, DataSet->InputStorageStructure.TotalCount);
 	
 	if(CopyResults)
 	{
-		if(DataSet->ResultData) Copy->ResultData = CopyArray(double, DataSet->ResultStorageStructure.TotalCount * (DataSet->TimestepsLastRun + 1), DataSet->ResultData);
+		if(DataSet->ResultData) Copy->ResultData = CopyArray(double, DataSet->ResultDataSize, DataSet->ResultData);
+		Copy->ResultDataSize = DataSet->ResultDataSize;
+		if(DataSet->RecordedResultData) Copy->RecordedResultData = CopyArray(double, DataSet->RecordedResultDataSize, DataSet->RecordedResultData);
+		Copy->RecordedResultDataSize = DataSet->RecordedResultDataSize;
+		Copy->RecordedOffsets = DataSet->RecordedOffsets;
+		Copy->RecordedIndex   = DataSet->RecordedIndex;
+		Copy->ResultWindow    = DataSet->ResultWindow;
+		if(DataSet->HasSeriesResults) Copy->SeriesResultData = CopyArray(double, DataSet->SeriesResultDataSize, DataSet->SeriesResultData);
+		Copy->SeriesResultDataSize = DataSet->HasSeriesResults ? DataSet->SeriesResultDataSize : 0;
+		Copy->HasSeriesResults     = DataSet->HasSeriesResults;
+		if(DataSet->SingleResultData) Copy->SingleResultData = CopyArray(float, DataSet->SingleResultDataSize, DataSet->SingleResultData);
+		Copy->SingleResultDataSize  = DataSet->SingleResultDataSize;
+		Copy->PackedOffsets = DataSet->PackedOffsets;
+		Copy->PackedIndex   = DataSet->PackedIndex;
+		Copy->CompressedResults = DataSet->CompressedResults;
 		CopyStorageStructure(&DataSet->ResultStorageStructure, &Copy->ResultStorageStructure, &Copy->BucketMemory);
 		Copy->TimestepsLastRun = DataSet->TimestepsLastRun;
 		Copy->StartDateLastRun = DataSet->StartDateLastRun;
 		Copy->HasBeenRun = DataSet->HasBeenRun;
+		Copy->ParameterDataLastRun = DataSet->ParameterDataLastRun;
+		Copy->InputGenerationLastRun = DataSet->InputGenerationLastRun;
+		Copy->IncrementalRunReport = DataSet->IncrementalRunReport;
 	}
 	else
 		Copy->HasBeenRun = false;
 	
+	Copy->ResultRecording = DataSet->ResultRecording;
+	Copy->Objectives      = DataSet->Objectives;
+	
 	if(DataSet->IndexCounts) Copy->IndexCounts = Copy->BucketMemory.Copy(DataSet->IndexCounts, Model->IndexSets.Count());
 	
 	if(DataSet->IndexNames)
@@ -127,6 +189,10 @@ CopyDataSet(mobius_data_set *DataSet, bool CopyResults = false, bool BorrowInput
 	}
 	Copy->IndexNamesToHandle = DataSet->IndexNamesToHandle;
 	Copy->AllIndexesHaveBeenSet = DataSet->AllIndexesHaveBeenSet;
+	Copy->ThreadCount = DataSet->ThreadCount;
+	Copy->InputThreadCount = DataSet->InputThreadCount;
+	Copy->IncrementalRuns = DataSet->IncrementalRuns;
+	Copy->SeriesMajorResults = DataSet->SeriesMajorResults;
 	
 	if(DataSet->BranchInputs)
 	{
@@ -718,18 +784,76 @@ AllocateParameterStorage(mobius_data_set *DataSet)
 static void
 ForeachInputInstance(mobius_data_set *DataSet, input_h Input, const std::function<void(index_t *Indexes, size_t IndexesCount)> &Do);
 
+inline bool
+InputStorageIsAllocated(const mobius_data_set *DataSet)
+{
+	return DataSet->InputData || DataSet->SingleInputData;
+}
+
+static const char MappedInputFileIdentifier[8]  = {'M', 'O', 'B', 'M', 'I', 'N', '0', '1'};
+static const char MappedResultFileIdentifier[8] = {'M', 'O', 'B', 'M', 'R', 'E', '0', '1'};
+
+struct mapped_storage_header
+{
+	//NOTE: The start of a file of memory-mapped storage, see SetMappedStorage. The data starts at DataOffset, which is a multiple of the page size, and is laid out as in memory: Rows timesteps of ValuesPerRow values each. In an input file, the header is followed by the InputTimeseriesWasProvided flags.
+	char Identifier[8];
+	u64  ElementSize;     //NOTE: sizeof(double), or sizeof(float) for single precision inputs.
+	u64  ValuesPerRow;
+	u64  Rows;
+	u64  DataOffset;
+	s64  StartDate;       //NOTE: The input start date, or the start date of the run that wrote the results.
+	u64  Flag;            //NOTE: Inputs: whether the input data had a separate start date. Results: whether the run that wrote them finished.
+};
+
+inline size_t
+MappedStorageDataOffset(size_t FlagCount)
+{
+	size_t PageSize = 4096; //NOTE: So that the data starts on a page boundary.
+	return ((sizeof(mapped_storage_header) + FlagCount + PageSize - 1) / PageSize) * PageSize;
+}
+
 static void
-AllocateInputStorage(mobius_data_set *DataSet, u64 Timesteps)
+WriteMappedStorageHeaders(mobius_data_set *DataSet)
+{
+	//NOTE: Updates the parts of the headers of the mapped files that can change after the files were created.
+	if(DataSet->MappedInputs.Data && !DataSet->MappedInputs.CopyOnWrite) //NOTE: Inputs that are mapped copy-on-write are from a binary input file, see ReadInputsFromBinaryFile.
+	{
+		mapped_storage_header *Header = (mapped_storage_header *)DataSet->MappedInputs.Data;
+		Header->StartDate = DataSet->InputDataStartDate.SecondsSinceEpoch;
+		Header->Flag      = DataSet->InputDataHasSeparateStartDate;
+	}
+	if(DataSet->MappedResults.Data)
+	{
+		mapped_storage_header *Header = (mapped_storage_header *)DataSet->MappedResults.Data;
+		Header->Rows      = DataSet->HasBeenRun ? DataSet->TimestepsLastRun + 1 : 0;
+		Header->StartDate = DataSet->StartDateLastRun.SecondsSinceEpoch;
+	}
+}
+
+static void
+CloseMappedStorage(mobius_data_set *DataSet)
+{
+	WriteMappedStorageHeaders(DataSet);
+	if(DataSet->MappedInputs.Data)
+	{
+		CloseMappedFile(&DataSet->MappedInputs);
+		DataSet->InputData       = nullptr;
+		DataSet->SingleInputData = nullptr;
+		InputsChanged(DataSet);
+	}
+	if(DataSet->MappedResults.Data)
+	{
+		CloseMappedFile(&DataSet->MappedResults);
+		DataSet->ResultData     = nullptr;
+		DataSet->ResultDataSize = 0;
+	}
+}
+
+static void
+SetupInputStorageStructure(mobius_data_set *DataSet)
 {
 	const mobius_model *Model = DataSet->Model;
 	
-	EnsureIndexesHaveBeenSet(DataSet);
-	
-	if(DataSet->InputData)
-		FatalError("ERROR: Tried to allocate input storage twice.\n");
-	
-	DataSet->OwnsInputs = true;
-
 	std::map<std::vector<index_set_h>, std::vector<input_h>> TransposedInputDependencies;
 	
 	for(input_h Input : Model->Inputs)
@@ -750,33 +874,86 @@ AllocateInputStorage(mobius_data_set *DataSet, u64 Timesteps)
 		++UnitIndex;
 	}
 	SetupStorageStructureSpecifer(&DataSet->InputStorageStructure, DataSet->IndexCounts, Model->Inputs.Count(), &DataSet->BucketMemory);
+}
 
+static void
+AllocateInputStorage(mobius_data_set *DataSet, u64 Timesteps)
+{
+	const mobius_model *Model = DataSet->Model;
+	
+	EnsureIndexesHaveBeenSet(DataSet);
+	
+	if(InputStorageIsAllocated(DataSet))
+		FatalError("ERROR: Tried to allocate input storage twice.\n");
+	
+	DataSet->OwnsInputs = true;
+	
+	SetupInputStorageStructure(DataSet);
 	
-	DataSet->InputData = AllocClearedArray(double, DataSet->InputStorageStructure.TotalCount * Timesteps);
+	size_t Count = DataSet->InputStorageStructure.TotalCount * Timesteps;
+	if(!DataSet->MappedStoragePath.empty())
+	{
+		size_t ElementSize = DataSet->SinglePrecisionInputs ? sizeof(float) : sizeof(double);
+		size_t DataOffset  = MappedStorageDataOffset(sizeof(bool)*DataSet->InputStorageStructure.TotalCount);
+		std::string Filename = DataSet->MappedStoragePath + ".inputs";
+		OpenMappedFile(&DataSet->MappedInputs, Filename.c_str(), DataOffset + ElementSize*Count, true);
+		
+		mapped_storage_header *Header = (mapped_storage_header *)DataSet->MappedInputs.Data;
+		memcpy(Header->Identifier, MappedInputFileIdentifier, sizeof(MappedInputFileIdentifier));
+		Header->ElementSize  = ElementSize;
+		Header->ValuesPerRow = DataSet->InputStorageStructure.TotalCount;
+		Header->Rows         = Timesteps;
+		Header->DataOffset   = DataOffset;
+		
+		u8 *Data = DataSet->MappedInputs.Data + DataOffset;
+		if(DataSet->SinglePrecisionInputs)
+			DataSet->SingleInputData = (float *)Data;
+		else
+			DataSet->InputData = (double *)Data;
+		AdviseSequentialAccess(&DataSet->MappedInputs);
+	}
+	else if(DataSet->SinglePrecisionInputs)
+		DataSet->SingleInputData = AllocClearedArray(float, Count);
+	else
+		DataSet->InputData = AllocClearedArray(double, Count);
 	DataSet->InputDataTimesteps = Timesteps;
 	
 	//NOTE: It would be easier if we just cleared every input series to NaN always, but that would require re-writing some models to account for it
-	//NOTE: The below way to do it is not that efficient...
+	//NOTE: The offsets are collected first so that the storage is cleared in one pass row by row instead of one strided pass per series, which is a lot faster for long input series.
+	std::vector<size_t> ClearOffsets;
 	for(input_h Input : Model->Inputs)
 	{
 		const input_spec &Spec = Model->Inputs[Input];
 		if(Spec.ClearToNaN)
 		{
-			ForeachInputInstance(DataSet, Input, [DataSet, Input](index_t *Indexes, size_t IndexesCount)
+			ForeachInputInstance(DataSet, Input, [DataSet, Input, &ClearOffsets](index_t *Indexes, size_t IndexesCount)
 				{
-					size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Indexes, IndexesCount, DataSet->IndexCounts, Input);
-					double *At = DataSet->InputData + Offset;
-					for(size_t Idx = 0; Idx < DataSet->InputDataTimesteps; ++Idx)
-					{
-						*At = std::numeric_limits<double>::quiet_NaN();
-						At += DataSet->InputStorageStructure.TotalCount;
-					}
+					ClearOffsets.push_back(OffsetForHandle(DataSet->InputStorageStructure, Indexes, IndexesCount, DataSet->IndexCounts, Input));
 				}
 			);
 		}
 	}
+	if(!ClearOffsets.empty())
+	{
+		size_t Stride = DataSet->InputStorageStructure.TotalCount;
+		for(size_t Idx = 0; Idx < DataSet->InputDataTimesteps; ++Idx)
+		{
+			for(size_t Offset : ClearOffsets)
+			{
+				if(DataSet->SingleInputData)
+					DataSet->SingleInputData[Offset + Idx*Stride] = std::numeric_limits<float>::quiet_NaN();
+				else
+					DataSet->InputData[Offset + Idx*Stride] = std::numeric_limits<double>::quiet_NaN();
+			}
+		}
+	}
+	
+	if(DataSet->MappedInputs.Data)
+		DataSet->InputTimeseriesWasProvided = (bool *)(DataSet->MappedInputs.Data + sizeof(mapped_storage_header));
+	else
+		DataSet->InputTimeseriesWasProvided = DataSet->BucketMemory.Allocate<bool>(DataSet->InputStorageStructure.TotalCount);
 	
-	DataSet->InputTimeseriesWasProvided = DataSet->BucketMemory.Allocate<bool>(DataSet->InputStorageStructure.TotalCount);
+	InputsChanged(DataSet);
 }
 
 static void
@@ -816,28 +993,432 @@ SetupResultStorageStructure(mobius_data_set *DataSet)
 
 
 static void
-AllocateResultStorage(mobius_data_set *DataSet, u64 Timesteps)
+SetupResultRecording(mobius_data_set *DataSet, bool Streaming)
 {
-	SetupResultStorageStructure(DataSet);
+	//NOTE: Finds the offsets of the results that should be recorded in the next run, see RecordResult. If the results are streamed to a result_sink, the full results are not kept, so then only the selected results are recorded too.
+	//  If the results are packed, i.e. stored in single precision (see SetSinglePrecisionStorage) or compressed (see SetCompressedResults), the full results are not kept either. Then the selected results (or all of them if none were selected and the results are not streamed) are put in PackedOffsets instead, and only the results accessed with EARLIER_RESULT are recorded unpacked.
+	const mobius_model *Model = DataSet->Model;
+	storage_structure<equation_h> &Structure = DataSet->ResultStorageStructure;
+	
+	DataSet->RecordedOffsets.clear();
+	DataSet->RecordedIndex.clear();
+	DataSet->PackedOffsets.clear();
+	DataSet->PackedIndex.clear();
+	
+	bool Packed = DataSet->SinglePrecisionResults || DataSet->CompressResults;
+	if(DataSet->ResultRecording.empty() && !Streaming && !Packed) return;
+	
+	DataSet->RecordedIndex.resize(Structure.TotalCount, -1);
+	
+	auto Record = [DataSet, Model, &Structure](equation_h Equation, const std::vector<s64> &Restriction)
+	{
+		array<index_set_h> &IndexSets = Structure.Units[Structure.UnitForHandle[Equation.Handle]].IndexSets;
+		
+		//TODO: This overflows if somebody have more than 256 index sets for an entity type, but that will not happen in practice.
+		index_t Indexes[256];
+		for(size_t Level = 0; Level < IndexSets.Count; ++Level)
+		{
+			s64 Index = Restriction.empty() ? -1 : Restriction[Level];
+			if(Index >= (s64)DataSet->IndexCounts[IndexSets[Level].Handle].Index)
+				FatalError("ERROR: The index set \"", GetName(Model, IndexSets[Level]), "\" no longer has the index that the result \"", GetName(Model, Equation), "\" was set to be recorded for.\n");
+			Indexes[Level] = {IndexSets[Level], (u32)Max(Index, (s64)0)};
+		}
+		
+		//NOTE: Iterate over all combinations of the indexes of the levels that are not restricted to a single index.
+		while(true)
+		{
+			size_t Offset = OffsetForHandle(Structure, Indexes, IndexSets.Count, DataSet->IndexCounts, Equation);
+			if(DataSet->RecordedIndex[Offset] < 0)
+			{
+				DataSet->RecordedIndex[Offset] = 0;
+				DataSet->RecordedOffsets.push_back(Offset);
+			}
+			
+			s64 Level = (s64)IndexSets.Count - 1;
+			for(; Level >= 0; --Level)
+			{
+				if(!Restriction.empty() && Restriction[Level] >= 0) continue;
+				++Indexes[Level];
+				if(Indexes[Level] < DataSet->IndexCounts[IndexSets[Level].Handle]) break;
+				Indexes[Level].Index = 0;
+			}
+			if(Level < 0) break;
+		}
+	};
+	
+	for(const result_recording &Recording : DataSet->ResultRecording)
+		Record(Recording.Equation, Recording.Indexes);
+	
+	if(Packed)
+	{
+		if(DataSet->ResultRecording.empty() && !Streaming)
+		{
+			for(size_t Offset = 0; Offset < Structure.TotalCount; ++Offset)
+				DataSet->RecordedOffsets.push_back(Offset);
+		}
+		std::sort(DataSet->RecordedOffsets.begin(), DataSet->RecordedOffsets.end());
+		DataSet->PackedIndex.resize(Structure.TotalCount, -1);
+		for(size_t Idx = 0; Idx < DataSet->RecordedOffsets.size(); ++Idx)
+			DataSet->PackedIndex[DataSet->RecordedOffsets[Idx]] = (s64)Idx;
+		DataSet->PackedOffsets.swap(DataSet->RecordedOffsets);
+		std::fill(DataSet->RecordedIndex.begin(), DataSet->RecordedIndex.end(), -1);
+	}
 	
-	if(DataSet->ResultData && (Timesteps != DataSet->TimestepsLastRun))
+	//NOTE: EARLIER_RESULT can look arbitrarily far back in time, so those results have to be recorded.
+	for(equation_h Equation : Model->Equations)
+	{
+		const equation_spec &Spec = Model->Equations[Equation];
+		if(Spec.AccessedByEarlierResult && Spec.Type != EquationType_InitialValue)
+			Record(Equation, {});
+	}
+	
+	//NOTE: Store the recorded results in storage order so that the copying after each timestep reads the full result data in sequence.
+	std::sort(DataSet->RecordedOffsets.begin(), DataSet->RecordedOffsets.end());
+	for(size_t Idx = 0; Idx < DataSet->RecordedOffsets.size(); ++Idx)
+		DataSet->RecordedIndex[DataSet->RecordedOffsets[Idx]] = (s64)Idx;
+}
+
+template<typename value_type> void
+AllocateClearedResultArray(value_type **Data, size_t *Size, size_t NewSize)
+{
+	if(*Data && *Size != NewSize)
 	{
 		//NOTE: We could realloc, but we need to clear it to 0 anyway, so there is probably not that much of a gain.
+		free(*Data);
+		*Data = nullptr;
+	}
+	
+	if(NewSize != 0)
+	{
+		if(!*Data)
+			*Data = AllocClearedArray(value_type, NewSize);
+		else
+			memset(*Data, 0, sizeof(value_type)*NewSize);
+	}
+	*Size = NewSize;
+}
+
+static void
+MapResultStorage(mobius_data_set *DataSet, size_t Count)
+{
+	//NOTE: Places ResultData in the file MappedStoragePath.results, see SetMappedStorage. The file is created again for every run, which also clears it.
+	if(DataSet->ResultData && !DataSet->MappedResults.Data)
 		free(DataSet->ResultData);
-		DataSet->ResultData = nullptr;
+	
+	size_t DataOffset = MappedStorageDataOffset(0);
+	std::string Filename = DataSet->MappedStoragePath + ".results";
+	OpenMappedFile(&DataSet->MappedResults, Filename.c_str(), DataOffset + sizeof(double)*Count, true);
+	
+	mapped_storage_header *Header = (mapped_storage_header *)DataSet->MappedResults.Data;
+	memcpy(Header->Identifier, MappedResultFileIdentifier, sizeof(MappedResultFileIdentifier));
+	Header->ElementSize  = sizeof(double);
+	Header->ValuesPerRow = DataSet->ResultStorageStructure.TotalCount;
+	Header->DataOffset   = DataOffset;
+	
+	DataSet->ResultData     = (double *)(DataSet->MappedResults.Data + DataOffset);
+	DataSet->ResultDataSize = Count;
+	AdviseSequentialAccess(&DataSet->MappedResults);
+}
+
+static void
+AllocateResultStorage(mobius_data_set *DataSet, u64 Timesteps, size_t StreamWindow = 0, bool KeepResults = false)
+{
+	//NOTE: StreamWindow is the window size of the result_sink the results are streamed to, or 0 if they are not streamed.
+	//NOTE: If KeepResults is true and every result is stored in a ResultData that already has the right size, the results of the last run are left in it (for an incremental run, see SetupIncrementalRun).
+	SetupResultStorageStructure(DataSet);
+	SetupResultRecording(DataSet, StreamWindow > 0);
+	
+	DataSet->HasSeriesResults = false; //NOTE: The series-major copy is made again when the run is finished, see TransposeResults.
+	
+	size_t TotalCount = DataSet->ResultStorageStructure.TotalCount;
+	
+	//NOTE: Results are only placed in the mapped file if all of them are stored. Otherwise ResultData only holds a window of timesteps, and can be in memory.
+	bool Mapped = DataSet->RecordedIndex.empty() && !DataSet->MappedStoragePath.empty();
+	if(DataSet->MappedResults.Data && !Mapped)
+	{
+		CloseMappedFile(&DataSet->MappedResults); //NOTE: The header was written when the results in it were, so the file can still be opened with OpenMappedStorage.
+		DataSet->ResultData     = nullptr;
+		DataSet->ResultDataSize = 0;
 	}
 	
 	//NOTE: We add 1 to Timesteps since we also need space for the initial values.
-	size_t AllocationSize = DataSet->ResultStorageStructure.TotalCount * (Timesteps + 1);
-	
-	if(!DataSet->ResultData)
-		DataSet->ResultData = AllocClearedArray(double, AllocationSize);
+	if(DataSet->RecordedIndex.empty())
+	{
+		DataSet->ResultWindow = 0;
+		if(!KeepResults || DataSet->ResultDataSize != TotalCount * (Timesteps + 1) || (Mapped && !DataSet->MappedResults.Data))
+		{
+			if(Mapped)
+				MapResultStorage(DataSet, TotalCount * (Timesteps + 1));
+			else
+				AllocateClearedResultArray(&DataSet->ResultData, &DataSet->ResultDataSize, TotalCount * (Timesteps + 1));
+		}
+		AllocateClearedResultArray(&DataSet->RecordedResultData, &DataSet->RecordedResultDataSize, 0);
+		if(Mapped)
+		{
+			DataSet->MappedResultsReleased = (u8 *)DataSet->ResultData - DataSet->MappedResults.Data;
+			((mapped_storage_header *)DataSet->MappedResults.Data)->Flag = 0; //NOTE: Set when the run is finished, see RunModel.
+		}
+	}
 	else
-		memset(DataSet->ResultData, 0, sizeof(double)*AllocationSize);
+	{
+		//NOTE: Compressed results are compressed one window at a time, so then the window is a block (unless the window size is given by a result sink).
+		size_t Window = StreamWindow;
+		if(Window == 0 && DataSet->CompressResults) Window = DataSet->CompressionBlockSize;
+		DataSet->ResultWindow = Max(Window, (size_t)1);
+		AllocateClearedResultArray(&DataSet->ResultData, &DataSet->ResultDataSize, TotalCount * (DataSet->ResultWindow + 1));
+		AllocateClearedResultArray(&DataSet->RecordedResultData, &DataSet->RecordedResultDataSize, DataSet->RecordedOffsets.size() * (Timesteps + 1));
+	}
+	
+	//NOTE: Compression takes precedence over single precision storage, since it is lossless.
+	compressed_results &Compressed = DataSet->CompressedResults;
+	Compressed.Active      = DataSet->CompressResults;
+	Compressed.SeriesCount = Compressed.Active ? DataSet->PackedOffsets.size() : 0;
+	Compressed.Bits.clear();
+	Compressed.BitCount    = 0;
+	Compressed.BlockStarts.clear();
+	Compressed.BlockRows.clear();
+	bool Single = DataSet->SinglePrecisionResults && !Compressed.Active;
+	AllocateClearedResultArray(&DataSet->SingleResultData, &DataSet->SingleResultDataSize, Single ? DataSet->PackedOffsets.size() * (Timesteps + 1) : 0);
 	
 	DataSet->TimestepsLastRun = Timesteps; //TODO: This may be misindicative naming since the model has not run yet at this point. We need to set this so that other routines can know how much result data has been allocated though.
 }
 
+inline void
+RecordResultTimestep(mobius_data_set *DataSet, const double *TimestepResults, s64 Timestep)
+{
+	//NOTE: Copies the recorded results out of one timestep of the full result data. Timestep 0 is the initial values.
+	size_t RecordedCount = DataSet->RecordedOffsets.size();
+	if(RecordedCount != 0)
+	{
+		double *WriteTo = DataSet->RecordedResultData + ((size_t)Timestep)*RecordedCount;
+		const size_t *Offsets = DataSet->RecordedOffsets.data();
+		for(size_t Idx = 0; Idx < RecordedCount; ++Idx)
+			WriteTo[Idx] = TimestepResults[Offsets[Idx]];
+	}
+	
+	size_t SingleCount = DataSet->PackedOffsets.size();
+	if(SingleCount != 0 && DataSet->SingleResultData)
+	{
+		float *WriteTo = DataSet->SingleResultData + ((size_t)Timestep)*SingleCount;
+		const size_t *Offsets = DataSet->PackedOffsets.data();
+		for(size_t Idx = 0; Idx < SingleCount; ++Idx)
+			WriteTo[Idx] = (float)TimestepResults[Offsets[Idx]];
+	}
+}
+
+inline void
+WriteBits(compressed_results *Compressed, u64 Value, int Count)
+{
+	//NOTE: Appends the Count (1 to 64) lowest bits of Value, the most significant bit first.
+	if(Count < 64) Value &= ((u64)1 << Count) - 1;
+	size_t Word = (size_t)(Compressed->BitCount / 64);
+	int    Free = 64 - (int)(Compressed->BitCount % 64);
+	if(Compressed->Bits.size() < Word + 2) Compressed->Bits.resize(Word + 2, 0);
+	if(Count <= Free)
+		Compressed->Bits[Word] |= (Count == 64) ? Value : Value << (Free - Count);
+	else
+	{
+		Compressed->Bits[Word]   |= Value >> (Count - Free);
+		Compressed->Bits[Word+1] |= Value << (64 - (Count - Free));
+	}
+	Compressed->BitCount += Count;
+}
+
+inline u64
+ReadBits(const u64 *Bits, u64 *Position, int Count)
+{
+	//NOTE: Reads Count (1 to 64) bits written with WriteBits.
+	size_t Word = (size_t)(*Position / 64);
+	int    Used = (int)(*Position % 64);
+	int    Free = 64 - Used;
+	*Position += Count;
+	if(Count <= Free)
+		return (Bits[Word] << Used) >> (64 - Count);
+	u64 High = (Bits[Word] << Used) >> Used;
+	return (High << (Count - Free)) | (Bits[Word+1] >> (64 - (Count - Free)));
+}
+
+static void
+CompressResultBlock(mobius_data_set *DataSet, const double *Rows, size_t RowCount)
+{
+	//NOTE: Compresses the packed results (see SetCompressedResults) of RowCount consecutive timesteps of the full result storage, which is the next block of the compressed results.
+	//  The values of a series in consecutive timesteps are usually close, and then many of the high bits of them are the same. Each series is encoded as in the Gorilla time series database (Pelkonen et al. 2015): The first value of the block is stored as is. Every later value is XORed with the one before it. If the XOR is 0, only a 0 bit is stored. Otherwise only the bits between the leading and trailing zeros of the XOR are stored, either within the same bit window as the last stored XOR (prefix 10), or with the number of leading zeros (5 bits) and the length (6 bits) of a new window first (prefix 11).
+	//  The blocks are independent of each other, so that a series can be decompressed without decompressing the other series in the same blocks.
+	compressed_results *Compressed = &DataSet->CompressedResults;
+	size_t TotalCount = DataSet->ResultStorageStructure.TotalCount;
+	Compressed->BlockRows.push_back((u32)RowCount);
+	for(size_t Series = 0; Series < Compressed->SeriesCount; ++Series)
+	{
+		Compressed->BlockStarts.push_back(Compressed->BitCount);
+		const double *Read = Rows + DataSet->PackedOffsets[Series];
+		
+		u64 Last;
+		memcpy(&Last, Read, sizeof(u64));
+		WriteBits(Compressed, Last, 64);
+		int LastLeading  = 64; //NOTE: There is no window to reuse before the first nonzero XOR.
+		int LastTrailing = 0;
+		for(size_t Row = 1; Row < RowCount; ++Row)
+		{
+			u64 Value;
+			memcpy(&Value, Read + Row*TotalCount, sizeof(u64));
+			u64 Xor = Value ^ Last;
+			Last = Value;
+			if(Xor == 0)
+			{
+				WriteBits(Compressed, 0, 1);
+				continue;
+			}
+			int Leading  = Min(CountLeadingZeros64(Xor), 31);
+			int Trailing = CountTrailingZeros64(Xor);
+			if(Leading >= LastLeading && Trailing >= LastTrailing)
+			{
+				WriteBits(Compressed, 2, 2);
+				WriteBits(Compressed, Xor >> LastTrailing, 64 - LastLeading - LastTrailing);
+			}
+			else
+			{
+				int Length = 64 - Leading - Trailing;
+				WriteBits(Compressed, 3, 2);
+				WriteBits(Compressed, (u64)Leading, 5);
+				WriteBits(Compressed, (u64)(Length - 1), 6);
+				WriteBits(Compressed, Xor >> Trailing, Length);
+				LastLeading  = Leading;
+				LastTrailing = Trailing;
+			}
+		}
+	}
+}
+
+static void
+DecompressResultSeries(mobius_data_set *DataSet, size_t Series, u64 FirstRow, double *WriteTo, size_t Count)
+{
+	//NOTE: Writes Count values of the compressed series number Series (see CompressResultBlock), starting at the row FirstRow (row 0 is the initial values). Rows that were not compressed (because the run did not finish) are written as 0.
+	const compressed_results &Compressed = DataSet->CompressedResults;
+	const u64 *Bits = Compressed.Bits.data();
+	u64 EndRow = FirstRow + Count;
+	u64 BlockFirstRow = 0;
+	size_t Written = 0;
+	for(size_t Block = 0; Block < Compressed.BlockRows.size() && BlockFirstRow < EndRow; ++Block)
+	{
+		u64 RowCount = Compressed.BlockRows[Block];
+		if(BlockFirstRow + RowCount <= FirstRow)
+		{
+			BlockFirstRow += RowCount;
+			continue;
+		}
+		
+		u64 Position = Compressed.BlockStarts[Block*Compressed.SeriesCount + Series];
+		u64 Last = ReadBits(Bits, &Position, 64);
+		int LastLeading  = 0;
+		int LastTrailing = 0;
+		for(u64 Row = BlockFirstRow; Row < BlockFirstRow + RowCount && Row < EndRow; ++Row)
+		{
+			if(Row != BlockFirstRow && ReadBits(Bits, &Position, 1) == 1)
+			{
+				if(ReadBits(Bits, &Position, 1) == 1)
+				{
+					LastLeading  = (int)ReadBits(Bits, &Position, 5);
+					int Length   = (int)ReadBits(Bits, &Position, 6) + 1;
+					LastTrailing = 64 - LastLeading - Length;
+				}
+				Last ^= ReadBits(Bits, &Position, 64 - LastLeading - LastTrailing) << LastTrailing;
+			}
+			if(Row >= FirstRow)
+				memcpy(WriteTo + (Written++), &Last, sizeof(double));
+		}
+		BlockFirstRow += RowCount;
+	}
+	for(; Written < Count; ++Written)
+		WriteTo[Written] = 0.0;
+}
+
+inline double *
+ResultSeriesLocation(mobius_data_set *DataSet, size_t Offset, size_t *Stride)
+{
+	//NOTE: Returns a pointer to the initial value of the result at Offset (in the result storage structure) from the last run, and in Stride the distance between the values of consecutive timesteps. Returns nullptr if only some results were recorded in the last run and this was not one of them.
+	size_t  Series      = Offset;
+	size_t  SeriesCount = DataSet->ResultStorageStructure.TotalCount;
+	double *Data        = DataSet->ResultData;
+	if(!DataSet->RecordedIndex.empty())
+	{
+		s64 RecordedIdx = DataSet->RecordedIndex[Offset];
+		if(RecordedIdx < 0) return nullptr;
+		Series      = (size_t)RecordedIdx;
+		SeriesCount = DataSet->RecordedOffsets.size();
+		Data        = DataSet->RecordedResultData;
+	}
+	
+	if(DataSet->HasSeriesResults)
+	{
+		*Stride = 1;
+		return DataSet->SeriesResultData + Series*(DataSet->TimestepsLastRun + 1);
+	}
+	
+	*Stride = SeriesCount;
+	return Data + Series;
+}
+
+inline float *
+SingleResultSeriesLocation(mobius_data_set *DataSet, size_t Offset, size_t *Stride)
+{
+	//NOTE: Same as ResultSeriesLocation, but for the results that were stored in single precision in the last run (see SetSinglePrecisionStorage). Returns nullptr if the results were not stored in single precision, or this one was not stored.
+	if(DataSet->PackedIndex.empty() || !DataSet->SingleResultData) return nullptr;
+	s64 RecordedIdx = DataSet->PackedIndex[Offset];
+	if(RecordedIdx < 0) return nullptr;
+	*Stride = DataSet->PackedOffsets.size();
+	return DataSet->SingleResultData + RecordedIdx;
+}
+
+static void
+TransposeResults(mobius_data_set *DataSet)
+{
+	//NOTE: Makes the series-major copy of the results of the last run (see SetSeriesMajorResults). In ResultData one timestep follows the other, so reading out a result series touches a new cache line for every value. Here the results are copied over in square tiles, so that both the timesteps that are read and the parts of the series that are written stay in cache while a tile is copied.
+	//NOTE: Packed results (stored in single precision or compressed) are not transposed, since an unpacked copy of them would use more memory than packing them saves.
+	if(!DataSet->PackedIndex.empty()) return;
+	
+	const double *Source;
+	size_t SeriesCount;
+	if(DataSet->RecordedIndex.empty())
+	{
+		Source      = DataSet->ResultData;
+		SeriesCount = DataSet->ResultStorageStructure.TotalCount;
+	}
+	else
+	{
+		Source      = DataSet->RecordedResultData;
+		SeriesCount = DataSet->RecordedOffsets.size();
+	}
+	size_t Length = DataSet->TimestepsLastRun + 1;
+	
+	if(DataSet->SeriesResultData && DataSet->SeriesResultDataSize != SeriesCount*Length)
+	{
+		free(DataSet->SeriesResultData);
+		DataSet->SeriesResultData = nullptr;
+	}
+	DataSet->SeriesResultDataSize = SeriesCount*Length;
+	if(!DataSet->SeriesResultData && DataSet->SeriesResultDataSize != 0)
+		DataSet->SeriesResultData = AllocClearedArray(double, DataSet->SeriesResultDataSize);
+	
+	const size_t Tile = 32; //NOTE: 32 timesteps of 32 series are 8KB to read and 8KB to write, which leaves room in a 32KB L1 cache.
+	double *Dest = DataSet->SeriesResultData;
+	for(size_t FirstRow = 0; FirstRow < Length; FirstRow += Tile)
+	{
+		size_t EndRow = Min(FirstRow + Tile, Length);
+		for(size_t FirstSeries = 0; FirstSeries < SeriesCount; FirstSeries += Tile)
+		{
+			size_t EndSeries = Min(FirstSeries + Tile, SeriesCount);
+			for(size_t Series = FirstSeries; Series < EndSeries; ++Series)
+			{
+				double *Write = Dest + Series*Length;
+				for(size_t Row = FirstRow; Row < EndRow; ++Row)
+					Write[Row] = Source[Row*SeriesCount + Series];
+			}
+		}
+	}
+	
+	DataSet->HasSeriesResults = true;
+}
+
 
 
 //NOTE: Returns the numeric index corresponding to an index name and an index_set.
@@ -992,6 +1573,41 @@ SetParameterValue(mobius_data_set *DataSet, const char *Name, const std::vector<
 	SetParameterValue(DataSet, Name, Indexes.data(), Indexes.size(), Value);
 }
 
+static parameter_value
+ParameterValueFromDouble(const mobius_model *Model, parameter_h Parameter, double Value)
+{
+	//NOTE: Converts a value given as a double (as in SetBatchParameters and RunModelEnsemble) to the type of the parameter. The value has to be representable in that type: Integer parameters take whole non-negative numbers, enum parameters take the index of one of their values, and boolean parameters take 0 or 1.
+	const parameter_spec &Spec = Model->Parameters[Parameter];
+	parameter_value Result;
+	Result.ValUInt = 0;
+	
+	if(Spec.Type == ParameterType_Double)
+		Result.ValDouble = Value;
+	else if(Spec.Type == ParameterType_Bool)
+	{
+		if(Value != 0.0 && Value != 1.0)
+			FatalError("ERROR: Tried to set the value of the boolean parameter \"", Spec.Name, "\" to ", Value, ". It has to be 0 or 1.\n");
+		Result.ValBool = (Value == 1.0);
+	}
+	else if(Spec.Type == ParameterType_UInt)
+	{
+		//NOTE: 18446744073709551616.0 is 2^64. The comparisons are negated so that they also catch NaN.
+		if(!(Value >= 0.0 && Value < 18446744073709551616.0) || Value != std::floor(Value))
+			FatalError("ERROR: Tried to set the value of the parameter \"", Spec.Name, "\" to ", Value, ", but it only takes whole numbers from 0 to 18446744073709551615.\n");
+		Result.ValUInt = (u64)Value;
+	}
+	else if(Spec.Type == ParameterType_Enum)
+	{
+		if(!(Value >= 0.0 && Value < (double)Spec.EnumNames.size()) || Value != std::floor(Value))
+			FatalError("ERROR: Tried to set the value of the enum parameter \"", Spec.Name, "\" to ", Value, ", but it only takes the whole numbers from 0 to ", Spec.EnumNames.size() - 1, " (the index of one of its values).\n");
+		Result.ValUInt = (u64)Value;
+	}
+	else
+		FatalError("ERROR: The parameter \"", Spec.Name, "\" is a date parameter, and it can not be set from a number.\n");
+	
+	return Result;
+}
+
 
 
 static parameter_value
@@ -1045,22 +1661,9 @@ GetParameterBool(mobius_data_set *DataSet, const char  *Name, const std::vector<
 
 
 static void
-SetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount, const double *InputSeries, size_t InputSeriesSize, bool AlignWithResults = false)
+WriteInputSeries(mobius_data_set *DataSet, size_t Offset, const char *Name, const double *InputSeries, size_t InputSeriesSize, bool AlignWithResults)
 {
-	if(!DataSet->InputData)
-		AllocateInputStorage(DataSet, InputSeriesSize);
-	
-	const mobius_model *Model = DataSet->Model;
-	
-	input_h Input = GetInputHandle(Model, Name);
-	
-	int Error;
-	size_t Offset = GetOffset(DataSet, Input, Indexes, IndexCount, DataSet->InputStorageStructure, &Error);
-	
-	if(Error >= 0)
-		FatalError("ERROR: Tried to set the value of the input series \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
-	
-	double *At = DataSet->InputData + Offset;
+	//NOTE: Writes the input series at Offset (in the input storage structure). The timesteps it does not cover are set to NaN (missing). Name is only used in error messages.
 	s64 TimestepOffset = 0;
 	
 	if(AlignWithResults && DataSet->InputDataHasSeparateStartDate)
@@ -1068,7 +1671,7 @@ SetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *I
 		//NOTE: In case the user asked for a input timeseries that starts at the start of the modelrun rather than at the start of the input series.
 		datetime DataSetStartDate = GetStartDate(DataSet);
 		datetime InputStartDate   = DataSet->InputDataStartDate;
-		TimestepOffset = FindTimestep(InputStartDate, DataSetStartDate, Model->TimestepSize);
+		TimestepOffset = FindTimestep(InputStartDate, DataSetStartDate, DataSet->Model->TimestepSize);
 	}
 	
 	if(InputSeriesSize + TimestepOffset > DataSet->InputDataTimesteps)
@@ -1076,19 +1679,56 @@ SetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *I
 		FatalError("ERROR: When setting input series for \"", Name, "\", the length of the time series was longer than what was allocated space for in the dataset. Got ", InputSeriesSize, ", expected ", DataSet->InputDataTimesteps-TimestepOffset, "\n");
 	}
 	
+	//NOTE: If the inputs are stored in single precision (see SetSinglePrecisionStorage), the values are rounded to single precision here.
+	//NOTE: The input generation is only bumped if the series actually changed, since preprocessing steps (such as ComputeThornthwaitePET) write the same series again at the start of every run, and that should not stop incremental runs from keeping results.
+	bool Changed = !DataSet->InputTimeseriesWasProvided[Offset];
+	size_t Stride = DataSet->InputStorageStructure.TotalCount;
 	for(size_t Idx = 0; Idx < DataSet->InputDataTimesteps; ++Idx)
 	{
-		if(Idx >= TimestepOffset && Idx <= InputSeriesSize + TimestepOffset)
-			*At = InputSeries[Idx - TimestepOffset];
+		double Value;
+		if((s64)Idx >= TimestepOffset && (s64)Idx < (s64)InputSeriesSize + TimestepOffset)
+			Value = InputSeries[Idx - TimestepOffset];
+		else
+			Value = std::numeric_limits<double>::quiet_NaN();
+		if(DataSet->SingleInputData)
+		{
+			float Single = (float)Value;
+			float *Stored = &DataSet->SingleInputData[Offset + Idx*Stride];
+			if(!Changed && memcmp(Stored, &Single, sizeof(float)) != 0) Changed = true;
+			*Stored = Single;
+		}
 		else
-			*At = std::numeric_limits<double>::quiet_NaN();
-		At += DataSet->InputStorageStructure.TotalCount;
+		{
+			double *Stored = &DataSet->InputData[Offset + Idx*Stride];
+			if(!Changed && memcmp(Stored, &Value, sizeof(double)) != 0) Changed = true;
+			*Stored = Value;
+		}
 	}
 	
 	DataSet->InputTimeseriesWasProvided[Offset] = true;
+	if(Changed) InputsChanged(DataSet);
 }
 
-inline void
+static void
+SetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount, const double *InputSeries, size_t InputSeriesSize, bool AlignWithResults = false)
+{
+	if(!InputStorageIsAllocated(DataSet))
+		AllocateInputStorage(DataSet, InputSeriesSize);
+	
+	const mobius_model *Model = DataSet->Model;
+	
+	input_h Input = GetInputHandle(Model, Name);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Input, Indexes, IndexCount, DataSet->InputStorageStructure, &Error);
+	
+	if(Error >= 0)
+		FatalError("ERROR: Tried to set the value of the input series \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	WriteInputSeries(DataSet, Offset, Name, InputSeries, InputSeriesSize, AlignWithResults);
+}
+
+inline void
 SetInputSeries(mobius_data_set *DataSet, const char *Name, const std::vector<const char *> &IndexNames, const double *InputSeries, size_t InputSeriesSize, bool AlignWithResults = false)
 {
 	SetInputSeries(DataSet, Name, IndexNames.data(), IndexNames.size(), InputSeries, InputSeriesSize, AlignWithResults);
@@ -1099,17 +1739,14 @@ SetInputSeries(mobius_data_set *DataSet, const char *Name, const std::vector<con
 // std::vector<double> MyResults;
 // MyResults.resize(DataSet->TimestepsLastRun);
 // GetResultSeries(DataSet, "Percolation input", {"Reach 1", "Forest", "Groundwater"}, MyResult.data(), MyResult.size());
-static void
-GetResultSeries(mobius_data_set *DataSet, const char *Name, const char* const* Indexes, size_t IndexCount, double *WriteTo, size_t WriteSize, bool IncludeInitial = false)
-{	
+static size_t
+ResultSeriesOffset(mobius_data_set *DataSet, const char *Name, const char* const* Indexes, size_t IndexCount)
+{
 	if(!DataSet->HasBeenRun || !DataSet->ResultData)
 		FatalError("ERROR: Tried to extract result series before the model was run at least once.\n");
 	
 	const mobius_model *Model = DataSet->Model;
 	
-	//TODO: If we ask for more values than we could get, should there not be an error?
-	u64 NumToWrite = Min(WriteSize, DataSet->TimestepsLastRun);
-	
 	equation_h Equation = GetEquationHandle(Model, Name);
 	
 	const equation_spec &Spec = Model->Equations[Equation];
@@ -1122,28 +1759,150 @@ GetResultSeries(mobius_data_set *DataSet, const char *Name, const char* const* I
 	if(Error >= 0)
 		FatalError("ERROR: Tried to get the result series of the equation \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
 	
-	double *Lookup = DataSet->ResultData + Offset;
+	return Offset;
+}
+
+static void
+CopyResultSeries(mobius_data_set *DataSet, size_t Offset, const char *Name, double *WriteTo, u64 NumToWrite, bool IncludeInitial)
+{
+	//NOTE: Copies out the result at Offset (in the result storage structure) from wherever the last run stored it. Name is only used in error messages.
+	if(DataSet->CompressedResults.Active && DataSet->PackedIndex[Offset] >= 0)
+	{
+		DecompressResultSeries(DataSet, (size_t)DataSet->PackedIndex[Offset], IncludeInitial ? 0 : 1, WriteTo, NumToWrite);
+		return;
+	}
+	
+	size_t Stride;
+	float *SingleLookup = SingleResultSeriesLocation(DataSet, Offset, &Stride);
+	if(SingleLookup)
+	{
+		//NOTE: The result was stored in single precision, see SetSinglePrecisionStorage.
+		if(!IncludeInitial)
+			SingleLookup += Stride;
+		for(size_t Idx = 0; Idx < NumToWrite; ++Idx)
+		{
+			WriteTo[Idx] = (double)*SingleLookup;
+			SingleLookup += Stride;
+		}
+		return;
+	}
+	
+	double *Lookup = ResultSeriesLocation(DataSet, Offset, &Stride);
+	
+	if(!Lookup)
+		FatalError("ERROR: The result series \"", Name, "\" with the given indexes was not recorded during the last model run. Use RecordResult (or DataSet.record_result in Python) to record it.\n");
 	
 	if(!IncludeInitial)
-		Lookup += DataSet->ResultStorageStructure.TotalCount;
+		Lookup += Stride;
+	
+	if(Stride == 1)
+	{
+		memcpy(WriteTo, Lookup, sizeof(double)*NumToWrite);
+		return;
+	}
 	
 	for(size_t Idx = 0; Idx < NumToWrite; ++Idx)
 	{
 		WriteTo[Idx] = *Lookup;
-		Lookup += DataSet->ResultStorageStructure.TotalCount;
+		Lookup += Stride;
 	}
 }
 
+static void
+GetResultSeries(mobius_data_set *DataSet, const char *Name, const char* const* Indexes, size_t IndexCount, double *WriteTo, size_t WriteSize, bool IncludeInitial = false)
+{	
+	size_t Offset = ResultSeriesOffset(DataSet, Name, Indexes, IndexCount);
+	
+	//TODO: If we ask for more values than we could get, should there not be an error?
+	u64 NumToWrite = Min(WriteSize, DataSet->TimestepsLastRun);
+	
+	CopyResultSeries(DataSet, Offset, Name, WriteTo, NumToWrite, IncludeInitial);
+}
+
 inline void
 GetResultSeries(mobius_data_set *DataSet, const char *Name, const std::vector<const char*> &IndexNames, double *WriteTo, size_t WriteSize, bool IncludeInitial = false)
 {
 	GetResultSeries(DataSet, Name, IndexNames.data(), IndexNames.size(), WriteTo, WriteSize, IncludeInitial);
 }
 
+static result_recording
+GetResultRecording(mobius_data_set *DataSet, const char *Name, const char * const *IndexNames, size_t IndexCount)
+{
+	//NOTE: IndexNames can be empty to mean all instances of the result, or have one entry per index set of the result where "*" means all the indexes of that index set.
+	const mobius_model *Model = DataSet->Model;
+	
+	result_recording Recording;
+	Recording.Equation = GetEquationHandle(Model, Name);
+	
+	if(Model->Equations[Recording.Equation].Type == EquationType_InitialValue)
+		FatalError("ERROR: Can not record the result series of the equation \"", Name, "\", because it is an initial value equation.\n");
+	
+	SetupResultStorageStructure(DataSet);
+	
+	if(IndexCount == 0) return Recording;
+	
+	storage_structure<equation_h> &Structure = DataSet->ResultStorageStructure;
+	array<index_set_h> &IndexSets = Structure.Units[Structure.UnitForHandle[Recording.Equation.Handle]].IndexSets;
+	if(IndexCount != IndexSets.Count)
+		FatalError("ERROR: Tried to record the result series of the equation \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", IndexSets.Count, " (or 0 to record all instances).\n");
+	
+	for(size_t Level = 0; Level < IndexCount; ++Level)
+	{
+		if(strcmp(IndexNames[Level], "*") == 0)
+			Recording.Indexes.push_back(-1);
+		else
+			Recording.Indexes.push_back((s64)GetIndex(DataSet, IndexSets[Level], IndexNames[Level]).Index);
+	}
+	
+	return Recording;
+}
+
+// NOTE: Selects result series to record in subsequent model runs. By default every result is recorded at every timestep, which for long runs of large models can use a lot of memory. If any results have been selected with RecordResult, only those are recorded (in addition to results accessed using EARLIER_RESULT), and only they can be extracted with GetResultSeries after the run. All other results are only kept for the two timesteps that the model run needs at any time.
+// Example:
+// RecordResult(DataSet, "Reach flow", {"Outlet"});
+// RecordResult(DataSet, "Soil water volume", {"*", "Forest"});   //NOTE: "*" records all the indexes of an index set.
+// RecordResult(DataSet, "Snow depth", {});                       //NOTE: Records all instances.
 static void
-GetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount, double *WriteTo, size_t WriteSize, bool AlignWithResults = false)
-{	
-	if(!DataSet->InputData)
+RecordResult(mobius_data_set *DataSet, const char *Name, const char * const *IndexNames, size_t IndexCount)
+{
+	DataSet->ResultRecording.push_back(GetResultRecording(DataSet, Name, IndexNames, IndexCount));
+}
+
+inline void
+RecordResult(mobius_data_set *DataSet, const char *Name, const std::vector<const char *> &IndexNames)
+{
+	RecordResult(DataSet, Name, IndexNames.data(), IndexNames.size());
+}
+
+inline void
+RecordAllResults(mobius_data_set *DataSet)
+{
+	//NOTE: Goes back to the default of recording every result in subsequent model runs.
+	DataSet->ResultRecording.clear();
+}
+
+static bool
+ResultWasRecorded(mobius_data_set *DataSet, const char *Name, const char * const *IndexNames, size_t IndexCount)
+{
+	if(!DataSet->HasBeenRun || !DataSet->ResultData)
+		return false;
+	
+	equation_h Equation = GetEquationHandle(DataSet->Model, Name);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Equation, IndexNames, IndexCount, DataSet->ResultStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Got the wrong amount of indexes when checking the result series for \"", Name, "\". Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	size_t Stride;
+	return (!DataSet->PackedIndex.empty() && DataSet->PackedIndex[Offset] >= 0) || ResultSeriesLocation(DataSet, Offset, &Stride);
+}
+
+static size_t
+InputSeriesOffset(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount, bool AlignWithResults, s64 *TimestepOffset)
+{
+	//NOTE: Returns the offset of the input series in the input storage structure, and in TimestepOffset the timestep of the input data that the series starts at.
+	if(!InputStorageIsAllocated(DataSet))
 		FatalError("ERROR: Tried to extract input series before input data was allocated.\n");
 	
 	const mobius_model *Model = DataSet->Model;
@@ -1156,26 +1915,39 @@ GetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *I
 	if(Error >= 0)
 		FatalError("ERROR: Tried to get the input series \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
 	
-	double *Lookup = DataSet->InputData + Offset;
-	
-	s64 TimestepOffset = 0;
+	*TimestepOffset = 0;
 	if(AlignWithResults && DataSet->InputDataHasSeparateStartDate)
 	{
 		//NOTE: In case the user asked for a input timeseries that starts at the start of the modelrun rather than at the start of the input series.
 		datetime DataSetStartDate = GetStartDate(DataSet);
 		datetime InputStartDate   = DataSet->InputDataStartDate;
-		TimestepOffset = FindTimestep(InputStartDate, DataSetStartDate, Model->TimestepSize);
-		Lookup += TimestepOffset * DataSet->InputStorageStructure.TotalCount;
+		*TimestepOffset = FindTimestep(InputStartDate, DataSetStartDate, Model->TimestepSize);
 	}
+	return Offset;
+}
+
+static void
+GetInputSeries(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount, double *WriteTo, size_t WriteSize, bool AlignWithResults = false)
+{	
+	s64 TimestepOffset;
+	size_t Offset = InputSeriesOffset(DataSet, Name, Indexes, IndexCount, AlignWithResults, &TimestepOffset);
+	
+	size_t Stride = DataSet->InputStorageStructure.TotalCount;
+	size_t First = Offset + TimestepOffset*Stride;
 	
 	//TODO: If we ask for more values than we could get, should there not be an error?
 	s64 NumToWrite = Min((s64)WriteSize, (s64)DataSet->InputDataTimesteps - TimestepOffset);
 	NumToWrite = Max(0, NumToWrite);
 	
-	for(size_t Idx = 0; Idx < NumToWrite; ++Idx)
+	if(DataSet->SingleInputData)
 	{
-		WriteTo[Idx] = *Lookup;
-		Lookup += DataSet->InputStorageStructure.TotalCount;
+		for(size_t Idx = 0; Idx < NumToWrite; ++Idx)
+			WriteTo[Idx] = (double)DataSet->SingleInputData[First + Idx*Stride];
+	}
+	else
+	{
+		for(size_t Idx = 0; Idx < NumToWrite; ++Idx)
+			WriteTo[Idx] = DataSet->InputData[First + Idx*Stride];
 	}
 }
 
@@ -1185,10 +1957,230 @@ GetInputSeries(mobius_data_set *DataSet, const char *Name, const std::vector<con
 	GetInputSeries(DataSet, Name, IndexNames.data(), IndexNames.size(), WriteTo, WriteSize, AlignWithResults);
 }
 
+struct series_view
+{
+	const u8 *Data;           //NOTE: The first value of the series, or nullptr if it can not be viewed in place.
+	size_t    Count;
+	size_t    Stride;         //NOTE: The distance in bytes between consecutive values.
+	size_t    ElementSize;    //NOTE: sizeof(double), or sizeof(float) if the series is stored in single precision.
+};
+
+// NOTE: GetResultSeriesView and GetInputSeriesView give the location of a series in the storage of the data set, so that it can be read without copying it out with GetResultSeries or GetInputSeries.
+// A result view is only valid until the model is run again. The next run may free or move the result storage, or overwrite it in place, and changes to how results are stored (RecordResult, SetSinglePrecisionStorage, SetCompressedResults, SetSeriesMajorResults, SetMappedStorage) take effect then. An input view is valid until the input storage is allocated again (e.g. by reading inputs from a file); SetInputSeries writes through to it. Views are read-only: the inputs have to be changed with SetInputSeries so that incremental runs see the change (see InputsChanged). No view is valid after the data set is deleted.
+static series_view
+GetResultSeriesView(mobius_data_set *DataSet, const char *Name, const char* const* Indexes, size_t IndexCount, bool IncludeInitial = false)
+{
+	size_t Offset = ResultSeriesOffset(DataSet, Name, Indexes, IndexCount);
+	
+	series_view View = {};
+	View.Count = DataSet->TimestepsLastRun + (IncludeInitial ? 1 : 0);
+	
+	//NOTE: Compressed results only exist in packed blocks, so they have to be copied out with GetResultSeries.
+	if(DataSet->CompressedResults.Active && DataSet->PackedIndex[Offset] >= 0)
+		return View;
+	
+	size_t Stride;
+	float *SingleLookup = SingleResultSeriesLocation(DataSet, Offset, &Stride);
+	if(SingleLookup)
+	{
+		View.ElementSize = sizeof(float);
+		View.Stride      = Stride*sizeof(float);
+		View.Data        = (const u8 *)(IncludeInitial ? SingleLookup : SingleLookup + Stride);
+		return View;
+	}
+	
+	double *Lookup = ResultSeriesLocation(DataSet, Offset, &Stride);
+	if(!Lookup)
+		FatalError("ERROR: The result series \"", Name, "\" with the given indexes was not recorded during the last model run. Use RecordResult (or DataSet.record_result in Python) to record it.\n");
+	
+	View.ElementSize = sizeof(double);
+	View.Stride      = Stride*sizeof(double);
+	View.Data        = (const u8 *)(IncludeInitial ? Lookup : Lookup + Stride);
+	return View;
+}
+
+static series_view
+GetInputSeriesView(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount, bool AlignWithResults = false)
+{
+	//NOTE: If AlignWithResults is set, the view starts at the start date of the model run and ends where the input data ends, which may be before the end of the run.
+	s64 TimestepOffset;
+	size_t Offset = InputSeriesOffset(DataSet, Name, Indexes, IndexCount, AlignWithResults, &TimestepOffset);
+	
+	series_view View = {};
+	if(TimestepOffset < 0) return View; //NOTE: The run starts before the input data. GetInputSeries can pad that, but a view can not.
+	
+	if(AlignWithResults)
+		View.Count = (size_t)Max(0, Min((s64)GetTimesteps(DataSet), (s64)DataSet->InputDataTimesteps - TimestepOffset));
+	else
+		View.Count = DataSet->InputDataTimesteps;
+	
+	size_t Stride = DataSet->InputStorageStructure.TotalCount;
+	size_t First  = Offset + TimestepOffset*Stride;
+	if(DataSet->SingleInputData)
+	{
+		View.ElementSize = sizeof(float);
+		View.Data        = (const u8 *)(DataSet->SingleInputData + First);
+	}
+	else
+	{
+		View.ElementSize = sizeof(double);
+		View.Data        = (const u8 *)(DataSet->InputData + First);
+	}
+	View.Stride = Stride*View.ElementSize;
+	return View;
+}
+
+//NOTE: A series batch is a list of result series, input series and parameters of a data set whose names and indexes are looked up once, when they are added. All of them can then be read or written with one call (e.g. in every iteration of a calibration) instead of one call per series, see GetBatchResults, SetBatchParameters and SetBatchInputs.
+struct series_batch
+{
+	mobius_data_set *DataSet;  //NOTE: Must not be deleted before the batch. If its index sets are changed, the batch has to be recreated.
+	
+	std::vector<size_t>         ResultOffsets;     //NOTE: Where in (one timestep of) the result storage each result series is.
+	std::vector<const char *>   ResultNames;       //NOTE: For error messages.
+	std::vector<size_t>         InputOffsets;
+	std::vector<const char *>   InputNames;
+	std::vector<size_t>         ParameterOffsets;
+	std::vector<parameter_h>    Parameters;
+};
+
+static void
+AddBatchResult(series_batch *Batch, const char *Name, const char * const *Indexes, size_t IndexCount)
+{
+	//NOTE: The results are the rows of the matrix written by GetBatchResults in the order they were added.
+	mobius_data_set *DataSet = Batch->DataSet;
+	const mobius_model *Model = DataSet->Model;
+	
+	equation_h Equation = GetEquationHandle(Model, Name);
+	if(Model->Equations[Equation].Type == EquationType_InitialValue)
+		FatalError("ERROR: Can not get the result series of the equation \"", Name, "\", because it is an initial value equation.\n");
+	
+	SetupResultStorageStructure(DataSet);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Equation, Indexes, IndexCount, DataSet->ResultStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to get the result series of the equation \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	Batch->ResultOffsets.push_back(Offset);
+	Batch->ResultNames.push_back(Model->Equations[Equation].Name);
+}
+
+static void
+AddBatchInput(series_batch *Batch, const char *Name, const char * const *Indexes, size_t IndexCount)
+{
+	//NOTE: The inputs are the rows of the matrix given to SetBatchInputs in the order they were added.
+	mobius_data_set *DataSet = Batch->DataSet;
+	const mobius_model *Model = DataSet->Model;
+	
+	if(!InputStorageIsAllocated(DataSet))
+		FatalError("ERROR: Tried to add an input series to a batch before the input data was allocated.\n");
+	
+	input_h Input = GetInputHandle(Model, Name);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Input, Indexes, IndexCount, DataSet->InputStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to set the value of the input series \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	Batch->InputOffsets.push_back(Offset);
+	Batch->InputNames.push_back(Model->Inputs[Input].Name);
+}
+
+static void
+AddBatchParameter(series_batch *Batch, const char *Name, const char * const *Indexes, size_t IndexCount)
+{
+	//NOTE: The parameters are the values given to SetBatchParameters in the order they were added.
+	mobius_data_set *DataSet = Batch->DataSet;
+	const mobius_model *Model = DataSet->Model;
+	
+	if(!DataSet->ParameterData)
+		AllocateParameterStorage(DataSet);
+	
+	parameter_h Parameter = GetParameterHandle(Model, Name);
+	parameter_type Type = Model->Parameters[Parameter].Type;
+	if(Type == ParameterType_Time)
+		FatalError("ERROR: The parameter \"", Name, "\" is a date parameter, and it can not be set in a batch.\n");
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Parameter, Indexes, IndexCount, DataSet->ParameterStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR; Tried to set the value of the parameter \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	Batch->ParameterOffsets.push_back(Offset);
+	Batch->Parameters.push_back(Parameter);
+}
+
+static void
+GetBatchResults(series_batch *Batch, double *WriteTo, size_t Timesteps)
+{
+	//NOTE: Writes the result series of the batch from the last run as the rows of a matrix with Timesteps columns. If the last run was shorter, the ends of the rows are not written to.
+	mobius_data_set *DataSet = Batch->DataSet;
+	if(!DataSet->HasBeenRun || !DataSet->ResultData)
+		FatalError("ERROR: Tried to extract result series before the model was run at least once.\n");
+	
+	u64 NumToWrite = Min(Timesteps, DataSet->TimestepsLastRun);
+	
+	//NOTE: Results that are packed (see CopyResultSeries) are copied one series at a time. The others are copied in tiles of timesteps, so that when they are stored one timestep after the other, each timestep is read from memory once for all the series in the batch rather than once per series.
+	std::vector<const double *> Sources;
+	std::vector<size_t>         Strides;
+	std::vector<double *>       Rows;
+	for(size_t Idx = 0; Idx < Batch->ResultOffsets.size(); ++Idx)
+	{
+		size_t Offset = Batch->ResultOffsets[Idx];
+		double *Row = WriteTo + Idx*Timesteps;
+		size_t Stride;
+		if((DataSet->CompressedResults.Active && DataSet->PackedIndex[Offset] >= 0) || SingleResultSeriesLocation(DataSet, Offset, &Stride))
+		{
+			CopyResultSeries(DataSet, Offset, Batch->ResultNames[Idx], Row, NumToWrite, false);
+			continue;
+		}
+		double *Lookup = ResultSeriesLocation(DataSet, Offset, &Stride);
+		if(!Lookup)
+			FatalError("ERROR: The result series \"", Batch->ResultNames[Idx], "\" with the given indexes was not recorded during the last model run. Use RecordResult (or DataSet.record_result in Python) to record it.\n");
+		Sources.push_back(Lookup + Stride); //NOTE: Skip the initial value.
+		Strides.push_back(Stride);
+		Rows.push_back(Row);
+	}
+	
+	const size_t Tile = 32;
+	for(size_t First = 0; First < NumToWrite; First += Tile)
+	{
+		size_t End = Min(First + Tile, (size_t)NumToWrite);
+		for(size_t Series = 0; Series < Sources.size(); ++Series)
+		{
+			const double *Source = Sources[Series];
+			size_t Stride = Strides[Series];
+			double *Row = Rows[Series];
+			for(size_t Timestep = First; Timestep < End; ++Timestep)
+				Row[Timestep] = Source[Timestep*Stride];
+		}
+	}
+}
+
+static void
+SetBatchParameters(series_batch *Batch, const double *Values)
+{
+	//NOTE: Sets the parameters of the batch to Values, in the order they were added. Integer, boolean and enum parameters are converted from the double values (see ParameterValueFromDouble). If any of the values is invalid, none of them are set.
+	mobius_data_set *DataSet = Batch->DataSet;
+	for(size_t Idx = 0; Idx < Batch->Parameters.size(); ++Idx)
+		ParameterValueFromDouble(DataSet->Model, Batch->Parameters[Idx], Values[Idx]);
+	for(size_t Idx = 0; Idx < Batch->Parameters.size(); ++Idx)
+		DataSet->ParameterData[Batch->ParameterOffsets[Idx]] = ParameterValueFromDouble(DataSet->Model, Batch->Parameters[Idx], Values[Idx]);
+}
+
+static void
+SetBatchInputs(series_batch *Batch, const double *Values, size_t Length, bool AlignWithResults = false)
+{
+	//NOTE: Sets the input series of the batch to the rows of the matrix Values, which has Length columns, in the order they were added. Works like SetInputSeries for each row.
+	mobius_data_set *DataSet = Batch->DataSet;
+	for(size_t Idx = 0; Idx < Batch->InputOffsets.size(); ++Idx)
+		WriteInputSeries(DataSet, Batch->InputOffsets[Idx], Batch->InputNames[Idx], Values + Idx*Length, Length, AlignWithResults);
+}
+
 static bool
 InputSeriesWasProvided(mobius_data_set *DataSet, const char *Name, const char * const *Indexes, size_t IndexCount)
 {
-	if(!DataSet->InputData)
+	if(!InputStorageIsAllocated(DataSet))
 		FatalError("ERROR: Tried to see if an input series was provided before input data was even allocated.\n");
 	
 	const mobius_model *Model = DataSet->Model;
@@ -1210,6 +2202,283 @@ InputSeriesWasProvided(mobius_data_set *DataSet, const char *Name, const std::ve
 	return InputSeriesWasProvided(DataSet, Name, IndexNames.data(), IndexNames.size());
 }
 
+// NOTE: Registers a goodness of fit statistic between a result series and an observed input series. The statistics (see objective_statistic) are accumulated while the model runs, and can be read with GetObjectiveStatistics after each run. This is much cheaper than extracting the series after each run, e.g. in calibration. Observations that are NaN (missing) are skipped, and so are the first SkipTimesteps timesteps. Returns the number of the objective.
+// If the index sets of the data set are changed, the objectives have to be cleared and added again.
+static size_t
+AddObjective(mobius_data_set *DataSet, const char *ResultName, const char * const *ResultIndexes, size_t ResultIndexCount, const char *InputName, const char * const *InputIndexes, size_t InputIndexCount, u64 SkipTimesteps = 0)
+{
+	if(!InputStorageIsAllocated(DataSet))
+		FatalError("ERROR: Tried to add an objective before the input data was allocated.\n");
+	
+	const mobius_model *Model = DataSet->Model;
+	
+	equation_h Equation = GetEquationHandle(Model, ResultName);
+	if(Model->Equations[Equation].Type == EquationType_InitialValue)
+		FatalError("ERROR: Can not use the result series of the equation \"", ResultName, "\" in an objective, because it is an initial value equation.\n");
+	input_h Input = GetInputHandle(Model, InputName);
+	
+	SetupResultStorageStructure(DataSet);
+	
+	objective_accumulator Objective = {};
+	int Error;
+	Objective.ResultOffset = GetOffset(DataSet, Equation, ResultIndexes, ResultIndexCount, DataSet->ResultStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to use the result series of the equation \"", ResultName, "\" in an objective, but an incorrect number of indexes were provided. Got ", ResultIndexCount, ", expected ", Error, ".\n");
+	Objective.InputOffset = GetOffset(DataSet, Input, InputIndexes, InputIndexCount, DataSet->InputStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to use the input series \"", InputName, "\" in an objective, but an incorrect number of indexes were provided. Got ", InputIndexCount, ", expected ", Error, ".\n");
+	if(!DataSet->InputTimeseriesWasProvided[Objective.InputOffset])
+		FatalError("ERROR: Tried to use the input series \"", InputName, "\" in an objective, but it was not provided in the input data.\n");
+	Objective.SkipTimesteps = SkipTimesteps;
+	
+	DataSet->Objectives.push_back(Objective);
+	return DataSet->Objectives.size() - 1;
+}
+
+inline size_t
+AddObjective(mobius_data_set *DataSet, const char *ResultName, const std::vector<const char *> &ResultIndexes, const char *InputName, const std::vector<const char *> &InputIndexes, u64 SkipTimesteps = 0)
+{
+	return AddObjective(DataSet, ResultName, ResultIndexes.data(), ResultIndexes.size(), InputName, InputIndexes.data(), InputIndexes.size(), SkipTimesteps);
+}
+
+inline void
+ClearObjectives(mobius_data_set *DataSet)
+{
+	DataSet->Objectives.clear();
+}
+
+inline const double *
+GetObjectiveStatistics(mobius_data_set *DataSet, size_t ObjectiveIdx)
+{
+	//NOTE: Returns ObjectiveStatistic_Count values, indexed by objective_statistic.
+	if(ObjectiveIdx >= DataSet->Objectives.size())
+		FatalError("ERROR: Tried to get the statistics of objective number ", ObjectiveIdx, ", but only ", DataSet->Objectives.size(), " objectives were added.\n");
+	if(!DataSet->HasBeenRun)
+		FatalError("ERROR: Tried to get objective statistics before the model was run.\n");
+	
+	return DataSet->Objectives[ObjectiveIdx].Statistics;
+}
+
+inline void
+SetIncrementalRuns(mobius_data_set *DataSet, bool Incremental)
+{
+	//NOTE: If incremental runs are turned on, RunModel only reevaluates the batch groups that are affected by the parameters that changed since the last run on this data set, and reuses the results of the others from the last run (see SetupIncrementalRun). This gives the same results as a full run.
+	//  Results can only be reused from a finished run that stored all its results (without a result sink or selective recording) over the same timesteps, so the first run after this is always a full one.
+	DataSet->IncrementalRuns = Incremental;
+	DataSet->ParameterDataLastRun.clear();
+}
+
+inline void
+SetSeriesMajorResults(mobius_data_set *DataSet, bool SeriesMajor)
+{
+	//NOTE: If this is turned on, the results are transposed to be stored series by series after every finished run (see TransposeResults), so that GetResultSeries and the functions that build on it read them from contiguous memory. This is useful when many series are read out after each run, for instance for plotting or calibration of large setups.
+	//  The model run itself needs the results timestep by timestep, so the series-major results are kept in addition to them. This doubles the memory used for results. If results are streamed to a result sink, only the recorded ones are transposed.
+	DataSet->SeriesMajorResults = SeriesMajor;
+	if(SeriesMajor && DataSet->HasBeenRun && !DataSet->HasSeriesResults)
+		TransposeResults(DataSet);
+	else if(!SeriesMajor)
+	{
+		if(DataSet->SeriesResultData) free(DataSet->SeriesResultData);
+		DataSet->SeriesResultData     = nullptr;
+		DataSet->SeriesResultDataSize = 0;
+		DataSet->HasSeriesResults     = false;
+	}
+}
+
+static void
+SetSinglePrecisionStorage(mobius_data_set *DataSet, bool Results, bool Inputs)
+{
+	//NOTE: Selects whether results and inputs are stored as float instead of double, which halves the memory they use. The equations are still evaluated in double precision. The model run keeps the timestep it is at and the one before it in double precision (so LAST_RESULT reads unrounded values), and the results accessed by EARLIER_RESULT are kept in double precision too, so the model behaves the same as with double precision storage except for the rounding of the inputs. GetResultSeries, GetInputSeries and SetInputSeries convert at the boundary.
+	//  With single precision results every timestep is copied out of the working window of the run (as when only some results are recorded, see RecordResult), so incremental runs and the evaluation of equations before the run loop are not used, and no series-major copy of the results is made (see SetSeriesMajorResults). The new setting for results applies from the next run.
+	//  Inputs that are already allocated are converted right away. This can not be done for a data set that borrows the inputs of another one (see CopyDataSet).
+	DataSet->SinglePrecisionResults = Results;
+	DataSet->SinglePrecisionInputs  = Inputs;
+	
+	if(!InputStorageIsAllocated(DataSet) || (Inputs == (DataSet->SingleInputData != nullptr)))
+		return;
+	
+	if(!DataSet->OwnsInputs)
+		FatalError("ERROR: Can not change the precision of the input data of a data set that borrows its inputs from another data set.\n");
+	if(DataSet->MappedInputs.Data && !DataSet->MappedInputs.CopyOnWrite)
+		FatalError("ERROR: Can not change the precision of input data that is stored in a mapped file. Set the precision before the inputs are allocated.\n");
+	
+	size_t Count = DataSet->InputStorageStructure.TotalCount * DataSet->InputDataTimesteps;
+	void *Old;
+	if(Inputs)
+	{
+		DataSet->SingleInputData = AllocClearedArray(float, Count);
+		for(size_t Idx = 0; Idx < Count; ++Idx)
+			DataSet->SingleInputData[Idx] = (float)DataSet->InputData[Idx];
+		Old = DataSet->InputData;
+		DataSet->InputData = nullptr;
+	}
+	else
+	{
+		DataSet->InputData = AllocClearedArray(double, Count);
+		for(size_t Idx = 0; Idx < Count; ++Idx)
+			DataSet->InputData[Idx] = (double)DataSet->SingleInputData[Idx];
+		Old = DataSet->SingleInputData;
+		DataSet->SingleInputData = nullptr;
+	}
+	if(DataSet->MappedInputs.Data)
+	{
+		//NOTE: The inputs were mapped from a binary input file (see ReadInputsFromBinaryFile). The flags of which series were provided are in the same mapping, so they are copied before it is closed.
+		DataSet->InputTimeseriesWasProvided = DataSet->BucketMemory.Copy(DataSet->InputTimeseriesWasProvided, DataSet->InputStorageStructure.TotalCount);
+		CloseMappedFile(&DataSet->MappedInputs);
+	}
+	else
+		free(Old);
+	InputsChanged(DataSet);
+}
+
+inline void
+SetCompressedResults(mobius_data_set *DataSet, bool Compressed, size_t BlockSize = 64)
+{
+	//NOTE: If this is turned on, the results are compressed losslessly while the model runs, in blocks of BlockSize timesteps (see CompressResultBlock), and GetResultSeries decompresses a series when it is read. Only the block that is being filled is kept uncompressed, and the results accessed with EARLIER_RESULT are kept uncompressed too. This is useful for long runs where most results change slowly, e.g. state variables such as water volumes or pools. The results of RecordResult apply as usual, so if only some results are recorded, only those are compressed.
+	//  As with single precision storage (see SetSinglePrecisionStorage), incremental runs, the evaluation of equations before the run loop and series-major results are not used with compressed results. If both are turned on, the results are compressed, not stored in single precision. The new setting applies from the next run.
+	if(Compressed && BlockSize == 0)
+		FatalError("ERROR: The block size of compressed results has to be at least 1.\n");
+	DataSet->CompressResults = Compressed;
+	if(Compressed) DataSet->CompressionBlockSize = BlockSize;
+}
+
+static void
+SetMappedStorage(mobius_data_set *DataSet, const char *Path)
+{
+	//NOTE: If this is turned on, the input data is placed in the file Path.inputs and the results in the file Path.results instead of in memory. The files are memory-mapped, so the data can be larger than the physical memory: the operating system reads and writes the parts of it that are in use, and the model run reads and writes each timestep after the other, which streams through the files. The files are left on disk, and can be opened again with OpenMappedStorage.
+	//  Results are only placed in the file if all of them are stored (i.e. not with selective recording, packed storage or a result sink, which keep little in memory anyway). Equations are not evaluated before the run loop with mapped results (see RunHoistedEquations), since that writes each series across the whole file.
+	//  This applies to inputs that are allocated after it is turned on, and to the results from the next run. An empty or null Path turns it off. Copies of the data set (see CopyDataSet) keep their own data in memory, but they can borrow the mapped inputs.
+	DataSet->MappedStoragePath = Path ? Path : "";
+}
+
+static void
+OpenMappedStorage(mobius_data_set *DataSet, const char *Path)
+{
+	//NOTE: Opens the files Path.inputs and Path.results that were written using SetMappedStorage, for instance by a data set in an earlier session, so that the inputs and the results of the last run stored in them can be read without running the model again. The data set has to have the same indexes as the one that wrote the files (e.g. be set up from the same parameter file). The inputs are only opened if the data set does not have inputs yet. Later runs of the data set are stored in the same files.
+	EnsureIndexesHaveBeenSet(DataSet);
+	std::string Base = Path;
+	bool Found = false;
+	
+	mapped_file Mapped = {};
+	std::string Filename = Base + ".inputs";
+	if(!InputStorageIsAllocated(DataSet) && OpenMappedFile(&Mapped, Filename.c_str(), 0, false))
+	{
+		SetupInputStorageStructure(DataSet);
+		size_t ValuesPerRow = DataSet->InputStorageStructure.TotalCount;
+		mapped_storage_header *Header = (mapped_storage_header *)Mapped.Data;
+		if(Mapped.Size < sizeof(mapped_storage_header) || memcmp(Header->Identifier, MappedInputFileIdentifier, sizeof(MappedInputFileIdentifier)) != 0
+			|| Header->ValuesPerRow != ValuesPerRow || (Header->ElementSize != sizeof(double) && Header->ElementSize != sizeof(float))
+			|| Header->DataOffset + Header->ElementSize*Header->Rows*ValuesPerRow > Mapped.Size)
+		{
+			CloseMappedFile(&Mapped);
+			FatalError("ERROR: The file \"", Filename, "\" does not hold the inputs of a data set with the same indexes as this one.\n");
+		}
+		DataSet->MappedInputs = Mapped;
+		DataSet->OwnsInputs = true;
+		DataSet->SinglePrecisionInputs = (Header->ElementSize == sizeof(float));
+		u8 *Data = Mapped.Data + Header->DataOffset;
+		if(DataSet->SinglePrecisionInputs)
+			DataSet->SingleInputData = (float *)Data;
+		else
+			DataSet->InputData = (double *)Data;
+		DataSet->InputDataTimesteps = Header->Rows;
+		DataSet->InputDataStartDate.SecondsSinceEpoch = Header->StartDate;
+		DataSet->InputDataHasSeparateStartDate = (Header->Flag != 0);
+		DataSet->InputTimeseriesWasProvided = (bool *)(Mapped.Data + sizeof(mapped_storage_header));
+		AdviseSequentialAccess(&DataSet->MappedInputs);
+		InputsChanged(DataSet);
+		Found = true;
+	}
+	
+	Mapped = {};
+	Filename = Base + ".results";
+	if(OpenMappedFile(&Mapped, Filename.c_str(), 0, false))
+	{
+		SetupResultStorageStructure(DataSet);
+		size_t ValuesPerRow = DataSet->ResultStorageStructure.TotalCount;
+		mapped_storage_header *Header = (mapped_storage_header *)Mapped.Data;
+		if(Mapped.Size < sizeof(mapped_storage_header) || memcmp(Header->Identifier, MappedResultFileIdentifier, sizeof(MappedResultFileIdentifier)) != 0
+			|| Header->ValuesPerRow != ValuesPerRow || Header->ElementSize != sizeof(double)
+			|| Header->DataOffset + sizeof(double)*Header->Rows*ValuesPerRow > Mapped.Size)
+		{
+			CloseMappedFile(&Mapped);
+			FatalError("ERROR: The file \"", Filename, "\" does not hold the results of a data set with the same indexes as this one.\n");
+		}
+		if(Header->Rows == 0)
+			WarningPrint("WARNING: The file \"", Filename, "\" does not hold the results of a model run.\n");
+		else if(!Header->Flag)
+			WarningPrint("WARNING: The model run that wrote the results in the file \"", Filename, "\" did not finish. The results of the timesteps it did not reach are 0.\n");
+		
+		if(DataSet->MappedResults.Data)
+			CloseMappedFile(&DataSet->MappedResults);
+		else if(DataSet->ResultData)
+			free(DataSet->ResultData);
+		DataSet->MappedResults  = Mapped;
+		DataSet->ResultData     = (double *)(Mapped.Data + Header->DataOffset);
+		DataSet->ResultDataSize = (Mapped.Size - Header->DataOffset) / sizeof(double);
+		
+		//NOTE: The results in the file are the only results of the data set now.
+		DataSet->ResultWindow = 0;
+		DataSet->RecordedOffsets.clear();
+		DataSet->RecordedIndex.clear();
+		DataSet->PackedOffsets.clear();
+		DataSet->PackedIndex.clear();
+		DataSet->CompressedResults.Active = false;
+		AllocateClearedResultArray(&DataSet->RecordedResultData, &DataSet->RecordedResultDataSize, 0);
+		AllocateClearedResultArray(&DataSet->SingleResultData, &DataSet->SingleResultDataSize, 0);
+		DataSet->HasSeriesResults = false;
+		DataSet->ParameterDataLastRun.clear();
+		
+		DataSet->HasBeenRun       = (Header->Rows != 0);
+		DataSet->TimestepsLastRun = (Header->Rows != 0) ? Header->Rows - 1 : 0;
+		DataSet->StartDateLastRun.SecondsSinceEpoch = Header->StartDate;
+		if(DataSet->SeriesMajorResults && DataSet->HasBeenRun)
+			TransposeResults(DataSet);
+		Found = true;
+	}
+	
+	if(!Found)
+		FatalError("ERROR: Did not find the files \"", Base, ".inputs\" or \"", Base, ".results\", or the data set already has inputs and there are no results.\n");
+	
+	DataSet->MappedStoragePath = Base;
+}
+
+inline const incremental_run_report &
+GetIncrementalRunReport(mobius_data_set *DataSet)
+{
+	//NOTE: How much of the last run was reused from the run before it. Everything is 0 if the last run was not incremental.
+	if(!DataSet->HasBeenRun)
+		FatalError("ERROR: Tried to get the incremental run report before the model was run.\n");
+	
+	return DataSet->IncrementalRunReport;
+}
+
+static hoisting_report
+GetHoistingReport(mobius_data_set *DataSet)
+{
+	//NOTE: How many of the equations of the model (and how many of the result values per timestep) are evaluated before the run loop instead of inside it, and how many of those are constant. The index sets have to be set.
+	const mobius_model *Model = DataSet->Model;
+	SetupResultStorageStructure(DataSet);
+	
+	hoisting_report Report = {};
+	size_t BatchGroupIdx = 0;
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		const storage_unit_specifier<equation_h> &Unit = DataSet->ResultStorageStructure.Units[BatchGroupIdx];
+		size_t TupleCount = DataSet->ResultStorageStructure.TotalCountForUnit[BatchGroupIdx] / Unit.Handles.Count;
+		
+		Report.HoistedEquations += BatchGroup.Hoisted.Equations.Count;
+		Report.EquationCount    += Unit.Handles.Count;
+		Report.HoistedResults   += BatchGroup.Hoisted.Equations.Count * TupleCount;
+		Report.ConstantEquations += BatchGroup.Hoisted.Constant.Count;
+		Report.ConstantResults   += BatchGroup.Hoisted.Constant.Count * TupleCount;
+		++BatchGroupIdx;
+	}
+	Report.ResultCount = DataSet->ResultStorageStructure.TotalCount;
+	
+	return Report;
+}
+
 inline bool
 EquationWasComputed(mobius_data_set *DataSet, const char *Name, const char * const *IndexNames, size_t IndexCount)
 {
@@ -538,6 +538,7 @@ struct mobius_input_reader
 {
 	//TODO: Need some error printing context
 	double *InputBase;
+	float  *SingleInputBase; //NOTE: Used instead of InputBase if the inputs are stored in single precision, see SetSinglePrecisionStorage.
 	std::vector<size_t> Offsets;
 	size_t StepStride;
 	input_series_flags Flags;
@@ -551,9 +552,9 @@ struct mobius_input_reader
 	std::vector<double>   YVals;
 	
 	
-	mobius_input_reader(double *InputBase, size_t StepStride, input_series_flags Flags, timestep_size TimestepSize, 
+	mobius_input_reader(double *InputBase, float *SingleInputBase, size_t StepStride, input_series_flags Flags, timestep_size TimestepSize, 
 		const std::vector<size_t> &Offsets, datetime InputStartDate, s64 InputDataTimesteps, const std::function<void(void)> &ErrorCleanup) 
-		: InputBase(InputBase), StepStride(StepStride), Flags(Flags), TimestepSize(TimestepSize), Offsets(Offsets), InputStartDate(InputStartDate), InputDataTimesteps(InputDataTimesteps),
+		: InputBase(InputBase), SingleInputBase(SingleInputBase), StepStride(StepStride), Flags(Flags), TimestepSize(TimestepSize), Offsets(Offsets), InputStartDate(InputStartDate), InputDataTimesteps(InputDataTimesteps),
 		  ErrorCleanup(ErrorCleanup)
 	{
 	}
@@ -564,8 +565,10 @@ struct mobius_input_reader
 		{
 			for(size_t Offset : Offsets)
 			{
-				double *WriteTo = InputBase + Offset + Timestep*StepStride;
-				*WriteTo = Value;
+				if(SingleInputBase)
+					SingleInputBase[Offset + Timestep*StepStride] = (float)Value;
+				else
+					InputBase[Offset + Timestep*StepStride] = Value;
 			}
 		}
 	}
@@ -642,9 +645,10 @@ struct mobius_input_reader
 	{
 		for(size_t Offset : Offsets)
 		{
-			double *ReadFrom = InputBase + Offset + FromStep*StepStride;
-			double *WriteTo  = InputBase + Offset + ToStep*StepStride;
-			*WriteTo = *ReadFrom;
+			if(SingleInputBase)
+				SingleInputBase[Offset + ToStep*StepStride] = SingleInputBase[Offset + FromStep*StepStride];
+			else
+				InputBase[Offset + ToStep*StepStride] = InputBase[Offset + FromStep*StepStride];
 		}
 	}
 	
@@ -854,15 +858,265 @@ struct mobius_input_reader
 };
 
 
+struct input_series_block
+{
+	//NOTE: The values of one input series in an input file. ReadInputSeries only reads the header of the series with the token stream, and the values are read later, possibly on another thread, by ParseInputSeriesBlock.
+	file_position Begin;
+	const char   *End;        //NOTE: The next quoted string (the name of the next input series or an included file), or the end of the file.
+	const char   *ResumeAt;   //NOTE: Where the token stream continues after the values. This is End, or an identifier (like include_file) right before it.
+	const char   *FileEnd;
+	const char   *Filename;
+	u64           Timesteps;
+	input_series_flags Flags;
+	std::unique_ptr<mobius_input_reader> Reader;
+	value_scan_error Error;
+};
+
+struct input_series_parser
+{
+	//NOTE: The blocks of input series values that ReadInputSeries has found in an input file (and the files it includes), but not yet parsed, see ParseInputSeriesBlocks.
+	mobius_data_set *DataSet;
+	std::vector<std::unique_ptr<input_series_block>> Blocks;
+	std::vector<bool> Pending;     //NOTE: For each input series offset, if a block in Blocks writes to it.
+	size_t            PendingSize; //NOTE: The number of bytes of values in Blocks.
+	thread_pool       Pool;
+	std::vector<std::string> IncludedFiles;
+};
+
+static void
+FindEndOfInputSeries(const char *Begin, const char *FileEnd, const char **End, const char **ResumeAt)
+{
+	//NOTE: Finds where the values of an input series that start at Begin end, without parsing them. They end at the first quotation mark that is not in a comment, or at the end of the file. If the last word before that is an identifier (like include_file), the token stream has to continue from that instead. NaN values are identifiers too, but they are a part of the values.
+	*End = FileEnd;
+	const char *At = Begin;
+	while(At != FileEnd)
+	{
+		const char *Quote = (const char *)memchr(At, '"', FileEnd - At);
+		if(!Quote) break;
+		const char *LineStart = Quote;
+		while(LineStart != Begin && LineStart[-1] != '\n') --LineStart;
+		if(!memchr(LineStart, '#', Quote - LineStart))
+		{
+			*End = Quote;
+			break;
+		}
+		const char *Newline = (const char *)memchr(Quote, '\n', FileEnd - Quote);
+		At = Newline ? Newline : FileEnd;
+	}
+	
+	*ResumeAt = *End;
+	
+	//NOTE: Look for the last word, going backwards one line at a time and skipping comments.
+	const char *SegmentEnd = *End;
+	while(true)
+	{
+		const char *LineStart = SegmentEnd;
+		while(LineStart != Begin && LineStart[-1] != '\n') --LineStart;
+		const char *Comment = (const char *)memchr(LineStart, '#', SegmentEnd - LineStart);
+		const char *WordEnd = Comment ? Comment : SegmentEnd;
+		while(WordEnd != LineStart && isspace(WordEnd[-1])) --WordEnd;
+		if(WordEnd != LineStart)
+		{
+			const char *WordStart = WordEnd;
+			while(WordStart != LineStart && !isspace(WordStart[-1])) --WordStart;
+			
+			token_string Word;
+			Word.Data   = WordStart;
+			Word.Length = WordEnd - WordStart;
+			bool WordIsIdentifier = IsIdentifier(*WordStart);
+			for(const char *C = WordStart; C != WordEnd; ++C)
+				WordIsIdentifier = WordIsIdentifier && (IsIdentifier(*C) || isdigit(*C));
+			if(WordIsIdentifier && !Word.Equals("NaN") && !Word.Equals("nan") && !Word.Equals("Nan"))
+				*ResumeAt = WordStart;
+			break;
+		}
+		if(LineStart == Begin) break;
+		SegmentEnd = LineStart - 1;
+	}
+}
+
+static bool
+ParseInputSeriesValues(value_scanner &Scanner, input_series_block *Block)
+{
+	mobius_input_reader &Reader = *Block->Reader;
+	const input_series_flags &Flags = Block->Flags;
+	token Token;
+	
+	//NOTE: For the first timestep, try to figure out what format the data was provided in.
+	if(!Scanner.PeekToken(&Token)) return false;
+	
+	if(IsNumeric(Token.Type))
+	{
+		for(u64 Timestep = 0; Timestep < Block->Timesteps; ++Timestep)
+		{
+			if(!Scanner.ReadToken(&Token)) return false;
+			if(!IsNumeric(Token.Type))
+			{
+				Scanner.SetError("Only got " + std::to_string(Timestep) + " values for series. Expected " + std::to_string(Block->Timesteps) + ".\n");
+				return false;
+			}
+			Reader.AddValue((s64)Timestep, Token.GetDoubleValue());
+		}
+		
+		//NOTE: The token stream continues at ResumeAt, so there should be nothing else before it.
+		Scanner.SkipBlank();
+		if(Scanner.Position.At != Block->ResumeAt)
+		{
+			if(!Scanner.ReadToken(&Token)) return false;
+			if(Token.Type == TokenType_Identifier)
+				Scanner.SetError("Unexpected command word " + std::string(Token.StringValue.Data, Token.StringValue.Length) + ".\n");
+			else
+				Scanner.SetError("Expected the quoted name of an input or an include_file directive.\n");
+			return false;
+		}
+	}
+	else if(Token.Type == TokenType_Date)
+	{
+		while(true)
+		{
+			datetime Date;
+			if(!Scanner.PeekToken(&Token)) return false;
+			
+			if(Token.Type == TokenType_Date)
+			{
+				if(!Scanner.ExpectDateTime(&Date)) return false;
+			}
+			else if(Token.Type == TokenType_QuotedString || Token.Type == TokenType_EOF)
+				break;
+			else
+			{
+				Scanner.SetError("Expected either a date or the beginning of a new input series.\n");
+				return false;
+			}
+			
+			if(!Scanner.PeekToken(&Token)) return false;
+			if(Token.Type == TokenType_Identifier)
+			{
+				if(Flags.InterpolationType != InterpolationType_None)
+				{
+					Scanner.SetError("Expected a number.\n");
+					return false;
+				}
+				
+				Scanner.ReadToken(&Token);
+				if(!Token.StringValue.Equals("to"))
+				{
+					Scanner.SetError("Expected either a 'to' or a number.\n");
+					return false;
+				}
+				datetime EndDateRange;
+				double Value;
+				if(!Scanner.ExpectDateTime(&EndDateRange) || !Scanner.ExpectDouble(&Value)) return false;
+				
+				//NOTE: The errors mobius_input_reader would give can not be printed from another thread, so we check for them here.
+				if(EndDateRange < Date)
+				{
+					Scanner.SetError("The end of the date range is earlier than the beginning.\n");
+					return false;
+				}
+				Reader.FillConstantRange(Date, EndDateRange, Value);
+			}
+			else if(IsNumeric(Token.Type))
+			{
+				double Value;
+				Scanner.ExpectDouble(&Value);
+				
+				if(Flags.InterpolationType != InterpolationType_None && std::isfinite(Value) && !Reader.XVals.empty() && Date <= Reader.XVals.back())
+				{
+					Scanner.SetError("In interpolation mode, the dates have to be in sequential order and non-overlapping.\n");
+					return false;
+				}
+				Reader.AddValue(Date, Value);
+			}
+			else
+			{
+				Scanner.SetError("Expected either a 'to' or a number.\n");
+				return false;
+			}
+		}
+	}
+	else
+	{
+		Scanner.SetError("Inputs are to be provided either as a series of numbers or a series of dates (or date ranges) together with numbers.\n");
+		return false;
+	}
+	
+	return true;
+}
+
+static void
+ParseInputSeriesBlock(input_series_block *Block)
+{
+	//NOTE: This can be called from several threads at once for different blocks, so it must not print anything. Errors are stored in Block->Error instead.
+	value_scanner Scanner(Block->Begin, Block->FileEnd);
+	if(!ParseInputSeriesValues(Scanner, Block))
+		Block->Error = Scanner.Error;
+}
+
+static void
+ParseInputSeriesBlocks(input_series_parser *Parser)
+{
+	//NOTE: Parses the values of all the blocks that were collected. No two blocks write to the same input series, so they are parsed on separate threads if there are enough of them. Errors are reported for the first block in the file that has one, and the blocks are finished (see mobius_input_reader::Finish) in the order of the file, so the outcome does not depend on the thread count.
+	std::vector<std::unique_ptr<input_series_block>> &Blocks = Parser->Blocks;
+	if(Blocks.empty()) return;
+	
+	constexpr size_t MinParallelSize = 1024*1024; //NOTE: It is not worth starting threads for less than this many bytes of values.
+	
+	size_t ThreadCount = Parser->DataSet->InputThreadCount;
+	if(ThreadCount == 0) ThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	
+	if(ThreadCount > 1 && Blocks.size() > 1 && Parser->PendingSize >= MinParallelSize)
+	{
+		//NOTE: The pool is started the first time it is needed, with the full thread count, and is reused for the later flushes of the same parser (e.g. after an include_file). Workers that find no blocks left just return.
+		if(Parser->Pool.WorkerCount == 1) Parser->Pool.Start(ThreadCount);
+		std::atomic<size_t> NextBlock(0);
+		Parser->Pool.Run([&Blocks, &NextBlock](size_t WorkerIdx)
+		{
+			while(true)
+			{
+				size_t BlockIdx = NextBlock++;
+				if(BlockIdx >= Blocks.size()) break;
+				ParseInputSeriesBlock(Blocks[BlockIdx].get());
+			}
+		});
+	}
+	else
+	{
+		for(auto &Block : Blocks)
+			ParseInputSeriesBlock(Block.get());
+	}
+	
+	for(auto &Block : Blocks)
+	{
+		if(!Block->Error.Message.empty())
+		{
+			ErrorPrint("ERROR: In file ", Block->Filename, " line ", (Block->Error.Line+1), " column ", Block->Error.Column, ": ");
+			FatalError(Block->Error.Message);
+		}
+		Block->Reader->Finish();
+	}
+	
+	Blocks.clear();
+	std::fill(Parser->Pending.begin(), Parser->Pending.end(), false);
+	Parser->PendingSize = 0;
+}
+
 static void
-ReadInputSeries(mobius_data_set *DataSet, token_stream &Stream)
+ReadInputSeries(input_series_parser *Parser, token_stream &Stream)
 {
+	//NOTE: Reads the input series in the inputs section of an input file. To make it faster to read large files, the token stream only reads the headers of the series. The values are handed to a value_scanner, and are parsed in bulk by ParseInputSeriesBlocks (on several threads if there are many of them).
+	mobius_data_set *DataSet = Parser->DataSet;
 	const mobius_model *Model = DataSet->Model;
 	
 	while(true)
 	{
 		token Token = Stream.ReadToken();
-		if(Token.Type == TokenType_EOF)	return;
+		if(Token.Type == TokenType_EOF)
+		{
+			//NOTE: The blocks point into the file data of the stream, so they have to be parsed before it is closed.
+			ParseInputSeriesBlocks(Parser);
+			return;
+		}
 		
 		if(Token.Type == TokenType_Identifier)
 		{
@@ -873,8 +1127,10 @@ ReadInputSeries(mobius_data_set *DataSet, token_stream &Stream)
 				//NOTE: The file path is given relatively to the current file, so we have to add any path of the current one in front.
 				const char *NewPath = MakePathRelativeTo(Stream.Filename, Filename);
 				token_stream SubStream(NewPath);
+				Parser->IncludedFiles.push_back(NewPath);
 				
-				ReadInputSeries(DataSet, SubStream);
+				ParseInputSeriesBlocks(Parser); //NOTE: So that the blocks are finished in the order of the files.
+				ReadInputSeries(Parser, SubStream);
 				
 				continue;
 			}
@@ -988,325 +1244,1107 @@ ReadInputSeries(mobius_data_set *DataSet, token_stream &Stream)
 		
 		u64 Timesteps = DataSet->InputDataTimesteps;
 		
-		auto HandleError = [&Stream]() { Stream.PrintErrorHeader(); };
-		
-		mobius_input_reader Reader(
-			DataSet->InputData, DataSet->InputStorageStructure.TotalCount, Flags,
-			Model->TimestepSize, Offsets, GetInputStartDate(DataSet), Timesteps, HandleError);
-		
-		//NOTE: This reads the actual data after the header.
-		
-		//NOTE: For the first timestep, try to figure out what format the data was provided in.
-		int FormatType = -1;
-		Token = Stream.PeekToken();
-		
-		if(IsNumeric(Token.Type))
-			FormatType = 0;
-		else if(Token.Type == TokenType_Date)
-			FormatType = 1;
-		else
-		{
-			Stream.PrintErrorHeader();
-			FatalError("Inputs are to be provided either as a series of numbers or a series of dates (or date ranges) together with numbers.\n");
-		}
+		std::unique_ptr<input_series_block> Block(new input_series_block);
+		Block->Begin     = Stream.GetPosition();
+		Block->Filename  = Stream.Filename;
+		Block->Timesteps = Timesteps;
+		Block->Flags     = Flags;
+		Block->FileEnd   = Stream.FileEnd();
+		FindEndOfInputSeries(Block->Begin.At, Block->FileEnd, &Block->End, &Block->ResumeAt);
 		
-
-		if(FormatType == 0)
-		{
-			for(u64 Timestep = 0; Timestep < Timesteps; ++Timestep)
-			{
-				Token = Stream.ReadToken();
-				if(!IsNumeric(Token.Type))
-				{
-					Stream.PrintErrorHeader();
-					FatalError("Only got ", Timestep, " values for series. Expected ", Timesteps, ".\n");
-				}
-				double Value = Token.GetDoubleValue();
-				Reader.AddValue(Timestep, Value);
-			}
-		}
-		else //FormatType == 1
+		//NOTE: Continue the token stream after the values.
+		file_position Resume = Block->Begin;
+		Resume.At    = Block->ResumeAt;
+		Resume.Line += (s32)CountNewlines(Block->Begin.At, Resume.At);
+		for(const char *C = Resume.At; C != Block->Begin.At; --C)
 		{
-			datetime StartDate = DataSet->InputDataStartDate;
-			
-			while(true)
+			if(C[-1] == '\n')
 			{
-				datetime Date;
-				token Token = Stream.PeekToken();
-				
-				if(Token.Type == TokenType_Date)
-					Date = Stream.ExpectDateTime();
-				else if(Token.Type == TokenType_QuotedString || Token.Type == TokenType_EOF)
-					break;
-				else
-				{
-					Stream.PrintErrorHeader();
-					FatalError("Expected either a date or the beginning of a new input series.\n");
-				}
-				
-				Token = Stream.PeekToken();
-				if(Token.Type == TokenType_Identifier)
-				{
-					if(Flags.InterpolationType != InterpolationType_None)
-					{
-						Stream.PrintErrorHeader();
-						FatalError("Expected a number.\n");
-					}
-					
-					Stream.ReadToken();
-					if(!Token.StringValue.Equals("to"))
-					{
-						Stream.PrintErrorHeader();
-						FatalError("Expected either a 'to' or a number.\n");
-					}
-					datetime EndDateRange = Stream.ExpectDateTime();
-					
-					double Value = Stream.ExpectDouble();
-					Reader.FillConstantRange(Date, EndDateRange, Value);
-				}
-				else if(IsNumeric(Token.Type))
-				{
-					double Value = Stream.ExpectDouble();
-					Reader.AddValue(Date, Value);
-				}
-				else
-				{
-					Stream.PrintErrorHeader();
-					FatalError("Expected either a 'to' or a number.\n");
-				}
+				Resume.LineStart = C;
+				break;
 			}
 		}
+		Stream.SetPosition(Resume);
+		
+		//NOTE: Errors from mobius_input_reader::Finish are reported at the end of the values, as they were when the values were read by the token stream.
+		const char *Filename = Stream.Filename;
+		s32 EndLine   = Resume.Line;
+		s32 EndColumn = (s32)(Resume.At - Resume.LineStart) + 1;
+		auto HandleError = [Filename, EndLine, EndColumn]() { ErrorPrint("ERROR: In file ", Filename, " line ", (EndLine+1), " column ", EndColumn, ": "); };
 		
-		Reader.Finish();
+		Block->Reader.reset(new mobius_input_reader(
+			DataSet->InputData, DataSet->SingleInputData, DataSet->InputStorageStructure.TotalCount, Flags,
+			Model->TimestepSize, Offsets, GetInputStartDate(DataSet), Timesteps, HandleError));
+		
+		//NOTE: If the series was provided before, the earlier values have to be written first.
+		bool Overlaps = false;
+		for(size_t Offset : Offsets)
+			Overlaps = Overlaps || Parser->Pending[Offset];
+		if(Overlaps) ParseInputSeriesBlocks(Parser);
+		
+		for(size_t Offset : Offsets)
+			Parser->Pending[Offset] = true;
+		Parser->PendingSize += Block->End - Block->Begin.At;
+		bool EndsAtIdentifier = (Block->ResumeAt != Block->End);
+		Parser->Blocks.push_back(std::move(Block));
+		
+		//NOTE: If there is an identifier after the values, an error in the values should be reported before any error the token stream gives for the identifier.
+		if(EndsAtIdentifier) ParseInputSeriesBlocks(Parser);
 	}
 }
 
+//NOTE: Binary input files are written by WriteInputsToBinaryFile, and ReadInputsFromFile and ReadInputDependenciesFromFile read them instead of the .dat format if they start with BinaryInputFileIdentifier. They start with a binary_input_header, followed by a description of the inputs (see WriteBinaryInputDescription), the InputTimeseriesWasProvided flags (one byte per input series), and then the input data at DataOffset. The data is laid out exactly as InputData (or SingleInputData) is in memory, one timestep after the other, so it can be mapped into memory without being parsed.
+static const char BinaryInputFileIdentifier[8] = {'M', 'O', 'B', 'I', 'N', 'P', '0', '1'};
+
+struct binary_input_header
+{
+	char Identifier[8];
+	u64  DataOffset;           //NOTE: A multiple of the page size.
+	u64  ElementSize;          //NOTE: sizeof(double), or sizeof(float) if the inputs were stored in single precision, see SetSinglePrecisionStorage.
+	u64  ValuesPerRow;         //NOTE: The InputStorageStructure.TotalCount of the data set that wrote the file.
+	u64  Timesteps;
+	s64  StartDate;
+	u64  HasSeparateStartDate;
+	u64  DescriptionSize;
+};
+
 static void
-ReadInputDependenciesFromSpreadsheet(mobius_model *Model, const char *Inputfile);
+WriteBinaryString(std::vector<u8> &Buffer, const char *String)
+{
+	u64 Length = String ? strlen(String) : 0;
+	Buffer.insert(Buffer.end(), (u8 *)&Length, (u8 *)&Length + sizeof(u64));
+	if(Length) Buffer.insert(Buffer.end(), (u8 *)String, (u8 *)String + Length);
+}
 
 static void
-ReadInputsFromSpreadsheet(mobius_data_set *DataSet, const char *Inputfile);
+WriteBinaryU64(std::vector<u8> &Buffer, u64 Value)
+{
+	Buffer.insert(Buffer.end(), (u8 *)&Value, (u8 *)&Value + sizeof(u64));
+}
 
 static void
-ReadInputsFromFile(mobius_data_set *DataSet, const char *Filename)
+WriteBinaryInputDescription(mobius_data_set *DataSet, std::vector<u8> &Buffer)
 {
-#ifdef _WIN32
-	bool FoundExtension;
-	const char *Extension = GetExtension(Filename, &FoundExtension);
-	if(FoundExtension && ((strcmp(Extension, ".xls") == 0) || (strcmp(Extension, ".xlsx") == 0)))
-	{
-		ReadInputsFromSpreadsheet(DataSet, Filename);
-		return;
-	} //Otherwise, assume we use the .dat format
-#endif
-	
+	//NOTE: The description holds what the layout of the input data depends on: Every input of the model in the order of the handles, with the index sets it depends on, and the indexes of those index sets. ReadInputsFromBinaryFile checks that these are the same in the data set that reads the file, and ReadInputDependenciesFromFile registers the additional inputs and the index set dependencies from it.
 	const mobius_model *Model = DataSet->Model;
 	
-	token_stream Stream(Filename);
-	
-	u64 Timesteps = 0;
-	
-	while(true)
+	std::set<index_set_h> UsedIndexSets;
+	WriteBinaryU64(Buffer, Model->Inputs.Count() - 1);
+	for(input_h Input : Model->Inputs)
 	{
-		token Token = Stream.PeekToken();
-		
-		if(Token.Type == TokenType_EOF)
-		{
-			Stream.PrintErrorHeader();
-			FatalError("Expected one of the code words timesteps, start_date, inputs, additional_timeseries or index_set_dependencies.\n");
-		}
-		
-		token_string Section = Stream.ExpectIdentifier();
-
-		if(Section.Equals("timesteps"))
-		{
-			//TODO: Guard against both 'timesteps' and 'end_date' being set?
-			Stream.ExpectToken(':');
-			Timesteps = Stream.ExpectUInt();
-		}
-		else if(Section.Equals("start_date"))
-		{
-			Stream.ExpectToken(':');
-			DataSet->InputDataStartDate = Stream.ExpectDateTime();
-			DataSet->InputDataHasSeparateStartDate = true;
-		}
-		else if(Section.Equals("end_date"))
-		{
-			if(!DataSet->InputDataHasSeparateStartDate)
-			{
-				Stream.PrintErrorHeader();
-				FatalError("The start date has to be provided before the end date.\n");
-			}
-			Stream.ExpectToken(':');
-			datetime EndDate = Stream.ExpectDateTime();
-			s64 Step = FindTimestep(DataSet->InputDataStartDate, EndDate, Model->TimestepSize);
-			Step += 1;    //NOTE: Because the end date is inclusive. 
-			if(Step <= 0)
-			{
-				Stream.PrintErrorHeader();
-				FatalError("The input data end date was set to be earlier than the input data start date.\n");
-			}
-			Timesteps = (u64)Step;
-		}
-		else if(Section.Equals("inputs"))
-		{
-			Stream.ExpectToken(':');
-			break;
-		}
-		else if(Section.Equals("index_set_dependencies") || Section.Equals("additional_timeseries"))
-		{
-			//NOTE: These are handled in a separate call, so we have to skip through them here.
-			while(true)
-			{
-				Token = Stream.PeekToken();
-				if(Token.Type == TokenType_Identifier && !Token.StringValue.Equals("unit")) break; //We hit a new section;
-				Stream.ReadToken(); //Otherwise consume the token and ignore it.
-			}
-		}
-		else
+		const input_spec &Spec = Model->Inputs[Input];
+		WriteBinaryString(Buffer, Spec.Name);
+		WriteBinaryString(Buffer, IsValid(Spec.Unit) ? GetName(Model, Spec.Unit) : nullptr);
+		WriteBinaryU64(Buffer, Spec.IsAdditional);
+		WriteBinaryU64(Buffer, Spec.IndexSetDependencies.size());
+		for(index_set_h IndexSet : Spec.IndexSetDependencies)
 		{
-			Stream.PrintErrorHeader();
-			FatalError("Input file parser does not recognize section type: ", Section, ".\n");
+			WriteBinaryString(Buffer, GetName(Model, IndexSet));
+			UsedIndexSets.insert(IndexSet);
 		}
 	}
 	
-	if(Timesteps == 0)
-		FatalError("ERROR: The amount of timesteps in the input file ", Filename, " is either not provided (as timesteps or end_date), or is set to 0.\n");
+	WriteBinaryU64(Buffer, UsedIndexSets.size());
+	for(index_set_h IndexSet : UsedIndexSets)
+	{
+		WriteBinaryString(Buffer, GetName(Model, IndexSet));
+		index_t Count = DataSet->IndexCounts[IndexSet.Handle];
+		WriteBinaryU64(Buffer, (u64)Count);
+		for(index_t Index = {IndexSet, 0}; Index < Count; ++Index)
+			WriteBinaryString(Buffer, DataSet->IndexNames[IndexSet.Handle][Index]);
+	}
+}
+
+struct binary_input_reader
+{
+	//NOTE: Reads the header and the description of a binary input file, see WriteBinaryInputDescription.
+	const u8   *At;
+	const u8   *End;
+	const char *Filename;
 	
-	AllocateInputStorage(DataSet, Timesteps);
+	void
+	Read(void *WriteTo, size_t Size)
+	{
+		if((size_t)(End - At) < Size)
+			FatalError("ERROR: The binary input file \"", Filename, "\" is truncated.\n");
+		memcpy(WriteTo, At, Size);
+		At += Size;
+	}
 	
-	if(!DataSet->InputDataHasSeparateStartDate)
-		DataSet->InputDataStartDate = GetStartDate(DataSet); //NOTE: This reads the "Start date" parameter.
+	u64
+	ReadU64()
+	{
+		u64 Value;
+		Read(&Value, sizeof(u64));
+		return Value;
+	}
 	
-	ReadInputSeries(DataSet, Stream);
+	token_string
+	ReadString()
+	{
+		u64 Length = ReadU64();
+		if((u64)(End - At) < Length)
+			FatalError("ERROR: The binary input file \"", Filename, "\" is truncated.\n");
+		token_string Result;
+		Result.Data   = (const char *)At;
+		Result.Length = (size_t)Length;
+		At += Length;
+		return Result;
+	}
+};
+
+static bool
+IsBinaryInputFile(const char *Filename)
+{
+	if(!Filename || strlen(Filename) == 0) return false;
+	FILE *File = OpenFile(Filename, "rb");
+	char Identifier[sizeof(BinaryInputFileIdentifier)];
+	bool IsBinary = fread(Identifier, 1, sizeof(Identifier), File) == sizeof(Identifier) && memcmp(Identifier, BinaryInputFileIdentifier, sizeof(Identifier)) == 0;
+	fclose(File);
+	return IsBinary;
 }
 
+static binary_input_header
+ReadBinaryInputHeader(binary_input_reader &Reader)
+{
+	binary_input_header Header;
+	Reader.Read(&Header, sizeof(binary_input_header));
+	if(memcmp(Header.Identifier, BinaryInputFileIdentifier, sizeof(BinaryInputFileIdentifier)) != 0)
+		FatalError("ERROR: The file \"", Reader.Filename, "\" is not a binary input file.\n");
+	if(Header.ElementSize != sizeof(double) && Header.ElementSize != sizeof(float))
+		FatalError("ERROR: The binary input file \"", Reader.Filename, "\" has values of an unknown size.\n");
+	if((size_t)(Reader.End - Reader.At) < Header.DescriptionSize)
+		FatalError("ERROR: The binary input file \"", Reader.Filename, "\" is truncated.\n");
+	return Header;
+}
 
 static void
-ReadInputDependenciesFromFile(mobius_model *Model, const char *Filename)
+ReadInputDependenciesFromBinaryFile(mobius_model *Model, const char *Filename)
 {
-#ifdef _WIN32
-	bool FoundExtension;
-	const char *Extension = GetExtension(Filename, &FoundExtension);
-	if(FoundExtension && ((strcmp(Extension, ".xls") == 0) || (strcmp(Extension, ".xlsx") == 0)))
+	//NOTE: Only the header and the description are read, not the input data.
+	FILE *File = OpenFile(Filename, "rb");
+	binary_input_header Header;
+	std::vector<u8> Buffer;
+	if(fread(&Header, sizeof(binary_input_header), 1, File) == 1)
 	{
-		ReadInputDependenciesFromSpreadsheet(Model, Filename);
-		return;
+		Buffer.resize(sizeof(binary_input_header) + (size_t)Header.DescriptionSize);
+		memcpy(Buffer.data(), &Header, sizeof(binary_input_header));
+		Buffer.resize(sizeof(binary_input_header) + fread(Buffer.data() + sizeof(binary_input_header), 1, (size_t)Header.DescriptionSize, File));
+	}
+	fclose(File);
+	
+	binary_input_reader Reader = {Buffer.data(), Buffer.data() + Buffer.size(), Filename};
+	ReadBinaryInputHeader(Reader);
+	
+	u64 InputCount = Reader.ReadU64();
+	for(u64 InputIdx = 0; InputIdx < InputCount; ++InputIdx)
+	{
+		token_string InputName = Reader.ReadString();
+		token_string UnitName  = Reader.ReadString();
+		bool IsAdditional = Reader.ReadU64();
+		u64 IndexSetCount = Reader.ReadU64();
+		
+		bool Found;
+		input_h Input = GetInputHandle(Model, InputName, Found);
+		if(!Found)
+		{
+			if(!IsAdditional)
+				FatalError("ERROR: The input \"", InputName, "\" in the binary input file \"", Filename, "\" was not registered with the model.\n");
+			unit_h Unit = {0};
+			if(UnitName.Length > 0)
+				Unit = RegisterUnit(Model, UnitName.Copy(&Model->BucketMemory).Data);
+			Input = RegisterInput(Model, InputName.Copy(&Model->BucketMemory).Data, Unit, true, true);
+		}
+		
+		std::vector<index_set_h> IndexSets;
+		for(u64 Idx = 0; Idx < IndexSetCount; ++Idx)
+		{
+			token_string IndexSetName = Reader.ReadString();
+			index_set_h IndexSet = GetIndexSetHandle(Model, IndexSetName, Found);
+			if(!Found)
+				FatalError("ERROR: The index set \"", IndexSetName, "\" in the binary input file \"", Filename, "\" was not registered with the model.\n");
+			IndexSets.push_back(IndexSet);
+		}
+		std::vector<index_set_h> &Dependencies = Model->Inputs[Input].IndexSetDependencies;
+		if(Dependencies.empty())
+			Dependencies = IndexSets;
+		else if(Dependencies != IndexSets)
+			FatalError("ERROR: The binary input file \"", Filename, "\" gives other index set dependencies for the input \"", InputName, "\" than it already has.\n");
+	}
+}
+
+static void
+ReadInputsFromBinaryFile(mobius_data_set *DataSet, const char *Filename)
+{
+	//NOTE: If the values in the file have the precision that the data set stores inputs with (see SetSinglePrecisionStorage), and the inputs are not stored in a file of their own (see SetMappedStorage), the file is mapped into memory copy-on-write and the data set uses the data in it directly. The pages of the file are then read when the model run (or anything else) first touches them, and changes to the inputs are not written to the file. Otherwise the data is copied into newly allocated input storage.
+	const mobius_model *Model = DataSet->Model;
+	
+	EnsureIndexesHaveBeenSet(DataSet);
+	if(InputStorageIsAllocated(DataSet))
+		FatalError("ERROR: Tried to allocate input storage twice.\n");
+	
+	mapped_file Mapped = {};
+	if(!OpenMappedFile(&Mapped, Filename, 0, false, true))
+		FatalError("ERROR: Tried to open file \"", Filename, "\", but was not able to.\n");
+	
+	binary_input_reader Reader = {Mapped.Data, Mapped.Data + Mapped.Size, Filename};
+	binary_input_header Header = ReadBinaryInputHeader(Reader);
+	
+	bool Matches = (Reader.ReadU64() == Model->Inputs.Count() - 1);
+	for(input_h Input : Model->Inputs)
+	{
+		if(!Matches) break;
+		const input_spec &Spec = Model->Inputs[Input];
+		Matches = Reader.ReadString().Equals(Spec.Name);
+		Reader.ReadString();
+		Reader.ReadU64();
+		Matches = Matches && (Reader.ReadU64() == Spec.IndexSetDependencies.size());
+		for(size_t Idx = 0; Idx < Spec.IndexSetDependencies.size() && Matches; ++Idx)
+			Matches = Reader.ReadString().Equals(GetName(Model, Spec.IndexSetDependencies[Idx]));
+	}
+	u64 IndexSetCount = Matches ? Reader.ReadU64() : 0;
+	for(u64 Idx = 0; Idx < IndexSetCount && Matches; ++Idx)
+	{
+		bool Found;
+		index_set_h IndexSet = GetIndexSetHandle(Model, Reader.ReadString(), Found);
+		index_t Count = Found ? DataSet->IndexCounts[IndexSet.Handle] : index_t(IndexSet, 0);
+		Matches = Found && (Reader.ReadU64() == (u64)Count);
+		for(index_t Index = {IndexSet, 0}; Index < Count && Matches; ++Index)
+			Matches = Reader.ReadString().Equals(DataSet->IndexNames[IndexSet.Handle][Index]);
+	}
+	//NOTE: The row of the file has to have one value for each instance of each input, which is the InputStorageStructure.TotalCount the data set gets.
+	u64 ValuesPerRow = 0;
+	for(input_h Input : Model->Inputs)
+	{
+		u64 Instances = 1;
+		for(index_set_h IndexSet : Model->Inputs[Input].IndexSetDependencies)
+			Instances *= (u64)DataSet->IndexCounts[IndexSet.Handle];
+		ValuesPerRow += Instances;
+	}
+	Matches = Matches && (Header.ValuesPerRow == ValuesPerRow);
+	if(!Matches)
+	{
+		CloseMappedFile(&Mapped);
+		FatalError("ERROR: The binary input file \"", Filename, "\" was written for a model with other inputs or for other indexes than the ones of this data set. It has to be converted again from the original input file.\n");
+	}
+	
+	if(Header.HasSeparateStartDate)
+	{
+		DataSet->InputDataStartDate.SecondsSinceEpoch = Header.StartDate;
+		DataSet->InputDataHasSeparateStartDate = true;
+	}
+	
+	//NOTE: The size of the data is checked without overflowing, and the data has to be aligned to its element size since the mapped file is used as the input storage directly.
+	size_t ElementSize = DataSet->SinglePrecisionInputs ? sizeof(float) : sizeof(double);
+	const u8 *WasProvided = Mapped.Data + sizeof(binary_input_header) + Header.DescriptionSize;
+	bool SizeFits = (Header.ValuesPerRow == 0) || (Header.Timesteps <= (std::numeric_limits<size_t>::max() / Header.ElementSize) / Header.ValuesPerRow);
+	size_t DataSize = SizeFits ? (size_t)(Header.ValuesPerRow * Header.Timesteps * Header.ElementSize) : 0;
+	if(!SizeFits || Header.DataOffset > Mapped.Size || DataSize > Mapped.Size - Header.DataOffset || Header.DataOffset % Header.ElementSize != 0
+		|| Header.DataOffset < sizeof(binary_input_header) + Header.DescriptionSize + Header.ValuesPerRow)
+	{
+		CloseMappedFile(&Mapped);
+		FatalError("ERROR: The binary input file \"", Filename, "\" is truncated or damaged.\n");
+	}
+	const u8 *Data        = Mapped.Data + Header.DataOffset;
+	
+	if(Header.ElementSize == ElementSize && DataSet->MappedStoragePath.empty())
+	{
+		DataSet->OwnsInputs = true;
+		SetupInputStorageStructure(DataSet);
+		DataSet->MappedInputs = Mapped;
+		if(DataSet->SinglePrecisionInputs)
+			DataSet->SingleInputData = (float *)Data;
+		else
+			DataSet->InputData = (double *)Data;
+		DataSet->InputTimeseriesWasProvided = (bool *)WasProvided;
+		DataSet->InputDataTimesteps = Header.Timesteps;
+		AdviseSequentialAccess(&DataSet->MappedInputs);
+	}
+	else
+	{
+		AllocateInputStorage(DataSet, Header.Timesteps);
+		size_t Count = (size_t)(Header.ValuesPerRow * Header.Timesteps);
+		if(Header.ElementSize == ElementSize)
+			memcpy(DataSet->InputData ? (void *)DataSet->InputData : (void *)DataSet->SingleInputData, Data, DataSize);
+		else if(DataSet->SingleInputData)
+		{
+			for(size_t Idx = 0; Idx < Count; ++Idx)
+				DataSet->SingleInputData[Idx] = (float)((const double *)Data)[Idx];
+		}
+		else
+		{
+			for(size_t Idx = 0; Idx < Count; ++Idx)
+				DataSet->InputData[Idx] = (double)((const float *)Data)[Idx];
+		}
+		for(size_t Offset = 0; Offset < Header.ValuesPerRow; ++Offset)
+			DataSet->InputTimeseriesWasProvided[Offset] = (WasProvided[Offset] != 0);
+		CloseMappedFile(&Mapped);
+	}
+	
+	if(!DataSet->InputDataHasSeparateStartDate)
+		DataSet->InputDataStartDate = GetStartDate(DataSet); //NOTE: This reads the "Start date" parameter.
+	
+	InputsChanged(DataSet);
+}
+
+static void
+ReadInputDependenciesFromSpreadsheet(mobius_model *Model, const char *Inputfile);
+
+static void
+ReadInputsFromSpreadsheet(mobius_data_set *DataSet, const char *Inputfile);
+
+enum input_file_format
+{
+	InputFileFormat_Dat,
+	InputFileFormat_Binary,
+	InputFileFormat_Spreadsheet,
+};
+
+struct input_file_index_set_dependency
+{
+	token_string              InputName;
+	std::vector<token_string> IndexSetNames;
+	error_location            InputLocation;    //NOTE: Where errors about the input are reported.
+	error_location            IndexSetLocation; //NOTE: Where errors about the index sets are reported.
+};
+
+struct input_file_additional_series
+{
+	token_string InputName;
+	token_string UnitName;  //NOTE: Has Length 0 if no unit was given.
+};
+
+struct input_file_header
+{
+	//NOTE: What is needed from an input file both before EndModelDefinition (the index set dependencies and additional time series) and when the inputs are read into a data set (the time span and the input series). It is filled in by ReadInputFileHeader, which reads the file up to the start of the "inputs" section once, and is then consumed by ReadInputDependenciesFromFile and ReadInputsFromFile. The token strings point into the file that is held open by Stream, so the header has to be kept alive until the inputs have been read.
+	std::string       Filename;
+	input_file_format Format;
+	
+	std::vector<input_file_additional_series>    AdditionalSeries;
+	std::vector<input_file_index_set_dependency> IndexSetDependencies;
+	
+	u64      Timesteps    = 0;
+	bool     HasStartDate = false;
+	datetime StartDate;
+	
+	//NOTE: If end_date comes before start_date in the file, the number of timesteps can only be found once we know whether the data set already has a separate start date.
+	bool           EndDateNeedsStartDate = false;
+	datetime       EndDate;
+	error_location EndDateLocation;
+	
+	bool           FoundInputs = false;
+	error_location EndOfFileLocation;
+	
+	std::unique_ptr<token_stream> Stream; //NOTE: Positioned at the start of the "inputs" section.
+	
+	std::vector<std::string> IncludedFiles; //NOTE: The files that the inputs section included, filled in by ReadInputsFromFile.
+};
+
+static void
+ReadInputFileHeader(input_file_header *Header, const mobius_model *Model, const char *Filename)
+{
+	Header->Filename = Filename;
+	
+#ifdef _WIN32
+	bool FoundExtension;
+	const char *Extension = GetExtension(Filename, &FoundExtension);
+	if(FoundExtension && ((strcmp(Extension, ".xls") == 0) || (strcmp(Extension, ".xlsx") == 0)))
+	{
+		Header->Format = InputFileFormat_Spreadsheet;
+		return;
 	} //Otherwise, assume we use the .dat format
 #endif
 	
-	if(!Filename || strlen(Filename)==0) return;
+	if(IsBinaryInputFile(Filename))
+	{
+		Header->Format = InputFileFormat_Binary;
+		return;
+	}
+	
+	Header->Format = InputFileFormat_Dat;
+	Header->Stream.reset(new token_stream(Header->Filename.c_str()));
+	token_stream &Stream = *Header->Stream;
 	
-	token_stream Stream(Filename);
-
 	while(true)
 	{
 		token Token = Stream.PeekToken();
+		
 		if(Token.Type == TokenType_EOF)
+		{
+			Header->EndOfFileLocation = Stream.GetErrorLocation();
 			break;
+		}
 		
 		token_string Section = Stream.ExpectIdentifier();
-		Stream.ExpectToken(':');
-
-		if(Section.Equals("index_set_dependencies"))
+		
+		if(Section.Equals("timesteps"))
 		{
-			while(true)
-			{
-				token Token = Stream.PeekToken();
-				if(Token.Type == TokenType_QuotedString)
-				{
-					Token = Stream.ReadToken();
-					token_string InputName = Token.StringValue;
-					bool Found;
-					input_h Input = GetInputHandle(Model, InputName, Found);
-					if(!Found)
-					{
-						Stream.PrintErrorHeader();
-						FatalError("The input \"", InputName, "\" was not registered with the model.\n");
-					}
-					
-					std::vector<index_set_h> &IndexSets = Model->Inputs[Input].IndexSetDependencies;
-					if(!IndexSets.empty()) //TODO: OR we could just clear it and give a warning..
-					{
-						Stream.PrintErrorHeader();
-						FatalError("Tried to set index set dependencies for the input ", InputName, " for a second time.\n");
-					}
-					Stream.ExpectToken(':');
-					
-					std::vector<token_string> IndexSetNames;
-					Stream.ReadQuotedStringList(IndexSetNames);
-					
-					//TODO: Why not use AddInputIndexSetDependency(mobius_model *Model, input_h Input, index_set_h IndexSet) ?
-					
-					for(token_string IndexSetName : IndexSetNames)
-					{
-						bool Found;
-						index_set_h IndexSetHandle = GetIndexSetHandle(Model, IndexSetName, Found);
-						if(!Found)
-						{
-							Stream.PrintErrorHeader();
-							FatalError("The index set \"", IndexSetName, "\" was not registered with the model.\n");
-						}
-						IndexSets.push_back(IndexSetHandle);
-					}
-				}
-				else break;
-			}
+			//TODO: Guard against both 'timesteps' and 'end_date' being set?
+			Stream.ExpectToken(':');
+			Header->Timesteps = Stream.ExpectUInt();
+			Header->EndDateNeedsStartDate = false;
 		}
-		else if(Section.Equals("additional_timeseries"))
+		else if(Section.Equals("start_date"))
 		{
-			while(true)
+			Stream.ExpectToken(':');
+			Header->StartDate    = Stream.ExpectDateTime();
+			Header->HasStartDate = true;
+		}
+		else if(Section.Equals("end_date"))
+		{
+			error_location Location = Stream.GetErrorLocation();
+			Stream.ExpectToken(':');
+			datetime EndDate = Stream.ExpectDateTime();
+			if(Header->HasStartDate)
 			{
-				token Token = Stream.PeekToken();
-				if(Token.Type == TokenType_QuotedString)
+				s64 Step = FindTimestep(Header->StartDate, EndDate, Model->TimestepSize);
+				Step += 1;    //NOTE: Because the end date is inclusive. 
+				if(Step <= 0)
 				{
-					Token = Stream.ReadToken();
-					token_string InputName = Token.StringValue.Copy(&Model->BucketMemory);
-					
-					unit_h Unit = {0};
-					Token = Stream.PeekToken();
-					if(Token.Type == TokenType_Identifier)
-					{
-						if(Token.StringValue.Equals("unit"))
-						{
-							Stream.ReadToken();
-							token_string UnitName = Stream.ExpectQuotedString().Copy(&Model->BucketMemory);
-							Unit = RegisterUnit(Model, UnitName.Data);
-						}
-					}
-					RegisterInput(Model, InputName.Data, Unit, true, true);
+					Stream.PrintErrorHeader();
+					FatalError("The input data end date was set to be earlier than the input data start date.\n");
 				}
-				else break;
+				Header->Timesteps = (u64)Step;
+				Header->EndDateNeedsStartDate = false;
+			}
+			else
+			{
+				Header->EndDate               = EndDate;
+				Header->EndDateLocation       = Location;
+				Header->EndDateNeedsStartDate = true;
 			}
 		}
 		else if(Section.Equals("inputs"))
 		{
 			//NOTE: "index_set_dependencies" and "additional_timeseries" are assumed to come before "inputs" in the file.
 			// This is so that we don't have to skip through the entire inputs section on this read since it can be quite long.
+			Stream.ExpectToken(':');
+			Header->FoundInputs = true;
 			break;
 		}
-		else
+		else if(Section.Equals("index_set_dependencies"))
 		{
-			//NOTE: We have to skip through other sections that are not relevant for this reading
+			Stream.ExpectToken(':');
 			while(true)
 			{
 				Token = Stream.PeekToken();
+				if(Token.Type != TokenType_QuotedString) break;
 				
-				if(Token.Type == TokenType_EOF) return;
+				input_file_index_set_dependency Dependency;
+				Dependency.InputName     = Stream.ReadToken().StringValue;
+				Dependency.InputLocation = Stream.GetErrorLocation();
+				Stream.ExpectToken(':');
+				Stream.ReadQuotedStringList(Dependency.IndexSetNames);
+				Dependency.IndexSetLocation = Stream.GetErrorLocation();
+				Header->IndexSetDependencies.push_back(Dependency);
+			}
+		}
+		else if(Section.Equals("additional_timeseries"))
+		{
+			Stream.ExpectToken(':');
+			while(true)
+			{
+				Token = Stream.PeekToken();
+				if(Token.Type != TokenType_QuotedString) break;
 				
-				if(Token.Type == TokenType_Identifier) break; //We hit a new section;
-				Stream.ReadToken(); //Otherwise consume the token and ignore it.
+				input_file_additional_series Series;
+				Series.InputName = Stream.ReadToken().StringValue;
+				Series.UnitName  = {};
+				Token = Stream.PeekToken();
+				if(Token.Type == TokenType_Identifier && Token.StringValue.Equals("unit"))
+				{
+					Stream.ReadToken();
+					Series.UnitName = Stream.ExpectQuotedString();
+				}
+				Header->AdditionalSeries.push_back(Series);
 			}
 		}
+		else
+		{
+			Stream.PrintErrorHeader();
+			FatalError("Input file parser does not recognize section type: ", Section, ".\n");
+		}
 	}
 }
 
+static void
+ReadInputDependenciesFromFile(mobius_model *Model, const input_file_header *Header)
+{
+#ifdef _WIN32
+	if(Header->Format == InputFileFormat_Spreadsheet)
+	{
+		ReadInputDependenciesFromSpreadsheet(Model, Header->Filename.c_str());
+		return;
+	}
+#endif
+	if(Header->Format == InputFileFormat_Binary)
+	{
+		ReadInputDependenciesFromBinaryFile(Model, Header->Filename.c_str());
+		return;
+	}
+	
+	for(const input_file_additional_series &Series : Header->AdditionalSeries)
+	{
+		unit_h Unit = {0};
+		if(Series.UnitName.Length > 0)
+			Unit = RegisterUnit(Model, Series.UnitName.Copy(&Model->BucketMemory).Data);
+		RegisterInput(Model, Series.InputName.Copy(&Model->BucketMemory).Data, Unit, true, true);
+	}
+	
+	for(const input_file_index_set_dependency &Dependency : Header->IndexSetDependencies)
+	{
+		bool Found;
+		input_h Input = GetInputHandle(Model, Dependency.InputName, Found);
+		if(!Found)
+		{
+			PrintErrorHeader(Dependency.InputLocation);
+			FatalError("The input \"", Dependency.InputName, "\" was not registered with the model.\n");
+		}
+		
+		std::vector<index_set_h> &IndexSets = Model->Inputs[Input].IndexSetDependencies;
+		if(!IndexSets.empty()) //TODO: OR we could just clear it and give a warning..
+		{
+			PrintErrorHeader(Dependency.InputLocation);
+			FatalError("Tried to set index set dependencies for the input ", Dependency.InputName, " for a second time.\n");
+		}
+		
+		//TODO: Why not use AddInputIndexSetDependency(mobius_model *Model, input_h Input, index_set_h IndexSet) ?
+		
+		for(token_string IndexSetName : Dependency.IndexSetNames)
+		{
+			index_set_h IndexSetHandle = GetIndexSetHandle(Model, IndexSetName, Found);
+			if(!Found)
+			{
+				PrintErrorHeader(Dependency.IndexSetLocation);
+				FatalError("The index set \"", IndexSetName, "\" was not registered with the model.\n");
+			}
+			IndexSets.push_back(IndexSetHandle);
+		}
+	}
+}
+
+static void
+ReadInputsFromFile(mobius_data_set *DataSet, input_file_header *Header)
+{
+	const char *Filename = Header->Filename.c_str();
+	
+#ifdef _WIN32
+	if(Header->Format == InputFileFormat_Spreadsheet)
+	{
+		ReadInputsFromSpreadsheet(DataSet, Filename);
+		return;
+	}
+#endif
+	if(Header->Format == InputFileFormat_Binary)
+	{
+		ReadInputsFromBinaryFile(DataSet, Filename);
+		return;
+	}
+	
+	if(!Header->Stream)
+		FatalError("ERROR (internal): Tried to read the inputs of the file ", Filename, " twice from the same input file header.\n");
+	
+	if(!Header->FoundInputs)
+	{
+		PrintErrorHeader(Header->EndOfFileLocation);
+		FatalError("Expected one of the code words timesteps, start_date, inputs, additional_timeseries or index_set_dependencies.\n");
+	}
+	
+	u64 Timesteps = Header->Timesteps;
+	if(Header->EndDateNeedsStartDate)
+	{
+		if(!DataSet->InputDataHasSeparateStartDate)
+		{
+			PrintErrorHeader(Header->EndDateLocation);
+			FatalError("The start date has to be provided before the end date.\n");
+		}
+		s64 Step = FindTimestep(DataSet->InputDataStartDate, Header->EndDate, DataSet->Model->TimestepSize);
+		Step += 1;    //NOTE: Because the end date is inclusive. 
+		if(Step <= 0)
+		{
+			PrintErrorHeader(Header->EndDateLocation);
+			FatalError("The input data end date was set to be earlier than the input data start date.\n");
+		}
+		Timesteps = (u64)Step;
+	}
+	
+	if(Header->HasStartDate)
+	{
+		DataSet->InputDataStartDate = Header->StartDate;
+		DataSet->InputDataHasSeparateStartDate = true;
+	}
+	
+	if(Timesteps == 0)
+		FatalError("ERROR: The amount of timesteps in the input file ", Filename, " is either not provided (as timesteps or end_date), or is set to 0.\n");
+	
+	AllocateInputStorage(DataSet, Timesteps);
+	
+	if(!DataSet->InputDataHasSeparateStartDate)
+		DataSet->InputDataStartDate = GetStartDate(DataSet); //NOTE: This reads the "Start date" parameter.
+	
+	input_series_parser Parser;
+	Parser.DataSet     = DataSet;
+	Parser.Pending.resize(DataSet->InputStorageStructure.TotalCount, false);
+	Parser.PendingSize = 0;
+	ReadInputSeries(&Parser, *Header->Stream);
+	InputsChanged(DataSet);
+	
+	Header->IncludedFiles = Parser.IncludedFiles;
+	Header->Stream.reset();
+}
+
+//NOTE: The file cache keeps what was read from parameter and input files in a directory (see SetFileCacheDirectory), so that later processes that read the same files for the same model can load it instead of parsing the files again. It is not used unless a directory is set.
+//  An entry is found by a key that hashes the structure of the model (see ModelCacheKey), the bytes of the files that were read, and anything else in the data set that the result depends on. The inputs are stored in the binary input format (see WriteInputsToBinaryFile) in <key>.inputs, and are mapped into memory directly when they are loaded. <key>.entry starts with a file_cache_entry_header. It is followed by a description (the files included by the input file with their hashes, and for entries made by SetupDataSetFromFiles also the index sets and branch inputs), and then by the parameter data.
+//  Warnings that were given when the files were parsed are not repeated when an entry is loaded.
+static const char FileCacheEntryIdentifier[8] = {'M', 'O', 'B', 'C', 'A', 'C', '0', '1'};
+
+struct file_cache_entry_header
+{
+	char Identifier[8];
+	u64  Key;
+	u64  ParseMicroseconds;    //NOTE: How long it took to read the files when the entry was made.
+	u64  DescriptionSize;
+	u64  ParameterCount;       //NOTE: The ParameterStorageStructure.TotalCount of the data set that made the entry, or 0 if the entry only holds inputs.
+	u64  DataOffset;           //NOTE: Where the parameter data starts.
+};
+
+struct file_cache_statistics
+{
+	u64 Lookups;
+	u64 Hits;
+	u64 ParseMicroseconds;    //NOTE: The time spent reading files (and storing them in the cache) on misses.
+	u64 LoadMicroseconds;     //NOTE: The time spent loading entries on hits. Since the inputs are mapped into memory, some of the cost of loading them is paid later, when they are first used.
+	s64 SavedMicroseconds;    //NOTE: The parse time recorded in the entries that were hit, minus the time it took to load them.
+};
+
+struct file_cache
+{
+	std::string           Directory;   //NOTE: Empty if the cache is not used.
+	file_cache_statistics Statistics;
+	std::mutex            Mutex;
+};
+
+static file_cache GlobalFileCache;
+
+static void
+SetFileCacheDirectory(const char *Directory)
+{
+	//NOTE: Turns on the file cache and places its entries in Directory, which has to exist. Several processes can share the directory. An empty (or null) Directory turns the cache off.
+	std::lock_guard<std::mutex> Lock(GlobalFileCache.Mutex);
+	GlobalFileCache.Directory = Directory ? Directory : "";
+	if(GlobalFileCache.Directory.empty()) return;
+	
+	std::string TestFile = GlobalFileCache.Directory + "/write_test.tmp" + std::to_string(std::random_device{}());
+	FILE *File = fopen(TestFile.c_str(), "wb");
+	if(!File)
+	{
+		GlobalFileCache.Directory.clear();
+		FatalError("ERROR: Can not write to the cache directory \"", Directory, "\". It has to exist before it is used.\n");
+	}
+	fclose(File);
+	remove(TestFile.c_str());
+}
+
+static file_cache_statistics
+GetFileCacheStatistics()
+{
+	std::lock_guard<std::mutex> Lock(GlobalFileCache.Mutex);
+	return GlobalFileCache.Statistics;
+}
+
+static std::string
+FileCacheDirectory()
+{
+	std::lock_guard<std::mutex> Lock(GlobalFileCache.Mutex);
+	return GlobalFileCache.Directory;
+}
+
+static void
+RecordFileCacheMiss(u64 ParseMicroseconds)
+{
+	std::lock_guard<std::mutex> Lock(GlobalFileCache.Mutex);
+	GlobalFileCache.Statistics.Lookups++;
+	GlobalFileCache.Statistics.ParseMicroseconds += ParseMicroseconds;
+}
+
+static void
+RecordFileCacheHit(u64 LoadMicroseconds, u64 EntryParseMicroseconds)
+{
+	std::lock_guard<std::mutex> Lock(GlobalFileCache.Mutex);
+	GlobalFileCache.Statistics.Lookups++;
+	GlobalFileCache.Statistics.Hits++;
+	GlobalFileCache.Statistics.LoadMicroseconds  += LoadMicroseconds;
+	GlobalFileCache.Statistics.SavedMicroseconds += (s64)EntryParseMicroseconds - (s64)LoadMicroseconds;
+}
+
+inline void
+CacheHash(u64 *Hash, u64 Value)
+{
+	*Hash = (*Hash ^ Value) * 1099511628211ull;
+	*Hash ^= *Hash >> 32;    //NOTE: So that the high bits of a value also affect the low bits of the hash.
+}
+
+static void
+CacheHash(u64 *Hash, const u8 *Data, size_t Size)
+{
+	//NOTE: Hashes 8 bytes at a time, so that hashing large input files is cheap compared to parsing them.
+	size_t Idx = 0;
+	for(; Idx + 8 <= Size; Idx += 8)
+	{
+		u64 Word;
+		memcpy(&Word, Data + Idx, 8);
+		CacheHash(Hash, Word);
+	}
+	u64 Tail = 0;
+	memcpy(&Tail, Data + Idx, Size - Idx);
+	CacheHash(Hash, Tail);
+	CacheHash(Hash, (u64)Size);
+}
+
+static void
+CacheHash(u64 *Hash, const char *String)
+{
+	CacheHash(Hash, (const u8 *)String, String ? strlen(String) : 0);
+}
+
+static bool
+CacheHashFile(u64 *Hash, const char *Filename)
+{
+	//NOTE: Returns false if the file could not be read. The file is then not cached, and reading it gives the usual error.
+	FILE *File = fopen(Filename, "rb");
+	if(!File) return false;
+	fseek(File, 0, SEEK_END);
+	long Size = ftell(File);
+	fclose(File);
+	if(Size <= 0) return false;
+	
+	mapped_file Mapped = {};
+	if(!OpenMappedFile(&Mapped, Filename, 0, false, true)) return false;
+	CacheHash(Hash, Mapped.Data, Mapped.Size);
+	CloseMappedFile(&Mapped);
+	return true;
+}
+
+static u64
+ModelCacheKey(const mobius_model *Model)
+{
+	//NOTE: A hash of the parts of the model that the layout and the meaning of the stored parameters and inputs depend on.
+	u64 Hash = 14695981039346656037ull;
+	CacheHash(&Hash, (const u8 *)FileCacheEntryIdentifier, sizeof(FileCacheEntryIdentifier));
+	CacheHash(&Hash, Model->Name);
+	CacheHash(&Hash, (u64)Model->TimestepSize.Unit);
+	CacheHash(&Hash, (u64)Model->TimestepSize.Magnitude);
+	for(module_h Module : Model->Modules)
+	{
+		CacheHash(&Hash, Model->Modules[Module].Name);
+		CacheHash(&Hash, Model->Modules[Module].Version);
+	}
+	for(index_set_h IndexSet : Model->IndexSets)
+	{
+		CacheHash(&Hash, Model->IndexSets[IndexSet].Name);
+		CacheHash(&Hash, (u64)Model->IndexSets[IndexSet].Type);
+	}
+	for(parameter_h Parameter : Model->Parameters)
+	{
+		const parameter_spec &Spec = Model->Parameters[Parameter];
+		CacheHash(&Hash, Spec.Name);
+		CacheHash(&Hash, (u64)Spec.Type);
+		for(index_set_h IndexSet : Spec.IndexSetDependencies) CacheHash(&Hash, (u64)IndexSet.Handle);
+	}
+	for(input_h Input : Model->Inputs)
+	{
+		const input_spec &Spec = Model->Inputs[Input];
+		CacheHash(&Hash, Spec.Name);
+		CacheHash(&Hash, (u64)Spec.IsAdditional);
+		for(index_set_h IndexSet : Spec.IndexSetDependencies) CacheHash(&Hash, (u64)IndexSet.Handle);
+	}
+	return Hash;
+}
+
+static std::string
+FileCachePath(const std::string &Directory, u64 Key, const char *Extension)
+{
+	char Name[32];
+	sprintf(Name, "/%016llx", (unsigned long long)Key);
+	return Directory + Name + Extension;
+}
+
+static bool
+FileExists(const std::string &Filename)
+{
+	FILE *File = fopen(Filename.c_str(), "rb");
+	if(File) fclose(File);
+	return File != nullptr;
+}
+
+static void
+ReplaceFile(const std::string &From, const std::string &To)
+{
+	//NOTE: Entries are written to a temporary file first and then renamed, so that other processes never see a partially written entry. If the rename fails (on Windows it does if To exists), another process has stored the same entry already.
+	if(rename(From.c_str(), To.c_str()) != 0)
+		remove(From.c_str());
+}
+
+static void
+WriteInputsToBinaryFile(mobius_data_set *DataSet, const char *Filename);
+
+static void
+StoreFileCacheEntry(mobius_data_set *DataSet, const std::string &Directory, u64 Key, u64 ParseMicroseconds, const std::vector<std::string> &IncludedFiles, bool StoreParameters)
+{
+	const mobius_model *Model = DataSet->Model;
+	std::string Temporary = ".tmp" + std::to_string(std::random_device{}());
+	
+	std::string InputsFile = FileCachePath(Directory, Key, ".inputs");
+	WriteInputsToBinaryFile(DataSet, (InputsFile + Temporary).c_str());
+	ReplaceFile(InputsFile + Temporary, InputsFile);
+	
+	std::vector<u8> Description;
+	WriteBinaryU64(Description, IncludedFiles.size());
+	for(const std::string &Included : IncludedFiles)
+	{
+		u64 Hash = 0;
+		if(!CacheHashFile(&Hash, Included.c_str())) return;
+		WriteBinaryString(Description, Included.c_str());
+		WriteBinaryU64(Description, Hash);
+	}
+	if(StoreParameters)
+	{
+		for(index_set_h IndexSet : Model->IndexSets)
+		{
+			index_t Count = DataSet->IndexCounts[IndexSet.Handle];
+			WriteBinaryU64(Description, (u64)Count);
+			for(index_t Index = {IndexSet, 0}; Index < Count; ++Index)
+			{
+				WriteBinaryString(Description, DataSet->IndexNames[IndexSet.Handle][Index]);
+				if(Model->IndexSets[IndexSet].Type == IndexSetType_Branched)
+				{
+					const array<index_t> &Inputs = DataSet->BranchInputs[IndexSet.Handle][Index];
+					WriteBinaryU64(Description, Inputs.Count);
+					for(index_t Input : Inputs) WriteBinaryU64(Description, (u64)Input);
+				}
+			}
+		}
+	}
+	
+	file_cache_entry_header Header = {};
+	memcpy(Header.Identifier, FileCacheEntryIdentifier, sizeof(FileCacheEntryIdentifier));
+	Header.Key               = Key;
+	Header.ParseMicroseconds = ParseMicroseconds;
+	Header.DescriptionSize   = Description.size();
+	Header.ParameterCount    = StoreParameters ? DataSet->ParameterStorageStructure.TotalCount : 0;
+	Header.DataOffset        = ((sizeof(file_cache_entry_header) + Description.size() + 7) / 8) * 8;
+	std::vector<u8> Padding(Header.DataOffset - sizeof(file_cache_entry_header) - Description.size());
+	
+	std::string EntryFile = FileCachePath(Directory, Key, ".entry");
+	FILE *File = OpenFile((EntryFile + Temporary).c_str(), "wb");
+	size_t DataSize = sizeof(parameter_value) * Header.ParameterCount;
+	bool Success = fwrite(&Header, sizeof(file_cache_entry_header), 1, File) == 1
+		&& fwrite(Description.data(), 1, Description.size(), File) == Description.size()
+		&& fwrite(Padding.data(), 1, Padding.size(), File) == Padding.size()
+		&& (DataSize == 0 || fwrite(DataSet->ParameterData, 1, DataSize, File) == DataSize);
+	fclose(File);
+	
+	if(Success)
+		ReplaceFile(EntryFile + Temporary, EntryFile);
+	else
+	{
+		remove((EntryFile + Temporary).c_str());
+		WarningPrint("WARNING: Could not write the cache entry \"", EntryFile, "\".\n");
+	}
+}
+
+static bool
+OpenFileCacheEntry(mapped_file *Mapped, const std::string &EntryFile, const std::string &InputsFile, u64 Key, bool HasParameters, file_cache_entry_header *Header, binary_input_reader *Reader)
+{
+	//NOTE: Opens the entry for Key if there is one that can be used, i.e. its files exist and the files that were included when it was made have not changed. Reader is then positioned after the included files in the description.
+	if(!FileExists(EntryFile) || !FileExists(InputsFile)) return false;
+	if(!OpenMappedFile(Mapped, EntryFile.c_str(), 0, false, true)) return false;
+	
+	bool Valid = Mapped->Size >= sizeof(file_cache_entry_header);
+	if(Valid)
+	{
+		memcpy(Header, Mapped->Data, sizeof(file_cache_entry_header));
+		Valid = memcmp(Header->Identifier, FileCacheEntryIdentifier, sizeof(FileCacheEntryIdentifier)) == 0
+			&& Header->Key == Key
+			&& (Header->ParameterCount != 0) == HasParameters
+			&& Header->DataOffset >= sizeof(file_cache_entry_header) + Header->DescriptionSize
+			&& Header->DataOffset + sizeof(parameter_value)*Header->ParameterCount <= Mapped->Size;
+	}
+	if(Valid)
+	{
+		*Reader = {Mapped->Data + sizeof(file_cache_entry_header), Mapped->Data + sizeof(file_cache_entry_header) + Header->DescriptionSize, EntryFile.c_str()};
+		u64 IncludedCount = Reader->ReadU64();
+		for(u64 Idx = 0; Idx < IncludedCount && Valid; ++Idx)
+		{
+			token_string Included = Reader->ReadString();
+			u64 StoredHash = Reader->ReadU64();
+			u64 Hash = 0;
+			Valid = CacheHashFile(&Hash, std::string(Included.Data, Included.Length).c_str()) && Hash == StoredHash;
+		}
+	}
+	if(!Valid) CloseMappedFile(Mapped);
+	return Valid;
+}
+
+static bool
+ReadInputsFromCache(mobius_data_set *DataSet, const char *Filename)
+{
+	//NOTE: Used by ReadInputsFromFile if the file cache is on. Either loads the inputs from the cache, or reads the file and stores them in the cache. Returns false if the file can not be cached, in which case nothing was read.
+	std::string Directory = FileCacheDirectory();
+	if(Directory.empty() || InputStorageIsAllocated(DataSet) || IsBinaryInputFile(Filename)) return false;
+	
+	EnsureIndexesHaveBeenSet(DataSet);
+	const mobius_model *Model = DataSet->Model;
+	
+	//NOTE: The inputs depend on the index sets, and on the start date if the data set already has one and the file does not give it.
+	u64 Key = ModelCacheKey(Model);
+	CacheHash(&Key, (const u8 *)"inputs", 6);
+	for(index_set_h IndexSet : Model->IndexSets)
+	{
+		index_t Count = DataSet->IndexCounts[IndexSet.Handle];
+		CacheHash(&Key, (u64)Count);
+		for(index_t Index = {IndexSet, 0}; Index < Count; ++Index)
+		{
+			CacheHash(&Key, DataSet->IndexNames[IndexSet.Handle][Index]);
+			if(Model->IndexSets[IndexSet].Type == IndexSetType_Branched)
+				for(index_t Input : DataSet->BranchInputs[IndexSet.Handle][Index]) CacheHash(&Key, (u64)Input);
+		}
+	}
+	CacheHash(&Key, (u64)DataSet->InputDataHasSeparateStartDate);
+	if(DataSet->InputDataHasSeparateStartDate) CacheHash(&Key, (u64)DataSet->InputDataStartDate.SecondsSinceEpoch);
+	if(!CacheHashFile(&Key, Filename)) return false;
+	
+	timer Timer = BeginTimer();
+	std::string EntryFile  = FileCachePath(Directory, Key, ".entry");
+	std::string InputsFile = FileCachePath(Directory, Key, ".inputs");
+	mapped_file Mapped = {};
+	file_cache_entry_header EntryHeader;
+	binary_input_reader Reader;
+	if(OpenFileCacheEntry(&Mapped, EntryFile, InputsFile, Key, false, &EntryHeader, &Reader))
+	{
+		CloseMappedFile(&Mapped);
+		ReadInputsFromBinaryFile(DataSet, InputsFile.c_str());
+		RecordFileCacheHit(GetTimerMicroseconds(&Timer), EntryHeader.ParseMicroseconds);
+		return true;
+	}
+	
+	input_file_header Header;
+	ReadInputFileHeader(&Header, Model, Filename);
+	ReadInputsFromFile(DataSet, &Header);
+	u64 ParseMicroseconds = GetTimerMicroseconds(&Timer);
+	StoreFileCacheEntry(DataSet, Directory, Key, ParseMicroseconds, Header.IncludedFiles, false);
+	RecordFileCacheMiss(GetTimerMicroseconds(&Timer));
+	return true;
+}
+
+static mobius_data_set *
+SetupDataSetFromFiles(mobius_model *Model, const char *ParameterFilename, const char *InputFilename)
+{
+	//NOTE: Ends the definition of the model and makes a data set with the parameters and inputs of the given files. The input file is only parsed once (see ReadInputFileHeader). If the file cache is on (see SetFileCacheDirectory), the data set is loaded from it if these files were read for this model before, and stored in it otherwise.
+	std::string Directory = FileCacheDirectory();
+	u64 Key = 0;
+	bool UseCache = false;
+	if(!Directory.empty())
+	{
+		Key = ModelCacheKey(Model);
+		CacheHash(&Key, (const u8 *)"data set", 8);
+		UseCache = CacheHashFile(&Key, ParameterFilename) && CacheHashFile(&Key, InputFilename);
+	}
+	
+	timer Timer = BeginTimer();
+	std::string EntryFile  = FileCachePath(Directory, Key, ".entry");
+	std::string InputsFile = FileCachePath(Directory, Key, ".inputs");
+	mapped_file Mapped = {};
+	file_cache_entry_header EntryHeader;
+	binary_input_reader Reader;
+	if(UseCache && OpenFileCacheEntry(&Mapped, EntryFile, InputsFile, Key, true, &EntryHeader, &Reader))
+	{
+		ReadInputDependenciesFromBinaryFile(Model, InputsFile.c_str());
+		EndModelDefinition(Model);
+		mobius_data_set *DataSet = GenerateDataSet(Model);
+		
+		for(index_set_h IndexSet : Model->IndexSets)
+		{
+			u64 Count = Reader.ReadU64();
+			if(Model->IndexSets[IndexSet].Type == IndexSetType_Branched)
+			{
+				std::vector<std::pair<token_string, std::vector<token_string>>> Indexes(Count);
+				for(u64 Idx = 0; Idx < Count; ++Idx)
+				{
+					Indexes[Idx].first = Reader.ReadString();
+					u64 InputCount = Reader.ReadU64();
+					for(u64 In = 0; In < InputCount; ++In)
+						Indexes[Idx].second.push_back(Indexes[Reader.ReadU64()].first);
+				}
+				SetBranchIndexes(DataSet, Model->IndexSets[IndexSet].Name, Indexes);
+			}
+			else
+			{
+				std::vector<token_string> Indexes(Count);
+				for(u64 Idx = 0; Idx < Count; ++Idx) Indexes[Idx] = Reader.ReadString();
+				SetIndexes(DataSet, Model->IndexSets[IndexSet].Name, Indexes);
+			}
+		}
+		
+		AllocateParameterStorage(DataSet);
+		if(DataSet->ParameterStorageStructure.TotalCount != EntryHeader.ParameterCount)
+			FatalError("ERROR: The cache entry \"", EntryFile, "\" does not match the model. It should be deleted.\n");
+		memcpy(DataSet->ParameterData, Mapped.Data + EntryHeader.DataOffset, sizeof(parameter_value)*EntryHeader.ParameterCount);
+		CloseMappedFile(&Mapped);
+		
+		ReadInputsFromBinaryFile(DataSet, InputsFile.c_str());
+		
+		RecordFileCacheHit(GetTimerMicroseconds(&Timer), EntryHeader.ParseMicroseconds);
+		return DataSet;
+	}
+	
+	input_file_header InputHeader;
+	ReadInputFileHeader(&InputHeader, Model, InputFilename);
+	ReadInputDependenciesFromFile(Model, &InputHeader);
+	
+	EndModelDefinition(Model);
+	
+	mobius_data_set *DataSet = GenerateDataSet(Model);
+	
+	ReadParametersFromFile(DataSet, ParameterFilename);
+	ReadInputsFromFile(DataSet, &InputHeader);
+	
+	if(UseCache)
+	{
+		StoreFileCacheEntry(DataSet, Directory, Key, GetTimerMicroseconds(&Timer), InputHeader.IncludedFiles, true);
+		RecordFileCacheMiss(GetTimerMicroseconds(&Timer));
+	}
+	
+	return DataSet;
+}
+
+static void
+ReadInputsFromFile(mobius_data_set *DataSet, const char *Filename)
+{
+	if(ReadInputsFromCache(DataSet, Filename)) return;
+	
+	input_file_header Header;
+	ReadInputFileHeader(&Header, DataSet->Model, Filename);
+	ReadInputsFromFile(DataSet, &Header);
+}
+
+static void
+ReadInputDependenciesFromFile(mobius_model *Model, const char *Filename)
+{
+	//NOTE: If the inputs are going to be read from the same file afterwards, it is faster to call ReadInputFileHeader once and pass the header to both ReadInputDependenciesFromFile and ReadInputsFromFile.
+	if(!Filename || strlen(Filename)==0) return;
+	
+	input_file_header Header;
+	ReadInputFileHeader(&Header, Model, Filename);
+	ReadInputDependenciesFromFile(Model, &Header);
+}
+
 
 
 static void
 WriteInputsToFile(mobius_data_set *DataSet, const char *Filename)
 {
-	if(!DataSet->InputData)
+	if(!InputStorageIsAllocated(DataSet))
 		FatalError("ERROR: Tried to write inputs to a file before input data was allocated.\n");
 	
 	FILE *File = OpenFile(Filename, "w");
@@ -1405,6 +2443,46 @@ WriteInputsToFile(mobius_data_set *DataSet, const char *Filename)
 	fclose(File);
 }
 
+static void
+WriteInputsToBinaryFile(mobius_data_set *DataSet, const char *Filename)
+{
+	//NOTE: Writes the inputs of the data set in the binary input format (see BinaryInputFileIdentifier), which ReadInputsFromFile can load without parsing. Converting a .dat file is done by reading it into a data set (for instance with DllSetupModel) and writing it out with this. The values are written with the precision the data set stores them in.
+	if(!InputStorageIsAllocated(DataSet))
+		FatalError("ERROR: Tried to write inputs to a file before input data was allocated.\n");
+	
+	std::vector<u8> Description;
+	WriteBinaryInputDescription(DataSet, Description);
+	
+	size_t ValuesPerRow = DataSet->InputStorageStructure.TotalCount;
+	
+	binary_input_header Header = {};
+	memcpy(Header.Identifier, BinaryInputFileIdentifier, sizeof(BinaryInputFileIdentifier));
+	Header.DataOffset           = MappedStorageDataOffset(Description.size() + ValuesPerRow);
+	Header.ElementSize          = DataSet->SingleInputData ? sizeof(float) : sizeof(double);
+	Header.ValuesPerRow         = ValuesPerRow;
+	Header.Timesteps            = DataSet->InputDataTimesteps;
+	Header.StartDate            = DataSet->InputDataStartDate.SecondsSinceEpoch;
+	Header.HasSeparateStartDate = DataSet->InputDataHasSeparateStartDate;
+	Header.DescriptionSize      = Description.size();
+	
+	std::vector<u8> Flags(ValuesPerRow);
+	for(size_t Offset = 0; Offset < ValuesPerRow; ++Offset)
+		Flags[Offset] = DataSet->InputTimeseriesWasProvided[Offset];
+	std::vector<u8> Padding(Header.DataOffset - sizeof(binary_input_header) - Description.size() - ValuesPerRow);
+	
+	FILE *File = OpenFile(Filename, "wb");
+	size_t DataSize = Header.ElementSize * ValuesPerRow * DataSet->InputDataTimesteps;
+	bool Success = fwrite(&Header, sizeof(binary_input_header), 1, File) == 1
+		&& fwrite(Description.data(), 1, Description.size(), File) == Description.size()
+		&& fwrite(Flags.data(), 1, Flags.size(), File) == Flags.size()
+		&& fwrite(Padding.data(), 1, Padding.size(), File) == Padding.size()
+		&& fwrite(DataSet->SingleInputData ? (void *)DataSet->SingleInputData : (void *)DataSet->InputData, 1, DataSize, File) == DataSize;
+	fclose(File);
+	
+	if(!Success)
+		FatalError("ERROR: Could not write all of the inputs to the file \"", Filename, "\".\n");
+}
+
 //TODO: Not sure if it is necessary to support this function anymore. It was mostly for debugging before we had MobiView.
 static void
 DlmWriteResultSeriesToFile(mobius_data_set *DataSet, const char *Filename, std::vector<const char *> ResultNames, const std::vector<std::vector<const char *>> &Indexes, char Delimiter)
@@ -1436,3 +2514,93 @@ DlmWriteResultSeriesToFile(mobius_data_set *DataSet, const char *Filename, std::
 	for(size_t Idx = 0; Idx < NumSeries; ++Idx) free(ResultSeries[Idx]);
 	free(ResultSeries);	
 }
+
+//NOTE: Binary result files are written by the sink from BinaryFileResultSink. They have an 8 byte identifier, then the number of values per row (u64, the ResultStorageStructure.TotalCount of the data set that was run), then every row of results (double), starting with the initial values. The layout of each row is the same as one timestep of the full ResultData, so the offset of a result series in a row can be found with GetOffset on a data set with the same index sets.
+static const char BinaryResultFileIdentifier[8] = {'M', 'O', 'B', 'R', 'E', 'S', '0', '1'};
+
+static result_sink
+BinaryFileResultSink(FILE *File, size_t WindowSize)
+{
+	//NOTE: The caller has to keep the file open until the model run is finished, and then close it.
+	result_sink Sink;
+	Sink.WindowSize = WindowSize;
+	Sink.Receive = [File](mobius_data_set *DataSet, const double *Results, u64 FirstRow, size_t RowCount)
+	{
+		u64 ValuesPerRow = (u64)DataSet->ResultStorageStructure.TotalCount;
+		if(FirstRow == 0)
+		{
+			fwrite(BinaryResultFileIdentifier, 1, sizeof(BinaryResultFileIdentifier), File);
+			fwrite(&ValuesPerRow, sizeof(u64), 1, File);
+		}
+		if(fwrite(Results, sizeof(double), ValuesPerRow*RowCount, File) != ValuesPerRow*RowCount)
+			FatalError("ERROR: Failed to write model results to a binary result file.\n");
+	};
+	return Sink;
+}
+
+static bool
+RunModelToBinaryFile(mobius_data_set *DataSet, const char *Filename, size_t WindowSize, s64 MillisecondTimeout=-1)
+{
+	//NOTE: Runs the model and writes all its results to a binary result file instead of keeping them in memory.
+	FILE *File = OpenFile(Filename, "wb");
+	result_sink Sink = BinaryFileResultSink(File, WindowSize);
+	bool Completed;
+	try
+	{
+		Completed = RunModel(DataSet, MillisecondTimeout, &Sink);
+	}
+	catch(...)
+	{
+		fclose(File); //NOTE: FatalError throws in the dll.
+		throw;
+	}
+	fclose(File);
+	return Completed;
+}
+
+inline void
+ReadResultSeriesFromBinaryFile(mobius_data_set *DataSet, const char *Filename, const char *Name, const char * const *IndexNames, size_t IndexCount, double *WriteTo, size_t WriteSize, bool IncludeInitial = false)
+{
+	//NOTE: Reads one result series from a binary result file written by a run of DataSet (or a data set with the same index sets).
+	equation_h Equation = GetEquationHandle(DataSet->Model, Name);
+	SetupResultStorageStructure(DataSet);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Equation, IndexNames, IndexCount, DataSet->ResultStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to read the result series of the equation \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	FILE *File = OpenFile(Filename, "rb");
+	
+	char Identifier[sizeof(BinaryResultFileIdentifier)];
+	u64 ValuesPerRow;
+	if(fread(Identifier, 1, sizeof(Identifier), File) != sizeof(Identifier) || memcmp(Identifier, BinaryResultFileIdentifier, sizeof(Identifier)) != 0
+		|| fread(&ValuesPerRow, sizeof(u64), 1, File) != 1)
+	{
+		fclose(File);
+		FatalError("ERROR: The file \"", Filename, "\" is not a binary result file.\n");
+	}
+	if(ValuesPerRow != DataSet->ResultStorageStructure.TotalCount)
+	{
+		fclose(File);
+		FatalError("ERROR: The binary result file \"", Filename, "\" was not written by a data set with the same index sets as this one.\n");
+	}
+	
+	size_t HeaderSize = sizeof(BinaryResultFileIdentifier) + sizeof(u64);
+	size_t FirstRow = IncludeInitial ? 0 : 1;
+	size_t Row = 0;
+	for(; Row < WriteSize; ++Row)
+	{
+		s64 Position = (s64)(HeaderSize + ((FirstRow + Row)*ValuesPerRow + Offset)*sizeof(double));
+#ifdef _WIN32
+		_fseeki64(File, Position, SEEK_SET);
+#else
+		fseeko(File, (off_t)Position, SEEK_SET);
+#endif
+		if(fread(WriteTo + Row, sizeof(double), 1, File) != 1) break;
+	}
+	fclose(File);
+	
+	if(Row != WriteSize)
+		FatalError("ERROR: The binary result file \"", Filename, "\" has fewer timesteps than were requested.\n");
+}
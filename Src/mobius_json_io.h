@@ -139,6 +139,8 @@ WriteResultsToJson(mobius_data_set *DataSet, const char *Filename)
 		ForeachResultInstance(DataSet, EquationName,
 			[DataSet, Timesteps, EquationName, &Json](const char * const *IndexNames, size_t IndexesCount)
 			{
+				if(!ResultWasRecorded(DataSet, EquationName, IndexNames, IndexesCount)) return; //NOTE: Only some results were recorded (see RecordResult).
+				
 				std::vector<double> Values((size_t)Timesteps);
 				GetResultSeries(DataSet, EquationName, IndexNames, IndexesCount, Values.data(), Values.size());
 				
@@ -165,16 +167,21 @@ WriteResultsToJson(mobius_data_set *DataSet, const char *Filename)
 		FatalError("ERROR: Could not write to file \"", Filename, "\".\n");
 }
 
-static void
-ReadInputDependenciesFromJson(mobius_model *Model, const char *Filename)
+static nlohmann::json
+ReadJsonFile(const char *Filename)
 {
 	std::ifstream Ifs(Filename);
 	nlohmann::json JData;
 	Ifs >> JData;
-	
+	return JData;
+}
+
+static void
+ReadInputDependenciesFromJson(mobius_model *Model, const nlohmann::json &JData)
+{
 	if (JData.find("additional_timeseries") != JData.end())
     {
-        std::vector<std::string> AdditionalTimeseries = JData["additional_timeseries"].get<std::vector<std::string>>();
+        std::vector<std::string> AdditionalTimeseries = JData.at("additional_timeseries").get<std::vector<std::string>>();
 		
 		for(std::string &Str : AdditionalTimeseries)
 		{
@@ -185,7 +192,7 @@ ReadInputDependenciesFromJson(mobius_model *Model, const char *Filename)
     
     if (JData.find("index_set_dependencies") != JData.end())
     {
-        std::map<std::string, std::vector<std::string>> Dep = JData["index_set_dependencies"].get<std::map<std::string,std::vector<std::string>>>();
+        std::map<std::string, std::vector<std::string>> Dep = JData.at("index_set_dependencies").get<std::map<std::string,std::vector<std::string>>>();
 		for(auto &D : Dep)
 		{
 			const std::string &Name = D.first;
@@ -202,22 +209,24 @@ ReadInputDependenciesFromJson(mobius_model *Model, const char *Filename)
     }
 }
 
+static void
+ReadInputDependenciesFromJson(mobius_model *Model, const char *Filename)
+{
+	//NOTE: If the inputs are going to be read from the same file afterwards, it is faster to parse it once with ReadJsonFile and pass the result to both ReadInputDependenciesFromJson and ReadInputsFromJson.
+	ReadInputDependenciesFromJson(Model, ReadJsonFile(Filename));
+}
 
 static void 
-ReadInputsFromJson(mobius_data_set *DataSet, const char *Filename)
+ReadInputsFromJson(mobius_data_set *DataSet, const nlohmann::json &JData, const char *Filename)
 {
-	std::ifstream Ifs(Filename);
-	nlohmann::json JData;
-	Ifs >> JData;
- 
 	if (JData.find("timesteps") != JData.end())
-		DataSet->InputDataTimesteps = (u64)JData["timesteps"].get<u64>();
+		DataSet->InputDataTimesteps = (u64)JData.at("timesteps").get<u64>();
 	else
 		FatalError("Input file \"", Filename, "\" does not declare the number of timesteps for the input data.\n");
     
 	if (JData.find("start_date") != JData.end())
 	{
-		std::string DateStr = JData["start_date"];
+		std::string DateStr = JData.at("start_date");
 		
 		bool ParseSuccess;
 		datetime Date(DateStr.c_str(), &ParseSuccess);
@@ -232,17 +241,18 @@ ReadInputsFromJson(mobius_data_set *DataSet, const char *Filename)
 	
 	if (JData.find("data") != JData.end())
 	{
-		for (nlohmann::json::iterator It = JData["data"].begin(); It != JData["data"].end(); ++It)
+		const nlohmann::json &Data = JData.at("data");
+		for (nlohmann::json::const_iterator It = Data.begin(); It != Data.end(); ++It)
 		{
 			std::string Name = It.key();
 			
 			for(auto Itit = It->begin(); Itit != It->end(); ++Itit)
 			{
-				std::vector<std::string> Indices = (*Itit)["indexes"].get<std::vector<std::string>>();
+				std::vector<std::string> Indices = Itit->at("indexes").get<std::vector<std::string>>();
 				std::vector<const char *> Indices2;
 				for(std::string &Str : Indices) Indices2.push_back(Str.c_str());
 				
-				auto &Val = (*Itit)["values"];
+				const auto &Val = Itit->at("values");
 				std::vector<double> Values;
 				Values.reserve(Val.size());
 				for(auto &V : Val)
@@ -261,6 +271,12 @@ ReadInputsFromJson(mobius_data_set *DataSet, const char *Filename)
 	}
 }
 
+static void 
+ReadInputsFromJson(mobius_data_set *DataSet, const char *Filename)
+{
+	ReadInputsFromJson(DataSet, ReadJsonFile(Filename), Filename);
+}
+
 
 static void
 WriteParametersToJson(mobius_data_set *DataSet, const char *Filename)
@@ -199,9 +199,19 @@ struct module_spec
 
 struct equation_batch;
 struct model_run_state;
+struct mobius_data_set;
 
 typedef std::function<double(model_run_state *)> mobius_equation;
 
+//NOTE: Run-mode representation of an equation body. Instead of going through the type erasure of std::function, each equation is a plain function pointer that is handed a pointer to the captured state (closure) of the lambda that was given in the EQUATION macro. The closures are stored contiguously in the model's ClosureMemory.
+typedef double mobius_equation_function(const void *Closure, model_run_state *RunState);
+
+struct mobius_equation_entry
+{
+	mobius_equation_function *Function;
+	const void               *Closure;
+};
+
 typedef std::function<void(size_t, size_t, double)> mobius_matrix_insertion_function;
 
 #define MOBIUS_SOLVER_FUNCTION(Name) bool Name(double h, size_t n, double* x0, double* wk, const equation_batch *Batch, model_run_state *RunState, double AbsErr, double RelErr)
@@ -294,10 +304,17 @@ struct equation_spec
 	//NOTE: The below are built during EndModelDefinition:
 	std::set<index_set_h> IndexSetDependencies;          //NOTE: If the equation is run on a solver, the final index set dependencies of the equation will be those of the solver, not the ones stored here. You should generally use the storage structure to determine the final dependencies rather than this vector unless you are doing something specific in EndModelDefinition.
 	std::set<parameter_h> ParameterDependencies;
+	std::set<parameter_h> CrossIndexParameterDependencies; //NOTE: Parameters that are referenced with explicit indexes. These are not loaded at the start of the batch, but are needed to know what the equation depends on.
 	std::set<input_h>     InputDependencies;
 	std::set<equation_h>  DirectResultDependencies;
 	std::set<equation_h>  DirectLastResultDependencies;
 	std::set<equation_h>  CrossIndexResultDependencies;
+	std::set<index_set_h> BranchInputsIndexSets;         //NOTE: The index sets that the equation iterates over the branch inputs of using BRANCH_INPUTS.
+	bool AccessedByEarlierResult;                        //NOTE: Whether any equation reads earlier timesteps of this result using EARLIER_RESULT. Such results are always recorded in full, see RecordResult.
+	bool UsesRandomNumbers;                              //NOTE: Whether the equation draws random numbers (UNIFORM_RANDOM_UINT etc.).
+	bool ReadsTime;                                      //NOTE: Whether the equation read CURRENT_TIME or CURRENT_TIMESTEP during the registration run.
+	bool IsHoisted;                                      //NOTE: Whether the equation is evaluated for all timesteps before the main run loop instead of in it, see FindHoistedEquations.
+	bool IsConstant;                                     //NOTE: Whether the equation is evaluated once per index tuple at the start of the run instead of in every timestep, see FindHoistedEquations.
 	
 	//TODO: The following should probably just be stored separately in a temporary structure in the EndModelDefinition procedure, as it is not reused outside of that procedure.
 	std::vector<result_dependency_registration> IndexedResultAndLastResultDependencies;
@@ -373,6 +390,16 @@ struct equation_batch
 	array<array<equation_h>> ODEIsDependencyOfNonODE;
 };
 
+struct hoisted_equations
+{
+	//NOTE: The equations of a batch group that only depend on inputs and parameters (directly, or through other hoisted equations), see FindHoistedEquations.
+	array<equation_h>  Equations;   //NOTE: In evaluation order.
+	array<equation_h>  Constant;    //NOTE: The ones among Equations that don't depend on inputs or time either, in evaluation order. These are only evaluated once per index tuple, see EvaluateConstantEquations.
+	array<parameter_h> Parameters;  //NOTE: The parameters, inputs and results of hoisted equations in earlier batch groups that these read.
+	array<input_h>     Inputs;
+	array<equation_h>  Results;
+};
+
 struct equation_batch_group
 {
 	size_t FirstBatch;
@@ -384,6 +411,11 @@ struct equation_batch_group
 	array<iteration_data> IterationData;
 
 	array<equation_h> InitialValueOrder; //NOTE: The initial value setup of equations happens in a different order than the execution order during model run because the intial value equations may have different dependencies than the equations they are initial values for.
+	
+	s32  IndependentLevels;        //NOTE: The number of leading index sets of the group whose index tuples don't depend on each other within a timestep. See EndModelDefinition.
+	bool BranchesCanRunInParallel; //NOTE: If the top index set of the group is branched and the indexes of it only depend on each other through BRANCH_INPUTS.
+	
+	hoisted_equations Hoisted;
 };
 
 
@@ -435,13 +467,21 @@ struct mobius_model
 	entity_registry  <conditional_h,     conditional_spec>      Conditionals;
 	entity_registry  <unit_h,            unit_spec>             Units;
 	
-	std::vector<mobius_equation> EquationBodies;
+	std::vector<mobius_equation> EquationBodies;        //NOTE: Registration-mode bodies, only called during EndModelDefinition to find the dependencies of the equations.
+	std::vector<mobius_equation_entry> EquationTable;   //NOTE: Run-mode bodies, these are what is called during the model run.
+	
+	bucket_allocator ClosureMemory;                     //NOTE: Storage for the captured state of the run-mode equation bodies.
+	std::vector<std::pair<void(*)(void *), void *>> ClosureDestructors;
 	
 	array<equation_batch> EquationBatches;
 	array<equation_batch_group> BatchGroups;
 	
 	std::vector<mobius_preprocessing_step> PreprocessingSteps;
 	
+	//NOTE: Built during EndModelDefinition, see BuildBatchGroupDependencies. Used by incremental runs.
+	std::vector<std::vector<parameter_h>> BatchGroupParameterDependencies; //NOTE: BatchGroupParameterDependencies[G] are all the parameters that the evaluation of batch group G reads.
+	std::vector<std::vector<size_t>>      BatchGroupDependents;             //NOTE: BatchGroupDependents[G] are the batch groups that read results of batch group G.
+	
 	timestep_size TimestepSize;
 	
 	
@@ -481,6 +521,90 @@ ForAllBatchEquations(const batch_like &Batch, std::function<bool(equation_h)> Do
 }
 
 
+struct result_recording
+{
+	equation_h Equation;
+	std::vector<s64> Indexes;  //NOTE: One per index set of the result, where -1 means all the indexes of that index set. If empty, all instances of the result are recorded.
+};
+
+enum objective_statistic
+{
+	ObjectiveStatistic_NSE = 0,       //NOTE: Nash-Sutcliffe efficiency.
+	ObjectiveStatistic_KGE,           //NOTE: Kling-Gupta efficiency.
+	ObjectiveStatistic_LogNSE,        //NOTE: Nash-Sutcliffe efficiency of the logarithms. Only uses the timesteps where both the simulated and the observed values are positive.
+	ObjectiveStatistic_Bias,          //NOTE: Mean error (simulated - observed).
+	ObjectiveStatistic_RMSE,          //NOTE: Root mean square error.
+	ObjectiveStatistic_Observations,  //NOTE: The number of timesteps that had an observation and were used in the statistics.
+	
+	ObjectiveStatistic_Count,
+};
+
+struct objective_accumulator
+{
+	//NOTE: Goodness of fit between a result series and an input series of observations, accumulated during the model run. See AddObjective.
+	size_t ResultOffset;  //NOTE: Offsets of the result and the observation in one timestep of the result and input storage.
+	size_t InputOffset;
+	u64    SkipTimesteps;
+	
+	//NOTE: Running means and (co-)moments (Welford's method), since naive sums of squares lose precision over long series.
+	double N, MeanObs, MeanSim, M2Obs, M2Sim, CoMoment, SumSquaredError;
+	double LogN, LogMeanObs, LogM2Obs, LogSumSquaredError;
+	
+	double Statistics[ObjectiveStatistic_Count];  //NOTE: The result of the last model run.
+};
+
+struct mobius_data_set;
+
+struct result_sink
+{
+	//NOTE: Receives the results of a model run while it is running, see RunModel. Results points to RowCount consecutive timesteps of results, each laid out as one timestep of the full result storage (ResultStorageStructure.TotalCount values). FirstRow counts the same way as the rows of the full result storage, i.e. row 0 is the initial values, and row T+1 is timestep T.
+	std::function<void(mobius_data_set *DataSet, const double *Results, u64 FirstRow, size_t RowCount)> Receive;
+	size_t WindowSize = 1;  //NOTE: The number of timesteps that are kept in memory and passed to Receive at a time.
+};
+
+struct compressed_results
+{
+	//NOTE: Result series that are compressed block by block, see CompressResultBlock. The blocks of all the series are stored one after the other in Bits, and the block Block of the series Series starts at the bit BlockStarts[Block*SeriesCount + Series].
+	bool                Active;      //NOTE: Whether the results of the last run were compressed.
+	size_t              SeriesCount;
+	std::vector<u64>    Bits;
+	u64                 BitCount;
+	std::vector<u64>    BlockStarts;
+	std::vector<u32>    BlockRows;   //NOTE: The number of timesteps in each block.
+};
+
+struct incremental_run_report
+{
+	//NOTE: How much of the last model run was reused from the run before it, see SetIncrementalRuns.
+	size_t BatchGroupsSkipped;
+	size_t BatchGroupCount;
+	u64    EvaluationsSkipped;  //NOTE: The number of result values (one per result per timestep) that were reused instead of being evaluated.
+	u64    EvaluationCount;
+};
+
+struct hoisting_report
+{
+	//NOTE: How much of the model is evaluated before the run loop instead of inside it, see FindHoistedEquations.
+	size_t HoistedEquations;
+	size_t EquationCount;    //NOTE: The equations that are evaluated in the run loop, i.e. not counting initial value equations.
+	size_t HoistedResults;   //NOTE: The number of result values per timestep that are computed by hoisted equations, with the index sets of the data set.
+	size_t ResultCount;
+	size_t ConstantEquations;  //NOTE: The hoisted equations that are only evaluated once per index tuple, and the number of result values they compute.
+	size_t ConstantResults;
+};
+
+#if !defined(MOBIUS_THREAD_COUNT)
+#define MOBIUS_THREAD_COUNT 1
+#endif
+
+#if !defined(MOBIUS_INPUT_THREAD_COUNT)
+#define MOBIUS_INPUT_THREAD_COUNT 0   //NOTE: The default of mobius_data_set::InputThreadCount. 0 means one thread per hardware thread.
+#endif
+
+#if !defined(MOBIUS_MAPPED_RELEASE_SIZE)
+#define MOBIUS_MAPPED_RELEASE_SIZE (64*1024*1024)   //NOTE: How many bytes of finished results a run with memory-mapped results collects before it releases them, see EndTimestep.
+#endif
+
 struct mobius_data_set
 {
 	const mobius_model *Model;
@@ -494,16 +618,53 @@ struct mobius_data_set
 	//  Also, why not use array<bla> for more of these below?
 	
 	double *InputData;
+	float  *SingleInputData;    //NOTE: Holds the input data instead of InputData if it is stored in single precision, see SetSinglePrecisionStorage. Only one of the two is allocated.
 	bool   *InputTimeseriesWasProvided;
 	storage_structure<input_h> InputStorageStructure;
 	datetime InputDataStartDate;
 	bool InputDataHasSeparateStartDate = false; //NOTE: Whether or not a start date was provided for the input data, which is potentially different from the start date of the model run.
 	u64 InputDataTimesteps;
 	bool OwnsInputs = true;     //NOTE: If this data set is a copy of another and only is set to reference the other's input data, this is set to false so that we don't delete the input data when deleting this set.
+	mobius_data_set *InputsBorrowedFrom; //NOTE: The data set that owns the input data if this is a copy that borrows it (see CopyDataSet), otherwise nullptr.
+	u64 InputGeneration;        //NOTE: Counts changes to the input data, see InputsChanged. Only used in the data set that owns the inputs.
+	
+	//NOTE: Memory-mapped storage, see SetMappedStorage. MappedInputs and MappedResults hold the files that InputData (or SingleInputData) and ResultData are placed in, and are empty if the data is in ordinary memory.
+	std::string MappedStoragePath;
+	mapped_file MappedInputs;
+	mapped_file MappedResults;
+	size_t      MappedResultsReleased;  //NOTE: How many bytes at the start of MappedResults have been released during the current run, see EndTimestep.
 	
 	double *ResultData;
+	size_t  ResultDataSize;    //NOTE: The number of values allocated for ResultData.
 	storage_structure<equation_h> ResultStorageStructure;
 	
+	//NOTE: Selective result recording, see RecordResult. If ResultRecording is empty, ResultData holds every result at every timestep. Otherwise ResultData only holds the two timesteps that a model run needs at any time, and the recorded results are copied out to RecordedResultData after each timestep.
+	std::vector<result_recording> ResultRecording;
+	std::vector<size_t> RecordedOffsets;  //NOTE: The offsets (in the result storage structure) of the results that were recorded in the last run, in the order they are stored in each timestep of RecordedResultData. Empty if all results were recorded.
+	std::vector<s64>    RecordedIndex;    //NOTE: RecordedIndex[Offset] is the position of Offset in RecordedOffsets, or -1 if that result was not recorded. Empty if all results were recorded.
+	double *RecordedResultData;
+	size_t  RecordedResultDataSize;
+	std::vector<objective_accumulator> Objectives;
+	
+	size_t  ResultWindow;  //NOTE: 0 if ResultData holds every timestep. Otherwise ResultData holds one timestep carried over from the previous window followed by a window of ResultWindow timesteps that is reused, see EndTimestep.
+	
+	//NOTE: Series-major results, see SetSeriesMajorResults. If HasSeriesResults is set, SeriesResultData holds each stored result series of the last run (including the initial value) contiguously, in the order of the offsets in ResultData (or in RecordedResultData if only some results were recorded).
+	bool    SeriesMajorResults = false;
+	bool    HasSeriesResults = false;
+	double *SeriesResultData;
+	size_t  SeriesResultDataSize;
+	
+	//NOTE: Packed result storage, i.e. single precision storage (see SetSinglePrecisionStorage) or compressed storage (see SetCompressedResults). If the results of the last run were packed, PackedOffsets holds the offsets of the stored results (in the order they are stored in each timestep of SingleResultData, or in each block of CompressedResults) and PackedIndex the position of each offset in it (or -1). RecordedOffsets then only holds the results that are accessed with EARLIER_RESULT, which are also kept unpacked in RecordedResultData.
+	bool SinglePrecisionResults = false;
+	bool SinglePrecisionInputs  = false;
+	bool CompressResults        = false;
+	size_t CompressionBlockSize = 64;
+	std::vector<size_t> PackedOffsets;
+	std::vector<s64>    PackedIndex;
+	float  *SingleResultData;
+	size_t  SingleResultDataSize;
+	compressed_results CompressedResults;
+	
 	index_t *IndexCounts;
 	const char ***IndexNames;  // IndexNames[IndexSet.Handle][IndexNamesToHandle[IndexSet.Handle][IndexName]] == IndexName;
 	std::vector<string_map<u32>> IndexNamesToHandle;
@@ -512,10 +673,19 @@ struct mobius_data_set
 	//TODO: could make this array<array<array<index_t>>>, but I don't know if it improves the code..
 	array<index_t> **BranchInputs; //BranchInputs[ReachIndexSet][ReachIndex] ...
 
+	u32 ThreadCount = MOBIUS_THREAD_COUNT; //NOTE: The number of threads to use when evaluating batch groups where the index tuples are independent (or the branches of a river network are). 1 means a serial run.
+	u32 InputThreadCount = MOBIUS_INPUT_THREAD_COUNT; //NOTE: The number of threads ReadInputsFromFile can use to parse the values of different input series, see ReadInputSeries. 0 means one per hardware thread.
+	
 	bool HasBeenRun;
 	u64 TimestepsLastRun;
 	datetime StartDateLastRun;
 	
+	//NOTE: Incremental runs, see SetIncrementalRuns. ParameterDataLastRun and InputGenerationLastRun are what the results that are currently in ResultData were computed from. ParameterDataLastRun is empty if there are no such results.
+	bool IncrementalRuns = false;
+	std::vector<parameter_value> ParameterDataLastRun;
+	u64 InputGenerationLastRun;
+	incremental_run_report IncrementalRunReport;
+	
 	~mobius_data_set();
 };
 
@@ -523,6 +693,37 @@ struct mobius_data_set
 #define MOBIUS_EQUATION_PROFILING 0
 #endif
 
+enum run_plan_op
+{
+	RunPlanOp_Equation,          //NOTE: Evaluate the equation Handle and store the result.
+	RunPlanOp_ComputedResult,    //NOTE: The result of the equation Handle is written by another equation (IsComputedBy) or was evaluated before the run loop (IsHoisted). Only the stored value is read into CurResults.
+	RunPlanOp_SkipResults,       //NOTE: Move past Count results of batches that are switched off in every index tuple in this run.
+	RunPlanOp_ConditionalBatch,  //NOTE: The switch of the batch Handle does not have the same value in every index tuple. If it is off, skip the next Count instructions and the results of the batch.
+	RunPlanOp_SolverBatch,       //NOTE: Solve the batch Handle.
+};
+
+struct run_plan_instruction
+{
+	run_plan_op Op;
+	u32 Handle;
+	u32 Count;
+};
+
+struct run_plan
+{
+	//NOTE: The equation batches of the model flattened to one instruction stream for the parameter values of one run, see BuildRunPlan.
+	array<run_plan_instruction> Instructions;
+	array<size_t>               GroupStart;          //NOTE: The instructions of batch group G are Instructions[GroupStart[G]] up to Instructions[GroupStart[G+1]].
+	array<bool>                 ResetEveryTimestep;  //NOTE: Indexed by equation handle, so that the solver batches don't have to look it up in the equation specs.
+	
+	bool          HoistEquations;  //NOTE: Whether the hoisted equations are evaluated before the run loop in this run, see RunHoistedEquations.
+	array<size_t> HoistedOffsets;  //NOTE: Temporary storage for RunHoistedEquations.
+	
+	array<bool>   IsConstant;      //NOTE: Indexed by equation handle. Whether the equation was evaluated once per index tuple at the start of this run, see EvaluateConstantEquations.
+	array<size_t> ConstantOffsets; //NOTE: The constant block: The result offsets and values of the constant equations for every index tuple, batch group by batch group.
+	array<double> ConstantValues;
+};
+
 struct model_run_state
 {
 	// The purpose of the model_run_state is to store temporary state that is needed during a model run as well as providing an access point to data that is needed when evaluating equations.
@@ -553,11 +754,14 @@ struct model_run_state
 	double *AllLastResultsBase;
 	
 	double *AllCurInputsBase;
+	std::vector<double> SingleInputRow; //NOTE: The inputs of the current timestep converted to double if the data set stores its inputs in single precision, see LoadInputTimestep.
+	size_t InputTimestep;               //NOTE: The timestep of the input data that AllCurInputsBase points to.
 	
 	double *AtResult;
 	double *AtLastResult;
 	
 	array<parameter_value> FastParameterLookup;
+	array<size_t>          FastParameterOffsets;  //NOTE: The offsets into the ParameterData of the data set of the values in FastParameterLookup, so that it can be updated without being rebuilt.
 	array<size_t>          FastInputLookup;
 	array<size_t>          FastResultLookup;
 	array<size_t>          FastLastResultLookup;
@@ -567,10 +771,16 @@ struct model_run_state
 	size_t *AtResultLookup;
 	size_t *AtLastResultLookup;
 	
+	run_plan Plan;   //NOTE: See BuildRunPlan.
+	
 	double *SolverTempX0;          //NOTE: Temporary storage for use by solvers
 	double *SolverTempWorkStorage; //NOTE: Temporary storage for use by solvers
 	double *JacobianTempStorage;   //NOTE: Temporary storage for use by Jacobian estimation
 	
+	bool StorageIsAllocated; //NOTE: Whether the fast lookup arrays have been built and the solver temporaries and run plan allocated, see BuildFastLookup.
+	
+	const result_sink *ResultSink;
+	
 
 	//So that some models can do random generation
 	std::mt19937 RandomGenerator;
@@ -581,6 +791,10 @@ struct model_run_state
 	std::vector<result_dependency_registration> ResultDependencies;
 	std::vector<result_dependency_registration> LastResultDependencies;
 	std::vector<index_set_h> DirectIndexSetDependencies;
+	std::vector<index_set_h> BranchInputsDependencies;
+	std::vector<equation_h> EarlierResultDependencies;
+	bool UsesRandomNumbers;
+	bool ReadsTime;         //NOTE: Set whenever CURRENT_TIME or CURRENT_TIMESTEP is read. This is also used during the run, see EvaluateConstantEquations.
 
 	
 #if MOBIUS_EQUATION_PROFILING
@@ -594,6 +808,8 @@ struct model_run_state
 		Running = false;
 		DataSet = nullptr;
 		this->Model = Model;
+		UsesRandomNumbers = false;
+		ReadsTime = false;
 	}
 	
 	//NOTE: For proper run:
@@ -617,11 +833,16 @@ struct model_run_state
 		
 		
 		Timestep = 0;
+		InputTimestep = 0;
+		ReadsTime = false;
 		
 		SolverTempX0 = nullptr;
 		SolverTempWorkStorage = nullptr;
 		JacobianTempStorage = nullptr;
 		
+		StorageIsAllocated = false;
+		ResultSink = nullptr;
+		
 		//NOTE: Code borrowed from stack exchange. Should really clean it up!
 		std::random_device Dev;
 		std::mt19937::result_type Seed = Dev() ^ (
@@ -666,6 +887,10 @@ struct model_run_state
 			ResultDependencies.clear();
 			LastResultDependencies.clear();
 			DirectIndexSetDependencies.clear();
+			BranchInputsDependencies.clear();
+			EarlierResultDependencies.clear();
+			UsesRandomNumbers = false;
+			ReadsTime = false;
 		}
 	}
 };
@@ -676,7 +901,8 @@ CallEquation(const mobius_model *Model, model_run_state *RunState, equation_h Eq
 #if MOBIUS_EQUATION_PROFILING
 	u64 Begin = __rdtsc();
 #endif
-	double ResultValue = Model->EquationBodies[Equation.Handle](RunState);
+	const mobius_equation_entry &Entry = Model->EquationTable[Equation.Handle];
+	double ResultValue = Entry.Function(Entry.Closure, RunState);
 #if MOBIUS_EQUATION_PROFILING
 	u64 End = __rdtsc();
 	RunState->EquationHits[Equation.Handle]++;
@@ -1048,8 +1274,20 @@ HideParameter(mobius_model *Model, parameter_h Parameter, bool ShouldNotBeExpose
 }
 
 
-inline void
-SetEquation(mobius_model *Model, equation_h Equation, mobius_equation EquationBody, bool Override = false)
+template<typename closure_type> double
+CallEquationClosure(const void *Closure, model_run_state *RunState)
+{
+	return (*(const closure_type *)Closure)(RunState);
+}
+
+template<typename closure_type> void
+DestroyEquationClosure(void *Closure)
+{
+	((closure_type *)Closure)->~closure_type();
+}
+
+template<typename registration_body, typename run_body> void
+SetEquation(mobius_model *Model, equation_h Equation, registration_body RegistrationBody, run_body RunBody, bool Override = false)
 {
 	//REGISTRATION_BLOCK(Model) //NOTE: We can't use REGISTRATION_BLOCK since the user don't call the SetEquation explicitly, it is called through the macro EQUATION, and so the error message would be confusing.
 	if(Model->Finalized)
@@ -1064,7 +1302,17 @@ SetEquation(mobius_model *Model, equation_h Equation, mobius_equation EquationBo
 		FatalError("ERROR: The equation body for \"", GetName(Model, Equation), "\" is already defined. It can not be defined twice unless it is explicitly overridden using EQUATION_OVERRIDE.\n");
 	}
 	
-	Model->EquationBodies[Equation.Handle] = EquationBody;
+	Model->EquationBodies[Equation.Handle] = RegistrationBody;
+	
+	//NOTE: Copy the closure of the run body into the closure memory, padded so that it gets the alignment it needs.
+	u8 *Memory = Model->ClosureMemory.Allocate<u8>(sizeof(run_body) + alignof(run_body));
+	size_t Misalignment = (size_t)Memory % alignof(run_body);
+	if(Misalignment != 0) Memory += alignof(run_body) - Misalignment;
+	run_body *Closure = new (Memory) run_body(RunBody);
+	
+	Model->ClosureDestructors.push_back({DestroyEquationClosure<run_body>, (void *)Closure});
+	Model->EquationTable[Equation.Handle] = {CallEquationClosure<run_body>, (const void *)Closure};
+	
 	Model->Equations[Equation].EquationIsSet = true;
 }
 
@@ -1110,7 +1358,10 @@ RegisterEquation_(mobius_model *Model, const char *Name, unit_h Unit, solver_h S
 	equation_h Equation = Model->Equations.Register(Name);
 	
 	if(Model->EquationBodies.size() <= Equation.Handle)
+	{
 		Model->EquationBodies.resize(Equation.Handle + 1, {});
+		Model->EquationTable.resize(Equation.Handle + 1, {});
+	}
 	
 	equation_spec &Spec = Model->Equations[Equation];
 	
@@ -1182,23 +1433,22 @@ RegisterEquationCumulative(mobius_model *Model, const char *Name, equation_h Cum
 	Model->Equations[Equation].Cumulates = Cumulates;
 	Model->Equations[Equation].CumulationWeight = Weight;
 	
+	//NOTE: These bodies do not use the accessor macros, so the same body is used both for registration and for the run.
 	if(IsValid(Weight))
 	{
-		SetEquation(Model, Equation,
-			[Cumulates, CumulatesOverIndexSet, Weight] (model_run_state *RunState) -> double
-			{
-				return CumulateResult(RunState->DataSet, Cumulates, CumulatesOverIndexSet, RunState->CurrentIndexes, RunState->AllCurResultsBase, Weight);
-			}
-		);
+		auto Body = [Cumulates, CumulatesOverIndexSet, Weight] (model_run_state *RunState) -> double
+		{
+			return CumulateResult(RunState->DataSet, Cumulates, CumulatesOverIndexSet, RunState->CurrentIndexes, RunState->AllCurResultsBase, Weight);
+		};
+		SetEquation(Model, Equation, Body, Body);
 	}
 	else
 	{
-		SetEquation(Model, Equation,
-			[Cumulates, CumulatesOverIndexSet] (model_run_state *RunState) -> double
-			{
-				return CumulateResult(RunState->DataSet, Cumulates, CumulatesOverIndexSet, RunState->CurrentIndexes, RunState->AllCurResultsBase);
-			}
-		);
+		auto Body = [Cumulates, CumulatesOverIndexSet] (model_run_state *RunState) -> double
+		{
+			return CumulateResult(RunState->DataSet, Cumulates, CumulatesOverIndexSet, RunState->CurrentIndexes, RunState->AllCurResultsBase);
+		};
+		SetEquation(Model, Equation, Body, Body);
 	}
 	
 	return Equation;
@@ -1420,28 +1670,56 @@ AddInputIndexSetDependency(mobius_model *Model, input_h Input, index_set_h Index
 ////////////////////////////////////////////////
 
 
-#define PARAMETER(ParH, ...) (RunState__->Running ? GetCurrentParameter(RunState__, ParH, ##__VA_ARGS__) : RegisterParameterDependency(RunState__, ParH, ##__VA_ARGS__))
-#define INPUT(InputH) (RunState__->Running ? GetCurrentInput(RunState__, InputH) : RegisterInputDependency(RunState__, InputH))
-#define RESULT(ResultH, ...) (RunState__->Running ? GetCurrentResult(RunState__, ResultH, ##__VA_ARGS__) : RegisterResultDependency(RunState__, ResultH, ##__VA_ARGS__))
-#define LAST_RESULT(ResultH, ...) (RunState__->Running ? GetLastResult(RunState__, ResultH, ##__VA_ARGS__) : RegisterLastResultDependency(RunState__, ResultH, ##__VA_ARGS__))
-#define EARLIER_RESULT(ResultH, StepBack, ...) (RunState__->Running ? GetEarlierResult(RunState__, ResultH, (StepBack), ##__VA_ARGS__) : RegisterLastResultDependency(RunState__, ResultH, ##__VA_ARGS__))
-#define INPUT_WAS_PROVIDED(InputH) (RunState__->Running ? GetIfInputWasProvided(RunState__, InputH) : RegisterInputDependency(RunState__, InputH))
-#define IF_INPUT_ELSE_PARAMETER(InputH, ParameterH) (RunState__->Running ? GetCurrentInputOrParameter(RunState__, InputH, ParameterH) : RegisterInputAndParameterDependency(RunState__, InputH, ParameterH))
+//NOTE: The EQUATION macro instantiates the equation body twice, once for the registration run and once for the actual model run. Each instantiation shadows EquationMode__ with a compile-time constant so that the RUNNING__ check in the accessors below is folded away by the compiler and the run-mode body has no branching on RunState__->Running. If the accessors are used outside of an EQUATION body (for instance in a helper lambda that is passed RunState__), this global is what is seen, and RUNNING__ falls back to checking RunState__->Running at runtime.
+enum equation_mode
+{
+	EquationMode_Dynamic,
+	EquationMode_Registration,
+	EquationMode_Run,
+};
+
+static const equation_mode EquationMode__ = EquationMode_Dynamic;
+
+#define RUNNING__ (EquationMode__ == EquationMode_Dynamic ? RunState__->Running : (EquationMode__ == EquationMode_Run))
+
+#define PARAMETER(ParH, ...) (RUNNING__ ? GetCurrentParameter(RunState__, ParH, ##__VA_ARGS__) : RegisterParameterDependency(RunState__, ParH, ##__VA_ARGS__))
+#define INPUT(InputH) (RUNNING__ ? GetCurrentInput(RunState__, InputH) : RegisterInputDependency(RunState__, InputH))
+#define RESULT(ResultH, ...) (RUNNING__ ? GetCurrentResult(RunState__, ResultH, ##__VA_ARGS__) : RegisterResultDependency(RunState__, ResultH, ##__VA_ARGS__))
+#define LAST_RESULT(ResultH, ...) (RUNNING__ ? GetLastResult(RunState__, ResultH, ##__VA_ARGS__) : RegisterLastResultDependency(RunState__, ResultH, ##__VA_ARGS__))
+#define EARLIER_RESULT(ResultH, StepBack, ...) (RUNNING__ ? GetEarlierResult(RunState__, ResultH, (StepBack), ##__VA_ARGS__) : RegisterEarlierResultDependency(RunState__, ResultH, ##__VA_ARGS__))
+#define INPUT_WAS_PROVIDED(InputH) (RUNNING__ ? GetIfInputWasProvided(RunState__, InputH) : RegisterInputDependency(RunState__, InputH))
+#define IF_INPUT_ELSE_PARAMETER(InputH, ParameterH) (RUNNING__ ? GetCurrentInputOrParameter(RunState__, InputH, ParameterH) : RegisterInputAndParameterDependency(RunState__, InputH, ParameterH))
 
 
+//NOTE: The time accessors mark that they were used, so that the equations that read the time are not treated as constant (see FindHoistedEquations). Equations should not read RunState__->Timestep directly for the same reason.
 inline const expanded_datetime &
 CurrentTime(model_run_state *RunState)
 {
+	RunState->ReadsTime = true;
 	return RunState->CurrentTime;
 }
 
+inline s64
+CurrentTimestep(model_run_state *RunState)
+{
+	RunState->ReadsTime = true;
+	return RunState->Timestep;
+}
+
 #define CURRENT_TIME() (CurrentTime(RunState__))
 
-#define CURRENT_TIMESTEP() (RunState__->Timestep)
+#define CURRENT_TIMESTEP() (CurrentTimestep(RunState__))
 
 #define EQUATION(Model, ResultH, Def) \
 SetEquation(Model, ResultH, \
  [=] (model_run_state *RunState__) { \
+ const equation_mode EquationMode__ = EquationMode_Registration; \
+ (void)EquationMode__; \
+ Def \
+ }, \
+ [=] (model_run_state *RunState__) { \
+ const equation_mode EquationMode__ = EquationMode_Run; \
+ (void)EquationMode__; \
  Def \
  } \
 );
@@ -1449,6 +1727,13 @@ SetEquation(Model, ResultH, \
 #define EQUATION_OVERRIDE(Model, ResultH, Def) \
 SetEquation(Model, ResultH, \
  [=] (model_run_state *RunState__) { \
+ const equation_mode EquationMode__ = EquationMode_Registration; \
+ (void)EquationMode__; \
+ Def \
+ }, \
+ [=] (model_run_state *RunState__) { \
+ const equation_mode EquationMode__ = EquationMode_Run; \
+ (void)EquationMode__; \
  Def \
  } \
  , true \
@@ -1560,6 +1845,9 @@ GetLastResult(model_run_state *RunState, equation_h Result, T... Indexes)
 	return RunState->AllLastResultsBase[Offset];
 }
 
+inline double *
+ResultSeriesLocation(mobius_data_set *DataSet, size_t Offset, size_t *Stride);
+
 template<typename... T> double
 GetEarlierResult(model_run_state *RunState, equation_h Result, u64 StepBack, T...Indexes)
 {
@@ -1568,14 +1856,18 @@ GetEarlierResult(model_run_state *RunState, equation_h Result, u64 StepBack, T..
 	index_t OverrideIndexes[OverrideCount] = {Indexes...};
 	size_t Offset = OffsetForHandle(DataSet->ResultStorageStructure, RunState->CurrentIndexes, DataSet->IndexCounts, OverrideIndexes, OverrideCount, Result);
 	
-	//TODO: Make proper accessor for this that belongs to mobius_data_set.h so that this file does not need to have knowledge of the inner workings of the storage system.
-	double *Initial = DataSet->ResultData + Offset;
-	//NOTE: Initial points to the initial value (adding TotalCount once gives us timestep 0)
+	//NOTE: The value of the current timestep is not in the recorded results yet if only some results are recorded.
+	if(StepBack == 0)
+		return RunState->AllCurResultsBase[Offset];
+	
+	size_t Stride;
+	double *Initial = ResultSeriesLocation(DataSet, Offset, &Stride); //NOTE: Never null, since results that are accessed with EARLIER_RESULT are always recorded.
+	//NOTE: Initial points to the initial value (adding Stride once gives us timestep 0)
 	if(StepBack > RunState->Timestep)
 	{
 		return *Initial;
 	}
-	return *(Initial + ( (RunState->Timestep+1) - StepBack)*(RunState->DataSet->ResultStorageStructure.TotalCount));
+	return *(Initial + ( (RunState->Timestep+1) - StepBack)*Stride);
 }
 
 inline double
@@ -1641,8 +1933,16 @@ RegisterLastResultDependency(model_run_state *RunState, equation_h Result, T...
 	return 0.0;
 }
 
+template<typename... T> double
+RegisterEarlierResultDependency(model_run_state *RunState, equation_h Result, T... Indexes)
+{
+	RunState->EarlierResultDependencies.push_back(Result);
+	
+	return RegisterLastResultDependency(RunState, Result, Indexes...);
+}
+
 //TODO: SET_RESULT is not that nice, and can interfere with how the dependency system works if used incorrectly. It is included to get PERSiST and some other models to work, but should be used with care!
-#define SET_RESULT(ResultH, Value, ...) {if(RunState__->Running){SetResult(RunState__, Value, ResultH, ##__VA_ARGS__);}}
+#define SET_RESULT(ResultH, Value, ...) {if(RUNNING__){SetResult(RunState__, Value, ResultH, ##__VA_ARGS__);}}
 
 template<typename... T> void
 SetResult(model_run_state *RunState, double Value, equation_h Result, T... Indexes)
@@ -1664,11 +1964,11 @@ SetResult(model_run_state *RunState, double Value, equation_h Result)
 }
 
 
-#define INDEX_COUNT(IndexSetH) (RunState__->Running ? (RunState__->DataSet->IndexCounts[IndexSetH.Handle]) : index_t(IndexSetH, 1))
-#define CURRENT_INDEX(IndexSetH) (RunState__->Running ? GetCurrentIndex(RunState__, IndexSetH) : RegisterIndexSetDependency(RunState__, IndexSetH))
+#define INDEX_COUNT(IndexSetH) (RUNNING__ ? (RunState__->DataSet->IndexCounts[IndexSetH.Handle]) : index_t(IndexSetH, 1))
+#define CURRENT_INDEX(IndexSetH) (RUNNING__ ? GetCurrentIndex(RunState__, IndexSetH) : RegisterIndexSetDependency(RunState__, IndexSetH))
 #define FIRST_INDEX(IndexSetH) (index_t(IndexSetH, 0))
 #define INDEX_NUMBER(IndexSetH, Index) (index_t(IndexSetH, (u32)Index))
-#define INPUT_COUNT(IndexSetH) (RunState__->Running ? GetInputCount(RunState__, IndexSetH) : 0)
+#define INPUT_COUNT(IndexSetH) (RUNNING__ ? GetInputCount(RunState__, IndexSetH) : 0)
 
 inline index_t
 RegisterIndexSetDependency(model_run_state *RunState, index_set_h IndexSet)
@@ -1703,6 +2003,8 @@ BranchInputs(model_run_state *RunState, index_set_h IndexSet, index_t Index)
 	if(RunState->Running)
 		return RunState->DataSet->BranchInputs[IndexSet.Handle][Index.Index];
 	
+	RunState->BranchInputsDependencies.push_back(IndexSet);
+	
 	DummyIndex = index_t { IndexSet.Handle, 0};
 	DummyIndexes.Count = 1;
 	DummyIndexes.Data = &DummyIndex;
@@ -1714,6 +2016,7 @@ BranchInputs(model_run_state *RunState, index_set_h IndexSet, index_t Index)
 inline u64
 UniformRandomU64(model_run_state *RunState, u64 Low, u64 High)
 {
+	if(!RunState->Running) RunState->UsesRandomNumbers = true;
 	std::uniform_int_distribution<u64> Distribution(Low, High);
 	return Distribution(RunState->RandomGenerator);
 }
@@ -1721,6 +2024,7 @@ UniformRandomU64(model_run_state *RunState, u64 Low, u64 High)
 inline double
 UniformRandomDouble(model_run_state *RunState, double Low, double High)
 {
+	if(!RunState->Running) RunState->UsesRandomNumbers = true;
 	std::uniform_real_distribution<double> Distribution(Low, High);
 	return Distribution(RunState->RandomGenerator);
 }
@@ -1729,6 +2033,69 @@ UniformRandomDouble(model_run_state *RunState, double Low, double High)
 #define UNIFORM_RANDOM_DOUBLE(Low, High) (UniformRandomDouble(RunState__, Low, High))
 
 
+inline void
+SignatureHash(u64 *Hash, u64 Value)
+{
+	//NOTE: FNV-1a, one byte at a time.
+	for(int Byte = 0; Byte < 8; ++Byte)
+	{
+		*Hash ^= (Value >> (8*Byte)) & 0xff;
+		*Hash *= 1099511628211ull;
+	}
+}
+
+template<typename handle_type> inline void
+SignatureHash(u64 *Hash, const array<handle_type> &Handles)
+{
+	SignatureHash(Hash, Handles.Count);
+	for(const handle_type &Handle : Handles)
+		SignatureHash(Hash, Handle.Handle);
+}
+
+static u64
+ModelStructureSignature(const mobius_model *Model)
+{
+	//NOTE: Computes a hash of the batch structure of a finalized model. Used to check that a checkpoint was made by a model with the same structure.
+	u64 Hash = 14695981039346656037ull;
+
+	SignatureHash(&Hash, Model->Equations.Count());
+	SignatureHash(&Hash, Model->Parameters.Count());
+	SignatureHash(&Hash, Model->Inputs.Count());
+	SignatureHash(&Hash, Model->IndexSets.Count());
+	SignatureHash(&Hash, Model->Solvers.Count());
+
+	for(equation_h Equation : Model->Equations)
+		SignatureHash(&Hash, Model->Equations[Equation].IsComputedBy.Handle);
+
+	SignatureHash(&Hash, Model->BatchGroups.Count);
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		SignatureHash(&Hash, BatchGroup.FirstBatch);
+		SignatureHash(&Hash, BatchGroup.LastBatch);
+		SignatureHash(&Hash, BatchGroup.IndexSets);
+		SignatureHash(&Hash, BatchGroup.LastResultsToReadAtBase);
+		for(const iteration_data &IterationData : BatchGroup.IterationData)
+		{
+			SignatureHash(&Hash, IterationData.ParametersToRead);
+			SignatureHash(&Hash, IterationData.InputsToRead);
+			SignatureHash(&Hash, IterationData.ResultsToRead);
+			SignatureHash(&Hash, IterationData.LastResultsToRead);
+		}
+	}
+
+	SignatureHash(&Hash, Model->EquationBatches.Count);
+	for(const equation_batch &Batch : Model->EquationBatches)
+	{
+		SignatureHash(&Hash, Batch.Solver.Handle);
+		SignatureHash(&Hash, Batch.ConditionalSwitch.Handle);
+		SignatureHash(&Hash, Batch.Equations);
+		SignatureHash(&Hash, Batch.EquationsODE);
+	}
+
+	return Hash;
+}
+
+
 
 #define MOBIUS_MODEL_H
 #endif
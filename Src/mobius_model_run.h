@@ -9,6 +9,7 @@ BeginModelDefinition(const char *Name = "(unnamed model)", bool UseEndDate = fal
 {
 	mobius_model *Model = new mobius_model {};
 	Model->BucketMemory.Initialize(1024*1024);
+	Model->ClosureMemory.Initialize(64*1024);
 #if MOBIUS_PRINT_TIMING_INFO
 	Model->DefinitionTimer = BeginTimer();
 #endif
@@ -33,6 +34,9 @@ BeginModelDefinition(const char *Name = "(unnamed model)", bool UseEndDate = fal
 
 mobius_model::~mobius_model()
 {
+	for(auto &Destructor : ClosureDestructors)
+		Destructor.first(Destructor.second);
+	ClosureMemory.DeallocateAll();
 	BucketMemory.DeallocateAll();
 }
 
@@ -751,6 +755,170 @@ ProcessBatchGroups(mobius_model *Model, std::vector<pre_batch> &PreBatches, std:
 	}
 }
 
+#if !defined(MOBIUS_HOIST_EQUATIONS)
+#define MOBIUS_HOIST_EQUATIONS 1
+#endif
+
+static void
+FindHoistedEquations(mobius_model *Model)
+{
+	/*
+		Finds the equations that can be evaluated for all timesteps before the main run loop instead of one timestep at a time inside it (see RunHoistedEquations). These are the equations that don't depend on the state of the model, i.e. they only read parameters, inputs and the results of other hoisted equations for the same timestep. Typical examples are unit conversions of inputs, evapotranspiration and degree-day computations.
+		
+		An equation is not hoisted if it
+		- is an ODE or a cumulative equation, or is in a solver batch or a conditional batch,
+		- reads a last result, an earlier result or an explicitly indexed result (this includes BRANCH_INPUTS),
+		- reads the result of an equation that is not hoisted,
+		- is computed by another equation (IsComputedBy) or computes other equations (SET_RESULT),
+		- has an initial value equation (since that is registered as a last result dependency),
+		- draws random numbers (since hoisting it would change the order of the draws).
+		
+		A hoisted equation is in addition constant if it does not read any inputs or the time, and the hoisted equations it reads are constant too. Its value then only depends on the parameters and the index tuple, so it is evaluated only once per index tuple (see EvaluateConstantEquations). Typical examples are geometry and unit-converted rate constants.
+		
+		Compile with MOBIUS_HOIST_EQUATIONS=0 to turn this off.
+	*/
+	
+	std::vector<bool> ComputesOthers(Model->Equations.Count(), false);
+	for(equation_h Equation : Model->Equations)
+	{
+		equation_h ComputedBy = Model->Equations[Equation].IsComputedBy;
+		if(IsValid(ComputedBy)) ComputesOthers[ComputedBy.Handle] = true;
+	}
+	
+	for(equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		std::vector<equation_h> Equations;
+		std::vector<equation_h> Constant;
+		std::set<parameter_h>   Parameters;
+		std::set<input_h>       Inputs;
+		std::set<equation_h>    Results;
+		
+		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		{
+			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
+			if(!MOBIUS_HOIST_EQUATIONS || IsValid(Batch.Solver) || IsValid(Batch.Conditional)) continue;
+			
+			for(equation_h Equation : Batch.Equations)
+			{
+				equation_spec &Spec = Model->Equations[Equation];
+				bool Hoist = Spec.Type == EquationType_Basic && !IsValid(Spec.IsComputedBy) && !ComputesOthers[Equation.Handle] && !Spec.UsesRandomNumbers
+					&& Spec.DirectLastResultDependencies.empty() && Spec.CrossIndexResultDependencies.empty() && Spec.IndexedResultAndLastResultDependencies.empty();
+				for(equation_h Dependency : Spec.DirectResultDependencies)
+					if(!Model->Equations[Dependency].IsHoisted) Hoist = false;  //NOTE: Dependencies are always evaluated earlier, so they have already been classified.
+				if(!Hoist) continue;
+				
+				Spec.IsHoisted = true;
+				Equations.push_back(Equation);
+				
+				Spec.IsConstant = Spec.InputDependencies.empty() && !Spec.ReadsTime;
+				for(equation_h Dependency : Spec.DirectResultDependencies)
+					if(!Model->Equations[Dependency].IsConstant) Spec.IsConstant = false;
+				if(Spec.IsConstant) Constant.push_back(Equation);
+
+				Parameters.insert(Spec.ParameterDependencies.begin(), Spec.ParameterDependencies.end());
+				Inputs.insert(Spec.InputDependencies.begin(), Spec.InputDependencies.end());
+				for(equation_h Dependency : Spec.DirectResultDependencies)
+				{
+					//NOTE: Results of hoisted equations in the same group are already in CurResults when they are needed, those from earlier groups have to be read in.
+					if(std::find(Equations.begin(), Equations.end(), Dependency) == Equations.end())
+						Results.insert(Dependency);
+				}
+			}
+		}
+		
+		BatchGroup.Hoisted.Equations.CopyFrom(&Model->BucketMemory, Equations);
+		BatchGroup.Hoisted.Constant.CopyFrom(&Model->BucketMemory, Constant);
+		BatchGroup.Hoisted.Parameters.CopyFrom(&Model->BucketMemory, Parameters);
+		BatchGroup.Hoisted.Inputs.CopyFrom(&Model->BucketMemory, Inputs);
+		BatchGroup.Hoisted.Results.CopyFrom(&Model->BucketMemory, Results);
+	}
+}
+
+static void
+BuildBatchGroupDependencies(mobius_model *Model)
+{
+	//NOTE: Finds all the parameters each batch group reads, and which batch groups read the results of each batch group. An incremental run (see SetupIncrementalRun) uses this to find which batch groups have to be reevaluated when some parameter values changed since the last run.
+	//  This is conservative. A batch group depends on another if any of its equations (or their initial value equations) reads a result or last result of an equation in the other. Results that are computed by another equation (IsComputedBy) tie the two batch groups together both ways.
+	size_t GroupCount = Model->BatchGroups.Count;
+	
+	std::vector<size_t> GroupOfEquation(Model->Equations.Count(), GroupCount);
+	for(size_t BatchGroupIdx = 0; BatchGroupIdx < GroupCount; ++BatchGroupIdx)
+	{
+		const equation_batch_group &BatchGroup = Model->BatchGroups[BatchGroupIdx];
+		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		{
+			ForAllBatchEquations(Model->EquationBatches[BatchIdx],
+			[&GroupOfEquation, BatchGroupIdx](equation_h Equation)
+			{
+				GroupOfEquation[Equation.Handle] = BatchGroupIdx;
+				return false;
+			});
+		}
+	}
+	
+	std::vector<std::set<parameter_h>> Parameters(GroupCount);
+	std::vector<std::set<size_t>>      Dependents(GroupCount);
+	
+	auto AddDependency = [&](size_t BatchGroupIdx, equation_h DependsOn)
+	{
+		size_t DependsOnGroup = GroupOfEquation[DependsOn.Handle];
+		if(DependsOnGroup != GroupCount && DependsOnGroup != BatchGroupIdx)    //NOTE: Initial value equations don't belong to a batch group. Their dependencies are added with the equation they are an initial value for.
+			Dependents[DependsOnGroup].insert(BatchGroupIdx);
+	};
+	
+	auto AddEquation = [&](size_t BatchGroupIdx, equation_h Equation)
+	{
+		const equation_spec &Spec = Model->Equations[Equation];
+		
+		Parameters[BatchGroupIdx].insert(Spec.ParameterDependencies.begin(), Spec.ParameterDependencies.end());
+		Parameters[BatchGroupIdx].insert(Spec.CrossIndexParameterDependencies.begin(), Spec.CrossIndexParameterDependencies.end());
+		if(IsValid(Spec.InitialValue))     Parameters[BatchGroupIdx].insert(Spec.InitialValue);
+		if(IsValid(Spec.CumulationWeight)) Parameters[BatchGroupIdx].insert(Spec.CumulationWeight);
+		
+		for(equation_h Dependency : Spec.DirectResultDependencies)     AddDependency(BatchGroupIdx, Dependency);
+		for(equation_h Dependency : Spec.DirectLastResultDependencies) AddDependency(BatchGroupIdx, Dependency);
+		for(equation_h Dependency : Spec.CrossIndexResultDependencies) AddDependency(BatchGroupIdx, Dependency);
+		for(const result_dependency_registration &Dependency : Spec.IndexedResultAndLastResultDependencies)
+			AddDependency(BatchGroupIdx, Dependency.Handle);
+		
+		if(IsValid(Spec.IsComputedBy))
+		{
+			AddDependency(BatchGroupIdx, Spec.IsComputedBy);
+			size_t ComputedByGroup = GroupOfEquation[Spec.IsComputedBy.Handle];
+			if(ComputedByGroup != BatchGroupIdx) Dependents[BatchGroupIdx].insert(ComputedByGroup);
+		}
+	};
+	
+	for(size_t BatchGroupIdx = 0; BatchGroupIdx < GroupCount; ++BatchGroupIdx)
+	{
+		const equation_batch_group &BatchGroup = Model->BatchGroups[BatchGroupIdx];
+		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		{
+			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
+			
+			if(IsValid(Batch.ConditionalSwitch)) Parameters[BatchGroupIdx].insert(Batch.ConditionalSwitch);
+			if(IsValid(Batch.Solver) && IsValid(Model->Solvers[Batch.Solver].hParam)) Parameters[BatchGroupIdx].insert(Model->Solvers[Batch.Solver].hParam);
+			
+			ForAllBatchEquations(Batch,
+			[&](equation_h Equation)
+			{
+				AddEquation(BatchGroupIdx, Equation);
+				equation_h InitialValueEquation = Model->Equations[Equation].InitialValueEquation;
+				if(IsValid(InitialValueEquation)) AddEquation(BatchGroupIdx, InitialValueEquation);
+				return false;
+			});
+		}
+	}
+	
+	Model->BatchGroupParameterDependencies.resize(GroupCount);
+	Model->BatchGroupDependents.resize(GroupCount);
+	for(size_t BatchGroupIdx = 0; BatchGroupIdx < GroupCount; ++BatchGroupIdx)
+	{
+		Model->BatchGroupParameterDependencies[BatchGroupIdx].assign(Parameters[BatchGroupIdx].begin(), Parameters[BatchGroupIdx].end());
+		Model->BatchGroupDependents[BatchGroupIdx].assign(Dependents[BatchGroupIdx].begin(), Dependents[BatchGroupIdx].end());
+	}
+}
+
 static void
 EndModelDefinition(mobius_model *Model)
 {
@@ -802,6 +970,11 @@ EndModelDefinition(mobius_model *Model)
 		Model->EquationBodies[Equation.Handle](&RunState);
 		
 		Spec.IndexSetDependencies.insert(RunState.DirectIndexSetDependencies.begin(), RunState.DirectIndexSetDependencies.end());
+		Spec.BranchInputsIndexSets.insert(RunState.BranchInputsDependencies.begin(), RunState.BranchInputsDependencies.end());
+		for(equation_h Earlier : RunState.EarlierResultDependencies)
+			Model->Equations[Earlier].AccessedByEarlierResult = true;
+		Spec.UsesRandomNumbers = RunState.UsesRandomNumbers;
+		Spec.ReadsTime = RunState.ReadsTime;
 		
 		for(auto &ParameterDependency : RunState.ParameterDependencies)
 		{
@@ -820,9 +993,10 @@ EndModelDefinition(mobius_model *Model)
 			if(ParameterDependency.NumExplicitIndexes == 0)
 			{
 				//NOTE: We only store the parameters that should be hotloaded at the start of the batch in this vector: For various reasons we can't do that with parameters that are referred to by explicit indexing.
-				//TODO: We should maybe store a cross-index parameter dependency list for easy referencing later (during debugging etc.).
 				Spec.ParameterDependencies.insert(Parameter);
 			}
+			else
+				Spec.CrossIndexParameterDependencies.insert(Parameter);
 		}
 		
 		for(auto &InputDependency : RunState.InputDependencies)
@@ -1286,6 +1460,78 @@ EndModelDefinition(mobius_model *Model)
 		}
 	}
 	
+	//////////////////////// Find batch groups where index tuples can be evaluated in parallel //////////////////////////////////
+	
+	//NOTE: For each batch group we find out which of its index sets the equations of the group access other indexes of (through explicitly indexed RESULTs of equations in the same group). The index tuples of the leading index sets that are not accessed that way are independent of each other within a timestep, and can be evaluated in any order (IndependentLevels).
+	//   If the top index set is branched and is only accessed through BRANCH_INPUTS, each index only depends on its upstream indexes, and indexes that don't depend on each other (directly or indirectly) can be evaluated concurrently (BranchesCanRunInParallel).
+	//   We can't tell from the registration run how an explicit index was obtained, so we assume that an equation that iterates over BRANCH_INPUTS(IndexSet) only uses explicit indexes of IndexSet that it got from there.
+	//   Groups with conditional batches or SET_RESULT are excluded since their result can depend on state left over from the evaluation of the previous index tuple.
+	//   See RunParallelBatchGroup for how this is used.
+	for(equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		BatchGroup.IndependentLevels = 0;
+		BatchGroup.BranchesCanRunInParallel = false;
+		if(BatchGroup.IndexSets.Count == 0) continue;
+		
+		bool CanRunInParallel = true;
+		std::set<equation_h> EquationsInGroup;
+		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		{
+			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
+			if(IsValid(Batch.Conditional)) CanRunInParallel = false;
+			ForAllBatchEquations(Batch, [&EquationsInGroup](equation_h Equation)
+			{
+				EquationsInGroup.insert(Equation);
+				return false;
+			});
+		}
+		
+		for(equation_h Equation : Model->Equations)
+		{
+			const equation_spec &Spec = Model->Equations[Equation];
+			if(IsValid(Spec.IsComputedBy) && (EquationsInGroup.find(Equation) != EquationsInGroup.end() || EquationsInGroup.find(Spec.IsComputedBy) != EquationsInGroup.end()))
+				CanRunInParallel = false;
+		}
+		
+		if(!CanRunInParallel) continue;
+		
+		index_set_h TopIndexSet = BatchGroup.IndexSets[0];
+		std::vector<bool> AccessedAcrossIndexes(BatchGroup.IndexSets.Count, false);
+		bool TopOnlyAccessedThroughBranchInputs = true;
+		
+		for(equation_h Equation : EquationsInGroup)
+		{
+			const equation_spec &Spec = Model->Equations[Equation];
+			bool UsesBranchInputs = (Spec.BranchInputsIndexSets.find(TopIndexSet) != Spec.BranchInputsIndexSets.end());
+			
+			for(const result_dependency_registration &ResultDependency : Spec.IndexedResultAndLastResultDependencies)
+			{
+				if(Spec.CrossIndexResultDependencies.find(ResultDependency.Handle) == Spec.CrossIndexResultDependencies.end()) continue; //NOTE: Only a last result dependency.
+				if(EquationsInGroup.find(ResultDependency.Handle) == EquationsInGroup.end()) continue; //NOTE: Computed in an earlier batch group.
+				for(index_t Index : ResultDependency.Indexes)
+				{
+					for(size_t Level = 0; Level < BatchGroup.IndexSets.Count; ++Level)
+					{
+						if(BatchGroup.IndexSets[Level].Handle != Index.IndexSetHandle) continue;
+						AccessedAcrossIndexes[Level] = true;
+						if(Level == 0 && !UsesBranchInputs) TopOnlyAccessedThroughBranchInputs = false;
+					}
+				}
+			}
+		}
+		
+		while(BatchGroup.IndependentLevels < (s32)BatchGroup.IndexSets.Count && !AccessedAcrossIndexes[BatchGroup.IndependentLevels])
+			++BatchGroup.IndependentLevels;
+		
+		BatchGroup.BranchesCanRunInParallel = (BatchGroup.IndependentLevels == 0) && (Model->IndexSets[TopIndexSet].Type == IndexSetType_Branched) && TopOnlyAccessedThroughBranchInputs;
+	}
+	
+	//////////////////////// Find the equations that can be evaluated outside the time loop //////////////////////////////////
+	FindHoistedEquations(Model);
+	
+	//////////////////////// Find what each batch group depends on, to be used by incremental runs //////////////////////////////////
+	BuildBatchGroupDependencies(Model);
+	
 	//////////////////////// Gather info about (in-) direct equation dependencies to be used by the Jacobian estimation used by some implicit solvers //////////////////////////////////
 	BuildJacobianInfo(Model);
 	
@@ -1304,7 +1550,266 @@ EndModelDefinition(mobius_model *Model)
 typedef INNER_LOOP_BODY(mobius_inner_loop_body);
 
 static void
-ModelLoop(mobius_data_set *DataSet, model_run_state *RunState, mobius_inner_loop_body InnerLoopBody)
+BatchGroupLoop(mobius_data_set *DataSet, model_run_state *RunState, const equation_batch_group &BatchGroup, size_t BatchGroupIdx, mobius_inner_loop_body InnerLoopBody, s32 TopLevel, u32 FirstIndex, u32 EndIndex)
+{
+	//NOTE: Iterates over the index tuples of a single batch group that has at least one index set, starting at the level TopLevel (the current indexes of the index sets above it are left as they are), and only over the indexes FirstIndex <= Index < EndIndex at that level. See ModelLoop for a description of the method.
+	
+	s32 BottomLevel = (s32)BatchGroup.IndexSets.Count - 1;
+	s32 CurrentLevel = TopLevel;
+	
+	index_set_h TopIndexSet = BatchGroup.IndexSets[TopLevel];
+	RunState->CurrentIndexes[TopIndexSet.Handle] = {TopIndexSet, FirstIndex};
+	
+	while (true)
+	{
+		index_set_h CurrentIndexSet = BatchGroup.IndexSets[CurrentLevel];
+		u32 EndAtLevel = (CurrentLevel == TopLevel) ? EndIndex : DataSet->IndexCounts[CurrentIndexSet.Handle].Index;
+		
+		if(RunState->CurrentIndexes[CurrentIndexSet.Handle].Index != EndAtLevel)
+			InnerLoopBody(DataSet, RunState, BatchGroup, BatchGroupIdx, CurrentLevel);
+		
+		if(CurrentLevel == BottomLevel)
+			++RunState->CurrentIndexes[CurrentIndexSet.Handle];
+		
+		//NOTE: We need to check again because currentindex may have changed.
+		if(RunState->CurrentIndexes[CurrentIndexSet.Handle].Index == EndAtLevel)
+		{
+			//NOTE: We are at the end of this index set
+			
+			RunState->CurrentIndexes[CurrentIndexSet.Handle] = {CurrentIndexSet, 0};
+			if(CurrentLevel == TopLevel) break; //NOTE: We are finished with this batch group.
+			CurrentLevel--;
+			CurrentIndexSet = BatchGroup.IndexSets[CurrentLevel];
+			++RunState->CurrentIndexes[CurrentIndexSet.Handle];
+			continue;
+		}
+		else if(CurrentLevel != BottomLevel)
+			++CurrentLevel;
+	}
+}
+
+struct run_state_cursor
+{
+	//NOTE: Positions of the cursors of a model_run_state. The lookup positions are offsets into the Fast..Lookup arrays, Result is the offset into the results of the current timestep.
+	size_t ParameterLookup;
+	size_t InputLookup;
+	size_t ResultLookup;
+	size_t LastResultLookup;
+	size_t Result;
+	
+	void Advance(const run_state_cursor &By, size_t Times)
+	{
+		ParameterLookup  += Times*By.ParameterLookup;
+		InputLookup      += Times*By.InputLookup;
+		ResultLookup     += Times*By.ResultLookup;
+		LastResultLookup += Times*By.LastResultLookup;
+		Result           += Times*By.Result;
+	}
+};
+
+struct parallel_batch_group
+{
+	s32 SplitLevel = -1;      //NOTE: The work is divided between the workers by the index tuples of the index sets up to and including this level. -1 if the group is not evaluated in parallel.
+	
+	run_state_cursor              Start;        //NOTE: The cursors at the start of the batch group.
+	std::vector<run_state_cursor> PerIndex;     //NOTE: PerIndex[Level] is how far the cursors move during the evaluation of one index at this level (including the levels below it).
+	std::vector<run_state_cursor> AtLevel;      //NOTE: AtLevel[Level] is how far the cursors move when the values at this level are read in.
+	
+	std::vector<std::vector<u32>> WorkLevels;   //NOTE: The work items (index tuples of the split level numbered in storage order) to evaluate. All the items of one level are evaluated before the next level is started. The last item is not included, see RunParallelBatchGroup.
+	u32 LastItem;
+};
+
+struct parallel_scheduler
+{
+	bool Active = false;
+	
+	thread_pool Pool;
+	std::vector<model_run_state *> Workers;     //NOTE: One scratch run state per worker thread, so that they don't interfere with each others' Cur-buffers, current indexes and solver temporaries.
+	
+	std::vector<parallel_batch_group> Groups;   //NOTE: One per batch group.
+	
+	~parallel_scheduler()
+	{
+		Pool.Stop();
+		for(model_run_state *Worker : Workers)
+			delete Worker;
+	}
+};
+
+inline void
+SetRunStateCursors(model_run_state *Target, const model_run_state *Main, const run_state_cursor &Cursor)
+{
+	Target->AtParameterLookup  = Main->FastParameterLookup.Data  + Cursor.ParameterLookup;
+	Target->AtInputLookup      = Main->FastInputLookup.Data      + Cursor.InputLookup;
+	Target->AtResultLookup     = Main->FastResultLookup.Data     + Cursor.ResultLookup;
+	Target->AtLastResultLookup = Main->FastLastResultLookup.Data + Cursor.LastResultLookup;
+	Target->AtResult           = Main->AllCurResultsBase  + Cursor.Result;
+	Target->AtLastResult       = Main->AllLastResultsBase + Cursor.Result;
+}
+
+static void
+RunParallelBatchGroupItem(mobius_data_set *DataSet, model_run_state *Target, const model_run_state *Main, const parallel_batch_group &Group, const equation_batch_group &BatchGroup, size_t BatchGroupIdx, mobius_inner_loop_body InnerLoopBody, u32 Item)
+{
+	//NOTE: Evaluates the index tuples below one index tuple of the split level. First the values of the levels above the split level are read in (with the cursors moved to where they are for this tuple), then the rest of the evaluation is as in a serial run.
+	s32 SplitLevel = Group.SplitLevel;
+	
+	u32 Remaining = Item;
+	for(s32 Level = SplitLevel; Level >= 0; --Level)
+	{
+		index_set_h IndexSet = BatchGroup.IndexSets[Level];
+		u32 Count = DataSet->IndexCounts[IndexSet.Handle].Index;
+		Target->CurrentIndexes[IndexSet.Handle] = {IndexSet, Remaining % Count};
+		Remaining /= Count;
+	}
+	
+	run_state_cursor At = Group.Start;
+	for(s32 Level = 0; Level <= SplitLevel; ++Level)
+	{
+		index_set_h IndexSet = BatchGroup.IndexSets[Level];
+		At.Advance(Group.PerIndex[Level], Target->CurrentIndexes[IndexSet.Handle].Index);
+		SetRunStateCursors(Target, Main, At);
+		if(Level == SplitLevel) break;
+		InnerLoopBody(DataSet, Target, BatchGroup, BatchGroupIdx, Level);
+		At.Advance(Group.AtLevel[Level], 1);
+	}
+	
+	u32 Index = Target->CurrentIndexes[BatchGroup.IndexSets[SplitLevel].Handle].Index;
+	BatchGroupLoop(DataSet, Target, BatchGroup, BatchGroupIdx, InnerLoopBody, SplitLevel, Index, Index + 1);
+	
+	for(s32 Level = 0; Level < SplitLevel; ++Level)
+	{
+		index_set_h IndexSet = BatchGroup.IndexSets[Level];
+		Target->CurrentIndexes[IndexSet.Handle] = {IndexSet, 0};
+	}
+}
+
+static void
+RunParallelBatchGroup(mobius_data_set *DataSet, model_run_state *RunState, parallel_scheduler *Scheduler, const equation_batch_group &BatchGroup, size_t BatchGroupIdx, mobius_inner_loop_body InnerLoopBody)
+{
+	/*
+		Evaluates a batch group that was set up to be evaluated in parallel in SetupParallelScheduler. The work items are the index tuples of the index sets down to the split level. They are evaluated one work level at a time, and the items within a work level are distributed between the worker threads, each worker picking the next available item when it is done with the previous one.
+		
+		For groups with independent index tuples (see EndModelDefinition), there is just one work level. For groups where the branches of a branched top index set can run in parallel, the work levels are the topological levels of the branch network.
+		
+		Each worker evaluates an item starting from a copy of the Cur-buffers of the main run state. This is the same state a serial evaluation would see, since everything that is specific to an index tuple of the group is reloaded or recomputed at the start of the tuple (that is why groups with conditional batches are excluded).
+		Results of upstream branches are read directly from the result storage, and those were written during an earlier work level.
+		
+		The last item is evaluated on the main run state after all the others so that the main run state (including its cursors) is left exactly as a serial evaluation would leave it. Nothing can depend on the last item within the group, since branch inputs are always declared before the indexes they are inputs to.
+	*/
+	
+	const mobius_model *Model = DataSet->Model;
+	const parallel_batch_group &Group = Scheduler->Groups[BatchGroupIdx];
+	
+	for(const std::vector<u32> &WorkLevel : Group.WorkLevels)
+	{
+		std::atomic<size_t> NextItem(0);
+		
+		auto Job = [&](size_t WorkerIdx)
+		{
+			model_run_state *Worker = Scheduler->Workers[WorkerIdx];
+			while(true)
+			{
+				size_t ItemIdx = NextItem.fetch_add(1);
+				if(ItemIdx >= WorkLevel.size()) break;
+				
+				memcpy(Worker->CurParameters,       RunState->CurParameters,       sizeof(parameter_value)*Model->Parameters.Count());
+				memcpy(Worker->CurInputs,           RunState->CurInputs,           sizeof(double)*Model->Inputs.Count());
+				memcpy(Worker->CurInputWasProvided, RunState->CurInputWasProvided, sizeof(bool)*Model->Inputs.Count());
+				memcpy(Worker->CurResults,          RunState->CurResults,          sizeof(double)*Model->Equations.Count());
+				memcpy(Worker->LastResults,         RunState->LastResults,         sizeof(double)*Model->Equations.Count());
+				
+				Worker->Timestep           = RunState->Timestep;
+				Worker->CurrentTime        = RunState->CurrentTime;
+				Worker->AllCurResultsBase  = RunState->AllCurResultsBase;
+				Worker->AllLastResultsBase = RunState->AllLastResultsBase;
+				Worker->AllCurInputsBase   = RunState->AllCurInputsBase;
+				Worker->Plan               = RunState->Plan;
+				
+				RunParallelBatchGroupItem(DataSet, Worker, RunState, Group, BatchGroup, BatchGroupIdx, InnerLoopBody, WorkLevel[ItemIdx]);
+			}
+		};
+		
+		if(WorkLevel.size() == 1)
+			Job(0);
+		else
+			Scheduler->Pool.Run(Job);
+	}
+	
+	RunParallelBatchGroupItem(DataSet, RunState, RunState, Group, BatchGroup, BatchGroupIdx, InnerLoopBody, Group.LastItem);
+}
+
+static run_state_cursor
+BatchGroupCursorExtent(const mobius_data_set *DataSet, const equation_batch_group &BatchGroup, size_t BatchGroupIdx)
+{
+	//NOTE: How far the cursors move during the evaluation of one batch group in one timestep. This matches what FastLookupCounter counts.
+	run_state_cursor Extent = {};
+	if(BatchGroup.IndexSets.Count == 0)
+		Extent.LastResultLookup = BatchGroup.LastResultsToReadAtBase.Count;
+	
+	size_t TupleCount = 1;
+	for(size_t Level = 0; Level < BatchGroup.IndexSets.Count; ++Level)
+	{
+		TupleCount *= DataSet->IndexCounts[BatchGroup.IndexSets[Level].Handle].Index;
+		const iteration_data &IterationData = BatchGroup.IterationData[Level];
+		Extent.ParameterLookup  += TupleCount*IterationData.ParametersToRead.Count;
+		Extent.InputLookup      += TupleCount*IterationData.InputsToRead.Count;
+		Extent.ResultLookup     += TupleCount*IterationData.ResultsToRead.Count;
+		Extent.LastResultLookup += TupleCount*IterationData.LastResultsToRead.Count;
+	}
+	Extent.Result = DataSet->ResultStorageStructure.TotalCountForUnit[BatchGroupIdx];
+	return Extent;
+}
+
+struct incremental_run
+{
+	//NOTE: The batch groups that an incremental run does not reevaluate, see SetupIncrementalRun.
+	bool Active = false;                      //NOTE: If any batch groups are skipped.
+	std::vector<bool>             SkipBatchGroup;
+	std::vector<run_state_cursor> Extent;     //NOTE: Extent[G] is BatchGroupCursorExtent of batch group G.
+	u64 InputGeneration;                      //NOTE: The input generation (see InputsChanged) the results of this run are computed from.
+	
+	//NOTE: Working storage of SetupIncrementalRun. It is kept here so that repeated runs of a prepared run (see PrepareModelRun) don't allocate it again.
+	std::vector<parameter_value> ParameterDataLastRun;
+	std::vector<bool>   ParameterChanged;
+	std::vector<bool>   Reevaluate;
+	std::vector<size_t> Visit;
+};
+
+static void
+SkipBatchGroup(mobius_data_set *DataSet, model_run_state *RunState, const equation_batch_group &BatchGroup, size_t BatchGroupIdx, const run_state_cursor &Extent)
+{
+	//NOTE: Moves the cursors past a batch group that is not reevaluated in an incremental run. Its results for this timestep are already in the result storage from the last run.
+	//  Later batch groups can read the results of equations without index sets directly from CurResults and LastResults (they are not reloaded through the fast lookup), so we put the same values there that an evaluation of the group would leave, i.e. those of its last index tuple.
+	RunState->AtParameterLookup  += Extent.ParameterLookup;
+	RunState->AtInputLookup      += Extent.InputLookup;
+	RunState->AtResultLookup     += Extent.ResultLookup;
+	RunState->AtLastResultLookup += Extent.LastResultLookup;
+	RunState->AtResult           += Extent.Result;
+	RunState->AtLastResult       += Extent.Result;
+	
+	size_t TupleSize = DataSet->ResultStorageStructure.Units[BatchGroupIdx].Handles.Count; //NOTE: This works because we set the storage structure up to mirror the batch group structure.
+	const double *Cur  = RunState->AtResult - TupleSize;
+	const double *Last = RunState->AtLastResult - TupleSize;
+	//NOTE: This visits the equations in the same order as ForAllBatchEquations, but without going through a std::function, which would allocate for every batch in every timestep.
+	for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+	{
+		const equation_batch &Batch = DataSet->Model->EquationBatches[BatchIdx];
+		for(equation_h Equation : Batch.Equations)
+		{
+			RunState->CurResults[Equation.Handle]  = *Cur++;
+			RunState->LastResults[Equation.Handle] = *Last++;
+		}
+		if(!IsValid(Batch.Solver)) continue;
+		for(equation_h Equation : Batch.EquationsODE)
+		{
+			RunState->CurResults[Equation.Handle]  = *Cur++;
+			RunState->LastResults[Equation.Handle] = *Last++;
+		}
+	}
+}
+
+static void
+ModelLoop(mobius_data_set *DataSet, model_run_state *RunState, mobius_inner_loop_body InnerLoopBody, parallel_scheduler *Scheduler = nullptr, const incremental_run *Incremental = nullptr)
 {
 	/*
 		This procedure is for iterating over the equation batch groups of the model and the tuples of indexes associated to each batch group, then executing the InnerLoopBody for each iteration. One typical use is if this is the main model run, and the InnerLoopBody is the function that evaluates the equations in the batch group (called RunInnerLoop).
@@ -1339,43 +1844,16 @@ ModelLoop(mobius_data_set *DataSet, model_run_state *RunState, mobius_inner_loop
 	size_t BatchGroupIdx = 0;
 	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
 	{
+		if(Incremental && Incremental->SkipBatchGroup[BatchGroupIdx])
+			SkipBatchGroup(DataSet, RunState, BatchGroup, BatchGroupIdx, Incremental->Extent[BatchGroupIdx]);
 		// (A)  -- see note at top of procedure.
-		if(BatchGroup.IndexSets.Count == 0)
-		{
+		else if(BatchGroup.IndexSets.Count == 0)
 			InnerLoopBody(DataSet, RunState, BatchGroup, BatchGroupIdx, -1);
-			BatchGroupIdx++;
-			continue;
-		}
+		else if(Scheduler && Scheduler->Groups[BatchGroupIdx].SplitLevel >= 0)
+			RunParallelBatchGroup(DataSet, RunState, Scheduler, BatchGroup, BatchGroupIdx, InnerLoopBody);
+		else // (B) -- see note at top of procedure.
+			BatchGroupLoop(DataSet, RunState, BatchGroup, BatchGroupIdx, InnerLoopBody, 0, 0, DataSet->IndexCounts[BatchGroup.IndexSets[0].Handle].Index);
 		
-		s32 BottomLevel = (s32)BatchGroup.IndexSets.Count - 1;
-		s32 CurrentLevel = 0;
-		
-		// (B) -- see note at top of procedure.
-		while (true)
-		{
-			index_set_h CurrentIndexSet = BatchGroup.IndexSets[CurrentLevel];
-			
-			if(RunState->CurrentIndexes[CurrentIndexSet.Handle] != DataSet->IndexCounts[CurrentIndexSet.Handle])
-				InnerLoopBody(DataSet, RunState, BatchGroup, BatchGroupIdx, CurrentLevel);
-			
-			if(CurrentLevel == BottomLevel)
-				++RunState->CurrentIndexes[CurrentIndexSet.Handle];
-			
-			//NOTE: We need to check again because currentindex may have changed.
-			if(RunState->CurrentIndexes[CurrentIndexSet.Handle] == DataSet->IndexCounts[CurrentIndexSet.Handle])
-			{
-				//NOTE: We are at the end of this index set
-				
-				RunState->CurrentIndexes[CurrentIndexSet.Handle] = {CurrentIndexSet, 0};
-				if(CurrentLevel == 0) break; //NOTE: We are finished with this batch group.
-				CurrentLevel--;
-				CurrentIndexSet = BatchGroup.IndexSets[CurrentLevel];
-				++RunState->CurrentIndexes[CurrentIndexSet.Handle];
-				continue;
-			}
-			else if(CurrentLevel != BottomLevel)
-				++CurrentLevel;
-		}
 		++BatchGroupIdx;
 	}
 }
@@ -1470,40 +1948,117 @@ void ODEEquationFunction(double *x0, double *wk, model_run_state *RunState, cons
 	}
 }
 
-INNER_LOOP_BODY(RunInnerLoop)
+inline void
+RunSolverBatch(mobius_data_set *DataSet, model_run_state *RunState, const equation_batch_group &BatchGroup, const equation_batch &Batch, s32 CurrentLevel)
 {
+	//NOTE: Solve the system of ODE equations in the Batch using the Batch.Solver, and write the results to RunState->AtResult.
 	const mobius_model *Model = DataSet->Model;
 	
-	s32 BottomLevel = (s32)BatchGroup.IndexSets.Count - 1;
+	//NOTE: The results from the last timestep are the initial results for this timestep.
+	size_t EquationIdx = 0;
+	for(equation_h Equation : Batch.EquationsODE)
+	{
+		if(RunState->Plan.ResetEveryTimestep[Equation.Handle])
+			RunState->SolverTempX0[EquationIdx] = 0;
+		else
+			RunState->SolverTempX0[EquationIdx] = RunState->LastResults[Equation.Handle]; //NOTE: RunState->LastResults is filled with the correct values already, see above.
+		++EquationIdx;
+	}
+	// TODO: Do we need to clear DataSet->wk to 0? (Has not been needed in the solvers we have used so far...)
 	
-	//NOTE: Reading in to the Cur-buffers data that need to be updated at this iteration stage.
-	if(CurrentLevel >= 0)
+	const solver_spec &SolverSpec = Model->Solvers[Batch.Solver];
+	
+	// The desired solver step. (Guideline only, solver is free to correct its step during error correction).
+	double h = SolverSpec.h;
+	if(IsValid(SolverSpec.hParam)) h = RunState->CurParameters[SolverSpec.hParam.Handle].ValDouble;
+	
+	//NOTE: Solve the system using the provided solver
+	bool Success = SolverSpec.SolverFunction(h, Batch.EquationsODE.Count, RunState->SolverTempX0, RunState->SolverTempWorkStorage, &Batch, RunState, SolverSpec.RelErr, SolverSpec.AbsErr);
+	
+	if(!Success)
 	{
-		const iteration_data &IterationData = BatchGroup.IterationData[CurrentLevel];
-		for(parameter_h Parameter : IterationData.ParametersToRead)
-		{
-			RunState->CurParameters[Parameter.Handle] = *RunState->AtParameterLookup; //NOTE: Parameter values are stored directly in the lookup since they don't change with the timestep.
-			++RunState->AtParameterLookup;
-		}
-		for(input_h Input : IterationData.InputsToRead)
-		{
-			size_t Offset = *RunState->AtInputLookup;
-			++RunState->AtInputLookup;
-			RunState->CurInputs[Input.Handle] = RunState->AllCurInputsBase[Offset];
-			RunState->CurInputWasProvided[Input.Handle] = DataSet->InputTimeseriesWasProvided[Offset];
-		
-		}
-		for(equation_h Result : IterationData.ResultsToRead)
+#if !MOBIUS_IGNORE_SOLVER_ERRORS
+		ErrorPrint("Solver: \"", SolverSpec.Name, "\", Timestep: ", RunState->Timestep, "\n");
+		ErrorPrint("Indexes:\n");
+		for(index_set_h IndexSet : BatchGroup.IndexSets)
 		{
-			size_t Offset = *RunState->AtResultLookup;
-			++RunState->AtResultLookup;
-			RunState->CurResults[Result.Handle] = RunState->AllCurResultsBase[Offset];
+			const char *IndexName = DataSet->IndexNames[IndexSet.Handle][RunState->CurrentIndexes[IndexSet.Handle]];
+			ErrorPrint("\t\"", GetName(Model, IndexSet), "\": \"", IndexName, "\"\n");
 		}
-		for(equation_h Result : IterationData.LastResultsToRead)
+		ErrorPrint("State of ODE equations at solver failure:\n");
+		size_t EquationIdx = 0;
+		for(equation_h Equation : Batch.EquationsODE)
 		{
-			size_t Offset = *RunState->AtLastResultLookup;
-			++RunState->AtLastResultLookup;
-			RunState->LastResults[Result.Handle] = RunState->AllLastResultsBase[Offset];
+			ErrorPrint("\t", GetName(Model, Equation), " = ", RunState->SolverTempX0[EquationIdx], "\n");
+			++EquationIdx;
+		}
+		FatalError();
+#endif
+	}
+	
+	//NOTE: Store out the final results from this solver to the main dataset.
+	for(equation_h Equation : Batch.Equations)
+	{
+		double ResultValue = RunState->CurResults[Equation.Handle];
+#if MOBIUS_TEST_FOR_NAN
+		NaNTest(Model, RunState, ResultValue, Equation);
+#endif
+		*RunState->AtResult = ResultValue;
+		++RunState->AtResult;
+#if MOBIUS_TIMESTEP_VERBOSITY >= 3
+		for(int Lev = 0; Lev < CurrentLevel; ++Lev) WarningPrint("\t");
+		WarningPrint("\t", GetName(Model, Equation), " = ", ResultValue, "\n");
+#endif
+	}
+	EquationIdx = 0;
+	for(equation_h Equation : Batch.EquationsODE)
+	{
+		double ResultValue = RunState->SolverTempX0[EquationIdx];
+#if MOBIUS_TEST_FOR_NAN
+		NaNTest(Model, RunState, ResultValue, Equation);
+#endif
+		RunState->CurResults[Equation.Handle] = ResultValue;
+		*RunState->AtResult = ResultValue;
+		++RunState->AtResult;
+		++EquationIdx;
+#if MOBIUS_TIMESTEP_VERBOSITY >= 3
+		for(int Lev = 0; Lev < CurrentLevel; ++Lev) WarningPrint("\t");
+		WarningPrint("\t", GetName(Model, Equation), " = ", ResultValue, "\n");
+#endif
+	}
+}
+
+inline void
+ReadIterationData(mobius_data_set *DataSet, model_run_state *RunState, const equation_batch_group &BatchGroup, s32 CurrentLevel)
+{
+	//NOTE: Reading in to the Cur-buffers data that need to be updated at this iteration stage.
+	if(CurrentLevel >= 0)
+	{
+		const iteration_data &IterationData = BatchGroup.IterationData[CurrentLevel];
+		for(parameter_h Parameter : IterationData.ParametersToRead)
+		{
+			RunState->CurParameters[Parameter.Handle] = *RunState->AtParameterLookup; //NOTE: Parameter values are stored directly in the lookup since they don't change with the timestep.
+			++RunState->AtParameterLookup;
+		}
+		for(input_h Input : IterationData.InputsToRead)
+		{
+			size_t Offset = *RunState->AtInputLookup;
+			++RunState->AtInputLookup;
+			RunState->CurInputs[Input.Handle] = RunState->AllCurInputsBase[Offset];
+			RunState->CurInputWasProvided[Input.Handle] = DataSet->InputTimeseriesWasProvided[Offset];
+		
+		}
+		for(equation_h Result : IterationData.ResultsToRead)
+		{
+			size_t Offset = *RunState->AtResultLookup;
+			++RunState->AtResultLookup;
+			RunState->CurResults[Result.Handle] = RunState->AllCurResultsBase[Offset];
+		}
+		for(equation_h Result : IterationData.LastResultsToRead)
+		{
+			size_t Offset = *RunState->AtLastResultLookup;
+			++RunState->AtLastResultLookup;
+			RunState->LastResults[Result.Handle] = RunState->AllLastResultsBase[Offset];
 		}
 	}
 	else
@@ -1515,6 +2070,42 @@ INNER_LOOP_BODY(RunInnerLoop)
 			RunState->LastResults[Result.Handle] = RunState->AllLastResultsBase[Offset];
 		}
 	}
+}
+
+inline void
+StoreEquationResult(const mobius_model *Model, model_run_state *RunState, equation_h Equation, double ResultValue, s32 CurrentLevel)
+{
+	RunState->CurResults[Equation.Handle] = ResultValue;
+#if MOBIUS_TEST_FOR_NAN
+	NaNTest(Model, RunState, ResultValue, Equation);
+#endif
+#if MOBIUS_TIMESTEP_VERBOSITY >= 3
+	for(int Lev = 0; Lev < CurrentLevel; ++Lev) WarningPrint("\t");
+	WarningPrint("\t", GetName(Model, Equation), " = ", ResultValue, "\n");
+#endif
+	++RunState->AtResult;
+}
+
+inline bool
+SkipConditionalBatch(model_run_state *RunState, const equation_batch &Batch)
+{
+	//Check if there is a conditional execution of this batch and if it should be executed. If it shouldn't, skip it.
+	if(IsValid(Batch.ConditionalSwitch) && Batch.ConditionalValue != RunState->CurParameters[Batch.ConditionalSwitch.Handle])
+	{
+		RunState->AtResult += Batch.Equations.Count;
+		RunState->AtResult += Batch.EquationsODE.Count;
+		return true;
+	}
+	return false;
+}
+
+INNER_LOOP_BODY(RunInnerLoop)
+{
+	const mobius_model *Model = DataSet->Model;
+	
+	s32 BottomLevel = (s32)BatchGroup.IndexSets.Count - 1;
+	
+	ReadIterationData(DataSet, RunState, BatchGroup, CurrentLevel);
 
 #if MOBIUS_TIMESTEP_VERBOSITY >= 2
 	if(CurrentLevel >= 0)
@@ -1528,136 +2119,49 @@ INNER_LOOP_BODY(RunInnerLoop)
 	
 	if(CurrentLevel == BottomLevel)
 	{
-		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		//NOTE: Read in the last results of all the equations in the batch group. They are stored in the same order as the storage unit lists them since the storage structure mirrors the batch group structure.
+		const array<equation_h> &Equations = DataSet->ResultStorageStructure.Units[BatchGroupIdx].Handles;
+		for(equation_h Equation : Equations)
 		{
-			//NOTE: Write LastResult values into the RunState for fast lookup.
-			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
-			
-			//TODO: We should maybe watch this and see if it causes performance problems and in that case expand the for loops.
-			ForAllBatchEquations(Batch,
-			[RunState](equation_h Equation)
-			{
-				double LastResultValue = *RunState->AtLastResult;
-				++RunState->AtLastResult;
-				RunState->LastResults[Equation.Handle] = LastResultValue;
-				return false;
-			});
+			RunState->LastResults[Equation.Handle] = *RunState->AtLastResult;
+			++RunState->AtLastResult;
 		}
 		
-		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		const run_plan_instruction *Instruction = RunState->Plan.Instructions.Data + RunState->Plan.GroupStart[BatchGroupIdx];
+		const run_plan_instruction *End         = RunState->Plan.Instructions.Data + RunState->Plan.GroupStart[BatchGroupIdx + 1];
+		for(; Instruction != End; ++Instruction)
 		{
-			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
-			
-			//Check if there is a conditional execution of this batch and if it should be executed. If it shouldn't, skip it.
-			if(IsValid(Batch.ConditionalSwitch) && Batch.ConditionalValue != RunState->CurParameters[Batch.ConditionalSwitch.Handle])
-			{
-				RunState->AtResult += Batch.Equations.Count;
-				RunState->AtResult += Batch.EquationsODE.Count;
-				continue;
-			}
-			
-			if(!IsValid(Batch.Solver))
-			{
-				//NOTE: Basic discrete timestep evaluation of equations.
-				for(equation_h Equation : Batch.Equations) 
-				{
-					double ResultValue;
-					//TODO: This is very inefficient, but we can't remove them from the equation batches since that would screw up the storage structure... Is there a better way to do this?
-					const equation_spec &Spec = Model->Equations[Equation];
-					if(!IsValid(Spec.IsComputedBy))
-					{
-						ResultValue = CallEquation(Model, RunState, Equation);
-						*RunState->AtResult = ResultValue;
-					}
-					else
-						ResultValue = *RunState->AtResult;
-					
-					RunState->CurResults[Equation.Handle] = ResultValue;
-#if MOBIUS_TEST_FOR_NAN
-					NaNTest(Model, RunState, ResultValue, Equation);
-#endif
-#if MOBIUS_TIMESTEP_VERBOSITY >= 3
-					for(int Lev = 0; Lev < CurrentLevel; ++Lev) WarningPrint("\t");
-					WarningPrint("\t", GetName(Model, Equation), " = ", ResultValue, "\n");
-#endif
-					++RunState->AtResult;
-				}
-			}
-			else // IsValid(Batch.Solver)  -- Solve the system of ODE equations using the given Solver.
+			equation_h Equation = {(entity_handle)Instruction->Handle};
+			switch(Instruction->Op)
 			{
-				//NOTE: The results from the last timestep are the initial results for this timestep.
-				size_t EquationIdx = 0;
-				for(equation_h Equation : Batch.EquationsODE)
+				case RunPlanOp_Equation:
 				{
-					//NOTE: Reading the Equations.Specs vector here may be slightly inefficient since each element of the vector is large. We could copy out an array of the ResetEveryTimestep bools instead beforehand.
-					if(Model->Equations[Equation].ResetEveryTimestep)
-						RunState->SolverTempX0[EquationIdx] = 0;
-					else
-						RunState->SolverTempX0[EquationIdx] = RunState->LastResults[Equation.Handle]; //NOTE: RunState->LastResults is filled with the correct values already, see above.
-					++EquationIdx;
-				}
-				// TODO: Do we need to clear DataSet->wk to 0? (Has not been needed in the solvers we have used so far...)
-				
-				const solver_spec &SolverSpec = Model->Solvers[Batch.Solver];
-				
-				// The desired solver step. (Guideline only, solver is free to correct its step during error correction).
-				double h = SolverSpec.h;
-				if(IsValid(SolverSpec.hParam)) h = RunState->CurParameters[SolverSpec.hParam.Handle].ValDouble;
+					double ResultValue = CallEquation(Model, RunState, Equation);
+					*RunState->AtResult = ResultValue;
+					StoreEquationResult(Model, RunState, Equation, ResultValue, CurrentLevel);
+				} break;
 				
-				//NOTE: Solve the system using the provided solver
-				bool Success = SolverSpec.SolverFunction(h, Batch.EquationsODE.Count, RunState->SolverTempX0, RunState->SolverTempWorkStorage, &Batch, RunState, SolverSpec.RelErr, SolverSpec.AbsErr);
+				case RunPlanOp_ComputedResult:
+				{
+					StoreEquationResult(Model, RunState, Equation, *RunState->AtResult, CurrentLevel);
+				} break;
 				
-				if(!Success)
+				case RunPlanOp_SkipResults:
 				{
-#if !MOBIUS_IGNORE_SOLVER_ERRORS
-					ErrorPrint("Solver: \"", SolverSpec.Name, "\", Timestep: ", RunState->Timestep, "\n");
-					ErrorPrint("Indexes:\n");
-					for(index_set_h IndexSet : BatchGroup.IndexSets)
-					{
-						const char *IndexName = DataSet->IndexNames[IndexSet.Handle][RunState->CurrentIndexes[IndexSet.Handle]];
-						ErrorPrint("\t\"", GetName(Model, IndexSet), "\": \"", IndexName, "\"\n");
-					}
-					ErrorPrint("State of ODE equations at solver failure:\n");
-					size_t EquationIdx = 0;
-					for(equation_h Equation : Batch.EquationsODE)
-					{
-						ErrorPrint("\t", GetName(Model, Equation), " = ", RunState->SolverTempX0[EquationIdx], "\n");
-						++EquationIdx;
-					}
-					FatalError();
-#endif
-				}
+					RunState->AtResult += Instruction->Count;
+				} break;
 				
-				//NOTE: Store out the final results from this solver to the main dataset.
-				for(equation_h Equation : Batch.Equations)
+				case RunPlanOp_ConditionalBatch:
 				{
-					double ResultValue = RunState->CurResults[Equation.Handle];
-#if MOBIUS_TEST_FOR_NAN
-					NaNTest(Model, RunState, ResultValue, Equation);
-#endif
-					*RunState->AtResult = ResultValue;
-					++RunState->AtResult;
-#if MOBIUS_TIMESTEP_VERBOSITY >= 3
-					for(int Lev = 0; Lev < CurrentLevel; ++Lev) WarningPrint("\t");
-					WarningPrint("\t", GetName(Model, Equation), " = ", ResultValue, "\n");
-#endif
-				}
-				EquationIdx = 0;
-				for(equation_h Equation : Batch.EquationsODE)
+					const equation_batch &Batch = Model->EquationBatches[Instruction->Handle];
+					if(SkipConditionalBatch(RunState, Batch))
+						Instruction += Instruction->Count;
+				} break;
+				
+				case RunPlanOp_SolverBatch:
 				{
-					double ResultValue = RunState->SolverTempX0[EquationIdx];
-#if MOBIUS_TEST_FOR_NAN
-					NaNTest(Model, RunState, ResultValue, Equation);
-#endif
-					RunState->CurResults[Equation.Handle] = ResultValue;
-					*RunState->AtResult = ResultValue;
-					++RunState->AtResult;
-					++EquationIdx;
-#if MOBIUS_TIMESTEP_VERBOSITY >= 3
-					for(int Lev = 0; Lev < CurrentLevel; ++Lev) WarningPrint("\t");
-					WarningPrint("\t", GetName(Model, Equation), " = ", ResultValue, "\n");
-#endif
-				}
+					RunSolverBatch(DataSet, RunState, BatchGroup, Model->EquationBatches[Instruction->Handle], CurrentLevel);
+				} break;
 			}
 		}
 	}
@@ -1685,6 +2189,7 @@ INNER_LOOP_BODY(FastLookupSetupInnerLoop)
 			//NOTE: Parameters are special here in that we can just store the value in the fast lookup, instead of the offset. This is because they don't change with the timestep.
 			size_t Offset = OffsetForHandle(DataSet->ParameterStorageStructure, RunState->CurrentIndexes, DataSet->IndexCounts, Parameter);
 			parameter_value Value = DataSet->ParameterData[Offset];
+			RunState->FastParameterOffsets[RunState->FastParameterLookup.Count] = Offset;
 			RunState->FastParameterLookup[RunState->FastParameterLookup.Count++] = Value;
 		}
 		
@@ -1733,7 +2238,10 @@ SetupInitialValue(mobius_data_set *DataSet, model_run_state *RunState, equation_
 	else if(Spec.HasExplicitInitialValue)
 		Initial = Spec.ExplicitInitialValue;
 	else if(IsValid(Spec.InitialValueEquation))
-		Initial = Model->EquationBodies[Spec.InitialValueEquation.Handle](RunState);
+	{
+		const mobius_equation_entry &Entry = Model->EquationTable[Spec.InitialValueEquation.Handle];
+		Initial = Entry.Function(Entry.Closure, RunState);
+	}
 	else
 	{
 		//NOTE: Equations without any type of initial value act as their own initial value equation
@@ -1744,7 +2252,10 @@ SetupInitialValue(mobius_data_set *DataSet, model_run_state *RunState, equation_
 			Initial = 0.0;
 		}
 		else
-			Initial = Model->EquationBodies[Equation.Handle](RunState);
+		{
+			const mobius_equation_entry &Entry = Model->EquationTable[Equation.Handle];
+			Initial = Entry.Function(Entry.Closure, RunState);
+		}
 	}
 	
 	size_t ResultStorageLocation = DataSet->ResultStorageStructure.LocationOfHandleInUnit[Equation.Handle];
@@ -1839,7 +2350,8 @@ ProcessComputedParameters(mobius_data_set *DataSet, model_run_state *RunState)
 					}
 					
 					size_t Offset = OffsetForHandle(DataSet->ParameterStorageStructure, Indexes, IndexesCount, DataSet->IndexCounts, Parameter);
-					double ValD = DataSet->Model->EquationBodies[Equation.Handle](RunState);
+					const mobius_equation_entry &Entry = DataSet->Model->EquationTable[Equation.Handle];
+					double ValD = Entry.Function(Entry.Closure, RunState);
 					parameter_value Value;
 					if(Spec.Type == ParameterType_Double)
 						Value.ValDouble = ValD;
@@ -1855,109 +2367,811 @@ ProcessComputedParameters(mobius_data_set *DataSet, model_run_state *RunState)
 static void
 PrintEquationProfiles(mobius_data_set *DataSet, model_run_state *RunState);
 
-static bool
-RunModel(mobius_data_set *DataSet, s64 MillisecondTimeout=-1)
+static void
+AllocateSolverTempStorage(model_run_state *RunState)
 {
-#if MOBIUS_PRINT_TIMING_INFO
-	timer SetupTimer = BeginTimer();
-#endif
-
-	const mobius_model *Model = DataSet->Model;
-	
-	// NOTE: in case there is an error later, these have to have been cleared.
-	DataSet->HasBeenRun = false;
-	DataSet->TimestepsLastRun = 0;
-	
-	//NOTE: Check that all the index sets have at least one index.
-	for(index_set_h IndexSet : Model->IndexSets)
-	{
-		if(DataSet->IndexCounts[IndexSet.Handle] == 0)
-			FatalError("ERROR: The index set \"", GetName(Model, IndexSet), "\" does not contain any indexes.\n");
-	}
-	
-	//NOTE: Allocate parameter storage in case it was not allocated during setup.
-	if(!DataSet->ParameterData)
+	//NOTE: Temporary storage for use by solvers:
+	const mobius_model *Model = RunState->Model;
+	size_t MaxODECount = 0;
+	size_t MaxNonODECount = 0;
+	size_t SolverTempWorkSpace = 0;
+	for(const equation_batch_group& BatchGroup : Model->BatchGroups)
 	{
-		AllocateParameterStorage(DataSet);
-		WarningPrint("WARNING: No parameter values were specified, using default parameter values only.\n");
+		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		{
+			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
+			if(IsValid(Batch.Solver))
+			{
+				size_t ODECount = Batch.EquationsODE.Count;
+				MaxODECount = Max(MaxODECount, ODECount);
+				MaxNonODECount = Max(MaxNonODECount, Batch.Equations.Count);
+				const solver_spec &SolverSpec = Model->Solvers[Batch.Solver];
+				SolverTempWorkSpace = Max(SolverTempWorkSpace, SolverSpec.SpaceRequirement(ODECount));
+			}
+		}
 	}
+
+	size_t JacobiTempWorkSpace = MaxODECount + MaxNonODECount;
 	
+	RunState->SolverTempX0          = RunState->BucketMemory.Allocate<double>(MaxODECount);
+	RunState->SolverTempWorkStorage = RunState->BucketMemory.Allocate<double>(SolverTempWorkSpace);
+	RunState->JacobianTempStorage   = RunState->BucketMemory.Allocate<double>(JacobiTempWorkSpace);
+}
+
+static void
+AllocateRunPlan(model_run_state *RunState)
+{
+	//NOTE: Allocates room for the largest run plan the model can have, which is when no conditional batch can be decided ahead of the run (see BuildRunPlan).
+	const mobius_model *Model = RunState->Model;
+	run_plan &Plan = RunState->Plan;
 	
-	u64 Timesteps           = GetTimesteps(DataSet); //NOTE: Reads either the "Timesteps" or the "End date" parameter and computes accordingly.
-	datetime ModelStartTime = GetStartDate(DataSet); //NOTE: This reads the "Start date" parameter.
-	
-	//TODO: Should we put a restriction on ModelStartTime so that it is "round" with respect to the Model->TimestepSize ?
+	size_t MaxInstructions = 0;
+	for(const equation_batch &Batch : Model->EquationBatches)
+		MaxInstructions += 1 + (IsValid(Batch.Solver) ? 1 : Batch.Equations.Count);
 	
-#if MOBIUS_PRINT_TIMING_INFO
-	WarningPrint("Running model ", Model->Name);
-	if(Model->Modules.Count() > 1)
-	{
-		WarningPrint(" with modules (");
-		for(module_h Module : Model->Modules)
-		{
-			const module_spec &ModuleSpec = Model->Modules[Module];
-			WarningPrint(ModuleSpec.Name, " V", ModuleSpec.Version);
-			if(Module.Handle != Model->Modules.Count()-1) WarningPrint(", ");
-		}
-		WarningPrint(")");
-	}
-	WarningPrint(" for ", Timesteps, " timesteps starting at ", ModelStartTime.ToString(), "\n");
-#endif
+	Plan.Instructions.Allocate(&RunState->BucketMemory, MaxInstructions);
+	Plan.GroupStart.Allocate(&RunState->BucketMemory, Model->BatchGroups.Count + 1);
+	Plan.ResetEveryTimestep.Allocate(&RunState->BucketMemory, Model->Equations.Count());
 	
-	//NOTE: Allocate input storage in case it was not allocated during setup.
-	if(!DataSet->InputData)
-	{
-		AllocateInputStorage(DataSet, Timesteps);
-		WarningPrint("WARNING: No input values were specified, using input values of 0 only.\n");
-	}
+	for(equation_h Equation : Model->Equations)
+		Plan.ResetEveryTimestep[Equation.Handle] = Model->Equations[Equation].ResetEveryTimestep;
 	
-	datetime InputStartDate = GetInputStartDate(DataSet);
-	s64 InputDataStartOffsetTimesteps = FindTimestep(InputStartDate, ModelStartTime, Model->TimestepSize);
+	size_t MaxHoistedOffsets = 0;
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+		MaxHoistedOffsets = Max(MaxHoistedOffsets, BatchGroup.Hoisted.Equations.Count + BatchGroup.Hoisted.Inputs.Count + BatchGroup.Hoisted.Results.Count);
+	Plan.HoistedOffsets.Allocate(&RunState->BucketMemory, MaxHoistedOffsets);
 	
+	Plan.IsConstant.Allocate(&RunState->BucketMemory, Model->Equations.Count());
 	
-	//NOTE: Do some sanity checks of the input and model start times that limit potential errors.
-
-	s64 TimeOffset;
-	if(Model->TimestepSize.Unit == Timestep_Second)
+	const storage_structure<equation_h> &Storage = RunState->DataSet->ResultStorageStructure;
+	size_t ConstantCount = 0;
+	for(size_t BatchGroupIdx = 0; BatchGroupIdx < Model->BatchGroups.Count; ++BatchGroupIdx)
 	{
-		TimeOffset = ModelStartTime.SecondsSinceEpoch - InputStartDate.SecondsSinceEpoch;
+		size_t TupleCount = Storage.TotalCountForUnit[BatchGroupIdx] / Storage.Units[BatchGroupIdx].Handles.Count;
+		ConstantCount += Model->BatchGroups[BatchGroupIdx].Hoisted.Constant.Count * TupleCount;
 	}
-	else
-	{
-		assert(Model->TimestepSize.Unit == Timestep_Month);
-		
-		s32 IYear, IMonth, IDay;
-		InputStartDate.YearMonthDay(&IYear, &IMonth, &IDay);
-		
-		s32 MYear, MMonth, MDay;
-		ModelStartTime.YearMonthDay(&MYear, &MMonth, &MDay);
-		
-		if(IDay != 1 || InputStartDate.SecondsSinceEpoch % 86400 != 0)
-			FatalError("ERROR: For models with timestep resolution measured in months or years, input data start dates have to be on the form yyyy-mm-01 or yyyy-mm-01 00:00:00 . In the current setup, the input start date was set to ", InputStartDate.ToString(), " .\n");
+	Plan.ConstantOffsets.Allocate(&RunState->BucketMemory, ConstantCount);
+	Plan.ConstantValues.Allocate(&RunState->BucketMemory, ConstantCount);
+}
+
+static void
+BuildRunPlan(mobius_data_set *DataSet, model_run_state *RunState)
+{
+	/*
+		Flattens the equation batches of the model into the instruction stream that RunInnerLoop executes (see run_plan_op). Decisions that can't change during the run are made here once instead of for every index tuple in every timestep:
 		
-		if(MDay != 1 || ModelStartTime.SecondsSinceEpoch % 86400 != 0)
-			FatalError("ERROR: For models with timestep resolution measured in months or years, the \"Start date\" has to be on the form yyyy-mm-01 or yyyy-mm-01 00:00:00 . In the current setup, the start date was set to ", ModelStartTime.ToString(), " .\n");
+		- A conditional batch whose switch parameter has the same value in every index tuple is either evaluated without testing the switch, or if it is switched off, replaced by a skip over its results. Only if the switch varies between index tuples is it tested during the run.
+		- Equations that are computed by another equation (IsComputedBy) are not evaluated, only their stored value is read in. The same goes for constant equations (see EvaluateConstantEquations), and for hoisted equations (see FindHoistedEquations) if Plan.HoistEquations is set.
 		
-		TimeOffset = (MYear-IYear)*12 + MMonth-IMonth;
-	}
-	
-	if(TimeOffset % Model->TimestepSize.Magnitude != 0)
-		FatalError("ERROR: The model run \"Start date\" was not set to be a whole number of timesteps after the input start date.\n");
-	
-	if(ModelStartTime.SecondsSinceEpoch < InputStartDate.SecondsSinceEpoch)
-		FatalError("ERROR: The input data starts at a later date than the model run.\n");
-	
-	if(((s64)DataSet->InputDataTimesteps - InputDataStartOffsetTimesteps) < (s64)Timesteps)
-		FatalError("ERROR: The input data provided has fewer timesteps (after the model run start date) than the number of timesteps the model is running for.\n");
-	
-	AllocateResultStorage(DataSet, Timesteps);
+		The plan depends on the parameter values, so it is rebuilt at the start of every run. It does not allocate anything, the room for it is allocated in BuildFastLookup.
+	*/
 	
+	const mobius_model *Model = DataSet->Model;
+	const storage_structure<parameter_h> &Parameters = DataSet->ParameterStorageStructure;
+	run_plan &Plan = RunState->Plan;
 	
-	for(const mobius_preprocessing_step &PreprocessingStep : Model->PreprocessingSteps)
-		PreprocessingStep(DataSet);
+	size_t At = 0;
+	auto Push = [&Plan, &At](run_plan_op Op, u32 Handle, u32 Count)
+	{
+		Plan.Instructions[At++] = {Op, Handle, Count};
+	};
 	
-	// Check if solver step size makes sense.
-	for(solver_h Solver: Model->Solvers)
+	size_t BatchGroupIdx = 0;
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		Plan.GroupStart[BatchGroupIdx] = At;
+		
+		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		{
+			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
+			
+			size_t ConditionalAt = At;
+			bool TestSwitch = false;
+			if(IsValid(Batch.ConditionalSwitch))
+			{
+				parameter_h Switch = Batch.ConditionalSwitch;
+				size_t Unit   = Parameters.UnitForHandle[Switch.Handle];
+				size_t Stride = Parameters.Units[Unit].Handles.Count;
+				size_t End    = Parameters.OffsetForUnit[Unit] + Parameters.TotalCountForUnit[Unit];
+				bool AnyOn  = false;
+				bool AnyOff = false;
+				for(size_t Offset = Parameters.OffsetForUnit[Unit] + Parameters.LocationOfHandleInUnit[Switch.Handle]; Offset < End; Offset += Stride)
+				{
+					if(DataSet->ParameterData[Offset] == Batch.ConditionalValue) AnyOn  = true;
+					else                                                         AnyOff = true;
+				}
+				
+				if(!AnyOn)
+				{
+					u32 ResultCount = (u32)(Batch.Equations.Count + Batch.EquationsODE.Count);
+					run_plan_instruction *Last = At > Plan.GroupStart[BatchGroupIdx] ? &Plan.Instructions[At - 1] : nullptr;
+					if(Last && Last->Op == RunPlanOp_SkipResults)
+						Last->Count += ResultCount;
+					else
+						Push(RunPlanOp_SkipResults, 0, ResultCount);
+					continue;
+				}
+				TestSwitch = AnyOff;
+				if(TestSwitch)
+					Push(RunPlanOp_ConditionalBatch, (u32)BatchIdx, 0);
+			}
+			
+			if(IsValid(Batch.Solver))
+				Push(RunPlanOp_SolverBatch, (u32)BatchIdx, 0);
+			else
+			{
+				for(equation_h Equation : Batch.Equations)
+				{
+					const equation_spec &Spec = Model->Equations[Equation];
+					bool Computed = IsValid(Spec.IsComputedBy) || Plan.IsConstant[Equation.Handle] || (Plan.HoistEquations && Spec.IsHoisted);
+					Push(Computed ? RunPlanOp_ComputedResult : RunPlanOp_Equation, Equation.Handle, 0);
+				}
+			}
+			
+			if(TestSwitch)
+				Plan.Instructions[ConditionalAt].Count = (u32)(At - ConditionalAt - 1);
+		}
+		
+		++BatchGroupIdx;
+	}
+	Plan.GroupStart[BatchGroupIdx] = At;
+}
+
+static void
+EvaluateConstantEquations(mobius_data_set *DataSet, model_run_state *RunState, const incremental_run *Incremental)
+{
+	/*
+		Evaluates the constant equations (see FindHoistedEquations) once for every index tuple, and writes their values to every timestep of the result storage. The main run loop and RunHoistedEquations then only read the stored values of these (see BuildRunPlan).
+		
+		The values are first put in the constant block of the run plan (Plan.ConstantOffsets and Plan.ConstantValues), batch group by batch group and index tuple by index tuple, and are then copied out to each timestep. The slots of these results are kept in every timestep of the result storage so that LAST_RESULT, explicitly indexed RESULT and GetResultSeries work on them as on any other result.
+		
+		An equation may only read the time in a branch that was not taken during the registration run. If an equation reads the time here, it is not treated as constant in this run after all, and neither are the constant equations that read its result. These are then evaluated as ordinary hoisted equations.
+		
+		This requires that the results of all the timesteps are stored (DataSet->ResultWindow == 0), since otherwise the timesteps are cleared when they are reused (see EndTimestep). If Plan.HoistEquations is not set, no equations are treated as constant. The caller has to set RunState->CurrentTime to the start of the run.
+	*/
+	
+	const mobius_model *Model = DataSet->Model;
+	run_plan &Plan = RunState->Plan;
+	
+	for(equation_h Equation : Model->Equations)
+		Plan.IsConstant[Equation.Handle] = Plan.HoistEquations && Model->Equations[Equation].IsConstant;
+	if(!Plan.HoistEquations) return;
+	
+	storage_structure<equation_h> &Storage = DataSet->ResultStorageStructure;
+	size_t ResultCount    = Storage.TotalCount;
+	double *FirstTimestep = DataSet->ResultData + ResultCount;
+	u64    Timesteps      = DataSet->TimestepsLastRun;
+	
+	RunState->Timestep = 0;
+	
+	size_t At = 0;
+	size_t BatchGroupIdx = 0;
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		const hoisted_equations &Hoisted = BatchGroup.Hoisted;
+		if(Hoisted.Constant.Count == 0)
+		{
+			++BatchGroupIdx;
+			continue;
+		}
+		
+		size_t GroupStart = At;
+		size_t TupleCount = Storage.TotalCountForUnit[BatchGroupIdx] / Storage.Units[BatchGroupIdx].Handles.Count;
+		
+		for(index_set_h IndexSet : BatchGroup.IndexSets)
+			RunState->CurrentIndexes[IndexSet.Handle] = {IndexSet, 0};
+		
+		for(size_t Tuple = 0; Tuple < TupleCount; ++Tuple)
+		{
+			for(parameter_h Parameter : Hoisted.Parameters)
+			{
+				size_t Offset = OffsetForHandle(DataSet->ParameterStorageStructure, RunState->CurrentIndexes, DataSet->IndexCounts, Parameter);
+				RunState->CurParameters[Parameter.Handle] = DataSet->ParameterData[Offset];
+			}
+			for(equation_h Result : Hoisted.Results)
+				RunState->CurResults[Result.Handle] = FirstTimestep[OffsetForHandle(Storage, RunState->CurrentIndexes, DataSet->IndexCounts, Result)];
+			
+			for(equation_h Equation : Hoisted.Constant)
+			{
+				double ResultValue = 0.0;
+				if(Plan.IsConstant[Equation.Handle])
+				{
+					RunState->ReadsTime = false;
+					ResultValue = CallEquation(Model, RunState, Equation);
+					if(RunState->ReadsTime) Plan.IsConstant[Equation.Handle] = false;
+#if MOBIUS_TEST_FOR_NAN
+					else NaNTest(Model, RunState, ResultValue, Equation);
+#endif
+				}
+				RunState->CurResults[Equation.Handle] = ResultValue;
+				Plan.ConstantOffsets[At] = OffsetForHandle(Storage, RunState->CurrentIndexes, DataSet->IndexCounts, Equation);
+				Plan.ConstantValues[At]  = ResultValue;
+				++At;
+			}
+			
+			//NOTE: Advance to the next index tuple, the last index set counting fastest.
+			for(s32 Level = (s32)BatchGroup.IndexSets.Count - 1; Level >= 0; --Level)
+			{
+				index_set_h IndexSet = BatchGroup.IndexSets[Level];
+				index_t &Index = RunState->CurrentIndexes[IndexSet.Handle];
+				++Index;
+				if(Index < DataSet->IndexCounts[IndexSet.Handle] || Level == 0) break;
+				Index = {IndexSet, 0};
+			}
+		}
+		
+		//NOTE: An equation that read the result of one that turned out to not be constant in an index tuple that came later is not constant either. The dependencies of an equation come before it in Hoisted.Constant, so one pass is enough.
+		for(equation_h Equation : Hoisted.Constant)
+		{
+			for(equation_h Dependency : Model->Equations[Equation].DirectResultDependencies)
+				if(!Plan.IsConstant[Dependency.Handle]) Plan.IsConstant[Equation.Handle] = false;
+		}
+		
+		//NOTE: If the batch group is skipped by an incremental run, the stored results are already the same as these. The values of the equations that turned out to not be constant are written too, but they are overwritten when these are evaluated later.
+		if(!Incremental || !Incremental->SkipBatchGroup[BatchGroupIdx])
+		{
+			for(u64 Timestep = 0; Timestep < Timesteps; ++Timestep)
+			{
+				double *Results = FirstTimestep + Timestep*ResultCount;
+				for(size_t Idx = GroupStart; Idx < At; ++Idx)
+					Results[Plan.ConstantOffsets[Idx]] = Plan.ConstantValues[Idx];
+			}
+		}
+		
+		++BatchGroupIdx;
+	}
+	
+	for(index_set_h IndexSet : Model->IndexSets)
+		RunState->CurrentIndexes[IndexSet.Handle] = {IndexSet, 0};
+}
+
+static void
+RunHoistedEquations(mobius_data_set *DataSet, model_run_state *RunState, const incremental_run *Incremental)
+{
+	/*
+		Evaluates the hoisted equations (see FindHoistedEquations) for every timestep of the run and writes their results to the result storage, before the main run loop. The main run loop then only reads the stored values of these (see BuildRunPlan).
+		
+		The loop order is turned around compared to the main run loop: For each batch group, we iterate over the index tuples, and for each tuple we go through all the timesteps. This way the parameters and the offsets of the inputs and results are looked up once per index tuple instead of once per timestep, and the same few equations are evaluated many times in a row.
+		
+		The constant equations among the hoisted ones have already been evaluated by EvaluateConstantEquations, so their values are only read in once per index tuple.
+		
+		This requires that the results of all the timesteps are stored (DataSet->ResultWindow == 0). The RunState is left as SetupModelRun left it, except for the Cur-buffers, which the main run loop reloads anyway.
+	*/
+	
+	const mobius_model *Model = DataSet->Model;
+	
+	u64    Timesteps   = DataSet->TimestepsLastRun;
+	size_t ResultCount = DataSet->ResultStorageStructure.TotalCount;
+	size_t InputCount  = DataSet->InputStorageStructure.TotalCount;
+	double *ResultBase = RunState->AllCurResultsBase;
+	double *InputBase  = RunState->AllCurInputsBase;
+	const float *SingleInputBase = DataSet->SingleInputData ? DataSet->SingleInputData + RunState->InputTimestep*InputCount : nullptr; //NOTE: AllCurInputsBase only holds one converted timestep if the inputs are stored in single precision, see LoadInputTimestep.
+	expanded_datetime StartTime = RunState->CurrentTime;
+	
+	size_t BatchGroupIdx = 0;
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		const hoisted_equations &Hoisted = BatchGroup.Hoisted;
+		bool AllConstant = true;
+		for(equation_h Equation : Hoisted.Equations)
+			if(!RunState->Plan.IsConstant[Equation.Handle]) AllConstant = false;
+		if(AllConstant || (Incremental && Incremental->SkipBatchGroup[BatchGroupIdx]))
+		{
+			++BatchGroupIdx;
+			continue;
+		}
+		
+		size_t *ResultOffsets     = RunState->Plan.HoistedOffsets.Data;
+		size_t *InputOffsets      = ResultOffsets + Hoisted.Equations.Count;
+		size_t *ReadResultOffsets = InputOffsets + Hoisted.Inputs.Count;
+		
+		storage_structure<equation_h> &Storage = DataSet->ResultStorageStructure;
+		size_t TupleCount = Storage.TotalCountForUnit[BatchGroupIdx] / Storage.Units[BatchGroupIdx].Handles.Count; //NOTE: This works because we set the storage structure up to mirror the batch group structure.
+		
+		for(index_set_h IndexSet : BatchGroup.IndexSets)
+			RunState->CurrentIndexes[IndexSet.Handle] = {IndexSet, 0};
+		
+		for(size_t Tuple = 0; Tuple < TupleCount; ++Tuple)
+		{
+			for(parameter_h Parameter : Hoisted.Parameters)
+			{
+				size_t Offset = OffsetForHandle(DataSet->ParameterStorageStructure, RunState->CurrentIndexes, DataSet->IndexCounts, Parameter);
+				RunState->CurParameters[Parameter.Handle] = DataSet->ParameterData[Offset];
+			}
+			for(size_t Idx = 0; Idx < Hoisted.Inputs.Count; ++Idx)
+			{
+				input_h Input = Hoisted.Inputs[Idx];
+				InputOffsets[Idx] = OffsetForHandle(DataSet->InputStorageStructure, RunState->CurrentIndexes, DataSet->IndexCounts, Input);
+				RunState->CurInputWasProvided[Input.Handle] = DataSet->InputTimeseriesWasProvided[InputOffsets[Idx]];
+			}
+			for(size_t Idx = 0; Idx < Hoisted.Results.Count; ++Idx)
+				ReadResultOffsets[Idx] = OffsetForHandle(Storage, RunState->CurrentIndexes, DataSet->IndexCounts, Hoisted.Results[Idx]);
+			for(size_t Idx = 0; Idx < Hoisted.Equations.Count; ++Idx)
+			{
+				equation_h Equation = Hoisted.Equations[Idx];
+				ResultOffsets[Idx] = OffsetForHandle(Storage, RunState->CurrentIndexes, DataSet->IndexCounts, Equation);
+				if(RunState->Plan.IsConstant[Equation.Handle])
+					RunState->CurResults[Equation.Handle] = ResultBase[ResultOffsets[Idx]];
+			}
+			
+			RunState->CurrentTime = StartTime;
+			for(u64 Timestep = 0; Timestep < Timesteps; ++Timestep)
+			{
+				RunState->Timestep          = (s64)Timestep;
+				RunState->AllCurResultsBase = ResultBase + Timestep*ResultCount;
+				
+				if(SingleInputBase)
+				{
+					for(size_t Idx = 0; Idx < Hoisted.Inputs.Count; ++Idx)
+						RunState->CurInputs[Hoisted.Inputs[Idx].Handle] = (double)SingleInputBase[Timestep*InputCount + InputOffsets[Idx]];
+				}
+				else
+				{
+					RunState->AllCurInputsBase = InputBase + Timestep*InputCount;
+					for(size_t Idx = 0; Idx < Hoisted.Inputs.Count; ++Idx)
+						RunState->CurInputs[Hoisted.Inputs[Idx].Handle] = RunState->AllCurInputsBase[InputOffsets[Idx]];
+				}
+				for(size_t Idx = 0; Idx < Hoisted.Results.Count; ++Idx)
+					RunState->CurResults[Hoisted.Results[Idx].Handle] = RunState->AllCurResultsBase[ReadResultOffsets[Idx]];
+				
+				for(size_t Idx = 0; Idx < Hoisted.Equations.Count; ++Idx)
+				{
+					equation_h Equation = Hoisted.Equations[Idx];
+					if(RunState->Plan.IsConstant[Equation.Handle]) continue;
+					double ResultValue = CallEquation(Model, RunState, Equation);
+#if MOBIUS_TEST_FOR_NAN
+					NaNTest(Model, RunState, ResultValue, Equation);
+#endif
+					RunState->CurResults[Equation.Handle] = ResultValue;
+					RunState->AllCurResultsBase[ResultOffsets[Idx]] = ResultValue;
+				}
+				
+				RunState->CurrentTime.Advance();
+			}
+			
+			//NOTE: Advance to the next index tuple, the last index set counting fastest.
+			for(s32 Level = (s32)BatchGroup.IndexSets.Count - 1; Level >= 0; --Level)
+			{
+				index_set_h IndexSet = BatchGroup.IndexSets[Level];
+				index_t &Index = RunState->CurrentIndexes[IndexSet.Handle];
+				++Index;
+				if(Index < DataSet->IndexCounts[IndexSet.Handle] || Level == 0) break;
+				Index = {IndexSet, 0};
+			}
+		}
+		
+		++BatchGroupIdx;
+	}
+	
+	for(index_set_h IndexSet : Model->IndexSets)
+		RunState->CurrentIndexes[IndexSet.Handle] = {IndexSet, 0};
+	RunState->Timestep          = 0;
+	RunState->CurrentTime       = StartTime;
+	RunState->AllCurInputsBase  = InputBase;
+	RunState->AllCurResultsBase = ResultBase;
+}
+
+static void
+BuildFastLookup(mobius_data_set *DataSet, model_run_state *RunState)
+{
+	//NOTE: Allocates and builds the fast lookup arrays of a run state, and allocates its solver temporaries and run plan. The result storage structure has to be set up.
+	//  The input and result lookups only depend on the index sets, so the run state can be reused for later runs of the same data set. Then only the parameter values have to be updated from FastParameterOffsets, see SetupModelRun.
+	
+	//NOTE: This is a hack, where we first set the Count for each array in the FastLookupCounter routine, then allocate, then set it to 0 to use it as an iterator in FastLookupSetupInnerLoop
+	ModelLoop(DataSet, RunState, FastLookupCounter);
+	RunState->Clear();
+	
+	RunState->FastParameterLookup.Allocate(&RunState->BucketMemory, RunState->FastParameterLookup.Count);
+	RunState->FastParameterOffsets.Allocate(&RunState->BucketMemory, RunState->FastParameterLookup.Count);
+	RunState->FastInputLookup.Allocate(&RunState->BucketMemory, RunState->FastInputLookup.Count);
+	RunState->FastResultLookup.Allocate(&RunState->BucketMemory, RunState->FastResultLookup.Count);
+	RunState->FastLastResultLookup.Allocate(&RunState->BucketMemory, RunState->FastLastResultLookup.Count);
+	
+	AllocateSolverTempStorage(RunState);
+	AllocateRunPlan(RunState);
+	
+#if MOBIUS_EQUATION_PROFILING
+	RunState->EquationHits        = RunState->BucketMemory.Allocate<size_t>(DataSet->Model->Equations.Count());
+	RunState->EquationTotalCycles = RunState->BucketMemory.Allocate<u64>(DataSet->Model->Equations.Count());
+#endif
+	
+	RunState->FastParameterLookup.Count  = 0;
+	RunState->FastInputLookup.Count      = 0;
+	RunState->FastResultLookup.Count     = 0;
+	RunState->FastLastResultLookup.Count = 0;
+	
+	ModelLoop(DataSet, RunState, FastLookupSetupInnerLoop);
+	RunState->Clear();
+	
+	RunState->StorageIsAllocated = true;
+}
+
+static void
+SetupParallelScheduler(mobius_data_set *DataSet, model_run_state *RunState, parallel_scheduler *Scheduler, size_t ThreadCount)
+{
+	const mobius_model *Model = DataSet->Model;
+	
+	Scheduler->Groups.resize(Model->BatchGroups.Count);
+	
+	//NOTE: We want enough work items per worker that the work is evenly divided between them even if the items take different amounts of time.
+	const size_t ItemsPerWorker = 4;
+	
+	run_state_cursor At = {};
+	size_t BatchGroupIdx = 0;
+	for(const equation_batch_group &BatchGroup : Model->BatchGroups)
+	{
+		if(BatchGroup.IndexSets.Count == 0)
+		{
+			At.LastResultLookup += BatchGroup.LastResultsToReadAtBase.Count;
+			At.Result           += DataSet->ResultStorageStructure.TotalCountForUnit[BatchGroupIdx];
+			++BatchGroupIdx;
+			continue;
+		}
+		
+		parallel_batch_group &Group = Scheduler->Groups[BatchGroupIdx];
+		Group.Start = At;
+		
+		//NOTE: Find how far the cursors move per index at each level. Since the index sets have a fixed size, each index at a given level takes up the same amount of space in the fast lookup arrays and in the result storage.
+		s32 LevelCount = (s32)BatchGroup.IndexSets.Count;
+		Group.PerIndex.resize(LevelCount);
+		Group.AtLevel.resize(LevelCount);
+		size_t TupleCount = 1;
+		for(s32 Level = LevelCount - 1; Level >= 0; --Level)
+		{
+			const iteration_data &IterationData = BatchGroup.IterationData[Level];
+			run_state_cursor &AtLevel = Group.AtLevel[Level];
+			AtLevel = {};
+			AtLevel.ParameterLookup  = IterationData.ParametersToRead.Count;
+			AtLevel.InputLookup      = IterationData.InputsToRead.Count;
+			AtLevel.ResultLookup     = IterationData.ResultsToRead.Count;
+			AtLevel.LastResultLookup = IterationData.LastResultsToRead.Count;
+			
+			run_state_cursor &PerIndex = Group.PerIndex[Level];
+			PerIndex = AtLevel;
+			if(Level == LevelCount - 1)
+				PerIndex.Result = DataSet->ResultStorageStructure.Units[BatchGroupIdx].Handles.Count; //NOTE: This works because we set the storage structure up to mirror the batch group structure.
+			else
+				PerIndex.Advance(Group.PerIndex[Level + 1], DataSet->IndexCounts[BatchGroup.IndexSets[Level + 1].Handle].Index);
+			
+			TupleCount *= DataSet->IndexCounts[BatchGroup.IndexSets[Level].Handle].Index;
+		}
+		
+		index_set_h TopIndexSet = BatchGroup.IndexSets[0];
+		u32 TopCount = DataSet->IndexCounts[TopIndexSet.Handle].Index;
+		At.Advance(Group.PerIndex[0], TopCount);
+		++BatchGroupIdx;
+		
+		//NOTE: Handing out work to the threads has an overhead, so small groups are better evaluated serially.
+		if(TupleCount < ItemsPerWorker*ThreadCount)
+			continue;
+		
+		if(BatchGroup.IndependentLevels > 0)
+		{
+			//NOTE: Split at the first level where there are enough tuples to go around.
+			u32 ItemCount = 1;
+			for(s32 Level = 0; Level < BatchGroup.IndependentLevels; ++Level)
+			{
+				ItemCount *= DataSet->IndexCounts[BatchGroup.IndexSets[Level].Handle].Index;
+				Group.SplitLevel = Level;
+				if(ItemCount >= ItemsPerWorker*ThreadCount) break;
+			}
+			if(ItemCount == 1)
+			{
+				Group.SplitLevel = -1;
+				continue;
+			}
+			
+			Group.WorkLevels.resize(1);
+			for(u32 Item = 0; Item < ItemCount - 1; ++Item)
+				Group.WorkLevels[0].push_back(Item);
+			Group.LastItem = ItemCount - 1;
+		}
+		else if(BatchGroup.BranchesCanRunInParallel && TopCount > 1)
+		{
+			Group.SplitLevel = 0;
+			
+			//NOTE: Sort the indexes into topological levels. Branch inputs are always declared before the indexes they are inputs to, so we can do this in a single pass.
+			std::vector<u32> LevelOf(TopCount);
+			for(u32 Index = 0; Index < TopCount - 1; ++Index)
+			{
+				u32 Level = 0;
+				for(index_t Input : DataSet->BranchInputs[TopIndexSet.Handle][Index])
+					Level = Max(Level, LevelOf[Input.Index] + 1);
+				LevelOf[Index] = Level;
+				
+				if(Group.WorkLevels.size() <= Level) Group.WorkLevels.resize(Level + 1);
+				Group.WorkLevels[Level].push_back(Index);
+			}
+			Group.LastItem = TopCount - 1;
+		}
+		else
+			continue;
+		
+		Scheduler->Active = true;
+	}
+	
+	assert(At.ParameterLookup == RunState->FastParameterLookup.Count && At.InputLookup == RunState->FastInputLookup.Count && At.ResultLookup == RunState->FastResultLookup.Count && At.LastResultLookup == RunState->FastLastResultLookup.Count && At.Result == DataSet->ResultStorageStructure.TotalCount);
+	
+	if(!Scheduler->Active) return;
+	
+	Scheduler->Pool.Start(ThreadCount);
+	Scheduler->Workers.resize(ThreadCount);
+	for(model_run_state *&Worker : Scheduler->Workers)
+	{
+		Worker = new model_run_state(DataSet);
+		Worker->Clear();
+		AllocateSolverTempStorage(Worker);
+	}
+}
+
+static void
+SetupIncrementalRun(mobius_data_set *DataSet, incremental_run *Incremental, const std::vector<parameter_value> *ParameterDataLastRun)
+{
+	/*
+		Finds which batch groups an incremental run (see SetIncrementalRuns) has to reevaluate. ParameterDataLastRun is the parameter values (after computed parameters were processed) the results that are still in the result storage were computed from, or nullptr if the storage does not hold the results of a finished run over the same timesteps.
+		
+		A batch group is reevaluated if it reads a parameter that changed since the last run, or if it reads the results of a batch group that is reevaluated (see BuildBatchGroupDependencies). Every other batch group would get exactly the same results as in the last run, so they are skipped and their results are left as they are. Everything is reevaluated if the input data changed since the last run. This is tracked by the input generation of the data set (see InputsChanged), so changes to the inputs have to be made through SetInputSeries (or the other functions of the data set API), also in preprocessing steps. The input data can not be written through series views (see GetInputSeriesView).
+		The initial values are always evaluated for all the batch groups since that is cheap.
+		
+		NOTE: Models that draw random numbers in their equations don't give the same results as a full run, since the skipped batch groups don't draw their numbers.
+	*/
+	const mobius_model *Model = DataSet->Model;
+	const storage_structure<equation_h> &Storage = DataSet->ResultStorageStructure;
+	size_t GroupCount = Model->BatchGroups.Count;
+	u64 Timesteps = DataSet->TimestepsLastRun;
+	
+	Incremental->InputGeneration = InputGeneration(DataSet);
+	Incremental->Active = false;
+	Incremental->SkipBatchGroup.assign(GroupCount, false);
+	Incremental->Extent.resize(GroupCount);
+	
+	incremental_run_report &Report = DataSet->IncrementalRunReport;
+	Report = {};
+	Report.BatchGroupCount = GroupCount;
+	Report.EvaluationCount = Storage.TotalCount * Timesteps;
+	
+	if(!ParameterDataLastRun) return; //NOTE: The result storage was cleared, so everything is evaluated as in a normal run.
+	
+	if(DataSet->ResultWindow != 0 || Incremental->InputGeneration != DataSet->InputGenerationLastRun || ParameterDataLastRun->size() != DataSet->ParameterStorageStructure.TotalCount)
+	{
+		memset(DataSet->ResultData, 0, sizeof(double)*DataSet->ResultDataSize);
+		return;
+	}
+	
+	const storage_structure<parameter_h> &ParameterStorage = DataSet->ParameterStorageStructure;
+	std::vector<bool> &ParameterChanged = Incremental->ParameterChanged;
+	ParameterChanged.assign(Model->Parameters.Count(), false);
+	for(size_t Unit = 0; Unit < ParameterStorage.Units.Count; ++Unit)
+	{
+		const array<parameter_h> &Handles = ParameterStorage.Units[Unit].Handles;
+		size_t UnitOffset = ParameterStorage.OffsetForUnit[Unit];
+		for(size_t Idx = 0; Idx < ParameterStorage.TotalCountForUnit[Unit]; ++Idx)
+		{
+			if(memcmp(&DataSet->ParameterData[UnitOffset + Idx], &(*ParameterDataLastRun)[UnitOffset + Idx], sizeof(parameter_value)) != 0)
+				ParameterChanged[Handles[Idx % Handles.Count].Handle] = true;
+		}
+	}
+	
+	std::vector<bool>   &Reevaluate = Incremental->Reevaluate;
+	std::vector<size_t> &Visit      = Incremental->Visit;
+	Reevaluate.assign(GroupCount, false);
+	Visit.clear();
+	for(size_t BatchGroupIdx = 0; BatchGroupIdx < GroupCount; ++BatchGroupIdx)
+	{
+		for(parameter_h Parameter : Model->BatchGroupParameterDependencies[BatchGroupIdx])
+		{
+			if(!ParameterChanged[Parameter.Handle]) continue;
+			Reevaluate[BatchGroupIdx] = true;
+			Visit.push_back(BatchGroupIdx);
+			break;
+		}
+	}
+	while(!Visit.empty())
+	{
+		size_t BatchGroupIdx = Visit.back();
+		Visit.pop_back();
+		for(size_t Dependent : Model->BatchGroupDependents[BatchGroupIdx])
+		{
+			if(Reevaluate[Dependent]) continue;
+			Reevaluate[Dependent] = true;
+			Visit.push_back(Dependent);
+		}
+	}
+	
+	for(size_t BatchGroupIdx = 0; BatchGroupIdx < GroupCount; ++BatchGroupIdx)
+	{
+		Incremental->Extent[BatchGroupIdx] = BatchGroupCursorExtent(DataSet, Model->BatchGroups[BatchGroupIdx], BatchGroupIdx);
+		size_t UnitCount = Storage.TotalCountForUnit[BatchGroupIdx];
+		
+		if(!Reevaluate[BatchGroupIdx])
+		{
+			Incremental->SkipBatchGroup[BatchGroupIdx] = true;
+			Incremental->Active = true;
+			++Report.BatchGroupsSkipped;
+			Report.EvaluationsSkipped += UnitCount * Timesteps;
+		}
+		else
+		{
+			//NOTE: Clear the old results of the batch groups that are reevaluated, since results that are not evaluated in a timestep (in conditional batches) should read as 0 as they do after a normal run.
+			size_t UnitOffset = Storage.OffsetForUnit[BatchGroupIdx];
+			for(u64 Row = 0; Row <= Timesteps; ++Row)
+				memset(DataSet->ResultData + Row*Storage.TotalCount + UnitOffset, 0, sizeof(double)*UnitCount);
+		}
+	}
+}
+
+struct prepared_run
+{
+	//NOTE: A model run state (with its fast lookup arrays and solver temporaries) and parallel scheduler that are kept between runs of a data set, so that repeated runs don't have to set them up again. See PrepareModelRun.
+	mobius_data_set *DataSet;
+	model_run_state  RunState;
+	std::unique_ptr<parallel_scheduler> Scheduler;
+	size_t SchedulerThreadCount = 0;   //NOTE: The thread count the Scheduler was set up for.
+	incremental_run Incremental;
+	
+	u64 PrepareMicroseconds   = 0;     //NOTE: The time PrepareModelRun took.
+	u64 SetupMicroseconds     = 0;     //NOTE: The time the last run took to set up (including the evaluation of the initial values) and to run the timesteps.
+	u64 ExecutionMicroseconds = 0;
+	
+	prepared_run(mobius_data_set *DataSet) : DataSet(DataSet), RunState(DataSet) {}
+};
+
+struct model_checkpoint
+{
+	//NOTE: The state of a model run after some number of timesteps, see RunModelToCheckpoint.
+	u64 ModelSignature;             //NOTE: ModelStructureSignature of the model that made the checkpoint.
+	datetime Time;                  //NOTE: The date of the next timestep to evaluate.
+	std::vector<double> Results;    //NOTE: The results of the last evaluated timestep (one timestep of the result storage).
+	std::string RandomState;        //NOTE: The state of the random generator of the run.
+};
+
+inline void
+LoadInputTimestep(mobius_data_set *DataSet, model_run_state *RunState, size_t InputTimestep)
+{
+	//NOTE: Points AllCurInputsBase to the given timestep of the input data. If the inputs are stored in single precision (see SetSinglePrecisionStorage), the timestep is converted to double in the SingleInputRow of the run state, so that the run always reads double values.
+	size_t Count = DataSet->InputStorageStructure.TotalCount;
+	RunState->InputTimestep = InputTimestep;
+	if(!DataSet->SingleInputData)
+	{
+		RunState->AllCurInputsBase = DataSet->InputData + InputTimestep*Count;
+		return;
+	}
+	
+	if(RunState->SingleInputRow.size() != Count)
+		RunState->SingleInputRow.resize(Count);
+	const float *Row = DataSet->SingleInputData + InputTimestep*Count;
+	for(size_t Idx = 0; Idx < Count; ++Idx)
+		RunState->SingleInputRow[Idx] = (double)Row[Idx];
+	RunState->AllCurInputsBase = RunState->SingleInputRow.data();
+}
+
+static void
+SetupModelRun(mobius_data_set *DataSet, model_run_state *RunState, const result_sink *Sink = nullptr, const model_checkpoint *ResumeFrom = nullptr, incremental_run *Incremental = nullptr)
+{
+	//NOTE: Does everything that has to be done before the first timestep of a model run: Checks that the setup is valid, allocates result storage, builds the fast lookup arrays, and evaluates the initial values. The RunState is left ready to evaluate the first timestep.
+	//  If a Sink is given, the results are passed to it as the run advances instead of being stored (see EndTimestep).
+	//  If ResumeFrom is given, the results of the checkpoint are used as the initial values instead of evaluating the initial value equations (see RunModelFromCheckpoint).
+	//  If Incremental is given, the results of the last run are kept where possible, and Incremental is set up with the batch groups that don't have to be reevaluated (see SetupIncrementalRun).
+	
+	const mobius_model *Model = DataSet->Model;
+	
+	//NOTE: What the results of the last run were computed from. This no longer holds once the result storage is written to, so it is stored again by RunModel only if this run finishes. In an incremental run it is swapped into the storage of Incremental, and the cleared vector keeps its capacity for when RunModel stores it again.
+	std::vector<parameter_value> LocalParameterDataLastRun;
+	std::vector<parameter_value> &ParameterDataLastRun = Incremental ? Incremental->ParameterDataLastRun : LocalParameterDataLastRun;
+	ParameterDataLastRun.swap(DataSet->ParameterDataLastRun);
+	DataSet->ParameterDataLastRun.clear();
+	u64      TimestepsLastRun = DataSet->TimestepsLastRun;
+	datetime StartDateLastRun = DataSet->StartDateLastRun;
+	
+	// NOTE: in case there is an error later, these have to have been cleared.
+	DataSet->HasBeenRun = false;
+	DataSet->TimestepsLastRun = 0;
+	DataSet->IncrementalRunReport = {};
+	
+	//NOTE: Check that all the index sets have at least one index.
+	for(index_set_h IndexSet : Model->IndexSets)
+	{
+		if(DataSet->IndexCounts[IndexSet.Handle] == 0)
+			FatalError("ERROR: The index set \"", GetName(Model, IndexSet), "\" does not contain any indexes.\n");
+	}
+	
+	//NOTE: Allocate parameter storage in case it was not allocated during setup.
+	if(!DataSet->ParameterData)
+	{
+		AllocateParameterStorage(DataSet);
+		WarningPrint("WARNING: No parameter values were specified, using default parameter values only.\n");
+	}
+	
+	
+	u64 Timesteps           = GetTimesteps(DataSet); //NOTE: Reads either the "Timesteps" or the "End date" parameter and computes accordingly.
+	datetime ModelStartTime = GetStartDate(DataSet); //NOTE: This reads the "Start date" parameter.
+	
+	if(ResumeFrom)
+	{
+		//NOTE: A resumed run evaluates the rest of the timesteps of the run that the parameters set up, starting at the date of the checkpoint. The "Start date" parameter is left as it is, so that later runs of the data set are not affected.
+		s64 ResumeStep = FindTimestep(ModelStartTime, ResumeFrom->Time, Model->TimestepSize);
+		if(ResumeStep < 0 || (u64)ResumeStep >= Timesteps)
+			FatalError("ERROR: The checkpoint is at ", ResumeFrom->Time.ToString(), ", which is not within the model run that starts at ", ModelStartTime.ToString(), " and has ", Timesteps, " timesteps.\n");
+		Timesteps     -= (u64)ResumeStep;
+		ModelStartTime = ResumeFrom->Time;
+	}
+	
+	//TODO: Should we put a restriction on ModelStartTime so that it is "round" with respect to the Model->TimestepSize ?
+	
+#if MOBIUS_PRINT_TIMING_INFO
+	WarningPrint("Running model ", Model->Name);
+	if(Model->Modules.Count() > 1)
+	{
+		WarningPrint(" with modules (");
+		for(module_h Module : Model->Modules)
+		{
+			const module_spec &ModuleSpec = Model->Modules[Module];
+			WarningPrint(ModuleSpec.Name, " V", ModuleSpec.Version);
+			if(Module.Handle != Model->Modules.Count()-1) WarningPrint(", ");
+		}
+		WarningPrint(")");
+	}
+	WarningPrint(" for ", Timesteps, " timesteps starting at ", ModelStartTime.ToString(), "\n");
+#endif
+	
+	//NOTE: Allocate input storage in case it was not allocated during setup.
+	if(!InputStorageIsAllocated(DataSet))
+	{
+		AllocateInputStorage(DataSet, Timesteps);
+		WarningPrint("WARNING: No input values were specified, using input values of 0 only.\n");
+	}
+	
+	datetime InputStartDate = GetInputStartDate(DataSet);
+	s64 InputDataStartOffsetTimesteps = FindTimestep(InputStartDate, ModelStartTime, Model->TimestepSize);
+	
+	
+	//NOTE: Do some sanity checks of the input and model start times that limit potential errors.
+
+	s64 TimeOffset;
+	if(Model->TimestepSize.Unit == Timestep_Second)
+	{
+		TimeOffset = ModelStartTime.SecondsSinceEpoch - InputStartDate.SecondsSinceEpoch;
+	}
+	else
+	{
+		assert(Model->TimestepSize.Unit == Timestep_Month);
+		
+		s32 IYear, IMonth, IDay;
+		InputStartDate.YearMonthDay(&IYear, &IMonth, &IDay);
+		
+		s32 MYear, MMonth, MDay;
+		ModelStartTime.YearMonthDay(&MYear, &MMonth, &MDay);
+		
+		if(IDay != 1 || InputStartDate.SecondsSinceEpoch % 86400 != 0)
+			FatalError("ERROR: For models with timestep resolution measured in months or years, input data start dates have to be on the form yyyy-mm-01 or yyyy-mm-01 00:00:00 . In the current setup, the input start date was set to ", InputStartDate.ToString(), " .\n");
+		
+		if(MDay != 1 || ModelStartTime.SecondsSinceEpoch % 86400 != 0)
+			FatalError("ERROR: For models with timestep resolution measured in months or years, the \"Start date\" has to be on the form yyyy-mm-01 or yyyy-mm-01 00:00:00 . In the current setup, the start date was set to ", ModelStartTime.ToString(), " .\n");
+		
+		TimeOffset = (MYear-IYear)*12 + MMonth-IMonth;
+	}
+	
+	if(TimeOffset % Model->TimestepSize.Magnitude != 0)
+		FatalError("ERROR: The model run \"Start date\" was not set to be a whole number of timesteps after the input start date.\n");
+	
+	if(ModelStartTime.SecondsSinceEpoch < InputStartDate.SecondsSinceEpoch)
+		FatalError("ERROR: The input data starts at a later date than the model run.\n");
+	
+	if(((s64)DataSet->InputDataTimesteps - InputDataStartOffsetTimesteps) < (s64)Timesteps)
+		FatalError("ERROR: The input data provided has fewer timesteps (after the model run start date) than the number of timesteps the model is running for.\n");
+	
+	RunState->ResultSink = Sink;
+	if(Sink && !Sink->Receive)
+		FatalError("ERROR: Got a result sink that does not have a receiver.\n");
+	bool KeepResults = Incremental && !ParameterDataLastRun.empty() && !Sink && !ResumeFrom && Timesteps == TimestepsLastRun && ModelStartTime.SecondsSinceEpoch == StartDateLastRun.SecondsSinceEpoch;
+	AllocateResultStorage(DataSet, Timesteps, Sink ? Max(Sink->WindowSize, (size_t)1) : 0, KeepResults);
+	
+	
+	for(const mobius_preprocessing_step &PreprocessingStep : Model->PreprocessingSteps)
+		PreprocessingStep(DataSet);
+	
+	// Check if solver step size makes sense.
+	for(solver_h Solver: Model->Solvers)
 	{
 		const solver_spec &SolverSpec = Model->Solvers[Solver];
 		double Correct = true;
@@ -1987,194 +3201,784 @@ RunModel(mobius_data_set *DataSet, s64 MillisecondTimeout=-1)
 	DataSet->HasBeenRun = true;
 	DataSet->TimestepsLastRun = Timesteps;
 	DataSet->StartDateLastRun = ModelStartTime;
+	WriteMappedStorageHeaders(DataSet);
 	
 	
-	model_run_state RunState(DataSet);
+	ProcessComputedParameters(DataSet, RunState);
 	
-	ProcessComputedParameters(DataSet, &RunState);
+	if(Incremental)
+		SetupIncrementalRun(DataSet, Incremental, KeepResults ? &ParameterDataLastRun : nullptr);
 	
-	RunState.Clear();
+	RunState->Clear();
 	
 	
 	///////////// Setting up fast lookup ////////////////////
 	
-	//NOTE: This is a hack, where we first set the Count for each array in the FastLookupCounter routine, then allocate, then set it to 0 to use it as an iterator in FastLookupSetupInnerLoop
-	ModelLoop(DataSet, &RunState, FastLookupCounter);
-	RunState.Clear();
+	//NOTE: A run state that is reused for another run of the same data set (a prepared run, see PrepareModelRun, or the run contexts of an ensemble, see RunModelEnsemble) already has the lookup arrays built. Only the parameter values can have changed since then.
+	if(!RunState->StorageIsAllocated)
+		BuildFastLookup(DataSet, RunState);
+	else
+	{
+		for(size_t Idx = 0; Idx < RunState->FastParameterLookup.Count; ++Idx)
+			RunState->FastParameterLookup.Data[Idx] = DataSet->ParameterData[RunState->FastParameterOffsets.Data[Idx]];
+	}
+	
+	RunState->Plan.HoistEquations = (DataSet->ResultWindow == 0) && !DataSet->MappedResults.Data; //NOTE: See RunHoistedEquations. With mapped results (see SetMappedStorage) the run should only stream through the result file once.
+	RunState->CurrentTime = expanded_datetime(ModelStartTime, Model->TimestepSize);
+	EvaluateConstantEquations(DataSet, RunState, Incremental);
+	BuildRunPlan(DataSet, RunState);
+	
+	//NOTE: System parameters (i.e. parameters that don't depend on index sets) are going to be the same during the entire run, so we just load them into CurParameters once and for all.
+	//NOTE: If any system parameters exist, the storage units are sorted such that the system parameters have to belong to storage unit [0].
+	if(DataSet->ParameterStorageStructure.Units.Count != 0 && DataSet->ParameterStorageStructure.Units[0].IndexSets.Count == 0)
+	{
+		for(parameter_h Parameter : DataSet->ParameterStorageStructure.Units[0].Handles)
+		{
+			size_t Offset = OffsetForHandle(DataSet->ParameterStorageStructure, Parameter);
+			RunState->CurParameters[Parameter.Handle] = DataSet->ParameterData[Offset];
+		}
+	}
+	
+	//NOTE: Similarly we have to set which of the unindexed inputs were provided.
+	if(DataSet->InputStorageStructure.Units.Count != 0 && DataSet->InputStorageStructure.Units[0].IndexSets.Count == 0)
+	{
+		for(input_h Input : DataSet->InputStorageStructure.Units[0].Handles)
+		{
+			size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Input);
+			RunState->CurInputWasProvided[Input.Handle] = DataSet->InputTimeseriesWasProvided[Offset];
+		}
+	}
+	
+	RunState->AllLastResultsBase = DataSet->ResultData;
+	RunState->AllCurResultsBase  = DataSet->ResultData;
+	
+	//TODO: We may want to set this one timestep back for it to also be correct during the initial value run.
+	RunState->CurrentTime = expanded_datetime(ModelStartTime, Model->TimestepSize);
+	
+	//************ NOTE: Set up initial values;
+	RunState->AtResult          = RunState->AllCurResultsBase;
+	RunState->AtLastResult      = RunState->AllLastResultsBase;
+	RunState->AtParameterLookup = RunState->FastParameterLookup.Data;
+	RunState->AtInputLookup     = RunState->FastInputLookup.Data;
+	//NOTE: Initial value equations can access input timeseries. The timestep they access is either the model run timestep (if the input start date is the same as the model run start date), or the timestep before that.
+	size_t InitialValueInputTimestep = (size_t)InputDataStartOffsetTimesteps;
+	if(InitialValueInputTimestep > 0) --InitialValueInputTimestep;
+	LoadInputTimestep(DataSet, RunState, InitialValueInputTimestep);
+	//NOTE: We have to update the inputs that don't depend on any index sets here, as that is not handled by the "fast lookup system".
+	if(DataSet->InputStorageStructure.Units.Count != 0 && DataSet->InputStorageStructure.Units[0].IndexSets.Count == 0)
+	{
+		for(input_h Input : DataSet->InputStorageStructure.Units[0].Handles)
+		{
+			size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Input);
+			RunState->CurInputs[Input.Handle] = RunState->AllCurInputsBase[Offset];
+		}
+	}
+#if MOBIUS_TIMESTEP_VERBOSITY >= 1
+	WarningPrint("Initial value step:\n");
+#endif
+	RunState->Timestep = -1;
+	if(ResumeFrom)
+	{
+		if(ResumeFrom->Results.size() != DataSet->ResultStorageStructure.TotalCount)
+			FatalError("ERROR: The checkpoint was made from a data set with different index sets than this one.\n");
+		memcpy(DataSet->ResultData, ResumeFrom->Results.data(), sizeof(double)*ResumeFrom->Results.size());
+		std::istringstream RandomState(ResumeFrom->RandomState);
+		RandomState >> RunState->RandomGenerator;
+	}
+	else
+		ModelLoop(DataSet, RunState, InitialValueSetupInnerLoop);
+	//***********
+	
+	if(!DataSet->RecordedIndex.empty())
+		RecordResultTimestep(DataSet, DataSet->ResultData, 0);
+	if(DataSet->CompressedResults.Active)
+		CompressResultBlock(DataSet, DataSet->ResultData, 1);
+	if(Sink)
+		Sink->Receive(DataSet, DataSet->ResultData, 0, 1);
+	
+	for(objective_accumulator &Objective : DataSet->Objectives)
+	{
+		Objective = {Objective.ResultOffset, Objective.InputOffset, Objective.SkipTimesteps};
+		for(double &Value : Objective.Statistics) Value = std::numeric_limits<double>::quiet_NaN(); //NOTE: In case the run does not finish.
+	}
+	
+	RunState->AllLastResultsBase = DataSet->ResultData;
+	RunState->AllCurResultsBase  = DataSet->ResultData + DataSet->ResultStorageStructure.TotalCount;
+	LoadInputTimestep(DataSet, RunState, (size_t)InputDataStartOffsetTimesteps);
+	RunState->Timestep = 0;
+}
 
-	RunState.FastParameterLookup.Allocate(&RunState.BucketMemory, RunState.FastParameterLookup.Count);
-	RunState.FastInputLookup.Allocate(&RunState.BucketMemory, RunState.FastInputLookup.Count);
-	RunState.FastResultLookup.Allocate(&RunState.BucketMemory, RunState.FastResultLookup.Count);
-	RunState.FastLastResultLookup.Allocate(&RunState.BucketMemory, RunState.FastLastResultLookup.Count);
+inline void
+BeginTimestep(mobius_data_set *DataSet, model_run_state *RunState)
+{
+#if MOBIUS_TIMESTEP_VERBOSITY >= 1
+	WarningPrint("Timestep: ", RunState->Timestep, "\n");
+#endif
+	
+	RunState->AtResult           = RunState->AllCurResultsBase;
+	RunState->AtLastResult       = RunState->AllLastResultsBase;
+	
+	RunState->AtParameterLookup  = RunState->FastParameterLookup.Data;
+	RunState->AtInputLookup      = RunState->FastInputLookup.Data;
+	RunState->AtResultLookup     = RunState->FastResultLookup.Data;
+	RunState->AtLastResultLookup = RunState->FastLastResultLookup.Data;
+	
+	//NOTE: We have to update the inputs that don't depend on any index sets here, as that is not handled by the "fast lookup system".
+	if(DataSet->InputStorageStructure.Units.Count != 0 && DataSet->InputStorageStructure.Units[0].IndexSets.Count == 0)
+	{
+		for(input_h Input : DataSet->InputStorageStructure.Units[0].Handles)
+		{
+			size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Input);
+			RunState->CurInputs[Input.Handle] = RunState->AllCurInputsBase[Offset];
+		}
+	}
+}
 
-	RunState.FastParameterLookup.Count  = 0;
-	RunState.FastInputLookup.Count      = 0;
-	RunState.FastResultLookup.Count     = 0;
-	RunState.FastLastResultLookup.Count = 0;
+inline void
+AccumulateObjectives(mobius_data_set *DataSet, model_run_state *RunState)
+{
+	//NOTE: Updates the goodness of fit statistics (see AddObjective) with the current timestep.
+	for(objective_accumulator &Obj : DataSet->Objectives)
+	{
+		if((u64)RunState->Timestep < Obj.SkipTimesteps) continue;
+		
+		double Obs = RunState->AllCurInputsBase[Obj.InputOffset];
+		double Sim = RunState->AllCurResultsBase[Obj.ResultOffset];
+		if(std::isnan(Obs)) continue;
+		
+		Obj.N += 1.0;
+		double DeltaObs = Obs - Obj.MeanObs;
+		double DeltaSim = Sim - Obj.MeanSim;
+		Obj.MeanObs += DeltaObs / Obj.N;
+		Obj.MeanSim += DeltaSim / Obj.N;
+		Obj.M2Obs    += DeltaObs * (Obs - Obj.MeanObs);
+		Obj.M2Sim    += DeltaSim * (Sim - Obj.MeanSim);
+		Obj.CoMoment += DeltaObs * (Sim - Obj.MeanSim);
+		Obj.SumSquaredError += (Sim - Obs)*(Sim - Obs);
+		
+		if(Obs > 0.0 && Sim > 0.0)
+		{
+			double LogObs = std::log(Obs);
+			double LogSim = std::log(Sim);
+			Obj.LogN += 1.0;
+			double DeltaLogObs = LogObs - Obj.LogMeanObs;
+			Obj.LogMeanObs += DeltaLogObs / Obj.LogN;
+			Obj.LogM2Obs   += DeltaLogObs * (LogObs - Obj.LogMeanObs);
+			Obj.LogSumSquaredError += (LogSim - LogObs)*(LogSim - LogObs);
+		}
+	}
 	
-	//Technically we really only need to rebuild the parameter lookup, not the three others, but it is very fast anyway.
-	ModelLoop(DataSet, &RunState, FastLookupSetupInnerLoop);
-	RunState.Clear();
+	if((u64)(RunState->Timestep + 1) != DataSet->TimestepsLastRun) return;
 	
-	//NOTE: Temporary storage for use by solvers:
-	//TODO: This code should probably be a member function of model_run_state or similar.
-	size_t MaxODECount = 0;
-	size_t MaxNonODECount = 0;
-	size_t SolverTempWorkSpace = 0;
-	for(const equation_batch_group& BatchGroup : Model->BatchGroups)
+	//NOTE: The run is finished, so compute the final statistics.
+	double NaN = std::numeric_limits<double>::quiet_NaN();
+	for(objective_accumulator &Obj : DataSet->Objectives)
 	{
-		for(size_t BatchIdx = BatchGroup.FirstBatch; BatchIdx <= BatchGroup.LastBatch; ++BatchIdx)
+		double *Stat = Obj.Statistics;
+		Stat[ObjectiveStatistic_Observations] = Obj.N;
+		if(Obj.N == 0.0)
 		{
-			const equation_batch &Batch = Model->EquationBatches[BatchIdx];
-			if(IsValid(Batch.Solver))
-			{
-				size_t ODECount = Batch.EquationsODE.Count;
-				MaxODECount = Max(MaxODECount, ODECount);
-				MaxNonODECount = Max(MaxNonODECount, Batch.Equations.Count);
-				const solver_spec &SolverSpec = Model->Solvers[Batch.Solver];
-				SolverTempWorkSpace = Max(SolverTempWorkSpace, SolverSpec.SpaceRequirement(ODECount));
-			}
+			for(size_t Idx = 0; Idx < ObjectiveStatistic_Observations; ++Idx) Stat[Idx] = NaN;
+			continue;
 		}
+		
+		Stat[ObjectiveStatistic_NSE]  = 1.0 - Obj.SumSquaredError / Obj.M2Obs;
+		Stat[ObjectiveStatistic_Bias] = Obj.MeanSim - Obj.MeanObs;
+		Stat[ObjectiveStatistic_RMSE] = std::sqrt(Obj.SumSquaredError / Obj.N);
+		
+		double R     = Obj.CoMoment / std::sqrt(Obj.M2Obs * Obj.M2Sim);
+		double Alpha = std::sqrt(Obj.M2Sim / Obj.M2Obs);
+		double Beta  = Obj.MeanSim / Obj.MeanObs;
+		Stat[ObjectiveStatistic_KGE] = 1.0 - std::sqrt((R - 1.0)*(R - 1.0) + (Alpha - 1.0)*(Alpha - 1.0) + (Beta - 1.0)*(Beta - 1.0));
+		
+		Stat[ObjectiveStatistic_LogNSE] = (Obj.LogN > 0.0) ? 1.0 - Obj.LogSumSquaredError / Obj.LogM2Obs : NaN;
 	}
+}
 
-	size_t JacobiTempWorkSpace = MaxODECount + MaxNonODECount;
-	
-	RunState.SolverTempX0          = RunState.BucketMemory.Allocate<double>(MaxODECount);
-	RunState.SolverTempWorkStorage = RunState.BucketMemory.Allocate<double>(SolverTempWorkSpace);
-	RunState.JacobianTempStorage   = RunState.BucketMemory.Allocate<double>(JacobiTempWorkSpace);
+inline void
+EndTimestep(mobius_data_set *DataSet, model_run_state *RunState)
+{
+	size_t TotalCount = DataSet->ResultStorageStructure.TotalCount;
 	
+	if(!DataSet->Objectives.empty())
+		AccumulateObjectives(DataSet, RunState);
 	
-
-	//NOTE: System parameters (i.e. parameters that don't depend on index sets) are going to be the same during the entire run, so we just load them into CurParameters once and for all.
-	//NOTE: If any system parameters exist, the storage units are sorted such that the system parameters have to belong to storage unit [0].
-	if(DataSet->ParameterStorageStructure.Units.Count != 0 && DataSet->ParameterStorageStructure.Units[0].IndexSets.Count == 0)
+	if(DataSet->ResultWindow == 0)
 	{
-		for(parameter_h Parameter : DataSet->ParameterStorageStructure.Units[0].Handles)
+		RunState->AllLastResultsBase = RunState->AllCurResultsBase;
+		RunState->AllCurResultsBase += TotalCount;
+		
+		if(DataSet->MappedResults.Data)
 		{
-			size_t Offset = OffsetForHandle(DataSet->ParameterStorageStructure, Parameter);
-			RunState.CurParameters[Parameter.Handle] = DataSet->ParameterData[Offset];
+			//NOTE: The results are in a mapped file (see SetMappedStorage). The timesteps before the last one are finished, so their pages are released now and then. The operating system writes them to the file, and the memory can be used for the next timesteps instead of for older ones.
+			size_t Finished = (u8 *)RunState->AllLastResultsBase - DataSet->MappedResults.Data;
+			if(Finished >= DataSet->MappedResultsReleased + MOBIUS_MAPPED_RELEASE_SIZE)
+				DataSet->MappedResultsReleased = ReleaseMappedRange(&DataSet->MappedResults, DataSet->MappedResultsReleased, Finished);
 		}
 	}
-	
-	//NOTE: Similarly we have to set which of the unindexed inputs were provided.
-	if(DataSet->InputStorageStructure.Units.Count != 0 && DataSet->InputStorageStructure.Units[0].IndexSets.Count == 0)
+	else
 	{
-		for(input_h Input : DataSet->InputStorageStructure.Units[0].Handles)
+		//NOTE: Only some of the results are recorded (see RecordResult), or the results are streamed to a result_sink. ResultData holds one timestep carried over from the previous window followed by a window of ResultWindow timesteps. When the window is full (or the run is finished) it is passed to the sink, and the last timestep of it is carried over so that LAST_RESULT can read it.
+		//NOTE: The new current timestep is cleared so that results that are not evaluated in a timestep (conditional batches) read as 0 just as they do when everything is stored.
+		RecordResultTimestep(DataSet, RunState->AllCurResultsBase, RunState->Timestep + 1);
+		
+		double *Window = DataSet->ResultData + TotalCount;
+		size_t RowCount = (size_t)(RunState->AllCurResultsBase - Window)/TotalCount + 1;
+		bool Finished = (u64)(RunState->Timestep + 1) == DataSet->TimestepsLastRun;
+		if(RowCount == DataSet->ResultWindow || Finished)
+		{
+			if(DataSet->CompressedResults.Active)
+				CompressResultBlock(DataSet, Window, RowCount);
+			if(RunState->ResultSink)
+				RunState->ResultSink->Receive(DataSet, Window, (u64)(RunState->Timestep + 2 - RowCount), RowCount);
+			memcpy(DataSet->ResultData, RunState->AllCurResultsBase, sizeof(double)*TotalCount);
+			RunState->AllLastResultsBase = DataSet->ResultData;
+			RunState->AllCurResultsBase  = Window;
+		}
+		else
 		{
-			size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Input);
-			RunState.CurInputWasProvided[Input.Handle] = DataSet->InputTimeseriesWasProvided[Offset];
+			RunState->AllLastResultsBase = RunState->AllCurResultsBase;
+			RunState->AllCurResultsBase += TotalCount;
 		}
+		memset(RunState->AllCurResultsBase, 0, sizeof(double)*TotalCount);
+	}
+	if(!DataSet->SingleInputData)
+	{
+		RunState->AllCurInputsBase += DataSet->InputStorageStructure.TotalCount;
+		++RunState->InputTimestep;
 	}
+	else if(RunState->InputTimestep + 1 < DataSet->InputDataTimesteps) //NOTE: The input data can end with the run.
+		LoadInputTimestep(DataSet, RunState, RunState->InputTimestep + 1);
 	
-	RunState.AllLastResultsBase = DataSet->ResultData;
-	RunState.AllCurResultsBase  = DataSet->ResultData;
+	RunState->CurrentTime.Advance();
+	++RunState->Timestep;
+}
+
+static bool
+RunModel(mobius_data_set *DataSet, s64 MillisecondTimeout, const result_sink *Sink, const model_checkpoint *ResumeFrom, model_checkpoint *SaveTo, u64 SaveAtTimestep, prepared_run *Prepared = nullptr)
+{
+	//NOTE: This is the general version of RunModel that can also resume from and save to checkpoints (see RunModelToCheckpoint and RunModelFromCheckpoint), and run with the run state of a prepared run (see PrepareModelRun).
 	
-	//TODO: We may want to set this one timestep back for it to also be correct during the initial value run.
-	RunState.CurrentTime = expanded_datetime(ModelStartTime, Model->TimestepSize);
+	timer SetupTimer = BeginTimer();
+
+	const mobius_model *Model = DataSet->Model;
 	
-	//************ NOTE: Set up initial values;
-	RunState.AtResult          = RunState.AllCurResultsBase;
-	RunState.AtLastResult      = RunState.AllLastResultsBase;
-	RunState.AtParameterLookup = RunState.FastParameterLookup.Data;
-	RunState.AtInputLookup     = RunState.FastInputLookup.Data;
-	//NOTE: Initial value equations can access input timeseries. The timestep they access is either the model run timestep (if the input start date is the same as the model run start date), or the timestep before that.
-	size_t InitialValueInputTimestep = (size_t)InputDataStartOffsetTimesteps;
-	if(InitialValueInputTimestep > 0) --InitialValueInputTimestep;
-	RunState.AllCurInputsBase = DataSet->InputData + (InitialValueInputTimestep)*DataSet->InputStorageStructure.TotalCount;
-	//NOTE: We have to update the inputs that don't depend on any index sets here, as that is not handled by the "fast lookup system".
-	if(DataSet->InputStorageStructure.Units.Count != 0 && DataSet->InputStorageStructure.Units[0].IndexSets.Count == 0)
+	std::unique_ptr<prepared_run> Temporary;
+	if(!Prepared)
 	{
-		for(input_h Input : DataSet->InputStorageStructure.Units[0].Handles)
-		{
-			size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Input);
-			RunState.CurInputs[Input.Handle] = RunState.AllCurInputsBase[Offset];
-		}
+		Temporary.reset(new prepared_run(DataSet));
+		Prepared = Temporary.get();
 	}
-#if MOBIUS_TIMESTEP_VERBOSITY >= 1
-	WarningPrint("Initial value step:\n");
+	model_run_state *RunState = &Prepared->RunState;
+	
+	//NOTE: A run that is stopped at a checkpoint or that does not store its results can not be reused by the next run.
+	incremental_run &Incremental = Prepared->Incremental;
+	Incremental.Active = false;
+	bool RunIncrementally = DataSet->IncrementalRuns && !Sink && !ResumeFrom && !SaveTo;
+	
+	SetupModelRun(DataSet, RunState, Sink, ResumeFrom, RunIncrementally ? &Incremental : nullptr);
+	
+	if(SaveTo)
+	{
+		if(SaveAtTimestep > DataSet->TimestepsLastRun)
+			FatalError("ERROR: Tried to make a checkpoint at timestep ", SaveAtTimestep, ", but the model run only has ", DataSet->TimestepsLastRun, " timesteps.\n");
+		DataSet->TimestepsLastRun = SaveAtTimestep; //NOTE: The run stops at the checkpoint.
+	}
+	
+	//NOTE: Set up parallel evaluation of independent index tuples (see EndModelDefinition) if we are allowed to use more than one thread.
+	//NOTE: The workers use their own random generators, so models that use random number generation in batch groups that are evaluated in parallel will not give the same results as a serial run.
+	size_t ThreadCount = DataSet->ThreadCount;
+#if MOBIUS_EQUATION_PROFILING || MOBIUS_TIMESTEP_VERBOSITY >= 2
+	ThreadCount = 1; //NOTE: The profiling counters and the printouts are not made to be used from several threads.
 #endif
-	RunState.Timestep = -1;
-	ModelLoop(DataSet, &RunState, InitialValueSetupInnerLoop);
-	//***********
+	if(ThreadCount > 1 && Prepared->SchedulerThreadCount != ThreadCount)
+	{
+		Prepared->Scheduler.reset(new parallel_scheduler);
+		SetupParallelScheduler(DataSet, RunState, Prepared->Scheduler.get(), ThreadCount);
+		Prepared->SchedulerThreadCount = ThreadCount;
+	}
+	parallel_scheduler *Scheduler = (ThreadCount > 1 && Prepared->Scheduler && Prepared->Scheduler->Active) ? Prepared->Scheduler.get() : nullptr;
+	
+	bool HoistEquations = RunState->Plan.HoistEquations;
+	
+	Prepared->SetupMicroseconds = GetTimerMicroseconds(&SetupTimer);
+	Prepared->ExecutionMicroseconds = 0;
 	
 #if MOBIUS_PRINT_TIMING_INFO
-	u64 SetupDuration = GetTimerMilliseconds(&SetupTimer);
 	u64 BeforeC = __rdtsc();
 #endif
 
 	timer RunTimer = BeginTimer();
 	
-	RunState.AllLastResultsBase = DataSet->ResultData;
-	RunState.AllCurResultsBase = DataSet->ResultData + DataSet->ResultStorageStructure.TotalCount;
-	RunState.AllCurInputsBase = DataSet->InputData + ((size_t)InputDataStartOffsetTimesteps)*DataSet->InputStorageStructure.TotalCount;
+	u64 Timesteps = DataSet->TimestepsLastRun;
 	
-#if MOBIUS_EQUATION_PROFILING
-	RunState.EquationHits        = RunState.BucketMemory.Allocate<size_t>(Model->Equations.Count());
-	RunState.EquationTotalCycles = RunState.BucketMemory.Allocate<u64>(Model->Equations.Count());
-#endif
-	
-	//TODO: Timesteps is u64. Can cause problems if somebody have an unrealistically high amount of timesteps. Ideally we should move every parameter from u64 to s64 anyway? There is a similar problem a little earlier in this routine.
+	//TODO: Timesteps is u64. Can cause problems if somebody have an unrealistically high amount of timesteps. Ideally we should move every parameter from u64 to s64 anyway? There is a similar problem in SetupModelRun.
 	s64 MaxStep = (s64)Timesteps;
 	
+	if(HoistEquations)
+		RunHoistedEquations(DataSet, RunState, Incremental.Active ? &Incremental : nullptr);
+	
 	//****** The main model run loop:
 	
-	for(RunState.Timestep = 0; RunState.Timestep < MaxStep; ++RunState.Timestep)
+	while(RunState->Timestep < MaxStep)
 	{
+		BeginTimestep(DataSet, RunState);
 		
-#if MOBIUS_TIMESTEP_VERBOSITY >= 1
-		WarningPrint("Timestep: ", RunState.Timestep, "\n");
-#endif
-		
-		RunState.AtResult           = RunState.AllCurResultsBase;
-		RunState.AtLastResult       = RunState.AllLastResultsBase;
-		
-		RunState.AtParameterLookup  = RunState.FastParameterLookup.Data;
-		RunState.AtInputLookup      = RunState.FastInputLookup.Data;
-		RunState.AtResultLookup     = RunState.FastResultLookup.Data;
-		RunState.AtLastResultLookup = RunState.FastLastResultLookup.Data;
-		
-		//NOTE: We have to update the inputs that don't depend on any index sets here, as that is not handled by the "fast lookup system".
-		if(DataSet->InputStorageStructure.Units.Count != 0 && DataSet->InputStorageStructure.Units[0].IndexSets.Count == 0)
-		{
-			for(input_h Input : DataSet->InputStorageStructure.Units[0].Handles)
-			{
-				size_t Offset = OffsetForHandle(DataSet->InputStorageStructure, Input);
-				RunState.CurInputs[Input.Handle] = RunState.AllCurInputsBase[Offset];
-			}
-		}
-		
-		ModelLoop(DataSet, &RunState, RunInnerLoop);
+		ModelLoop(DataSet, RunState, RunInnerLoop, Scheduler, Incremental.Active ? &Incremental : nullptr);
 		
-		RunState.AllLastResultsBase = RunState.AllCurResultsBase;
-		RunState.AllCurResultsBase += DataSet->ResultStorageStructure.TotalCount;
-		RunState.AllCurInputsBase  += DataSet->InputStorageStructure.TotalCount;
-		
-		RunState.CurrentTime.Advance();
+		EndTimestep(DataSet, RunState);
 		
 		if(MillisecondTimeout > 0)
 		{
 			s64 Ms = GetTimerMilliseconds(&RunTimer);
 			if(Ms > MillisecondTimeout)
+			{
+				Prepared->ExecutionMicroseconds = GetTimerMicroseconds(&RunTimer);
 				return false;
+			}
 		}
 	}
 	
+	Prepared->ExecutionMicroseconds = GetTimerMicroseconds(&RunTimer);
+	
 #if MOBIUS_PRINT_TIMING_INFO
 	u64 AfterC = __rdtsc();
 	
-	u64 RunDuration = GetTimerMilliseconds(&RunTimer);
 	u64 RunDurationCycles = AfterC - BeforeC;
 
-	WarningPrint("Model execution setup time: ", SetupDuration, " milliseconds\n");
-	WarningPrint("Model execution time: ", RunDuration, " milliseconds\n");
+	WarningPrint("Model execution setup time: ", Prepared->SetupMicroseconds / 1000, " milliseconds\n");
+	WarningPrint("Model execution time: ", Prepared->ExecutionMicroseconds / 1000, " milliseconds\n");
 	WarningPrint("Model execution processor cycles: ", RunDurationCycles, "\n");
 	WarningPrint("Average cycles per result instance including overhead: ", (RunDurationCycles / (Timesteps * DataSet->ResultStorageStructure.TotalCount)), "\n");
 	WarningPrint("(Note: one instance can be the result of several equation evaluations in the case of solvers)\n");
+	if(RunIncrementally)
+		WarningPrint("Incremental run: skipped ", DataSet->IncrementalRunReport.BatchGroupsSkipped, " of ", DataSet->IncrementalRunReport.BatchGroupCount, " batch groups (", DataSet->IncrementalRunReport.EvaluationsSkipped, " of ", DataSet->IncrementalRunReport.EvaluationCount, " result evaluations)\n");
+	if(HoistEquations)
+	{
+		hoisting_report Hoisting = GetHoistingReport(DataSet);
+		WarningPrint("Hoisted equations: ", Hoisting.HoistedEquations, " of ", Hoisting.EquationCount, " equations (", Hoisting.HoistedResults, " of ", Hoisting.ResultCount, " results per timestep) were evaluated before the run loop\n");
+		WarningPrint("Constant equations: ", Hoisting.ConstantEquations, " of these (", Hoisting.ConstantResults, " results) were evaluated only once per index tuple\n");
+	}
 #endif
 
 #if MOBIUS_EQUATION_PROFILING
-	PrintEquationProfiles(DataSet, &RunState);
+	PrintEquationProfiles(DataSet, RunState);
 #endif
 
+	if(RunIncrementally && DataSet->ResultWindow == 0)
+	{
+		DataSet->ParameterDataLastRun.assign(DataSet->ParameterData, DataSet->ParameterData + DataSet->ParameterStorageStructure.TotalCount);
+		DataSet->InputGenerationLastRun = Incremental.InputGeneration;
+	}
+
+	if(SaveTo)
+	{
+		SaveTo->ModelSignature = ModelStructureSignature(Model);
+		SaveTo->Time = RunState->CurrentTime.DateTime;
+		SaveTo->Results.assign(RunState->AllLastResultsBase, RunState->AllLastResultsBase + DataSet->ResultStorageStructure.TotalCount);
+		std::ostringstream RandomState;
+		RandomState << RunState->RandomGenerator;
+		SaveTo->RandomState = RandomState.str();
+	}
+	
+	if(DataSet->SeriesMajorResults)
+		TransposeResults(DataSet);
+	if(DataSet->CompressedResults.Active)
+		DataSet->CompressedResults.Bits.shrink_to_fit(); //NOTE: The compressed results grow by doubling during the run.
+	if(DataSet->MappedResults.Data)
+	{
+		((mapped_storage_header *)DataSet->MappedResults.Data)->Flag = 1; //NOTE: Marks that the results in the file are from a finished run, see OpenMappedStorage.
+		WriteMappedStorageHeaders(DataSet);
+	}
+
 	return true;
 }
+
+static bool
+RunModel(mobius_data_set *DataSet, s64 MillisecondTimeout=-1, const result_sink *Sink=nullptr)
+{
+	//NOTE: If a Sink is given, the results are passed to it as the run advances, and only the results selected with RecordResult (if any) can be read from the data set after the run. The memory use for results is then independent of the number of timesteps. If the run times out, the sink does not receive the last (partial) window.
+	return RunModel(DataSet, MillisecondTimeout, Sink, nullptr, nullptr, 0);
+}
+
+static prepared_run *
+PrepareModelRun(mobius_data_set *DataSet)
+{
+	/*
+		Sets up a run state for the data set that is kept between runs (see RunPreparedModel). A normal RunModel builds the fast lookup arrays and allocates the run state, the solver temporaries and the parallel scheduler every time. A prepared run does this once, and later runs only copy the current parameter values into the parameter lookup. Repeated runs then don't allocate any memory unless the number of timesteps changes (or the model has preprocessing steps or computed parameters that do). This holds for incremental runs too (see SetIncrementalRuns), except for the first one, which allocates the working storage of SetupIncrementalRun.
+		This is for calibration loops and other uses where the same data set is run many times with different parameter values. The index sets of the data set can not change while it is prepared, and the prepared run has to be deleted before the data set is.
+	*/
+	timer PrepareTimer = BeginTimer();
+	
+	if(!DataSet->ParameterData)
+		FatalError("ERROR: Tried to prepare a model run before the parameter values were set.\n");
+	
+	prepared_run *Prepared = new prepared_run(DataSet);
+	SetupResultStorageStructure(DataSet);
+	BuildFastLookup(DataSet, &Prepared->RunState);
+	
+	Prepared->PrepareMicroseconds = GetTimerMicroseconds(&PrepareTimer);
+	return Prepared;
+}
+
+static bool
+RunPreparedModel(prepared_run *Prepared, s64 MillisecondTimeout=-1)
+{
+	//NOTE: Runs the model of a data set that was prepared with PrepareModelRun. The results are the same as those of RunModel.
+	return RunModel(Prepared->DataSet, MillisecondTimeout, nullptr, nullptr, nullptr, 0, Prepared);
+}
+
+static void
+CheckCheckpointSupport(const mobius_model *Model)
+{
+	for(equation_h Equation : Model->Equations)
+	{
+		if(Model->Equations[Equation].AccessedByEarlierResult)
+			FatalError("ERROR: Checkpoints are not supported for the model \"", Model->Name, "\", since the equation \"", GetName(Model, Equation), "\" is accessed using EARLIER_RESULT, which needs the results of more than one earlier timestep.\n");
+	}
+}
+
+static bool
+RunModelToCheckpoint(mobius_data_set *DataSet, u64 Timestep, model_checkpoint *Checkpoint, s64 MillisecondTimeout=-1)
+{
+	/*
+		Runs the model for the given number of timesteps (counted from the start date), and saves the state of the run in Checkpoint. The run can then be continued from the checkpoint with RunModelFromCheckpoint, also with different parameter values, for instance to avoid repeating a long spin-up period.
+		The results of the run up to the checkpoint can be read from the data set as usual. The state consists of the results of the last timestep, the date and the random generator. The solvers do not keep state between timesteps, and the input data is looked up from the date.
+	*/
+	CheckCheckpointSupport(DataSet->Model);
+	
+	bool Finished = RunModel(DataSet, MillisecondTimeout, nullptr, nullptr, Checkpoint, Timestep);
+	if(!Finished)
+		Checkpoint->Results.clear(); //NOTE: The run timed out before it got to the checkpoint.
+	return Finished;
+}
+
+static bool
+RunModelFromCheckpoint(mobius_data_set *DataSet, const model_checkpoint *Checkpoint, s64 MillisecondTimeout=-1, const result_sink *Sink=nullptr)
+{
+	/*
+		Continues a model run from a checkpoint made by RunModelToCheckpoint. The run evaluates the timesteps of the run set up by the "Start date" and "End date" (or "Timesteps") parameters that come after the date of the checkpoint, and the results of the checkpoint take the place of the initial values. The results of the resumed run start at the date of the checkpoint.
+		The parameters of the data set are not changed, so later runs of the data set start at the "Start date" as usual. Continuing with the same parameter values gives exactly the same results as an uninterrupted run.
+	*/
+	const mobius_model *Model = DataSet->Model;
+	
+	CheckCheckpointSupport(Model);
+	if(Checkpoint->Results.empty())
+		FatalError("ERROR: Tried to resume a model run from an empty checkpoint.\n");
+	if(Checkpoint->ModelSignature != ModelStructureSignature(Model))
+		FatalError("ERROR: The checkpoint was made by a different model than \"", Model->Name, "\", or a different version of it.\n");
+	
+	return RunModel(DataSet, MillisecondTimeout, Sink, Checkpoint, nullptr, 0);
+}
+
+//NOTE: Checkpoints are serialized as an 8 byte identifier, the model signature (u64), the date (s64 seconds since epoch), the number of results (u64) and the results (double), and the length (u64) and text of the random generator state.
+static const char CheckpointIdentifier[8] = {'M', 'O', 'B', 'C', 'H', 'K', '0', '1'};
+
+template<typename T> inline void
+AppendBytes(std::vector<u8> &Data, const T *Values, size_t Count)
+{
+	const u8 *Bytes = (const u8 *)Values;
+	Data.insert(Data.end(), Bytes, Bytes + sizeof(T)*Count);
+}
+
+static void
+SerializeCheckpoint(const model_checkpoint *Checkpoint, std::vector<u8> &Data)
+{
+	Data.clear();
+	u64 ResultCount = Checkpoint->Results.size();
+	u64 RandomStateLength = Checkpoint->RandomState.size();
+	AppendBytes(Data, CheckpointIdentifier, sizeof(CheckpointIdentifier));
+	AppendBytes(Data, &Checkpoint->ModelSignature, 1);
+	AppendBytes(Data, &Checkpoint->Time.SecondsSinceEpoch, 1);
+	AppendBytes(Data, &ResultCount, 1);
+	AppendBytes(Data, Checkpoint->Results.data(), ResultCount);
+	AppendBytes(Data, &RandomStateLength, 1);
+	AppendBytes(Data, Checkpoint->RandomState.data(), RandomStateLength);
+}
+
+static void
+DeserializeCheckpoint(const u8 *Data, size_t Size, model_checkpoint *Checkpoint)
+{
+	size_t At = 0;
+	auto Read = [Data, Size, &At](void *Into, size_t Bytes)
+	{
+		if(At + Bytes > Size)
+			FatalError("ERROR: The checkpoint data is truncated or is not a checkpoint.\n");
+		memcpy(Into, Data + At, Bytes);
+		At += Bytes;
+	};
+	
+	char Identifier[sizeof(CheckpointIdentifier)];
+	Read(Identifier, sizeof(Identifier));
+	if(memcmp(Identifier, CheckpointIdentifier, sizeof(Identifier)) != 0)
+		FatalError("ERROR: The data is not a model checkpoint.\n");
+	
+	u64 ResultCount, RandomStateLength;
+	Read(&Checkpoint->ModelSignature, sizeof(u64));
+	Read(&Checkpoint->Time.SecondsSinceEpoch, sizeof(s64));
+	Read(&ResultCount, sizeof(u64));
+	if(ResultCount > (Size - At)/sizeof(double))
+		FatalError("ERROR: The checkpoint data is truncated or is not a checkpoint.\n");
+	Checkpoint->Results.resize(ResultCount);
+	Read(Checkpoint->Results.data(), sizeof(double)*ResultCount);
+	Read(&RandomStateLength, sizeof(u64));
+	if(RandomStateLength > Size - At)
+		FatalError("ERROR: The checkpoint data is truncated or is not a checkpoint.\n");
+	Checkpoint->RandomState.resize(RandomStateLength);
+	Read(&Checkpoint->RandomState[0], RandomStateLength);
+}
+
+
+struct ensemble_parameter
+{
+	const char *Name;
+	std::vector<const char *> Indexes;
+};
+
+enum ensemble_statistic
+{
+	EnsembleStatistic_Series = 0,  //NOTE: The entire series.
+	EnsembleStatistic_Mean,
+	EnsembleStatistic_Sum,
+	EnsembleStatistic_Min,
+	EnsembleStatistic_Max,
+	EnsembleStatistic_Last,
+	EnsembleStatistic_Count,
+};
+
+struct ensemble_context
+{
+	//NOTE: What one worker thread needs to run members. It is reused for every member the worker runs, also in later runs of the same ensemble, so that the run state of the members only has to be set up once (see PrepareModelRun).
+	std::unique_ptr<mobius_data_set> MemberDataSet;
+	std::unique_ptr<prepared_run>    Prepared;      //NOTE: Declared after MemberDataSet so that it is deleted before it.
+};
+
+struct model_ensemble
+{
+	mobius_data_set *DataSet;  //NOTE: The members start out with the parameter values of this data set and borrow its inputs, so it must not be deleted before the ensemble. If its index sets are changed, the ensemble has to be recreated.
+	
+	std::vector<size_t>             ParameterOffsets;  //NOTE: Where in the parameter storage the value of each ensemble parameter goes.
+	std::vector<parameter_h>        Parameters;
+	
+	std::vector<size_t>             ResultOffsets;     //NOTE: Where in (one timestep of) the result storage each requested result is.
+	std::vector<ensemble_statistic> ResultStatistics;
+	std::vector<result_recording>   ResultRecording;   //NOTE: The members only record the requested results (see RecordResult).
+	size_t SeriesCount     = 0;
+	size_t StatisticsCount = 0;
+	
+	thread_pool Pool;
+	std::vector<std::unique_ptr<ensemble_context>> Contexts;  //NOTE: One per worker thread. Created during the first run.
+};
+
+static model_ensemble *
+CreateEnsemble(mobius_data_set *DataSet, size_t ThreadCount = 0)
+{
+	//NOTE: If ThreadCount is 0, the ThreadCount of the data set is used.
+	if(!DataSet->ParameterData)
+	{
+		AllocateParameterStorage(DataSet);
+		WarningPrint("WARNING: No parameter values were specified, using default parameter values only.\n");
+	}
+	
+	model_ensemble *Ensemble = new model_ensemble {};
+	Ensemble->DataSet = DataSet;
+	Ensemble->Pool.Start(ThreadCount == 0 ? DataSet->ThreadCount : ThreadCount);
+	return Ensemble;
+}
+
+static void
+AddEnsembleParameter(model_ensemble *Ensemble, const char *Name, const char * const *Indexes, size_t IndexCount)
+{
+	//NOTE: Adds a parameter that varies between the members of the ensemble. The parameters are the columns of the parameter matrix in the order they were added.
+	mobius_data_set *DataSet = Ensemble->DataSet;
+	const mobius_model *Model = DataSet->Model;
+	
+	parameter_h Parameter = GetParameterHandle(Model, Name);
+	parameter_type Type = Model->Parameters[Parameter].Type;
+	if(Type == ParameterType_Time)
+		FatalError("ERROR: The parameter \"", Name, "\" is a date parameter, and it can not be varied in an ensemble run.\n");
+	if(strcmp(Name, "Timesteps") == 0)
+		FatalError("ERROR: The parameter \"Timesteps\" can not be varied in an ensemble run, since all the members have to run for the same number of timesteps.\n");
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Parameter, Indexes, IndexCount, DataSet->ParameterStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to set the value of the parameter \"", Name, "\" in an ensemble run, but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	Ensemble->ParameterOffsets.push_back(Offset);
+	Ensemble->Parameters.push_back(Parameter);
+}
+
+static void
+AddEnsembleResult(model_ensemble *Ensemble, const char *Name, const char * const *Indexes, size_t IndexCount, ensemble_statistic Statistic)
+{
+	//NOTE: Requests a result series (or a statistic of it) from each member. The series and the statistics are output separately, each in the order they were added.
+	mobius_data_set *DataSet = Ensemble->DataSet;
+	const mobius_model *Model = DataSet->Model;
+	
+	if((u32)Statistic >= (u32)EnsembleStatistic_Count)
+		FatalError("ERROR: Unknown statistic for the ensemble result \"", Name, "\".\n");
+	
+	equation_h Equation = GetEquationHandle(Model, Name);
+	if(Model->Equations[Equation].Type == EquationType_InitialValue)
+		FatalError("ERROR: Can not get the result series of the equation \"", Name, "\", because it is an initial value equation.\n");
+	
+	SetupResultStorageStructure(DataSet);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Equation, Indexes, IndexCount, DataSet->ResultStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to get the result series of the equation \"", Name, "\" from an ensemble run, but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	
+	Ensemble->ResultOffsets.push_back(Offset);
+	Ensemble->ResultStatistics.push_back(Statistic);
+	Ensemble->ResultRecording.push_back(GetResultRecording(DataSet, Name, Indexes, IndexCount));
+	if(Statistic == EnsembleStatistic_Series) ++Ensemble->SeriesCount;
+	else                                      ++Ensemble->StatisticsCount;
+}
+
+static void
+RunEnsembleMember(model_ensemble *Ensemble, ensemble_context *Context, const double *ParameterMatrix, size_t Member, u64 Timesteps, const std::function<void(size_t Member, mobius_data_set *MemberDataSet)> &MemberFinished)
+{
+	mobius_data_set *DataSet = Ensemble->DataSet;
+	mobius_data_set *MemberDataSet = Context->MemberDataSet.get();
+	size_t ParameterCount = Ensemble->ParameterOffsets.size();
+	
+	//NOTE: Reset the parameters of the member data set, since the computed parameters and the values of the previous member have to be overwritten.
+	memcpy(MemberDataSet->ParameterData, DataSet->ParameterData, sizeof(parameter_value)*DataSet->ParameterStorageStructure.TotalCount);
+	const double *Row = ParameterMatrix + Member*ParameterCount;
+	for(size_t ParIdx = 0; ParIdx < ParameterCount; ++ParIdx)
+		MemberDataSet->ParameterData[Ensemble->ParameterOffsets[ParIdx]] = ParameterValueFromDouble(DataSet->Model, Ensemble->Parameters[ParIdx], Row[ParIdx]);
+	
+	RunModel(MemberDataSet, -1, nullptr, nullptr, nullptr, 0, Context->Prepared.get());
+	assert(MemberDataSet->TimestepsLastRun == Timesteps); //NOTE: The parameters that decide the number of timesteps can not be ensemble parameters, see AddEnsembleParameter.
+	
+	MemberFinished(Member, MemberDataSet);
+}
+
+static void
+RunModelEnsemble(model_ensemble *Ensemble, const double *ParameterMatrix, size_t MemberCount, const std::function<void(size_t Member, mobius_data_set *MemberDataSet)> &MemberFinished)
+{
+	/*
+		Runs the model once for each of MemberCount parameter sets. The parameter sets only differ from the parameters of the data set of the ensemble in the values of the ensemble parameters. ParameterMatrix is row-major with one row per member and one column per ensemble parameter (values for integer, enum and boolean parameters are converted from double, see ParameterValueFromDouble).
+		
+		The members are divided between the worker threads of the ensemble. Each worker has one data set that borrows the inputs of the data set of the ensemble, and a prepared run of it (see PrepareModelRun) that it reuses for every member it runs. The members are run with the normal run loop, so the run plan, hoisted and constant equations and (if enabled on the data set) incremental runs apply as in RunModel. With incremental runs, only the batch groups that depend on the ensemble parameters are reevaluated for each member.
+		
+		MemberFinished is called (from the worker thread that ran the member) with the data set of a member after the member is finished. The results of the member can be read from this data set, but the data set is reused for later members, so the results have to be copied out if they are needed after MemberFinished returns. If results were added to the ensemble with AddEnsembleResult, only those results are recorded for the members.
+		
+		NOTE: Parallel evaluation of batch groups is not used in ensemble runs, since the workers already run one member each.
+	*/
+	
+	if(MemberCount == 0) return;
+	
+	mobius_data_set *DataSet = Ensemble->DataSet;
+	u64 Timesteps = GetTimesteps(DataSet);
+	
+	//NOTE: Check all the parameter values before the run, since errors can not be reported from the worker threads. This includes the checks RunModel would do on the parameter values, i.e. that solver steps are in (0,1]. The number of timesteps is the same for every member (see AddEnsembleParameter), and the inputs are shared, so the other checks of RunModel give the same outcome for every member as for the data set of the ensemble.
+	const mobius_model *Model = DataSet->Model;
+	size_t ParameterCount = Ensemble->Parameters.size();
+	std::vector<const char *> SolverOfParameter(ParameterCount, nullptr);
+	for(solver_h Solver : Model->Solvers)
+	{
+		const solver_spec &SolverSpec = Model->Solvers[Solver];
+		for(size_t ParIdx = 0; ParIdx < ParameterCount; ++ParIdx)
+			if(IsValid(SolverSpec.hParam) && SolverSpec.hParam == Ensemble->Parameters[ParIdx]) SolverOfParameter[ParIdx] = SolverSpec.Name;
+	}
+	for(size_t Member = 0; Member < MemberCount; ++Member)
+	{
+		for(size_t ParIdx = 0; ParIdx < ParameterCount; ++ParIdx)
+		{
+			double Value = ParameterMatrix[Member*ParameterCount + ParIdx];
+			ParameterValueFromDouble(Model, Ensemble->Parameters[ParIdx], Value);
+			if(SolverOfParameter[ParIdx] && !(Value > 0.0 && Value <= 1.0))
+				FatalError("ERROR: The solver \"", SolverOfParameter[ParIdx], "\" was given a step that is not in the range (0,1] for member ", Member, " of the ensemble.\n");
+		}
+	}
+	
+	if(Ensemble->Contexts.empty())
+	{
+		Ensemble->Contexts.resize(Ensemble->Pool.WorkerCount);
+		for(auto &Context : Ensemble->Contexts)
+		{
+			Context.reset(new ensemble_context());
+			mobius_data_set *MemberDataSet = CopyDataSet(DataSet, false, true);
+			MemberDataSet->SinglePrecisionResults = false; //NOTE: The results of a member are only kept until it is finished, and the ensemble reads them with ResultSeriesLocation.
+			MemberDataSet->CompressResults        = false;
+			MemberDataSet->ThreadCount            = 1;
+			if(!Ensemble->ResultRecording.empty())
+				MemberDataSet->ResultRecording = Ensemble->ResultRecording;
+			Context->MemberDataSet.reset(MemberDataSet);
+			Context->Prepared.reset(PrepareModelRun(MemberDataSet));
+		}
+	}
+	
+	std::atomic<size_t> NextMember(0);
+	
+	Ensemble->Pool.Run([&](size_t WorkerIdx)
+	{
+		ensemble_context *Context = Ensemble->Contexts[WorkerIdx].get();
+		while(true)
+		{
+			size_t Member = NextMember.fetch_add(1);
+			if(Member >= MemberCount) break;
+			RunEnsembleMember(Ensemble, Context, ParameterMatrix, Member, Timesteps, MemberFinished);
+		}
+	});
+}
+
+static void
+RunModelEnsemble(model_ensemble *Ensemble, const double *ParameterMatrix, size_t MemberCount, double *SeriesOut, double *StatisticsOut)
+{
+	//NOTE: Runs the ensemble, and writes the requested result series to SeriesOut (MemberCount x SeriesCount x Timesteps values) and the requested statistics to StatisticsOut (MemberCount x StatisticsCount values). Either can be null if no results of that kind were requested.
+	size_t Timesteps = (size_t)GetTimesteps(Ensemble->DataSet);
+	
+	RunModelEnsemble(Ensemble, ParameterMatrix, MemberCount,
+	[Ensemble, SeriesOut, StatisticsOut, Timesteps](size_t Member, mobius_data_set *MemberDataSet)
+	{
+		size_t SeriesIdx = 0;
+		size_t StatisticIdx = 0;
+		for(size_t ResultIdx = 0; ResultIdx < Ensemble->ResultOffsets.size(); ++ResultIdx)
+		{
+			size_t Stride = 0;
+			const double *Lookup = ResultSeriesLocation(MemberDataSet, Ensemble->ResultOffsets[ResultIdx], &Stride);
+			assert(Lookup); //NOTE: The members record all the results that were added to the ensemble, see RunModelEnsemble.
+			Lookup += Stride; //NOTE: Skip the initial values.
+			ensemble_statistic Statistic = Ensemble->ResultStatistics[ResultIdx];
+			
+			if(Statistic == EnsembleStatistic_Series)
+			{
+				double *WriteTo = SeriesOut + (Member*Ensemble->SeriesCount + SeriesIdx)*Timesteps;
+				for(size_t Timestep = 0; Timestep < Timesteps; ++Timestep, Lookup += Stride)
+					WriteTo[Timestep] = *Lookup;
+				++SeriesIdx;
+				continue;
+			}
+			
+			double Value = 0.0;
+			if(Statistic == EnsembleStatistic_Min)      Value = DBL_MAX;
+			else if(Statistic == EnsembleStatistic_Max) Value = -DBL_MAX;
+			for(size_t Timestep = 0; Timestep < Timesteps; ++Timestep, Lookup += Stride)
+			{
+				double X = *Lookup;
+				if(Statistic == EnsembleStatistic_Min)      Value = Min(Value, X);
+				else if(Statistic == EnsembleStatistic_Max) Value = Max(Value, X);
+				else if(Statistic == EnsembleStatistic_Last) Value = X;
+				else                                        Value += X;
+			}
+			if(Statistic == EnsembleStatistic_Mean && Timesteps > 0) Value /= (double)Timesteps;
+			
+			StatisticsOut[Member*Ensemble->StatisticsCount + StatisticIdx] = Value;
+			++StatisticIdx;
+		}
+	});
+}
+
+inline void
+RunModelEnsemble(mobius_data_set *DataSet, const std::vector<ensemble_parameter> &Parameters, const double *ParameterMatrix, size_t MemberCount, const std::function<void(size_t Member, mobius_data_set *MemberDataSet)> &MemberFinished)
+{
+	//NOTE: Convenience version for a one-off ensemble run that uses the ThreadCount of the data set.
+	std::unique_ptr<model_ensemble> Ensemble(CreateEnsemble(DataSet));
+	for(const ensemble_parameter &Par : Parameters)
+		AddEnsembleParameter(Ensemble.get(), Par.Name, Par.Indexes.data(), Par.Indexes.size());
+	RunModelEnsemble(Ensemble.get(), ParameterMatrix, MemberCount, MemberFinished);
+}
@@ -4,6 +4,17 @@
 #include <chrono>
 #include <ctime>
 
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+#if !defined(_WIN32)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
 inline void *
 AllocClearedArray_(size_t ElementSize, size_t ArrayLen)
 {
@@ -47,6 +58,172 @@ GetTimerMilliseconds(timer *Timer)
 	return (u64)Ms;
 }
 
+inline u64
+GetTimerMicroseconds(timer *Timer)
+{
+	auto End = std::chrono::high_resolution_clock::now();
+	return (u64)std::chrono::duration_cast<std::chrono::microseconds>(End - Timer->Begin).count();
+}
+
+inline int
+CountLeadingZeros64(u64 Value)
+{
+	//NOTE: Value can not be 0.
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanReverse64(&Index, Value);
+	return 63 - (int)Index;
+#else
+	return __builtin_clzll(Value);
+#endif
+}
+
+inline int
+CountTrailingZeros64(u64 Value)
+{
+	//NOTE: Value can not be 0.
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward64(&Index, Value);
+	return (int)Index;
+#else
+	return __builtin_ctzll(Value);
+#endif
+}
+
+
+struct mapped_file
+{
+	//NOTE: A file that is mapped into memory, see OpenMappedFile.
+	u8     *Data;
+	size_t  Size;
+	bool    CopyOnWrite;  //NOTE: If this is set, changes to the mapped memory are not written to the file.
+#if defined(_WIN32)
+	HANDLE  File;
+	HANDLE  Mapping;
+#else
+	int     File;
+#endif
+};
+
+static void
+CloseMappedFile(mapped_file *Mapped)
+{
+	if(!Mapped->Data) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(Mapped->Data);
+	CloseHandle(Mapped->Mapping);
+	CloseHandle(Mapped->File);
+#else
+	munmap(Mapped->Data, Mapped->Size);
+	close(Mapped->File);
+#endif
+	*Mapped = {};
+}
+
+static bool
+OpenMappedFile(mapped_file *Mapped, const char *Filename, size_t Size, bool Create, bool CopyOnWrite = false)
+{
+	//NOTE: Maps the file Filename for reading and writing. The changes that are made to the mapped memory are written back to the file by the operating system, and the file can be larger than the physical memory. If Create is set, the file is created (or truncated) and given the size Size with all bytes cleared to 0. Otherwise an existing file is mapped with the size it has, and false is returned if it could not be opened.
+	//  If CopyOnWrite is set, an existing file is only opened for reading, and the pages that are changed in memory get private copies instead of being written back.
+	CloseMappedFile(Mapped);
+	if(Create) CopyOnWrite = false;
+	
+#if defined(_WIN32)
+	std::u16string Filename16 = std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t>{}.from_bytes(Filename);
+	DWORD Access = CopyOnWrite ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE);
+	HANDLE File = CreateFileW((wchar_t *)Filename16.data(), Access, FILE_SHARE_READ, nullptr, Create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(File == INVALID_HANDLE_VALUE)
+	{
+		if(Create) FatalError("ERROR: Could not create the file \"", Filename, "\".\n");
+		return false;
+	}
+	if(!Create)
+	{
+		LARGE_INTEGER FileSize;
+		GetFileSizeEx(File, &FileSize);
+		Size = (size_t)FileSize.QuadPart;
+	}
+	HANDLE Mapping = nullptr;
+	void *Data = nullptr;
+	if(Size != 0)
+	{
+		//NOTE: Creating a mapping that is larger than the file extends the file, and the new part of it reads as 0.
+		Mapping = CreateFileMappingW(File, nullptr, CopyOnWrite ? PAGE_WRITECOPY : PAGE_READWRITE, (DWORD)((u64)Size >> 32), (DWORD)((u64)Size & 0xffffffff), nullptr);
+		if(Mapping) Data = MapViewOfFile(Mapping, CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS, 0, 0, Size);
+	}
+	if(!Data)
+	{
+		if(Mapping) CloseHandle(Mapping);
+		CloseHandle(File);
+		FatalError("ERROR: Could not map the file \"", Filename, "\" into memory.\n");
+	}
+	Mapped->File    = File;
+	Mapped->Mapping = Mapping;
+#else
+	int File = open(Filename, Create ? (O_RDWR | O_CREAT | O_TRUNC) : (CopyOnWrite ? O_RDONLY : O_RDWR), 0644);
+	if(File < 0)
+	{
+		if(Create) FatalError("ERROR: Could not create the file \"", Filename, "\".\n");
+		return false;
+	}
+	if(Create)
+	{
+		if(ftruncate(File, (off_t)Size) != 0)
+		{
+			close(File);
+			FatalError("ERROR: Could not give the file \"", Filename, "\" a size of ", Size, " bytes.\n");
+		}
+	}
+	else
+	{
+		struct stat Stat;
+		fstat(File, &Stat);
+		Size = (size_t)Stat.st_size;
+	}
+	void *Data = (Size != 0) ? mmap(nullptr, Size, PROT_READ | PROT_WRITE, CopyOnWrite ? MAP_PRIVATE : MAP_SHARED, File, 0) : MAP_FAILED;
+	if(Data == MAP_FAILED)
+	{
+		close(File);
+		FatalError("ERROR: Could not map the file \"", Filename, "\" into memory.\n");
+	}
+	Mapped->File = File;
+#endif
+	Mapped->Data        = (u8 *)Data;
+	Mapped->Size        = Size;
+	Mapped->CopyOnWrite = CopyOnWrite;
+	return true;
+}
+
+inline void
+AdviseSequentialAccess(mapped_file *Mapped)
+{
+	//NOTE: Tells the operating system that the file is read and written from the start to the end, so that it reads ahead of the accesses and drops pages behind them early.
+#if !defined(_WIN32) && defined(MADV_SEQUENTIAL)
+	madvise(Mapped->Data, Mapped->Size, MADV_SEQUENTIAL);
+#endif
+}
+
+static size_t
+ReleaseMappedRange(mapped_file *Mapped, size_t From, size_t To)
+{
+	//NOTE: Tells the operating system that the bytes From to To of a mapped file will not be accessed again soon, so that the memory they use can be given to other pages. Changes that were made to them are not lost, they are still written back to the file. Only whole pages are released, and the return value is where the released pages end (or From if none were).
+#if defined(_WIN32)
+	size_t PageSize = 4096;
+#else
+	size_t PageSize = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+	From = ((From + PageSize - 1) / PageSize) * PageSize;
+	To   = (To / PageSize) * PageSize;
+	if(To <= From || To > Mapped->Size) return From;
+#if defined(_WIN32)
+	VirtualUnlock(Mapped->Data + From, To - From); //NOTE: Unlocking pages that are not locked removes them from the working set of the process.
+#elif defined(MADV_DONTNEED)
+	madvise(Mapped->Data + From, To - From, MADV_DONTNEED);
+#endif
+	return To;
+}
+
 
 bool IsIdentifier(const char *Name)
 {
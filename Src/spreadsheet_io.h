@@ -936,7 +936,7 @@ ReadInputsFromSpreadsheet(mobius_data_set *DataSet, const char *Inputfile)
 			//NOTE: We currently don't support setting multiple dataset series per excel column. Hence only one offset is passed to each Reader.
 			Readers.push_back(
 				mobius_input_reader	(
-					DataSet->InputData, DataSet->InputStorageStructure.TotalCount, Flags[Idx],
+					DataSet->InputData, DataSet->SingleInputData, DataSet->InputStorageStructure.TotalCount, Flags[Idx],
 					DataSet->Model->TimestepSize, {Offsets[Idx]}, GetInputStartDate(DataSet), DataSet->InputDataTimesteps, HandleError)
 			);
 		}
@@ -966,6 +966,7 @@ ReadInputsFromSpreadsheet(mobius_data_set *DataSet, const char *Inputfile)
 		
 		OLEDestroyMatrix(&Matrix);
 	}
+	InputsChanged(DataSet);
 	
 	
 	OLECloseSpreadsheet(&Handles);
@@ -0,0 +1,142 @@
+
+/*
+	Very simple thread pool used by the model run to evaluate independent parts of a batch group concurrently.
+
+	The pool does not have a task queue. Instead Run() hands the same job to every worker (including the calling thread, which acts as worker 0), and returns when all of them have returned from it. The job itself is responsible for dividing up the work, typically by having each worker pull work items from a shared atomic counter until there are none left.
+
+	If a job throws (e.g. because FatalError was overridden to throw, as it is in the dll), the first exception is rethrown on the calling thread once all workers are done.
+*/
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+struct thread_pool
+{
+	size_t WorkerCount = 1;     //NOTE: Including the thread that calls Run().
+
+	void Start(size_t WorkerCount);
+	void Run(const std::function<void(size_t WorkerIdx)> &Job);
+	void Stop();
+
+	~thread_pool() { Stop(); }
+
+private:
+	std::vector<std::thread> Threads;
+	std::mutex               Mutex;
+	std::condition_variable  WorkAvailable;
+	std::condition_variable  WorkDone;
+
+	const std::function<void(size_t)> *Job = nullptr;
+	u64    Generation    = 0;
+	size_t StillRunning  = 0;
+	bool   Quit          = false;
+	std::exception_ptr Exception;
+
+	void WorkerLoop(size_t WorkerIdx, u64 LastGeneration);
+	void RunJob(size_t WorkerIdx);
+};
+
+void
+thread_pool::Start(size_t WorkerCount)
+{
+	Stop();
+
+	if(WorkerCount == 0) WorkerCount = 1;
+	this->WorkerCount = WorkerCount;
+
+	//NOTE: Generation keeps counting across restarts of the pool, so the new workers start from its current value and only wake up for a Run that comes after this.
+	u64 StartGeneration;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Quit = false;
+		StartGeneration = Generation;
+	}
+
+	for(size_t WorkerIdx = 1; WorkerIdx < WorkerCount; ++WorkerIdx)
+		Threads.push_back(std::thread(&thread_pool::WorkerLoop, this, WorkerIdx, StartGeneration));
+}
+
+void
+thread_pool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Quit = true;
+	}
+	WorkAvailable.notify_all();
+	for(std::thread &Thread : Threads)
+		Thread.join();
+	Threads.clear();
+	WorkerCount = 1;
+}
+
+void
+thread_pool::RunJob(size_t WorkerIdx)
+{
+	try
+	{
+		(*Job)(WorkerIdx);
+	}
+	catch(...)
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		if(!Exception) Exception = std::current_exception();
+	}
+}
+
+void
+thread_pool::WorkerLoop(size_t WorkerIdx, u64 LastGeneration)
+{
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			WorkAvailable.wait(Lock, [this, LastGeneration](){ return Quit || Generation != LastGeneration; });
+			if(Quit) return;
+			LastGeneration = Generation;
+		}
+
+		RunJob(WorkerIdx);
+
+		bool Last;
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Last = (--StillRunning == 0);
+		}
+		if(Last) WorkDone.notify_one();
+	}
+}
+
+void
+thread_pool::Run(const std::function<void(size_t WorkerIdx)> &Job)
+{
+	if(Threads.empty())
+	{
+		Job(0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		this->Job    = &Job;
+		StillRunning = Threads.size();
+		Exception    = nullptr;
+		++Generation;
+	}
+	WorkAvailable.notify_all();
+
+	RunJob(0);
+
+	std::exception_ptr Rethrow;
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		WorkDone.wait(Lock, [this](){ return StillRunning == 0; });
+		this->Job = nullptr;
+		Rethrow = Exception;
+		Exception = nullptr;
+	}
+	if(Rethrow) std::rethrow_exception(Rethrow);
+}
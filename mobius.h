@@ -20,6 +20,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <functional>
+#include <new>
+#include <memory>
 #include <algorithm>
 #include <vector>
 #include <unordered_map>
@@ -97,6 +99,7 @@ WarningPrint(t Value, v... Tail)
 #include "Src/mobius_math.h"
 #include "Src/mobius_util.h"
 #include "Src/bucket_allocator.h"
+#include "Src/thread_pool.h"
 #include "Src/token_string.h"
 #include "Src/datetime.h"
 #include "Src/mobius_model.h"
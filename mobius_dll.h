@@ -72,21 +72,40 @@ DllEncounteredWarning(char *WarningmsgOut, u64 BufferLen)
 mobius_model *
 DllBuildModel();
 
-DLLEXPORT void *
-DllSetupModel(char *ParameterFilename, char *InputFilename)
+DLLEXPORT void
+DllSetFileCacheDirectory(char *Directory)
 {
 	CHECK_ERROR_BEGIN
 	
-	mobius_model *Model = DllBuildModel();
+	SetFileCacheDirectory(Directory);
 	
-	ReadInputDependenciesFromFile(Model, InputFilename);
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllGetFileCacheStatistics(s64 *StatisticsOut)
+{
+	CHECK_ERROR_BEGIN
 	
-	EndModelDefinition(Model);
+	//NOTE: Writes the number of lookups, the number of hits, and the microseconds spent parsing on misses, spent loading on hits, and saved by the hits.
+	file_cache_statistics Statistics = GetFileCacheStatistics();
+	StatisticsOut[0] = (s64)Statistics.Lookups;
+	StatisticsOut[1] = (s64)Statistics.Hits;
+	StatisticsOut[2] = (s64)Statistics.ParseMicroseconds;
+	StatisticsOut[3] = (s64)Statistics.LoadMicroseconds;
+	StatisticsOut[4] = Statistics.SavedMicroseconds;
 	
-	mobius_data_set *DataSet = GenerateDataSet(Model);
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void *
+DllSetupModel(char *ParameterFilename, char *InputFilename)
+{
+	CHECK_ERROR_BEGIN
 	
-	ReadParametersFromFile(DataSet, ParameterFilename);
-	ReadInputsFromFile(DataSet, InputFilename);
+	mobius_model *Model = DllBuildModel();
+	
+	mobius_data_set *DataSet = SetupDataSetFromFiles(Model, ParameterFilename, InputFilename);
 	
 	//NOTE: This makes some functionality in MobiView more convenient. Without this it can't read the storage structure of the results before the model is run.
 	SetupResultStorageStructure(DataSet);
@@ -159,7 +178,7 @@ DllSetInputSpan(void *DataSetPtr, char *StartDate, char *EndDate)
 	CHECK_ERROR_BEGIN
 	
 	mobius_data_set *DataSet = (mobius_data_set *)DataSetPtr;
-	if(DataSet->InputData)
+	if(InputStorageIsAllocated(DataSet))
 		FatalError("Tried to set date range for inputs after input data was allocated.\n");
 	
 	bool Success;
@@ -275,6 +294,467 @@ DllRunModel(void *DataSetPtr, s64 MillisecondTimeout)
 	return false;
 }
 
+DLLEXPORT u64
+DllAddObjective(void *DataSetPtr, char *ResultName, char **ResultIndexes, u64 ResultIndexCount, char *InputName, char **InputIndexes, u64 InputIndexCount, u64 SkipTimesteps)
+{
+	CHECK_ERROR_BEGIN
+	
+	return (u64)AddObjective((mobius_data_set *)DataSetPtr, ResultName, ResultIndexes, (size_t)ResultIndexCount, InputName, InputIndexes, (size_t)InputIndexCount, SkipTimesteps);
+	
+	CHECK_ERROR_END
+	
+	return 0;
+}
+
+DLLEXPORT void
+DllClearObjectives(void *DataSetPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	ClearObjectives((mobius_data_set *)DataSetPtr);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT u64
+DllGetObjectiveCount(void *DataSetPtr)
+{
+	return (u64)((mobius_data_set *)DataSetPtr)->Objectives.size();
+}
+
+DLLEXPORT bool
+DllRunModelWithObjectives(void *DataSetPtr, s64 MillisecondTimeout, double *StatisticsOut)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: Runs the model and writes ObjectiveStatistic_Count statistics per objective (see AddObjective) to StatisticsOut.
+	mobius_data_set *DataSet = (mobius_data_set *)DataSetPtr;
+	bool Finished = RunModel(DataSet, MillisecondTimeout);
+	for(size_t ObjectiveIdx = 0; ObjectiveIdx < DataSet->Objectives.size(); ++ObjectiveIdx)
+		memcpy(StatisticsOut + ObjectiveIdx*ObjectiveStatistic_Count, GetObjectiveStatistics(DataSet, ObjectiveIdx), sizeof(double)*ObjectiveStatistic_Count);
+	return Finished;
+	
+	CHECK_ERROR_END
+	
+	return false;
+}
+
+typedef void (*dll_result_receiver)(u64 FirstRow, u64 RowCount, u64 ValuesPerRow, const double *Results);
+
+DLLEXPORT bool
+DllRunModelWithSink(void *DataSetPtr, s64 MillisecondTimeout, u64 WindowSize, dll_result_receiver Receiver)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: The Results pointer passed to the Receiver is only valid until it returns.
+	result_sink Sink;
+	Sink.WindowSize = (size_t)WindowSize;
+	Sink.Receive = [Receiver](mobius_data_set *DataSet, const double *Results, u64 FirstRow, size_t RowCount)
+	{
+		Receiver(FirstRow, (u64)RowCount, (u64)DataSet->ResultStorageStructure.TotalCount, Results);
+	};
+	return RunModel((mobius_data_set *)DataSetPtr, MillisecondTimeout, &Sink);
+	
+	CHECK_ERROR_END
+	
+	return false;
+}
+
+DLLEXPORT bool
+DllRunModelToBinaryFile(void *DataSetPtr, char *Filename, u64 WindowSize, s64 MillisecondTimeout)
+{
+	CHECK_ERROR_BEGIN
+	
+	return RunModelToBinaryFile((mobius_data_set *)DataSetPtr, Filename, (size_t)WindowSize, MillisecondTimeout);
+	
+	CHECK_ERROR_END
+	
+	return false;
+}
+
+DLLEXPORT u64
+DllGetResultOffset(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: The position of a result series within one timestep (row) of results, as they are passed to result sinks and written to binary result files.
+	mobius_data_set *DataSet = (mobius_data_set *)DataSetPtr;
+	equation_h Equation = GetEquationHandle(DataSet->Model, Name);
+	SetupResultStorageStructure(DataSet);
+	
+	int Error;
+	size_t Offset = GetOffset(DataSet, Equation, IndexNames, (size_t)IndexCount, DataSet->ResultStorageStructure, &Error);
+	if(Error >= 0)
+		FatalError("ERROR: Tried to get the offset of the result series of the equation \"", Name, "\", but an incorrect number of indexes were provided. Got ", IndexCount, ", expected ", Error, ".\n");
+	return (u64)Offset;
+	
+	CHECK_ERROR_END
+	
+	return 0;
+}
+
+DLLEXPORT void *
+DllCreateEnsemble(void *DataSetPtr, u64 ThreadCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	return (void *)CreateEnsemble((mobius_data_set *)DataSetPtr, (size_t)ThreadCount);
+	
+	CHECK_ERROR_END
+	
+	return 0;
+}
+
+DLLEXPORT void
+DllEnsembleAddParameter(void *EnsemblePtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	AddEnsembleParameter((model_ensemble *)EnsemblePtr, Name, IndexNames, (size_t)IndexCount);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllEnsembleAddResult(void *EnsemblePtr, char *Name, char **IndexNames, u64 IndexCount, u64 Statistic)
+{
+	CHECK_ERROR_BEGIN
+	
+	AddEnsembleResult((model_ensemble *)EnsemblePtr, Name, IndexNames, (size_t)IndexCount, (ensemble_statistic)Statistic);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllRunEnsemble(void *EnsemblePtr, u64 MemberCount, double *ParameterMatrix, double *SeriesOut, double *StatisticsOut)
+{
+	CHECK_ERROR_BEGIN
+	
+	RunModelEnsemble((model_ensemble *)EnsemblePtr, ParameterMatrix, (size_t)MemberCount, SeriesOut, StatisticsOut);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllDeleteEnsemble(void *EnsemblePtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	delete (model_ensemble *)EnsemblePtr;
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void *
+DllCreateSeriesBatch(void *DataSetPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	series_batch *Batch = new series_batch {};
+	Batch->DataSet = (mobius_data_set *)DataSetPtr;
+	return (void *)Batch;
+	
+	CHECK_ERROR_END
+	
+	return 0;
+}
+
+DLLEXPORT void
+DllBatchAddResult(void *BatchPtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	AddBatchResult((series_batch *)BatchPtr, Name, IndexNames, (size_t)IndexCount);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllBatchAddInput(void *BatchPtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	AddBatchInput((series_batch *)BatchPtr, Name, IndexNames, (size_t)IndexCount);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllBatchAddParameter(void *BatchPtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	AddBatchParameter((series_batch *)BatchPtr, Name, IndexNames, (size_t)IndexCount);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllBatchGetResults(void *BatchPtr, double *WriteTo, u64 Timesteps)
+{
+	CHECK_ERROR_BEGIN
+	
+	GetBatchResults((series_batch *)BatchPtr, WriteTo, (size_t)Timesteps);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllBatchSetParameters(void *BatchPtr, double *Values)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetBatchParameters((series_batch *)BatchPtr, Values);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllBatchSetInputs(void *BatchPtr, double *Values, u64 Length, bool AlignWithResults)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetBatchInputs((series_batch *)BatchPtr, Values, (size_t)Length, AlignWithResults);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllDeleteSeriesBatch(void *BatchPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	delete (series_batch *)BatchPtr;
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void *
+DllPrepareRun(void *DataSetPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	return (void *)PrepareModelRun((mobius_data_set *)DataSetPtr);
+	
+	CHECK_ERROR_END
+	
+	return 0;
+}
+
+DLLEXPORT bool
+DllRunPrepared(void *PreparedPtr, s64 MillisecondTimeout)
+{
+	CHECK_ERROR_BEGIN
+	
+	return RunPreparedModel((prepared_run *)PreparedPtr, MillisecondTimeout);
+	
+	CHECK_ERROR_END
+	
+	return false;
+}
+
+DLLEXPORT void
+DllGetPreparedRunTiming(void *PreparedPtr, u64 *TimingOut)
+{
+	//NOTE: Writes the time in microseconds that the preparation took, and that the last run took to set up and to run the timesteps.
+	prepared_run *Prepared = (prepared_run *)PreparedPtr;
+	TimingOut[0] = Prepared->PrepareMicroseconds;
+	TimingOut[1] = Prepared->SetupMicroseconds;
+	TimingOut[2] = Prepared->ExecutionMicroseconds;
+}
+
+DLLEXPORT void
+DllDeletePreparedRun(void *PreparedPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	delete (prepared_run *)PreparedPtr;
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void *
+DllRunModelToCheckpoint(void *DataSetPtr, u64 Timestep, s64 MillisecondTimeout)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: Returns null if the run timed out before it got to the checkpoint.
+	std::unique_ptr<model_checkpoint> Checkpoint(new model_checkpoint());
+	if(RunModelToCheckpoint((mobius_data_set *)DataSetPtr, Timestep, Checkpoint.get(), MillisecondTimeout))
+		return (void *)Checkpoint.release();
+	
+	CHECK_ERROR_END
+	
+	return nullptr;
+}
+
+DLLEXPORT bool
+DllRunModelFromCheckpoint(void *DataSetPtr, void *CheckpointPtr, s64 MillisecondTimeout)
+{
+	CHECK_ERROR_BEGIN
+	
+	return RunModelFromCheckpoint((mobius_data_set *)DataSetPtr, (model_checkpoint *)CheckpointPtr, MillisecondTimeout);
+	
+	CHECK_ERROR_END
+	
+	return false;
+}
+
+DLLEXPORT u64
+DllGetCheckpointSize(void *CheckpointPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	std::vector<u8> Data;
+	SerializeCheckpoint((model_checkpoint *)CheckpointPtr, Data);
+	return (u64)Data.size();
+	
+	CHECK_ERROR_END
+	
+	return 0;
+}
+
+DLLEXPORT void
+DllSerializeCheckpoint(void *CheckpointPtr, u8 *WriteTo)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: WriteTo must have room for DllGetCheckpointSize bytes.
+	std::vector<u8> Data;
+	SerializeCheckpoint((model_checkpoint *)CheckpointPtr, Data);
+	memcpy(WriteTo, Data.data(), Data.size());
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void *
+DllDeserializeCheckpoint(u8 *Data, u64 Size)
+{
+	CHECK_ERROR_BEGIN
+	
+	std::unique_ptr<model_checkpoint> Checkpoint(new model_checkpoint());
+	DeserializeCheckpoint(Data, (size_t)Size, Checkpoint.get());
+	return (void *)Checkpoint.release();
+	
+	CHECK_ERROR_END
+	
+	return nullptr;
+}
+
+DLLEXPORT void
+DllDeleteCheckpoint(void *CheckpointPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	delete (model_checkpoint *)CheckpointPtr;
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllSetThreadCount(void *DataSetPtr, u64 ThreadCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	if(ThreadCount == 0)
+		FatalError("ERROR: The thread count must be at least 1.\n");
+	((mobius_data_set *)DataSetPtr)->ThreadCount = (u32)ThreadCount;
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllSetIncrementalRuns(void *DataSetPtr, bool Incremental)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetIncrementalRuns((mobius_data_set *)DataSetPtr, Incremental);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllSetSeriesMajorResults(void *DataSetPtr, bool SeriesMajor)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetSeriesMajorResults((mobius_data_set *)DataSetPtr, SeriesMajor);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllSetSinglePrecisionStorage(void *DataSetPtr, bool Results, bool Inputs)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetSinglePrecisionStorage((mobius_data_set *)DataSetPtr, Results, Inputs);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllSetCompressedResults(void *DataSetPtr, bool Compressed, u64 BlockSize)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetCompressedResults((mobius_data_set *)DataSetPtr, Compressed, (size_t)BlockSize);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllSetMappedStorage(void *DataSetPtr, char *Path)
+{
+	CHECK_ERROR_BEGIN
+	
+	SetMappedStorage((mobius_data_set *)DataSetPtr, Path);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllOpenMappedStorage(void *DataSetPtr, char *Path)
+{
+	CHECK_ERROR_BEGIN
+	
+	OpenMappedStorage((mobius_data_set *)DataSetPtr, Path);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllGetIncrementalRunReport(void *DataSetPtr, u64 *ReportOut)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: Writes the batch groups skipped, the batch group count, the result evaluations skipped and the result evaluation count.
+	const incremental_run_report &Report = GetIncrementalRunReport((mobius_data_set *)DataSetPtr);
+	ReportOut[0] = (u64)Report.BatchGroupsSkipped;
+	ReportOut[1] = (u64)Report.BatchGroupCount;
+	ReportOut[2] = Report.EvaluationsSkipped;
+	ReportOut[3] = Report.EvaluationCount;
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllGetHoistingReport(void *DataSetPtr, u64 *ReportOut)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: Writes the number of hoisted equations, the number of equations, the number of hoisted result values per timestep, the number of result values per timestep, the number of constant equations and the number of constant result values.
+	hoisting_report Report = GetHoistingReport((mobius_data_set *)DataSetPtr);
+	ReportOut[0] = (u64)Report.HoistedEquations;
+	ReportOut[1] = (u64)Report.EquationCount;
+	ReportOut[2] = (u64)Report.HoistedResults;
+	ReportOut[3] = (u64)Report.ResultCount;
+	ReportOut[4] = (u64)Report.ConstantEquations;
+	ReportOut[5] = (u64)Report.ConstantResults;
+	
+	CHECK_ERROR_END
+}
+
 DLLEXPORT void *
 DllCopyDataSet(void *DataSetPtr, bool CopyResults, bool BorrowInputs)
 {
@@ -422,6 +902,37 @@ DllGetResultSeries(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCou
 	CHECK_ERROR_END
 }
 
+DLLEXPORT void
+DllRecordResult(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	RecordResult((mobius_data_set *)DataSetPtr, Name, IndexNames, (size_t)IndexCount);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT void
+DllRecordAllResults(void *DataSetPtr)
+{
+	CHECK_ERROR_BEGIN
+	
+	RecordAllResults((mobius_data_set *)DataSetPtr);
+	
+	CHECK_ERROR_END
+}
+
+DLLEXPORT bool
+DllResultWasRecorded(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount)
+{
+	CHECK_ERROR_BEGIN
+	
+	return ResultWasRecorded((mobius_data_set *)DataSetPtr, Name, IndexNames, (size_t)IndexCount);
+	
+	CHECK_ERROR_END
+	return false;
+}
+
 DLLEXPORT double
 DllGetResultInitialValue(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount)
 {
@@ -453,6 +964,40 @@ DllGetInputSeries(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCoun
 	CHECK_ERROR_END
 }
 
+DLLEXPORT const void *
+DllGetResultSeriesView(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount, u64 *CountOut, u64 *StrideOut, u64 *ElementSizeOut)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: Returns a pointer to the first value of the result series in the storage of the data set, with the number of values, the distance in bytes between them and the size of each (8 for double, 4 for float). Returns nullptr if the series is stored compressed, and has to be copied out with DllGetResultSeries. See GetResultSeriesView for how long the pointer is valid.
+	series_view View = GetResultSeriesView((mobius_data_set *)DataSetPtr, Name, IndexNames, (size_t)IndexCount);
+	*CountOut       = View.Count;
+	*StrideOut      = View.Stride;
+	*ElementSizeOut = View.ElementSize;
+	return View.Data;
+	
+	CHECK_ERROR_END
+	
+	return nullptr;
+}
+
+DLLEXPORT const void *
+DllGetInputSeriesView(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount, bool AlignWithResults, u64 *CountOut, u64 *StrideOut, u64 *ElementSizeOut)
+{
+	CHECK_ERROR_BEGIN
+	
+	//NOTE: Same as DllGetResultSeriesView, but for input series. Returns nullptr if AlignWithResults is set and the model run starts before the input data.
+	series_view View = GetInputSeriesView((mobius_data_set *)DataSetPtr, Name, IndexNames, (size_t)IndexCount, AlignWithResults);
+	*CountOut       = View.Count;
+	*StrideOut      = View.Stride;
+	*ElementSizeOut = View.ElementSize;
+	return View.Data;
+	
+	CHECK_ERROR_END
+	
+	return nullptr;
+}
+
 DLLEXPORT void
 DllSetParameterDouble(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount, double Val)
 {
@@ -727,6 +1272,16 @@ DllWriteInputsToFile(void *DataSetPtr, char *Filename)
 	CHECK_ERROR_END
 }
 
+DLLEXPORT void
+DllWriteInputsToBinaryFile(void *DataSetPtr, char *Filename)
+{
+	CHECK_ERROR_BEGIN
+	
+	WriteInputsToBinaryFile((mobius_data_set *)DataSetPtr, (const char *)Filename);
+	
+	CHECK_ERROR_END
+}
+
 DLLEXPORT void
 DllSetInputSeries(void *DataSetPtr, char *Name, char **IndexNames, u64 IndexCount, double *InputData, u64 InputDataLength, bool AlignWithResults)
 {
@@ -1300,17 +1855,36 @@ DllCopyData(void *SourceDataSetPtr, void *TargetDataSetPtr, bool CopyParams, boo
 		if(!Target->InputStorageStructure.HasBeenSetUp)
 			AllocateInputStorage(Target, Source->InputDataTimesteps);
 		
-		memcpy(Target->InputData, Source->InputData, Source->InputStorageStructure.TotalCount*Source->InputDataTimesteps*sizeof(double));
+		//NOTE: The target gets the input precision of the source, see SetSinglePrecisionStorage.
+		SetSinglePrecisionStorage(Target, Target->SinglePrecisionResults, Source->SingleInputData != nullptr);
+		size_t Count = Source->InputStorageStructure.TotalCount*Source->InputDataTimesteps;
+		if(Source->SingleInputData)
+			memcpy(Target->SingleInputData, Source->SingleInputData, Count*sizeof(float));
+		else
+			memcpy(Target->InputData, Source->InputData, Count*sizeof(double));
+		InputsChanged(Target);
 	}
 	
 	if(CopyResults)
 	{
 		if(!Source->ResultStorageStructure.HasBeenSetUp)
 			FatalError("ERROR (internal): Attempting to copy result data from a dataset where the result data is not allocated");
-		if(!Target->ResultStorageStructure.HasBeenSetUp)
-			AllocateResultStorage(Target, Source->TimestepsLastRun);
+		//NOTE: The target has to record the same results as the source (in the same precision) for the result data to have the same layout.
+		Target->ResultRecording        = Source->ResultRecording;
+		Target->SinglePrecisionResults = !Source->PackedIndex.empty() && !Source->CompressedResults.Active;
+		Target->CompressResults        = Source->CompressedResults.Active;
+		Target->CompressionBlockSize   = Source->CompressionBlockSize;
+		//NOTE: Packed results (see SetupResultRecording) set up their own window, and passing it as a stream window would make the target record only the selected results.
+		AllocateResultStorage(Target, Source->TimestepsLastRun, Source->PackedIndex.empty() ? Source->ResultWindow : 0);
+		if(Target->ResultDataSize != Source->ResultDataSize || Target->RecordedResultDataSize != Source->RecordedResultDataSize || Target->SingleResultDataSize != Source->SingleResultDataSize)
+			FatalError("ERROR: Attempting to copy result data between datasets with different index sets.\n");
 		
-		memcpy(Target->ResultData, Source->ResultData, Source->ResultStorageStructure.TotalCount*(Source->TimestepsLastRun+1)*sizeof(double));
+		memcpy(Target->ResultData, Source->ResultData, Source->ResultDataSize*sizeof(double));
+		if(Source->RecordedResultData)
+			memcpy(Target->RecordedResultData, Source->RecordedResultData, Source->RecordedResultDataSize*sizeof(double));
+		if(Source->SingleResultData)
+			memcpy(Target->SingleResultData, Source->SingleResultData, Source->SingleResultDataSize*sizeof(float));
+		Target->CompressedResults = Source->CompressedResults;
 	}
 	
 	CHECK_ERROR_END